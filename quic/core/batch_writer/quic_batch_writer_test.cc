@@ -4,6 +4,7 @@
 
 #include "quic/core/batch_writer/quic_batch_writer_test.h"
 #include "quic/core/batch_writer/quic_gso_batch_writer.h"
+#include "quic/core/batch_writer/quic_io_uring_batch_writer.h"
 #include "quic/core/batch_writer/quic_sendmmsg_batch_writer.h"
 
 namespace quic {
@@ -72,6 +73,35 @@ INSTANTIATE_TEST_SUITE_P(
     testing::ValuesIn(MakeQuicBatchWriterTestParams<
                       QuicSendmmsgBatchWriterIOTestDelegate>()));
 
+class QuicIoUringBatchWriterIOTestDelegate
+    : public QuicUdpBatchWriterIOTestDelegate {
+ public:
+  bool ShouldSkip(const QuicUdpBatchWriterIOTestParams& /*params*/) override {
+    if (!QuicIoUring::IsSupported()) {
+      QUIC_LOG(WARNING) << "Test skipped since io_uring is not supported.";
+      return true;
+    }
+    return false;
+  }
+
+  void ResetWriter(int fd) override {
+    writer_ = QuicIoUringBatchWriter::Create(
+        std::make_unique<QuicBatchWriterBuffer>(), fd, /*completion_fd=*/-1);
+    ASSERT_NE(nullptr, writer_);
+  }
+
+  QuicUdpBatchWriter* GetWriter() override { return writer_.get(); }
+
+ private:
+  std::unique_ptr<QuicIoUringBatchWriter> writer_;
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    QuicIoUringBatchWriterTest,
+    QuicUdpBatchWriterIOTest,
+    testing::ValuesIn(MakeQuicBatchWriterTestParams<
+                      QuicIoUringBatchWriterIOTestDelegate>()));
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
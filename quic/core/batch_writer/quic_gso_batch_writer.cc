@@ -28,7 +28,8 @@ QuicGsoBatchWriter::QuicGsoBatchWriter(int fd,
       supports_release_time_(
           GetQuicRestartFlag(quic_support_release_time_for_gso) &&
           QuicLinuxSocketUtils::EnableReleaseTime(fd,
-                                                  clockid_for_release_time)) {
+                                                  clockid_for_release_time)),
+      max_release_time_spread_ns_(GetMaxReleaseTimeSpread()) {
   if (supports_release_time_) {
     QUIC_RESTART_FLAG_COUNT(quic_support_release_time_for_gso);
     QUIC_LOG_FIRST_N(INFO, 5) << "Release time is enabled.";
@@ -44,7 +45,8 @@ QuicGsoBatchWriter::QuicGsoBatchWriter(
     ReleaseTimeForceEnabler /*enabler*/)
     : QuicUdpBatchWriter(std::move(batch_buffer), fd),
       clockid_for_release_time_(clockid_for_release_time),
-      supports_release_time_(true) {
+      supports_release_time_(true),
+      max_release_time_spread_ns_(GetMaxReleaseTimeSpread()) {
   QUIC_DLOG(INFO) << "Release time forcefully enabled.";
 }
 
@@ -70,7 +72,8 @@ QuicGsoBatchWriter::CanBatchResult QuicGsoBatchWriter::CanBatch(
   // [3] Already buffered writes all have the same length.
   // [4] Length of already buffered writes must >= length of the new write.
   // [5] The new packet can be released without delay, or it has the same
-  //     release time as buffered writes.
+  //     release time as buffered writes, which GetReleaseTime() gives paced
+  //     packets close to them.
   const BufferedWrite& first = buffered_writes().front();
   const BufferedWrite& last = buffered_writes().back();
   // Whether this packet can be sent without delay, regardless of release time.
@@ -129,10 +132,34 @@ QuicGsoBatchWriter::ReleaseTime QuicGsoBatchWriter::GetReleaseTime(
     return result;
   }
 
+  if (max_release_time_spread_ns_ > 0 && !buffered_writes().empty()) {
+    // The pacer spreads the packets of a burst over a short period. Releasing
+    // the ones close to the buffered packets with them sends them in a single
+    // GSO packet, at the cost of a bounded pacing error.
+    const uint64_t batch_release_time = buffered_writes().back().release_time;
+    const uint64_t spread = batch_release_time > ideal_release_time
+                                ? batch_release_time - ideal_release_time
+                                : ideal_release_time - batch_release_time;
+    if (batch_release_time >= now && spread <= max_release_time_spread_ns_) {
+      QUIC_RESTART_FLAG_COUNT(quic_gso_batch_paced_packets);
+      const int64_t offset_ns = batch_release_time - ideal_release_time;
+      return {batch_release_time,
+              QuicTime::Delta::FromMicroseconds(offset_ns / 1000)};
+    }
+  }
+
   // Send according to the release time delay.
   return {ideal_release_time, QuicTime::Delta::Zero()};
 }
 
+// static
+uint64_t QuicGsoBatchWriter::GetMaxReleaseTimeSpread() {
+  if (!GetQuicRestartFlag(quic_gso_batch_paced_packets)) {
+    return 0;
+  }
+  return GetQuicFlag(FLAGS_quic_gso_max_release_time_spread_us) * 1000;
+}
+
 uint64_t QuicGsoBatchWriter::NowInNanosForReleaseTime() const {
   struct timespec ts;
 
@@ -108,8 +108,16 @@ class QUIC_EXPORT_PRIVATE QuicGsoBatchWriter : public QuicUdpBatchWriter {
  private:
   static std::unique_ptr<QuicBatchWriterBuffer> CreateBatchWriterBuffer();
 
+  // Returns FLAGS_quic_gso_max_release_time_spread_us in nanoseconds if
+  // quic_restart_flag_quic_gso_batch_paced_packets is true, 0 otherwise.
+  static uint64_t GetMaxReleaseTimeSpread();
+
   const clockid_t clockid_for_release_time_;
   const bool supports_release_time_;
+  // Max difference between the ideal release time of a packet and the release
+  // time of the batch it joins. Zero if only packets which may be sent without
+  // delay join a batch with a different ideal release time.
+  const uint64_t max_release_time_spread_ns_;
 };
 
 }  // namespace quic
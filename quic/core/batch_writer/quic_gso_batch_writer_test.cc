@@ -4,12 +4,16 @@
 
 #include "quic/core/batch_writer/quic_gso_batch_writer.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <limits>
 #include <memory>
 #include <utility>
 
+#include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_ip_address.h"
+#include "quic/platform/api/quic_logging.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/quic_mock_syscall_wrapper.h"
 
@@ -467,6 +471,102 @@ TEST_F(QuicGsoBatchWriterTest, ReleaseTime) {
   EXPECT_EQ(result.send_time_offset, QuicTime::Delta::Zero());
 }
 
+TEST_F(QuicGsoBatchWriterTest, PacedPacketsShareBatch) {
+  SetQuicRestartFlag(quic_gso_batch_paced_packets, true);
+  SetQuicFlag(FLAGS_quic_gso_max_release_time_spread_us, 250);
+  const WriteResult write_buffered(WRITE_STATUS_OK, 0);
+  auto writer = TestQuicGsoBatchWriter::NewInstanceWithReleaseTimeSupport();
+  TestPerPacketOptions options;
+
+  // The 1st packet has no delay.
+  WriteResult result = WritePacketWithOptions(writer.get(), &options);
+  ASSERT_EQ(write_buffered, result);
+  EXPECT_EQ(MillisToNanos(1), writer->buffered_writes().back().release_time);
+
+  // The 2nd packet is paced 200us later, and is released with the 1st.
+  options.release_time_delay = QuicTime::Delta::FromMicroseconds(200);
+  result = WritePacketWithOptions(writer.get(), &options);
+  ASSERT_EQ(write_buffered, result);
+  EXPECT_EQ(MillisToNanos(1), writer->buffered_writes().back().release_time);
+  EXPECT_EQ(QuicTime::Delta::FromMicroseconds(-200), result.send_time_offset);
+
+  // The 3rd packet is paced too far from the batch, which is flushed.
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, _))
+      .WillOnce(Invoke([](int /*sockfd*/, const msghdr* msg, int /*flags*/) {
+        EXPECT_EQ(2700u, PacketLength(msg));
+        errno = 0;
+        return 0;
+      }));
+  options.release_time_delay = QuicTime::Delta::FromMicroseconds(400);
+  result = WritePacketWithOptions(writer.get(), &options);
+  ASSERT_EQ(WriteResult(WRITE_STATUS_OK, 2700), result);
+  EXPECT_EQ(MillisToNanos(1) + 400000,
+            writer->buffered_writes().back().release_time);
+  EXPECT_EQ(QuicTime::Delta::Zero(), result.send_time_offset);
+
+  // The 4th packet joins the new batch.
+  options.release_time_delay = QuicTime::Delta::FromMicroseconds(500);
+  result = WritePacketWithOptions(writer.get(), &options);
+  ASSERT_EQ(write_buffered, result);
+  EXPECT_EQ(2u, writer->buffered_writes().size());
+  EXPECT_EQ(QuicTime::Delta::FromMicroseconds(-100), result.send_time_offset);
+}
+
+// Simulates a connection paced at several rates, which writes the packets due
+// in the next millisecond every millisecond, and logs the number of sendmsg
+// calls per MB and the pacing error for several max release time spreads.
+TEST_F(QuicGsoBatchWriterTest, DISABLED_PacedSyscallsPerMegabyte) {
+  const size_t kPacketSize = 1350;
+  const int kDurationMs = 200;
+  size_t num_syscalls = 0;
+  EXPECT_CALL(mock_syscalls_, Sendmsg(_, _, _))
+      .WillRepeatedly(
+          Invoke([&num_syscalls](int /*sockfd*/, const msghdr* msg,
+                                 int /*flags*/) {
+            ++num_syscalls;
+            return PacketLength(msg);
+          }));
+
+  for (uint64_t rate_mbps : {10, 100, 1000}) {
+    const uint64_t interval_ns = kPacketSize * 8 * 1000 / rate_mbps;
+    for (uint64_t spread_us : {0, 50, 250, 1000}) {
+      SetQuicRestartFlag(quic_gso_batch_paced_packets, spread_us > 0);
+      SetQuicFlag(FLAGS_quic_gso_max_release_time_spread_us, spread_us);
+      auto writer =
+          TestQuicGsoBatchWriter::NewInstanceWithReleaseTimeSupport();
+      num_syscalls = 0;
+      uint64_t num_packets = 0;
+      uint64_t total_error_us = 0;
+      int64_t max_error_us = 0;
+      uint64_t next_release_time = MillisToNanos(1);
+      for (int now_ms = 1; now_ms <= kDurationMs; ++now_ms) {
+        writer->ForceReleaseTimeMs(now_ms);
+        while (next_release_time < MillisToNanos(now_ms + 1)) {
+          TestPerPacketOptions options;
+          options.release_time_delay = QuicTime::Delta::FromMicroseconds(
+              (next_release_time - MillisToNanos(now_ms)) / 1000);
+          WriteResult result = writer->WritePacket(
+              &packet_buffer_[0], kPacketSize, self_address_, peer_address_,
+              &options);
+          ASSERT_FALSE(IsWriteError(result.status));
+          const int64_t error_us = result.send_time_offset.ToMicroseconds();
+          total_error_us += std::abs(error_us);
+          max_error_us = std::max(max_error_us, std::abs(error_us));
+          ++num_packets;
+          next_release_time += interval_ns;
+        }
+        ASSERT_FALSE(IsWriteError(writer->Flush().status));
+      }
+      const double megabytes = num_packets * kPacketSize / 1e6;
+      QUIC_LOG(INFO) << rate_mbps << " Mbps, max spread " << spread_us
+                     << "us: " << num_syscalls / megabytes
+                     << " sendmsg/MB, mean pacing error "
+                     << total_error_us / num_packets << "us, max "
+                     << max_error_us << "us";
+    }
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
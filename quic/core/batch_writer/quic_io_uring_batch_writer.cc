@@ -0,0 +1,231 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/batch_writer/quic_io_uring_batch_writer.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "quic/platform/api/quic_flag_utils.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+#if QUIC_IO_URING_SUPPORTED
+
+// static
+std::unique_ptr<QuicIoUringBatchWriter> QuicIoUringBatchWriter::Create(
+    std::unique_ptr<QuicBatchWriterBuffer> batch_buffer,
+    int fd,
+    int completion_fd) {
+  if (!QuicIoUring::IsSupported()) {
+    return nullptr;
+  }
+  std::unique_ptr<QuicIoUring> ring =
+      QuicIoUring::Create(kIoUringWriterQueueSize);
+  if (ring == nullptr ||
+      (completion_fd >= 0 && !ring->RegisterEventFd(completion_fd))) {
+    return nullptr;
+  }
+  return std::unique_ptr<QuicIoUringBatchWriter>(new QuicIoUringBatchWriter(
+      std::move(batch_buffer), fd, std::move(ring)));
+}
+
+QuicIoUringBatchWriter::QuicIoUringBatchWriter(
+    std::unique_ptr<QuicBatchWriterBuffer> batch_buffer,
+    int fd,
+    std::unique_ptr<QuicIoUring> ring)
+    : QuicUdpBatchWriter(std::move(batch_buffer), fd),
+      ring_(std::move(ring)),
+      num_pending_completions_(0) {}
+
+QuicIoUringBatchWriter::~QuicIoUringBatchWriter() {
+  // The kernel may still read the msghdrs and the buffered packets.
+  while (num_pending_completions_ > 0) {
+    int rc = ring_->Submit(/*min_complete=*/num_pending_completions_);
+    if (rc < 0) {
+      QUIC_LOG(ERROR) << "Failed to wait for io_uring completions: "
+                      << strerror(-rc);
+      break;
+    }
+    ReapCompletions();
+  }
+}
+
+QuicIoUringBatchWriter::CanBatchResult QuicIoUringBatchWriter::CanBatch(
+    const char* /*buffer*/,
+    size_t /*buf_len*/,
+    const QuicIpAddress& /*self_address*/,
+    const QuicSocketAddress& /*peer_address*/,
+    const PerPacketOptions* /*options*/,
+    uint64_t /*release_time*/) const {
+  return CanBatchResult(/*can_batch=*/true, /*must_flush=*/false);
+}
+
+QuicIoUringBatchWriter::FlushImplResult QuicIoUringBatchWriter::FlushImpl() {
+  QUICHE_DCHECK(!IsWriteBlocked());
+  QUICHE_DCHECK(!buffered_writes().empty());
+
+  FlushImplResult result = {WriteResult(WRITE_STATUS_OK, 0),
+                            /*num_packets_sent=*/0, /*bytes_written=*/0};
+  WriteResult& write_result = result.write_result;
+
+  while (chain_mhdr_ != nullptr || !buffered_writes().empty()) {
+    if (chain_mhdr_ == nullptr) {
+      const auto first = buffered_writes().cbegin();
+      const auto last =
+          first + std::min<size_t>(kIoUringWriterQueueSize,
+                                   buffered_writes().size());
+      write_result = SubmitChain(first, last);
+      if (write_result.status != WRITE_STATUS_OK) {
+        break;
+      }
+    }
+
+    ReapCompletions();
+    if (num_pending_completions_ > 0) {
+      // The packets stay buffered, and are popped by the flush after the
+      // completion signal.
+      QUIC_CODE_COUNT(quic_io_uring_batch_writer_pending_completions);
+      write_result = WriteResult(WRITE_STATUS_BLOCKED, EAGAIN);
+      break;
+    }
+
+    // Popping moves the remaining buffered writes, which is only safe once no
+    // request refers to them anymore.
+    FlushImplResult chain_result = FinishChain();
+    batch_buffer().PopBufferedWrite(chain_result.num_packets_sent);
+    result.num_packets_sent += chain_result.num_packets_sent;
+    result.bytes_written += chain_result.bytes_written;
+    write_result = chain_result.write_result;
+    if (write_result.status != WRITE_STATUS_OK) {
+      break;
+    }
+  }
+
+  if (write_result.status != WRITE_STATUS_OK) {
+    return result;
+  }
+
+  QUIC_BUG_IF(quic_io_uring_batch_writer_not_empty, !buffered_writes().empty())
+      << "All packets should have been written on a successful return";
+  write_result.bytes_written = result.bytes_written;
+  return result;
+}
+
+template <typename IteratorT>
+WriteResult QuicIoUringBatchWriter::SubmitChain(const IteratorT& first,
+                                                const IteratorT& last) {
+  QUICHE_DCHECK(chain_mhdr_ == nullptr);
+  auto mhdr = std::make_unique<QuicMMsgHdr>(
+      first, last, kCmsgSpaceForIp,
+      [](QuicMMsgHdr* mhdr, int i, const BufferedWrite& buffered_write) {
+        mhdr->SetIpInNextCmsg(i, buffered_write.self_address);
+      });
+  const int num_msgs = mhdr->num_msgs();
+  for (int i = 0; i < num_msgs; ++i) {
+    io_uring_sqe* sqe = ring_->GetSqe();
+    if (sqe == nullptr) {
+      QUIC_BUG(quic_io_uring_batch_writer_sq_full)
+          << "io_uring submission queue full.";
+      return WriteResult(WRITE_STATUS_ERROR, ENOBUFS);
+    }
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd();
+    sqe->addr = reinterpret_cast<uint64_t>(&mhdr->mhdr()[i].msg_hdr);
+    sqe->len = 1;
+    // Fail with EAGAIN rather than waiting for the socket to become writable.
+    sqe->msg_flags = MSG_DONTWAIT;
+    sqe->user_data = i;
+    if (i + 1 < num_msgs) {
+      sqe->flags = IOSQE_IO_LINK;
+    }
+  }
+
+  int rc = ring_->Submit(/*min_complete=*/0);
+  if (rc < 0) {
+    return WriteResult(WRITE_STATUS_ERROR, -rc);
+  }
+  chain_mhdr_ = std::move(mhdr);
+  chain_results_.assign(num_msgs, -ECANCELED);
+  num_pending_completions_ = num_msgs;
+  return WriteResult(WRITE_STATUS_OK, 0);
+}
+
+void QuicIoUringBatchWriter::ReapCompletions() {
+  // Completions may arrive out of order, they are collected until all of them
+  // are available to determine how many packets were sent in order.
+  while (num_pending_completions_ > 0) {
+    io_uring_cqe* cqe = ring_->PeekCqe();
+    if (cqe == nullptr) {
+      return;
+    }
+    if (cqe->user_data < chain_results_.size()) {
+      chain_results_[cqe->user_data] = cqe->res;
+    }
+    ring_->AdvanceCq();
+    --num_pending_completions_;
+  }
+}
+
+QuicIoUringBatchWriter::FlushImplResult QuicIoUringBatchWriter::FinishChain() {
+  QUICHE_DCHECK_EQ(0, num_pending_completions_);
+  FlushImplResult result = {WriteResult(WRITE_STATUS_OK, 0),
+                            /*num_packets_sent=*/0, /*bytes_written=*/0};
+  for (int res : chain_results_) {
+    if (res < 0) {
+      const int error = -res;
+      result.write_result = WriteResult(
+          (error == EAGAIN || error == EWOULDBLOCK) ? WRITE_STATUS_BLOCKED
+                                                    : WRITE_STATUS_ERROR,
+          error);
+      break;
+    }
+    ++result.num_packets_sent;
+    result.bytes_written += res;
+  }
+  if (result.write_result.status == WRITE_STATUS_OK) {
+    result.write_result.bytes_written = result.bytes_written;
+  }
+  QUIC_DVLOG(1) << "io_uring sent " << result.num_packets_sent << " out of "
+                << chain_results_.size()
+                << " packets. WriteResult=" << result.write_result;
+  chain_mhdr_.reset();
+  chain_results_.clear();
+  return result;
+}
+
+#else  // QUIC_IO_URING_SUPPORTED
+
+// static
+std::unique_ptr<QuicIoUringBatchWriter> QuicIoUringBatchWriter::Create(
+    std::unique_ptr<QuicBatchWriterBuffer> /*batch_buffer*/,
+    int /*fd*/,
+    int /*completion_fd*/) {
+  return nullptr;
+}
+
+QuicIoUringBatchWriter::~QuicIoUringBatchWriter() = default;
+
+QuicIoUringBatchWriter::CanBatchResult QuicIoUringBatchWriter::CanBatch(
+    const char* /*buffer*/,
+    size_t /*buf_len*/,
+    const QuicIpAddress& /*self_address*/,
+    const QuicSocketAddress& /*peer_address*/,
+    const PerPacketOptions* /*options*/,
+    uint64_t /*release_time*/) const {
+  return CanBatchResult(/*can_batch=*/false, /*must_flush=*/true);
+}
+
+QuicIoUringBatchWriter::FlushImplResult QuicIoUringBatchWriter::FlushImpl() {
+  return {WriteResult(WRITE_STATUS_ERROR, ENOSYS), /*num_packets_sent=*/0,
+          /*bytes_written=*/0};
+}
+
+#endif  // QUIC_IO_URING_SUPPORTED
+
+}  // namespace quic
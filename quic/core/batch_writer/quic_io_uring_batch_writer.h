@@ -0,0 +1,83 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_IO_URING_BATCH_WRITER_H_
+#define QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_IO_URING_BATCH_WRITER_H_
+
+#include <memory>
+#include <vector>
+
+#include "quic/core/batch_writer/quic_batch_writer_base.h"
+#include "quic/core/quic_io_uring.h"
+#include "quic/core/quic_linux_socket_utils.h"
+
+namespace quic {
+
+// Maximum number of sendmsg requests submitted per io_uring_enter call.
+const uint32_t kIoUringWriterQueueSize = 64;
+
+// QuicIoUringBatchWriter sends QUIC packets in batches by submitting one linked
+// chain of sendmsg requests to an io_uring. Linking the requests preserves the
+// packet order: if one of them fails, e.g. because the socket is write
+// blocked, all following requests in the chain are cancelled, which matches the
+// partial write semantics of sendmmsg.
+//
+// The writer never waits for completions. Requests on a non-blocking socket
+// almost always complete while they are submitted; if some do not, the writer
+// reports WRITE_STATUS_BLOCKED and keeps the packets buffered until they
+// complete, which is signalled on |completion_fd|.
+class QUIC_EXPORT_PRIVATE QuicIoUringBatchWriter : public QuicUdpBatchWriter {
+ public:
+  // Returns nullptr if io_uring is not supported, in which case the caller
+  // should use a QuicSendmmsgBatchWriter or QuicGsoBatchWriter instead.
+  // |completion_fd| is an eventfd which is signalled when requests complete
+  // after being submitted. The caller should watch it, and call SetWritable()
+  // and flush the writer when it is readable. If negative, completions are
+  // only picked up by the next flush.
+  static std::unique_ptr<QuicIoUringBatchWriter> Create(
+      std::unique_ptr<QuicBatchWriterBuffer> batch_buffer,
+      int fd,
+      int completion_fd);
+
+  ~QuicIoUringBatchWriter() override;
+
+  CanBatchResult CanBatch(const char* buffer,
+                          size_t buf_len,
+                          const QuicIpAddress& self_address,
+                          const QuicSocketAddress& peer_address,
+                          const PerPacketOptions* options,
+                          uint64_t release_time) const override;
+
+  FlushImplResult FlushImpl() override;
+
+ private:
+  QuicIoUringBatchWriter(std::unique_ptr<QuicBatchWriterBuffer> batch_buffer,
+                         int fd,
+                         std::unique_ptr<QuicIoUring> ring);
+
+  // Submits the buffered writes in [first, last) as one linked chain, without
+  // waiting for their completions. |last| - |first| must not exceed
+  // kIoUringWriterQueueSize.
+  template <typename IteratorT>
+  WriteResult SubmitChain(const IteratorT& first, const IteratorT& last);
+
+  // Consumes the available completions of the submitted chain.
+  void ReapCompletions();
+
+  // Returns the number of packets of the completed chain which were sent in
+  // order, and the result of the first one which was not.
+  FlushImplResult FinishChain();
+
+  std::unique_ptr<QuicIoUring> ring_;
+  // The msghdrs of the submitted chain, which must stay valid until all its
+  // requests complete. nullptr if no chain is in flight.
+  std::unique_ptr<QuicMMsgHdr> chain_mhdr_;
+  // The result of each request of the chain, by position.
+  std::vector<int> chain_results_;
+  int num_pending_completions_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_BATCH_WRITER_QUIC_IO_URING_BATCH_WRITER_H_
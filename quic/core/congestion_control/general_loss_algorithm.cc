@@ -4,6 +4,8 @@
 
 #include "quic/core/congestion_control/general_loss_algorithm.h"
 
+#include <limits>
+
 #include "quic/core/congestion_control/rtt_stats.h"
 #include "quic/core/quic_packets.h"
 #include "quic/platform/api/quic_bug_tracker.h"
@@ -81,6 +83,17 @@ LossDetectionInterface::DetectionStats GeneralLossAlgorithm::DetectLosses(
   least_in_flight_.Clear();
   QUICHE_DCHECK_EQ(packet_number_space_,
                    unacked_packets.GetPacketNumberSpace(largest_newly_acked));
+  // Packet threshold loss detection is skipped for packets larger than the
+  // largest newly acked packet, unless use_packet_threshold_for_runt_packets_.
+  QuicPacketLength largest_newly_acked_bytes_sent =
+      std::numeric_limits<QuicPacketLength>::max();
+  if (!use_packet_threshold_for_runt_packets_ &&
+      it != unacked_packets.end() && packet_number <= largest_newly_acked) {
+    largest_newly_acked_bytes_sent =
+        unacked_packets.GetTransmissionInfo(largest_newly_acked).bytes_sent;
+  }
+  // Only notify parent_ of reordering once per call.
+  bool reordering_detected = false;
   for (; it != unacked_packets.end() && packet_number <= largest_newly_acked;
        ++it, ++packet_number) {
     if (unacked_packets.GetPacketNumberSpace(it->encryption_level) !=
@@ -93,7 +106,9 @@ LossDetectionInterface::DetectionStats GeneralLossAlgorithm::DetectLosses(
       continue;
     }
 
-    if (parent_ != nullptr && largest_newly_acked != packet_number) {
+    if (parent_ != nullptr && !reordering_detected &&
+        largest_newly_acked != packet_number) {
+      reordering_detected = true;
       parent_->OnReorderingDetected();
     }
 
@@ -106,9 +121,7 @@ LossDetectionInterface::DetectionStats GeneralLossAlgorithm::DetectLosses(
     // Packet threshold loss detection.
     // Skip packet threshold loss detection if largest_newly_acked is a runt.
     const bool skip_packet_threshold_detection =
-        !use_packet_threshold_for_runt_packets_ &&
-        it->bytes_sent >
-            unacked_packets.GetTransmissionInfo(largest_newly_acked).bytes_sent;
+        it->bytes_sent > largest_newly_acked_bytes_sent;
     if (!skip_packet_threshold_detection &&
         largest_newly_acked - packet_number >= reordering_threshold_) {
       packets_lost->push_back(LostPacket(packet_number, it->bytes_sent));
@@ -0,0 +1,585 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/congestion_control/pcc_sender.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "quic/core/congestion_control/rtt_stats.h"
+#include "quic/core/quic_constants.h"
+#include "quic/core/quic_time_accumulator.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+// The minimum congestion window, which keeps delayed acks from stalling the
+// connection. The congestion window does not limit the sending rate
+// otherwise.
+const QuicByteCount kMinimumCongestionWindow = 4 * kMaxSegmentSize;
+// The congestion window is this many times the bytes sent at the sending rate
+// in a minimum RTT, so that it only limits sending when acks stop arriving or
+// the queue at the bottleneck grows deep.
+const float kCongestionWindowGain = 2.0f;
+// The size of the bandwidth filter window, in round-trips.
+const QuicRoundTripCount kBandwidthWindowSize = 10;
+// The sending rate never drops below this.
+const QuicBandwidth kMinSendingRate = QuicBandwidth::FromKBitsPerSecond(16);
+
+// A monitor interval lasts at least a smoothed RTT, and long enough to send
+// this many packets.
+const QuicPacketCount kMinPacketsPerMonitorInterval = 10;
+// Intervals which are not complete after this many more intervals are sent
+// are given up on.
+const size_t kMaxMonitorIntervals = 100;
+
+// The probing intervals are sent at (1 + kProbingStep) and (1 - kProbingStep)
+// times the sending rate.
+const double kProbingStep = 0.05;
+
+// The utility of an interval sent at x Mbps is
+//   x^kSendingRateExponent - kRttGradientCoefficient * x * rtt_gradient
+//       - kLossCoefficient * x * loss_rate.
+const double kSendingRateExponent = 0.9;
+const double kRttGradientCoefficient = 900;
+const double kLossCoefficient = 11.35;
+// RTT gradients smaller than this are considered noise.
+const double kRttGradientTolerance = 0.01;
+
+// The rate change of a decision is kRateChangeGain Mbps per unit of utility
+// gradient, times the confidence amplifier.
+const double kRateChangeGain = 2.0;
+// A rate change is bounded to (kInitialRateChangeBound +
+// kRateChangeBoundStep * k) times the sending rate, where k is the number of
+// consecutive bounded changes, up to kMaxRateChangeBound.
+const double kInitialRateChangeBound = 0.05;
+const double kRateChangeBoundStep = 0.05;
+const double kMaxRateChangeBound = 0.3;
+
+double ToMbps(QuicBandwidth bandwidth) {
+  return bandwidth.ToBitsPerSecond() / 1e6;
+}
+}  // namespace
+
+PccSender::DebugState::DebugState(const PccSender& sender)
+    : mode(sender.mode_),
+      sending_rate(sender.sending_rate_),
+      max_bandwidth(sender.max_bandwidth_.GetBest()),
+      round_trip_count(sender.round_trip_count_),
+      num_monitor_intervals(sender.monitor_intervals_.size()),
+      rate_change_amplifier(sender.rate_change_amplifier_),
+      rate_change_bound_count(sender.rate_change_bound_count_) {}
+
+PccSender::DebugState::DebugState(const DebugState& state) = default;
+
+PccSender::PccSender(QuicTime now,
+                     const RttStats* rtt_stats,
+                     const QuicUnackedPacketMap* unacked_packets,
+                     QuicPacketCount initial_tcp_congestion_window,
+                     QuicPacketCount max_tcp_congestion_window,
+                     QuicRandom* random,
+                     QuicConnectionStats* stats)
+    : rtt_stats_(rtt_stats),
+      unacked_packets_(unacked_packets),
+      random_(random),
+      stats_(stats),
+      mode_(STARTING),
+      sampler_(unacked_packets, kBandwidthWindowSize),
+      max_bandwidth_(kBandwidthWindowSize, QuicBandwidth::Zero(), 0),
+      round_trip_count_(0),
+      sending_rate_(QuicBandwidth::FromBytesAndTimeDelta(
+          initial_tcp_congestion_window * kDefaultTCPMSS,
+          rtt_stats->SmoothedOrInitialRtt())),
+      initial_sending_rate_(sending_rate_),
+      min_congestion_window_(kMinimumCongestionWindow),
+      max_congestion_window_(max_tcp_congestion_window * kDefaultTCPMSS),
+      has_last_utility_(false),
+      last_utility_(0),
+      last_sending_rate_(QuicBandwidth::Zero()),
+      num_probing_intervals_sent_(0),
+      probe_faster_first_(true),
+      has_faster_utility_(false),
+      faster_utility_(0),
+      has_slower_utility_(false),
+      slower_utility_(0),
+      last_rate_change_direction_(0),
+      rate_change_amplifier_(0),
+      rate_change_bound_count_(0) {
+  if (stats_) {
+    // Reset the startup stats if |stats_| has been used by another sender,
+    // which happens e.g. when QuicConnection switch send algorithms. STARTING
+    // is accounted for as slow start.
+    stats_->slowstart_count = 1;
+    stats_->slowstart_duration = QuicTimeAccumulator();
+    stats_->slowstart_duration.Start(now);
+  }
+}
+
+PccSender::~PccSender() {}
+
+bool PccSender::InSlowStart() const {
+  return mode_ == STARTING;
+}
+
+bool PccSender::InRecovery() const {
+  return false;
+}
+
+bool PccSender::ShouldSendProbingPacket() const {
+  return false;
+}
+
+void PccSender::SetFromConfig(const QuicConfig& /*config*/,
+                              Perspective /*perspective*/) {}
+
+void PccSender::ApplyConnectionOptions(
+    const QuicTagVector& /*connection_options*/) {}
+
+void PccSender::AdjustNetworkParameters(const NetworkParams& params) {
+  if (mode_ != STARTING || params.bandwidth.IsZero()) {
+    return;
+  }
+  if (params.allow_cwnd_to_decrease) {
+    sending_rate_ = params.bandwidth;
+  } else {
+    sending_rate_ = std::max(sending_rate_, params.bandwidth);
+  }
+}
+
+void PccSender::SetInitialCongestionWindowInPackets(
+    QuicPacketCount congestion_window) {
+  if (mode_ != STARTING || !monitor_intervals_.empty()) {
+    return;
+  }
+  initial_sending_rate_ = QuicBandwidth::FromBytesAndTimeDelta(
+      congestion_window * kDefaultTCPMSS, rtt_stats_->SmoothedOrInitialRtt());
+  sending_rate_ = initial_sending_rate_;
+}
+
+void PccSender::OnCongestionEvent(bool rtt_updated,
+                                  QuicByteCount /*prior_in_flight*/,
+                                  QuicTime event_time,
+                                  const AckedPacketVector& acked_packets,
+                                  const LostPacketVector& lost_packets) {
+  if (!acked_packets.empty()) {
+    UpdateRoundTripCounter(acked_packets.rbegin()->packet_number);
+  }
+
+  BandwidthSamplerInterface::CongestionEventSample sample =
+      sampler_.OnCongestionEvent(event_time, acked_packets, lost_packets,
+                                 max_bandwidth_.GetBest(),
+                                 QuicBandwidth::Infinite(), round_trip_count_);
+  if (!sample.sample_max_bandwidth.IsZero() &&
+      (!sample.sample_is_app_limited ||
+       sample.sample_max_bandwidth > max_bandwidth_.GetBest())) {
+    max_bandwidth_.Update(sample.sample_max_bandwidth, round_trip_count_);
+  }
+  sampler_.RemoveObsoletePackets(unacked_packets_->GetLeastUnacked());
+
+  for (const AckedPacket& packet : acked_packets) {
+    MonitorInterval* interval = GetMonitorInterval(packet.packet_number);
+    if (interval != nullptr) {
+      interval->bytes_acked +=
+          interval->RemoveOutstandingPacket(packet.packet_number);
+    }
+  }
+  for (const LostPacket& packet : lost_packets) {
+    MonitorInterval* interval = GetMonitorInterval(packet.packet_number);
+    if (interval != nullptr) {
+      interval->bytes_lost +=
+          interval->RemoveOutstandingPacket(packet.packet_number);
+    }
+  }
+
+  if (rtt_updated && !acked_packets.empty()) {
+    // The RTT sample is taken by the largest acked packet, and is attributed
+    // to the time that packet was sent.
+    MonitorInterval* interval =
+        GetMonitorInterval(acked_packets.rbegin()->packet_number);
+    if (interval != nullptr) {
+      const QuicTime::Delta latest_rtt = rtt_stats_->latest_rtt();
+      const double time =
+          (event_time - latest_rtt - interval->start_time).ToMicroseconds() /
+          1e6;
+      const double rtt = latest_rtt.ToMicroseconds() / 1e6;
+      ++interval->num_rtt_samples;
+      interval->sum_times += time;
+      interval->sum_rtts += rtt;
+      interval->sum_squared_times += time * time;
+      interval->sum_time_rtt_products += time * rtt;
+    }
+  }
+
+  ProcessCompletedMonitorIntervals(event_time);
+}
+
+void PccSender::OnPacketSent(QuicTime sent_time,
+                             QuicByteCount bytes_in_flight,
+                             QuicPacketNumber packet_number,
+                             QuicByteCount bytes,
+                             HasRetransmittableData is_retransmittable) {
+  if (stats_ && InSlowStart()) {
+    ++stats_->slowstart_packets_sent;
+    stats_->slowstart_bytes_sent += bytes;
+  }
+
+  last_sent_packet_ = packet_number;
+  sampler_.OnPacketSent(sent_time, packet_number, bytes, bytes_in_flight,
+                        is_retransmittable);
+
+  if (is_retransmittable != HAS_RETRANSMITTABLE_DATA) {
+    return;
+  }
+  if (monitor_intervals_.empty() ||
+      sent_time >= monitor_intervals_.back().end_time) {
+    StartMonitorInterval(sent_time);
+  }
+  MonitorInterval& interval = monitor_intervals_.back();
+  if (!interval.first_packet_number.IsInitialized()) {
+    interval.first_packet_number = packet_number;
+  }
+  interval.last_packet_number = packet_number;
+  interval.outstanding_packet_bytes.resize(
+      packet_number - interval.first_packet_number + 1, 0);
+  interval.outstanding_packet_bytes.back() =
+      static_cast<QuicPacketLength>(bytes);
+  interval.bytes_sent += bytes;
+}
+
+void PccSender::OnPacketNeutered(QuicPacketNumber packet_number) {
+  sampler_.OnPacketNeutered(packet_number);
+  // Packets are neutered after they are removed from the bytes in flight, so
+  // the bytes they were sent with are taken from the interval.
+  MonitorInterval* interval = GetMonitorInterval(packet_number);
+  if (interval != nullptr) {
+    interval->bytes_neutered +=
+        interval->RemoveOutstandingPacket(packet_number);
+  }
+}
+
+void PccSender::OnConnectionMigration() {
+  mode_ = STARTING;
+  sending_rate_ = initial_sending_rate_;
+  monitor_intervals_.clear();
+  has_last_utility_ = false;
+  last_rate_change_direction_ = 0;
+  rate_change_amplifier_ = 0;
+  rate_change_bound_count_ = 0;
+  max_bandwidth_.Reset(QuicBandwidth::Zero(), round_trip_count_);
+}
+
+bool PccSender::CanSend(QuicByteCount bytes_in_flight) {
+  return bytes_in_flight < GetCongestionWindow();
+}
+
+QuicBandwidth PccSender::PacingRate(QuicByteCount /*bytes_in_flight*/) const {
+  if (monitor_intervals_.empty()) {
+    return sending_rate_;
+  }
+  return monitor_intervals_.back().sending_rate;
+}
+
+QuicBandwidth PccSender::BandwidthEstimate() const {
+  return max_bandwidth_.GetBest();
+}
+
+QuicByteCount PccSender::GetCongestionWindow() const {
+  const QuicByteCount congestion_window =
+      kCongestionWindowGain *
+      PacingRate(0).ToBytesPerPeriod(rtt_stats_->MinOrInitialRtt());
+  return std::min(std::max(congestion_window, min_congestion_window_),
+                  max_congestion_window_);
+}
+
+QuicByteCount PccSender::GetSlowStartThreshold() const {
+  return 0;
+}
+
+CongestionControlType PccSender::GetCongestionControlType() const {
+  return kPCC;
+}
+
+std::string PccSender::GetDebugState() const {
+  std::ostringstream stream;
+  stream << ExportDebugState();
+  return stream.str();
+}
+
+void PccSender::OnApplicationLimited(QuicByteCount bytes_in_flight) {
+  if (bytes_in_flight >= GetCongestionWindow()) {
+    return;
+  }
+
+  sampler_.OnAppLimited();
+  // The current interval does not tell what its rate is worth.
+  if (!monitor_intervals_.empty()) {
+    monitor_intervals_.back().is_app_limited = true;
+  }
+  QUIC_DVLOG(2) << "Becoming application limited. Last sent packet: "
+                << last_sent_packet_ << ", sending rate: " << sending_rate_;
+}
+
+void PccSender::PopulateConnectionStats(QuicConnectionStats* stats) const {
+  stats->num_ack_aggregation_epochs = sampler_.num_ack_aggregation_epochs();
+}
+
+PccSender::DebugState PccSender::ExportDebugState() const {
+  return DebugState(*this);
+}
+
+double PccSender::MonitorInterval::RttGradient() const {
+  if (num_rtt_samples < 2) {
+    return 0;
+  }
+  const double n = num_rtt_samples;
+  const double denominator = n * sum_squared_times - sum_times * sum_times;
+  if (denominator <= 0) {
+    return 0;
+  }
+  return (n * sum_time_rtt_products - sum_times * sum_rtts) / denominator;
+}
+
+QuicByteCount PccSender::MonitorInterval::RemoveOutstandingPacket(
+    QuicPacketNumber packet_number) {
+  QUICHE_DCHECK(first_packet_number.IsInitialized() &&
+                first_packet_number <= packet_number &&
+                packet_number <= last_packet_number);
+  QuicPacketLength& bytes =
+      outstanding_packet_bytes[packet_number - first_packet_number];
+  const QuicByteCount removed_bytes = bytes;
+  bytes = 0;
+  return removed_bytes;
+}
+
+PccSender::MonitorInterval* PccSender::GetMonitorInterval(
+    QuicPacketNumber packet_number) {
+  for (MonitorInterval& interval : monitor_intervals_) {
+    if (interval.first_packet_number.IsInitialized() &&
+        interval.first_packet_number <= packet_number &&
+        packet_number <= interval.last_packet_number) {
+      return &interval;
+    }
+  }
+  return nullptr;
+}
+
+void PccSender::StartMonitorInterval(QuicTime now) {
+  MonitorInterval interval;
+  interval.start_time = now;
+  if (mode_ == STARTING) {
+    interval.sending_rate = sending_rate_;
+    interval.is_useful = true;
+  } else if (num_probing_intervals_sent_ < 2) {
+    const bool faster =
+        probe_faster_first_ == (num_probing_intervals_sent_ == 0);
+    interval.sending_rate =
+        sending_rate_ * (faster ? 1 + kProbingStep : 1 - kProbingStep);
+    interval.is_useful = true;
+    ++num_probing_intervals_sent_;
+  } else {
+    // Keep sending at the sending rate until both probing intervals are
+    // complete.
+    interval.sending_rate = sending_rate_;
+  }
+  const QuicTime::Delta duration =
+      std::max(rtt_stats_->SmoothedOrInitialRtt(),
+               interval.sending_rate.TransferTime(
+                   kMinPacketsPerMonitorInterval * kMaxSegmentSize));
+  interval.end_time = now + duration;
+  monitor_intervals_.push_back(interval);
+
+  if (monitor_intervals_.size() > kMaxMonitorIntervals) {
+    QUIC_DVLOG(1) << "Giving up on a monitor interval which is not complete.";
+    monitor_intervals_.pop_front();
+    if (mode_ == PROBING) {
+      RestartProbing();
+    }
+  }
+}
+
+void PccSender::ProcessCompletedMonitorIntervals(QuicTime now) {
+  while (!monitor_intervals_.empty()) {
+    const MonitorInterval& interval = monitor_intervals_.front();
+    // Packets can still be sent in the last interval until it ends.
+    if (interval.bytes_acked + interval.bytes_lost + interval.bytes_neutered <
+            interval.bytes_sent ||
+        (monitor_intervals_.size() == 1 && now < interval.end_time)) {
+      return;
+    }
+    const MonitorInterval completed = interval;
+    monitor_intervals_.pop_front();
+    if (!completed.is_useful) {
+      continue;
+    }
+    if (completed.is_app_limited || completed.bytes_sent == 0) {
+      if (mode_ == PROBING) {
+        RestartProbing();
+      }
+      continue;
+    }
+    OnUtilityAvailable(completed, ComputeUtility(completed), now);
+  }
+}
+
+double PccSender::ComputeUtility(const MonitorInterval& interval) const {
+  const double sending_rate = ToMbps(interval.sending_rate);
+  double rtt_gradient = interval.RttGradient();
+  if (std::abs(rtt_gradient) < kRttGradientTolerance) {
+    rtt_gradient = 0;
+  }
+  const QuicByteCount bytes_delivered =
+      interval.bytes_acked + interval.bytes_lost;
+  const double loss_rate =
+      bytes_delivered == 0
+          ? 0
+          : static_cast<double>(interval.bytes_lost) / bytes_delivered;
+  const double utility =
+      std::pow(sending_rate, kSendingRateExponent) -
+      kRttGradientCoefficient * sending_rate * rtt_gradient -
+      kLossCoefficient * sending_rate * loss_rate;
+  QUIC_DVLOG(2) << "Utility of interval at " << interval.sending_rate << ": "
+                << utility << ", RTT gradient: " << rtt_gradient
+                << ", loss rate: " << loss_rate;
+  return utility;
+}
+
+void PccSender::OnUtilityAvailable(const MonitorInterval& interval,
+                                   double utility,
+                                   QuicTime now) {
+  if (mode_ == STARTING) {
+    // Intervals sent before the rate was last doubled tell nothing new.
+    if (has_last_utility_ && interval.sending_rate <= last_sending_rate_) {
+      return;
+    }
+    if (!has_last_utility_ || utility > last_utility_) {
+      has_last_utility_ = true;
+      last_utility_ = utility;
+      last_sending_rate_ = interval.sending_rate;
+      sending_rate_ = std::max(sending_rate_, interval.sending_rate * 2);
+      return;
+    }
+    // Fall back to the last rate whose utility increased if the path has not
+    // delivered anything yet.
+    sending_rate_ = last_sending_rate_;
+    EnterProbing(now);
+    return;
+  }
+
+  if (interval.sending_rate > sending_rate_) {
+    has_faster_utility_ = true;
+    faster_utility_ = utility;
+  } else {
+    has_slower_utility_ = true;
+    slower_utility_ = utility;
+  }
+  if (has_faster_utility_ && has_slower_utility_) {
+    MakeRateDecision();
+  }
+}
+
+void PccSender::MakeRateDecision() {
+  const double sending_rate = ToMbps(sending_rate_);
+  const double gradient = (faster_utility_ - slower_utility_) /
+                          (2 * kProbingStep * sending_rate);
+  const int direction = gradient > 0 ? 1 : -1;
+  if (direction != last_rate_change_direction_) {
+    last_rate_change_direction_ = direction;
+    rate_change_amplifier_ = 0;
+    rate_change_bound_count_ = 0;
+  }
+
+  // The confidence in the direction grows with every decision which agrees
+  // with the previous ones.
+  ++rate_change_amplifier_;
+  const double amplifier = rate_change_amplifier_ <= 3
+                               ? rate_change_amplifier_
+                               : 2 * rate_change_amplifier_ - 3;
+  double rate_change = amplifier * kRateChangeGain * gradient;
+
+  const double bound =
+      std::min(kInitialRateChangeBound +
+                   kRateChangeBoundStep * rate_change_bound_count_,
+               kMaxRateChangeBound) *
+      sending_rate;
+  if (std::abs(rate_change) > bound) {
+    ++rate_change_bound_count_;
+    rate_change = direction * bound;
+  }
+
+  sending_rate_ = std::max(
+      QuicBandwidth::FromBitsPerSecond((sending_rate + rate_change) * 1e6),
+      kMinSendingRate);
+  QUIC_DVLOG(1) << "Utility gradient " << gradient << ", new sending rate "
+                << sending_rate_;
+  RestartProbing();
+}
+
+void PccSender::EnterProbing(QuicTime now) {
+  mode_ = PROBING;
+  if (stats_) {
+    stats_->slowstart_duration.Stop(now);
+  }
+  if (!max_bandwidth_.GetBest().IsZero()) {
+    sending_rate_ = max_bandwidth_.GetBest();
+  }
+  sending_rate_ = std::max(sending_rate_, kMinSendingRate);
+  QUIC_DVLOG(1) << "Utility dropped, probing from " << sending_rate_;
+  RestartProbing();
+}
+
+void PccSender::RestartProbing() {
+  num_probing_intervals_sent_ = 0;
+  probe_faster_first_ = random_->RandUint64() % 2 == 0;
+  has_faster_utility_ = false;
+  has_slower_utility_ = false;
+  for (MonitorInterval& interval : monitor_intervals_) {
+    interval.is_useful = false;
+  }
+}
+
+bool PccSender::UpdateRoundTripCounter(QuicPacketNumber last_acked_packet) {
+  if (!current_round_trip_end_.IsInitialized() ||
+      last_acked_packet > current_round_trip_end_) {
+    round_trip_count_++;
+    current_round_trip_end_ = last_sent_packet_;
+    if (stats_ && InSlowStart()) {
+      ++stats_->slowstart_num_rtts;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+static std::string ModeToString(PccSender::Mode mode) {
+  switch (mode) {
+    case PccSender::STARTING:
+      return "STARTING";
+    case PccSender::PROBING:
+      return "PROBING";
+  }
+  return "???";
+}
+
+std::ostream& operator<<(std::ostream& os, const PccSender::Mode& mode) {
+  os << ModeToString(mode);
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const PccSender::DebugState& state) {
+  os << "Mode: " << ModeToString(state.mode) << std::endl;
+  os << "Sending rate: " << state.sending_rate << std::endl;
+  os << "Maximum bandwidth: " << state.max_bandwidth << std::endl;
+  os << "Round trip counter: " << state.round_trip_count << std::endl;
+  os << "Monitor intervals: " << state.num_monitor_intervals << std::endl;
+  os << "Rate change amplifier: " << state.rate_change_amplifier << std::endl;
+  os << "Rate change bound count: " << state.rate_change_bound_count
+     << std::endl;
+  return os;
+}
+
+}  // namespace quic
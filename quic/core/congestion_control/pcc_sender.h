@@ -0,0 +1,270 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// PCC Vivace (Performance-oriented Congestion Control) congestion control
+// algorithm.
+
+#ifndef QUICHE_QUIC_CORE_CONGESTION_CONTROL_PCC_SENDER_H_
+#define QUICHE_QUIC_CORE_CONGESTION_CONTROL_PCC_SENDER_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "quic/core/congestion_control/bandwidth_sampler.h"
+#include "quic/core/congestion_control/send_algorithm_interface.h"
+#include "quic/core/congestion_control/windowed_filter.h"
+#include "quic/core/crypto/quic_random.h"
+#include "quic/core/quic_bandwidth.h"
+#include "quic/core/quic_packet_number.h"
+#include "quic/core/quic_packets.h"
+#include "quic/core/quic_time.h"
+#include "quic/core/quic_unacked_packet_map.h"
+#include "quic/platform/api/quic_export.h"
+#include "common/quiche_circular_deque.h"
+
+namespace quic {
+
+class RttStats;
+
+// PccSender implements PCC Vivace. Instead of reacting to individual packet
+// losses, PCC paces packets at a fixed rate for the duration of a monitor
+// interval, about one round trip, and computes the utility of that rate from
+// the loss rate and the RTT gradient the acks of the interval show. The rate
+// is then moved in the direction which increases the utility. Since random
+// losses cost little utility, PCC keeps its rate on lossy links where loss
+// based algorithms back off, while the RTT gradient keeps it from filling
+// shallow buffers.
+//
+// PCC relies on pacing in order to function properly. Do not use PCC when
+// pacing is disabled.
+class QUIC_EXPORT_PRIVATE PccSender : public SendAlgorithmInterface {
+ public:
+  enum Mode {
+    // Double the sending rate every time the utility of an interval increases,
+    // until it drops.
+    STARTING,
+    // Compare the utility of sending slightly faster and slightly slower than
+    // the sending rate, and move the rate along the utility gradient.
+    PROBING,
+  };
+
+  // Debug state can be exported in order to troubleshoot potential congestion
+  // control issues.
+  struct QUIC_EXPORT_PRIVATE DebugState {
+    explicit DebugState(const PccSender& sender);
+    DebugState(const DebugState& state);
+
+    Mode mode;
+    QuicBandwidth sending_rate;
+    QuicBandwidth max_bandwidth;
+    QuicRoundTripCount round_trip_count;
+    size_t num_monitor_intervals;
+    // Number of consecutive rate changes in the same direction.
+    int64_t rate_change_amplifier;
+    // Number of consecutive rate changes which were limited in size.
+    int64_t rate_change_bound_count;
+  };
+
+  PccSender(QuicTime now,
+            const RttStats* rtt_stats,
+            const QuicUnackedPacketMap* unacked_packets,
+            QuicPacketCount initial_tcp_congestion_window,
+            QuicPacketCount max_tcp_congestion_window,
+            QuicRandom* random,
+            QuicConnectionStats* stats);
+  PccSender(const PccSender&) = delete;
+  PccSender& operator=(const PccSender&) = delete;
+  ~PccSender() override;
+
+  // Start implementation of SendAlgorithmInterface.
+  bool InSlowStart() const override;
+  bool InRecovery() const override;
+  bool ShouldSendProbingPacket() const override;
+
+  void SetFromConfig(const QuicConfig& config,
+                     Perspective perspective) override;
+  void ApplyConnectionOptions(const QuicTagVector& connection_options) override;
+
+  void AdjustNetworkParameters(const NetworkParams& params) override;
+  void SetInitialCongestionWindowInPackets(
+      QuicPacketCount congestion_window) override;
+  void OnCongestionEvent(bool rtt_updated,
+                         QuicByteCount prior_in_flight,
+                         QuicTime event_time,
+                         const AckedPacketVector& acked_packets,
+                         const LostPacketVector& lost_packets) override;
+  void OnPacketSent(QuicTime sent_time,
+                    QuicByteCount bytes_in_flight,
+                    QuicPacketNumber packet_number,
+                    QuicByteCount bytes,
+                    HasRetransmittableData is_retransmittable) override;
+  void OnPacketNeutered(QuicPacketNumber packet_number) override;
+  void OnRetransmissionTimeout(bool /*packets_retransmitted*/) override {}
+  void OnConnectionMigration() override;
+  bool CanSend(QuicByteCount bytes_in_flight) override;
+  QuicBandwidth PacingRate(QuicByteCount bytes_in_flight) const override;
+  QuicBandwidth BandwidthEstimate() const override;
+  QuicByteCount GetCongestionWindow() const override;
+  QuicByteCount GetSlowStartThreshold() const override;
+  CongestionControlType GetCongestionControlType() const override;
+  std::string GetDebugState() const override;
+  void OnApplicationLimited(QuicByteCount bytes_in_flight) override;
+  void PopulateConnectionStats(QuicConnectionStats* stats) const override;
+  // End implementation of SendAlgorithmInterface.
+
+  DebugState ExportDebugState() const;
+
+ private:
+  using MaxBandwidthFilter = WindowedFilter<QuicBandwidth,
+                                            MaxFilter<QuicBandwidth>,
+                                            QuicRoundTripCount,
+                                            QuicRoundTripCount>;
+
+  // The packets sent at one rate, and what their acks tell about that rate.
+  struct QUIC_NO_EXPORT MonitorInterval {
+    // Returns the slope of the linear regression of the RTT samples over the
+    // time they were taken, in seconds of RTT per second.
+    double RttGradient() const;
+
+    // Returns the bytes |packet_number| was sent with if it is still
+    // outstanding, and stops tracking it. Returns 0 otherwise, so that a
+    // packet is only accounted for once, whether it is acked, lost or
+    // neutered.
+    QuicByteCount RemoveOutstandingPacket(QuicPacketNumber packet_number);
+
+    QuicBandwidth sending_rate = QuicBandwidth::Zero();
+    // Whether the utility of the interval adjusts the sending rate.
+    bool is_useful = false;
+    // Whether the connection was application limited during the interval, in
+    // which case the sending rate was not used in full.
+    bool is_app_limited = false;
+    QuicTime start_time = QuicTime::Zero();
+    // Packets sent at or after |end_time| belong to the next interval.
+    QuicTime end_time = QuicTime::Zero();
+    QuicPacketNumber first_packet_number;
+    QuicPacketNumber last_packet_number;
+    // The bytes each packet from |first_packet_number| to
+    // |last_packet_number| was sent with, recorded at send time, or 0 once the
+    // packet is acked, lost or neutered. Packets without retransmittable data
+    // are not tracked.
+    std::vector<QuicPacketLength> outstanding_packet_bytes;
+    // The interval is complete once all the bytes sent are acked, lost or
+    // neutered.
+    QuicByteCount bytes_sent = 0;
+    QuicByteCount bytes_acked = 0;
+    QuicByteCount bytes_lost = 0;
+    QuicByteCount bytes_neutered = 0;
+    // Sums for the linear regression of the RTT samples, with times in
+    // seconds since |start_time|.
+    size_t num_rtt_samples = 0;
+    double sum_times = 0;
+    double sum_rtts = 0;
+    double sum_squared_times = 0;
+    double sum_time_rtt_products = 0;
+  };
+
+  // Returns the interval which |packet_number| was sent in, or nullptr if it
+  // was sent outside of any interval still being monitored.
+  MonitorInterval* GetMonitorInterval(QuicPacketNumber packet_number);
+
+  // Starts a new monitor interval at |now|, at a rate which depends on the
+  // mode.
+  void StartMonitorInterval(QuicTime now);
+
+  // Removes the completed intervals from the front of |monitor_intervals_|,
+  // and adjusts the sending rate by the utility of the useful ones.
+  void ProcessCompletedMonitorIntervals(QuicTime now);
+
+  // Returns the utility of |interval|, which must be complete.
+  double ComputeUtility(const MonitorInterval& interval) const;
+
+  void OnUtilityAvailable(const MonitorInterval& interval,
+                          double utility,
+                          QuicTime now);
+
+  // Moves the sending rate along the utility gradient measured by the two
+  // probing intervals.
+  void MakeRateDecision();
+
+  // Leaves STARTING for PROBING, at a rate the path is known to deliver.
+  void EnterProbing(QuicTime now);
+
+  // Restarts probing at the current sending rate. The results of intervals
+  // which are still being monitored are ignored.
+  void RestartProbing();
+
+  // Updates the round-trip counter if a round-trip has passed. Returns true if
+  // the counter has been advanced.
+  bool UpdateRoundTripCounter(QuicPacketNumber last_acked_packet);
+
+  const RttStats* rtt_stats_;
+  const QuicUnackedPacketMap* unacked_packets_;
+  QuicRandom* random_;
+  QuicConnectionStats* stats_;
+
+  Mode mode_;
+
+  // Bandwidth sampler provides the delivery rate of the path, which is where
+  // PROBING starts.
+  BandwidthSampler sampler_;
+  // The filter that tracks the maximum bandwidth over the multiple recent
+  // round-trips.
+  MaxBandwidthFilter max_bandwidth_;
+
+  // The number of the round trips that have occurred during the connection.
+  QuicRoundTripCount round_trip_count_;
+  // The packet number of the most recently sent packet.
+  QuicPacketNumber last_sent_packet_;
+  // Acknowledgement of any packet after |current_round_trip_end_| will cause
+  // the round trip counter to advance.
+  QuicPacketNumber current_round_trip_end_;
+
+  // The intervals whose packets are not all acked or lost yet, oldest first.
+  // The last one is the one new packets are sent in.
+  quiche::QuicheCircularDeque<MonitorInterval> monitor_intervals_;
+
+  // The rate intervals are sent at. In PROBING, the probing intervals are sent
+  // slightly faster and slower than this.
+  QuicBandwidth sending_rate_;
+  QuicBandwidth initial_sending_rate_;
+  const QuicByteCount min_congestion_window_;
+  const QuicByteCount max_congestion_window_;
+
+  // The utility and sending rate of the last useful interval in STARTING. The
+  // sending rate is doubled each time the utility increases.
+  bool has_last_utility_;
+  double last_utility_;
+  QuicBandwidth last_sending_rate_;
+
+  // Number of probing intervals sent since probing last (re)started, in
+  // PROBING.
+  int num_probing_intervals_sent_;
+  // Whether the first probing interval is sent faster than |sending_rate_|.
+  bool probe_faster_first_;
+  // The utilities of the faster and the slower probing intervals, once known.
+  bool has_faster_utility_;
+  double faster_utility_;
+  bool has_slower_utility_;
+  double slower_utility_;
+
+  // Direction of the last rate change; 1 for increases, -1 for decreases and
+  // 0 before the first one.
+  int last_rate_change_direction_;
+  // Number of consecutive rate changes in the same direction.
+  int64_t rate_change_amplifier_;
+  // Number of consecutive rate changes which were limited in size.
+  int64_t rate_change_bound_count_;
+};
+
+QUIC_EXPORT_PRIVATE std::ostream& operator<<(std::ostream& os,
+                                             const PccSender::Mode& mode);
+QUIC_EXPORT_PRIVATE std::ostream& operator<<(
+    std::ostream& os,
+    const PccSender::DebugState& state);
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CONGESTION_CONTROL_PCC_SENDER_H_
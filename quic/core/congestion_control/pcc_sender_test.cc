@@ -0,0 +1,360 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/congestion_control/pcc_sender.h"
+
+#include <memory>
+#include <string>
+
+#include "quic/core/congestion_control/rtt_stats.h"
+#include "quic/core/congestion_control/send_algorithm_interface.h"
+#include "quic/core/quic_bandwidth.h"
+#include "quic/core/quic_connection_stats.h"
+#include "quic/core/quic_packet_number.h"
+#include "quic/core/quic_time.h"
+#include "quic/core/quic_types.h"
+#include "quic/core/quic_unacked_packet_map.h"
+#include "quic/platform/api/quic_flags.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/mock_clock.h"
+#include "quic/test_tools/quic_connection_peer.h"
+#include "quic/test_tools/quic_sent_packet_manager_peer.h"
+#include "quic/test_tools/quic_test_utils.h"
+#include "quic/test_tools/simulator/link.h"
+#include "quic/test_tools/simulator/quic_endpoint.h"
+#include "quic/test_tools/simulator/random_loss_filter.h"
+#include "quic/test_tools/simulator/simulator.h"
+#include "quic/test_tools/simulator/switch.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// The tests use the following network topology:
+//
+//            Sender
+//               |
+//               |  <-- local link
+//               |
+//        Network switch
+//               *  <-- the bottleneck queue in the direction
+//               |          of the receiver
+//               *  <-- random loss of the packets to the receiver
+//               |
+//               |  <-- test link
+//               |
+//           Receiver
+const QuicBandwidth kLocalLinkBandwidth =
+    QuicBandwidth::FromKBitsPerSecond(10000);
+const QuicTime::Delta kLocalLinkDelay = QuicTime::Delta::FromMilliseconds(2);
+const QuicBandwidth kTestLinkBandwidth =
+    QuicBandwidth::FromKBitsPerSecond(4000);
+const QuicTime::Delta kTestLinkDelay = QuicTime::Delta::FromMilliseconds(30);
+const QuicTime::Delta kRtt = 2 * (kLocalLinkDelay + kTestLinkDelay);
+// The bottleneck queue holds two BDPs.
+const QuicByteCount kSwitchQueueCapacity = 2 * (kTestLinkBandwidth * kRtt);
+
+// Use the initial CWND of 10, as 32 is too much for the test network.
+const QuicPacketCount kInitialCwndPackets = 10;
+const QuicByteCount kTransferSize = 4 * 1024 * 1024;
+const QuicTime::Delta kTransferTimeout = QuicTime::Delta::FromSeconds(60);
+// The interval at which the bottleneck queue is sampled.
+const QuicTime::Delta kQueueSampleInterval =
+    QuicTime::Delta::FromMilliseconds(10);
+
+const char* CongestionControlTypeToString(CongestionControlType cc_type) {
+  switch (cc_type) {
+    case kCubicBytes:
+      return "CUBIC_BYTES";
+    case kBBR:
+      return "BBR";
+    case kBBRv2:
+      return "BBRv2";
+    case kPCC:
+      return "PCC";
+    default:
+      return "UNEXPECTED";
+  }
+}
+
+struct TransferResult {
+  bool completed = false;
+  QuicBandwidth goodput = QuicBandwidth::Zero();
+  QuicTime::Delta average_queueing_delay = QuicTime::Delta::Zero();
+};
+
+class PccSenderTest : public QuicTest {
+ protected:
+  PccSenderTest() {
+    // Prevent the server(receiver), which only sends acks, from closing
+    // connection due to too many outstanding packets.
+    SetQuicFlag(FLAGS_quic_max_tracked_packet_count, 1000000);
+  }
+
+  // Transfers |kTransferSize| bytes over the test network, which drops
+  // |loss_rate| of the packets to the receiver, using |cc_type| congestion
+  // control. Each transfer runs in a fresh simulation with the same seed.
+  TransferResult DoTransfer(CongestionControlType cc_type, float loss_rate) {
+    SimpleRandom random;
+    random.set_seed(kRandomSeed);
+    simulator::Simulator simulator(&random);
+    simulator::QuicEndpoint sender(&simulator, "Sender", "Receiver",
+                                   Perspective::IS_CLIENT,
+                                   TestConnectionId(42));
+    simulator::QuicEndpoint receiver(&simulator, "Receiver", "Sender",
+                                     Perspective::IS_SERVER,
+                                     TestConnectionId(42));
+    simulator::Switch network_switch(&simulator, "Switch", 8,
+                                     kSwitchQueueCapacity);
+    simulator::RandomLossFilter loss_filter(&simulator, "Loss filter",
+                                            network_switch.port(2), loss_rate);
+    simulator::SymmetricLink sender_link(&sender, network_switch.port(1),
+                                         kLocalLinkBandwidth, kLocalLinkDelay);
+    simulator::SymmetricLink receiver_link(&receiver, &loss_filter,
+                                           kTestLinkBandwidth, kTestLinkDelay);
+
+    QuicConnection* connection = sender.connection();
+    // Ownership of the sender will be overtaken by the endpoint.
+    SendAlgorithmInterface* send_algorithm = SendAlgorithmInterface::Create(
+        connection->clock(), connection->sent_packet_manager().GetRttStats(),
+        QuicSentPacketManagerPeer::GetUnackedPacketMap(
+            QuicConnectionPeer::GetSentPacketManager(connection)),
+        cc_type, &random, QuicConnectionPeer::GetStats(connection),
+        kInitialCwndPackets, /*old_send_algorithm=*/nullptr);
+    QuicConnectionPeer::SetSendAlgorithm(connection, send_algorithm);
+    const int kTestMaxPacketSize = 1350;
+    connection->SetMaxPacketLength(kTestMaxPacketSize);
+
+    const QuicTime start_time = simulator.GetClock()->Now();
+    const QuicTime deadline = start_time + kTransferTimeout;
+    sender.AddBytesToTransfer(kTransferSize);
+    QuicTime::Delta total_queueing_delay = QuicTime::Delta::Zero();
+    int64_t num_queue_samples = 0;
+    while (receiver.bytes_received() < kTransferSize &&
+           simulator.GetClock()->Now() < deadline) {
+      simulator.RunFor(kQueueSampleInterval);
+      total_queueing_delay =
+          total_queueing_delay +
+          kTestLinkBandwidth.TransferTime(
+              network_switch.port_queue(2)->bytes_queued());
+      ++num_queue_samples;
+    }
+
+    TransferResult result;
+    result.completed = receiver.bytes_received() >= kTransferSize;
+    result.goodput = QuicBandwidth::FromBytesAndTimeDelta(
+        receiver.bytes_received(), simulator.GetClock()->Now() - start_time);
+    if (num_queue_samples > 0) {
+      result.average_queueing_delay =
+          total_queueing_delay * (1.0 / num_queue_samples);
+    }
+    QUIC_LOG(INFO) << CongestionControlTypeToString(cc_type) << " with "
+                   << loss_rate * 100 << "% loss: goodput " << result.goodput
+                   << ", average queueing delay "
+                   << result.average_queueing_delay;
+    if (cc_type == kPCC) {
+      QUIC_LOG(INFO) << "PCC state: "
+                     << static_cast<PccSender*>(send_algorithm)
+                            ->ExportDebugState();
+    }
+    return result;
+  }
+
+  static constexpr uint64_t kRandomSeed = 42;
+};
+
+TEST_F(PccSenderTest, SimpleTransfer) {
+  TransferResult result = DoTransfer(kPCC, /*loss_rate=*/0);
+  EXPECT_TRUE(result.completed);
+  EXPECT_LE(kTestLinkBandwidth * 0.8f, result.goodput);
+  // PCC backs off when the RTT starts growing, rather than when the queue
+  // overflows.
+  EXPECT_GT(kRtt, result.average_queueing_delay);
+}
+
+// PCC does not mistake random loss for congestion.
+TEST_F(PccSenderTest, RandomLoss) {
+  const float kLossRate = 0.02f;
+  TransferResult pcc = DoTransfer(kPCC, kLossRate);
+  EXPECT_TRUE(pcc.completed);
+  EXPECT_LE(kTestLinkBandwidth * 0.7f, pcc.goodput);
+  EXPECT_GT(kRtt, pcc.average_queueing_delay);
+
+  // The results of the others are logged for comparison.
+  TransferResult cubic = DoTransfer(kCubicBytes, kLossRate);
+  EXPECT_LT(cubic.goodput, pcc.goodput);
+  DoTransfer(kBBR, kLossRate);
+  DoTransfer(kBBRv2, kLossRate);
+}
+
+// Drives a PccSender directly, one monitor interval at a time. No RTT samples
+// are taken, so the utility of an interval only depends on its sending rate
+// and loss rate.
+class PccSenderMonitorIntervalTest : public QuicTest {
+ protected:
+  PccSenderMonitorIntervalTest()
+      : unacked_packets_(Perspective::IS_CLIENT), bytes_in_flight_(0) {
+    clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
+    rtt_stats_.UpdateRtt(kRtt, QuicTime::Delta::Zero(), clock_.Now());
+    sender_ = std::make_unique<PccSender>(
+        clock_.Now(), &rtt_stats_, &unacked_packets_, kInitialCwndPackets,
+        kMaxCwndPackets, &random_, &stats_);
+  }
+
+  // Sends the packets of a new monitor interval, and advances the clock to
+  // the end of the interval. Returns the rate the interval is sent at.
+  QuicBandwidth SendMonitorInterval() {
+    QuicBandwidth sending_rate = QuicBandwidth::Zero();
+    for (QuicPacketCount i = 0; i < kPacketsPerInterval; ++i) {
+      sender_->OnPacketSent(clock_.Now(), bytes_in_flight_,
+                            QuicPacketNumber(++last_sent_packet_),
+                            kDefaultTCPMSS, HAS_RETRANSMITTABLE_DATA);
+      bytes_in_flight_ += kDefaultTCPMSS;
+      if (i == 0) {
+        sending_rate = sender_->PacingRate(bytes_in_flight_);
+      }
+    }
+    clock_.AdvanceTime(std::max(
+        kRtt,
+        sending_rate.TransferTime(kPacketsPerInterval * kDefaultTCPMSS)));
+    return sending_rate;
+  }
+
+  // Acks the packets from |first| to |last|, except for the last |num_lost|
+  // of them, which are lost.
+  void AckPackets(uint64_t first, uint64_t last, uint64_t num_lost) {
+    AckedPacketVector acked_packets;
+    LostPacketVector lost_packets;
+    for (uint64_t packet_number = first; packet_number <= last;
+         ++packet_number) {
+      if (packet_number + num_lost > last) {
+        lost_packets.push_back(
+            LostPacket(QuicPacketNumber(packet_number), kDefaultTCPMSS));
+      } else {
+        acked_packets.push_back(AckedPacket(QuicPacketNumber(packet_number),
+                                            kDefaultTCPMSS, QuicTime::Zero()));
+      }
+    }
+    const QuicByteCount prior_in_flight = bytes_in_flight_;
+    bytes_in_flight_ -= (last - first + 1) * kDefaultTCPMSS;
+    sender_->OnCongestionEvent(/*rtt_updated=*/false, prior_in_flight,
+                               clock_.Now(), acked_packets, lost_packets);
+  }
+
+  // Leaves STARTING by doubling the sending rate once, and losing half of the
+  // packets sent at the doubled rate.
+  void EnterProbing() {
+    SendMonitorInterval();
+    AckPackets(last_sent_packet_ - kPacketsPerInterval + 1, last_sent_packet_,
+               0);
+    SendMonitorInterval();
+    AckPackets(last_sent_packet_ - kPacketsPerInterval + 1, last_sent_packet_,
+               kPacketsPerInterval / 2);
+    ASSERT_EQ(PccSender::PROBING, sender_->ExportDebugState().mode);
+  }
+
+  // Sends both probing intervals and acks them, losing half of the packets of
+  // the faster one if |lose_faster| is true.
+  void ProbeAndDecide(bool lose_faster) {
+    const QuicBandwidth sending_rate = sender_->ExportDebugState().sending_rate;
+    const QuicBandwidth first_rate = SendMonitorInterval();
+    const QuicBandwidth second_rate = SendMonitorInterval();
+    // One of the probing intervals is sent faster than the sending rate, and
+    // the other one slower.
+    EXPECT_LT(std::min(first_rate, second_rate), sending_rate);
+    EXPECT_GT(std::max(first_rate, second_rate), sending_rate);
+    const bool first_is_faster = first_rate > second_rate;
+    const uint64_t first_packet = last_sent_packet_ - 2 * kPacketsPerInterval;
+    AckPackets(first_packet + 1, first_packet + kPacketsPerInterval,
+               lose_faster && first_is_faster ? kPacketsPerInterval / 2 : 0);
+    AckPackets(first_packet + kPacketsPerInterval + 1, last_sent_packet_,
+               lose_faster && !first_is_faster ? kPacketsPerInterval / 2 : 0);
+  }
+
+  static constexpr QuicPacketCount kMaxCwndPackets = 2000;
+  // The number of packets sent in each monitor interval.
+  static constexpr QuicPacketCount kPacketsPerInterval = 10;
+
+  MockClock clock_;
+  RttStats rtt_stats_;
+  QuicUnackedPacketMap unacked_packets_;
+  SimpleRandom random_;
+  QuicConnectionStats stats_;
+  std::unique_ptr<PccSender> sender_;
+  uint64_t last_sent_packet_ = 0;
+  QuicByteCount bytes_in_flight_;
+};
+
+TEST_F(PccSenderMonitorIntervalTest, NeuteredPacketCompletesInterval) {
+  const QuicBandwidth initial_rate = SendMonitorInterval();
+  EXPECT_EQ(1u, sender_->ExportDebugState().num_monitor_intervals);
+
+  // Neutered packets are no longer in flight, and are never acked or lost.
+  sender_->OnPacketNeutered(QuicPacketNumber(kPacketsPerInterval));
+  AckPackets(1, kPacketsPerInterval - 1, 0);
+  EXPECT_EQ(0u, sender_->ExportDebugState().num_monitor_intervals);
+  // The utility of the interval doubled the sending rate.
+  EXPECT_EQ(initial_rate * 2, sender_->ExportDebugState().sending_rate);
+}
+
+TEST_F(PccSenderMonitorIntervalTest, PacketsAreOnlyAccountedForOnce) {
+  SendMonitorInterval();
+  sender_->OnPacketNeutered(QuicPacketNumber(1));
+  AckPackets(1, 1, 0);
+  // The first packet completes nothing, whether it is neutered or acked.
+  EXPECT_EQ(1u, sender_->ExportDebugState().num_monitor_intervals);
+  AckPackets(2, kPacketsPerInterval, 0);
+  EXPECT_EQ(0u, sender_->ExportDebugState().num_monitor_intervals);
+}
+
+TEST_F(PccSenderMonitorIntervalTest, StartingEntersProbingWhenUtilityDrops) {
+  const QuicBandwidth initial_rate = SendMonitorInterval();
+  EXPECT_TRUE(sender_->InSlowStart());
+  AckPackets(1, kPacketsPerInterval, 0);
+  EXPECT_EQ(PccSender::STARTING, sender_->ExportDebugState().mode);
+  EXPECT_EQ(initial_rate * 2, sender_->ExportDebugState().sending_rate);
+
+  // Losing half of the packets sent at the doubled rate lowers the utility.
+  EXPECT_EQ(initial_rate * 2, SendMonitorInterval());
+  AckPackets(kPacketsPerInterval + 1, 2 * kPacketsPerInterval,
+             kPacketsPerInterval / 2);
+  EXPECT_EQ(PccSender::PROBING, sender_->ExportDebugState().mode);
+  EXPECT_FALSE(sender_->InSlowStart());
+  // Probing starts from the bandwidth the path delivered.
+  EXPECT_LT(sender_->ExportDebugState().sending_rate, initial_rate * 2);
+}
+
+TEST_F(PccSenderMonitorIntervalTest, RateDecisionFollowsUtilityGradient) {
+  EnterProbing();
+
+  // Without losses, the faster probing interval has the higher utility. The
+  // first rate change is bounded to 5% of the sending rate.
+  QuicBandwidth sending_rate = sender_->ExportDebugState().sending_rate;
+  ProbeAndDecide(/*lose_faster=*/false);
+  PccSender::DebugState state = sender_->ExportDebugState();
+  EXPECT_APPROX_EQ(sending_rate * 1.05f, state.sending_rate, 0.001f);
+  EXPECT_EQ(1, state.rate_change_amplifier);
+  EXPECT_EQ(1, state.rate_change_bound_count);
+
+  // Decisions in the same direction grow the bound.
+  sending_rate = state.sending_rate;
+  ProbeAndDecide(/*lose_faster=*/false);
+  state = sender_->ExportDebugState();
+  EXPECT_APPROX_EQ(sending_rate * 1.1f, state.sending_rate, 0.001f);
+  EXPECT_EQ(2, state.rate_change_amplifier);
+  EXPECT_EQ(2, state.rate_change_bound_count);
+
+  // Losses at the faster rate reverse the direction, and reset the bound.
+  sending_rate = state.sending_rate;
+  ProbeAndDecide(/*lose_faster=*/true);
+  state = sender_->ExportDebugState();
+  EXPECT_APPROX_EQ(sending_rate * 0.95f, state.sending_rate, 0.001f);
+  EXPECT_EQ(1, state.rate_change_amplifier);
+  EXPECT_EQ(1, state.rate_change_bound_count);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
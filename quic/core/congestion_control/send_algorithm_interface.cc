@@ -4,9 +4,9 @@
 
 #include "quic/core/congestion_control/send_algorithm_interface.h"
 
-#include "absl/base/attributes.h"
 #include "quic/core/congestion_control/bbr2_sender.h"
 #include "quic/core/congestion_control/bbr_sender.h"
+#include "quic/core/congestion_control/pcc_sender.h"
 #include "quic/core/congestion_control/tcp_cubic_sender_bytes.h"
 #include "quic/core/quic_packets.h"
 #include "quic/platform/api/quic_bug_tracker.h"
@@ -44,8 +44,9 @@ SendAlgorithmInterface* SendAlgorithmInterface::Create(
               ? static_cast<BbrSender*>(old_send_algorithm)
               : nullptr);
     case kPCC:
-      // PCC is currently not supported, fall back to CUBIC instead.
-      ABSL_FALLTHROUGH_INTENDED;
+      return new PccSender(clock->ApproximateNow(), rtt_stats, unacked_packets,
+                           initial_congestion_window, max_congestion_window,
+                           random, stats);
     case kCubicBytes:
       return new TcpCubicSenderBytes(
           clock, rtt_stats, false /* don't use Reno */,
@@ -190,6 +190,52 @@ bool AeadBaseDecrypter::DecryptPacket(uint64_t packet_number,
   return true;
 }
 
+size_t AeadBaseDecrypter::DecryptPackets(
+    absl::Span<PacketToDecrypt> packets) {
+  if (have_preliminary_key_) {
+    QUIC_BUG(quic_bug_10709_4)
+        << "Unable to decrypt while key diversification is pending";
+    return 0;
+  }
+
+  // Only the packet number part of the nonce changes from packet to packet.
+  uint8_t nonce[kMaxNonceSize];
+  memcpy(nonce, iv_, nonce_size_);
+  const size_t prefix_len = nonce_size_ - sizeof(uint64_t);
+  size_t num_decrypted = 0;
+  for (PacketToDecrypt& packet : packets) {
+    packet.decrypted = false;
+    if (packet.ciphertext.length() < auth_tag_size_) {
+      continue;
+    }
+    const uint64_t packet_number = packet.packet_number;
+    if (use_ietf_nonce_construction_) {
+      for (size_t i = 0; i < sizeof(packet_number); ++i) {
+        nonce[prefix_len + i] =
+            iv_[prefix_len + i] ^
+            ((packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff);
+      }
+    } else {
+      memcpy(nonce + prefix_len, &packet_number, sizeof(packet_number));
+    }
+    if (!EVP_AEAD_CTX_open(
+            ctx_.get(), reinterpret_cast<uint8_t*>(packet.output),
+            &packet.output_length, packet.max_output_length, nonce,
+            nonce_size_,
+            reinterpret_cast<const uint8_t*>(packet.ciphertext.data()),
+            packet.ciphertext.size(),
+            reinterpret_cast<const uint8_t*>(packet.associated_data.data()),
+            packet.associated_data.size())) {
+      // As in DecryptPacket, decryption errors are expected.
+      ClearOpenSslErrors();
+      continue;
+    }
+    packet.decrypted = true;
+    ++num_decrypted;
+  }
+  return num_decrypted;
+}
+
 size_t AeadBaseDecrypter::GetKeySize() const {
   return key_size_;
 }
@@ -8,6 +8,7 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "third_party/boringssl/src/include/openssl/aead.h"
 #include "quic/core/crypto/quic_decrypter.h"
 #include "quic/platform/api/quic_export.h"
@@ -40,6 +41,7 @@ class QUIC_EXPORT_PRIVATE AeadBaseDecrypter : public QuicDecrypter {
                      char* output,
                      size_t* output_length,
                      size_t max_output_length) override;
+  size_t DecryptPackets(absl::Span<PacketToDecrypt> packets) override;
   size_t GetKeySize() const override;
   size_t GetNoncePrefixSize() const override;
   size_t GetIVSize() const override;
@@ -137,16 +137,7 @@ bool AeadBaseEncrypter::EncryptPacket(uint64_t packet_number,
   // TODO(ianswett): Introduce a check to ensure that we don't encrypt with the
   // same packet number twice.
   alignas(4) char nonce_buffer[kMaxNonceSize];
-  memcpy(nonce_buffer, iv_, nonce_size_);
-  size_t prefix_len = nonce_size_ - sizeof(packet_number);
-  if (use_ietf_nonce_construction_) {
-    for (size_t i = 0; i < sizeof(packet_number); ++i) {
-      nonce_buffer[prefix_len + i] ^=
-          (packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff;
-    }
-  } else {
-    memcpy(nonce_buffer + prefix_len, &packet_number, sizeof(packet_number));
-  }
+  MakeNonce(packet_number, nonce_buffer);
 
   if (!Encrypt(absl::string_view(nonce_buffer, nonce_size_), associated_data,
                plaintext, reinterpret_cast<unsigned char*>(output))) {
@@ -156,6 +147,92 @@ bool AeadBaseEncrypter::EncryptPacket(uint64_t packet_number,
   return true;
 }
 
+bool AeadBaseEncrypter::EncryptPackets(absl::Span<PacketToEncrypt> packets) {
+  // Only the packet number part of the nonce changes from packet to packet.
+  alignas(4) uint8_t nonce[kMaxNonceSize];
+  memcpy(nonce, iv_, nonce_size_);
+  const size_t prefix_len = nonce_size_ - sizeof(uint64_t);
+  for (PacketToEncrypt& packet : packets) {
+    const size_t ciphertext_size = GetCiphertextSize(packet.plaintext.length());
+    if (packet.max_output_length < ciphertext_size) {
+      return false;
+    }
+    const uint64_t packet_number = packet.packet_number;
+    if (use_ietf_nonce_construction_) {
+      for (size_t i = 0; i < sizeof(packet_number); ++i) {
+        nonce[prefix_len + i] =
+            iv_[prefix_len + i] ^
+            ((packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff);
+      }
+    } else {
+      memcpy(nonce + prefix_len, &packet_number, sizeof(packet_number));
+    }
+    size_t ciphertext_len;
+    if (!EVP_AEAD_CTX_seal(
+            ctx_.get(), reinterpret_cast<uint8_t*>(packet.output),
+            &ciphertext_len, ciphertext_size, nonce, nonce_size_,
+            reinterpret_cast<const uint8_t*>(packet.plaintext.data()),
+            packet.plaintext.size(),
+            reinterpret_cast<const uint8_t*>(packet.associated_data.data()),
+            packet.associated_data.size())) {
+      DLogOpenSslErrors();
+      return false;
+    }
+    packet.output_length = ciphertext_size;
+  }
+  return true;
+}
+
+bool AeadBaseEncrypter::EncryptPacketWithTrailingData(
+    uint64_t packet_number,
+    absl::string_view associated_data,
+    absl::string_view plaintext,
+    absl::string_view trailing_plaintext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  const size_t ciphertext_size =
+      GetCiphertextSize(plaintext.length() + trailing_plaintext.length());
+  if (max_output_length < ciphertext_size) {
+    return false;
+  }
+  alignas(4) char nonce_buffer[kMaxNonceSize];
+  MakeNonce(packet_number, nonce_buffer);
+
+  // |plaintext| is encrypted to |output|, and |trailing_plaintext| is
+  // encrypted to right after it, followed by the tag.
+  uint8_t* out = reinterpret_cast<uint8_t*>(output);
+  size_t out_tag_len;
+  if (!EVP_AEAD_CTX_seal_scatter(
+          ctx_.get(), out, out + plaintext.size(), &out_tag_len,
+          max_output_length - plaintext.size(),
+          reinterpret_cast<const uint8_t*>(nonce_buffer), nonce_size_,
+          reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+          reinterpret_cast<const uint8_t*>(trailing_plaintext.data()),
+          trailing_plaintext.size(),
+          reinterpret_cast<const uint8_t*>(associated_data.data()),
+          associated_data.size())) {
+    DLogOpenSslErrors();
+    return false;
+  }
+  *output_length = plaintext.size() + out_tag_len;
+  QUICHE_DCHECK_EQ(ciphertext_size, *output_length);
+  return true;
+}
+
+void AeadBaseEncrypter::MakeNonce(uint64_t packet_number, char* nonce) const {
+  memcpy(nonce, iv_, nonce_size_);
+  size_t prefix_len = nonce_size_ - sizeof(packet_number);
+  if (use_ietf_nonce_construction_) {
+    for (size_t i = 0; i < sizeof(packet_number); ++i) {
+      nonce[prefix_len + i] ^=
+          (packet_number >> ((sizeof(packet_number) - i - 1) * 8)) & 0xff;
+    }
+  } else {
+    memcpy(nonce + prefix_len, &packet_number, sizeof(packet_number));
+  }
+}
+
 size_t AeadBaseEncrypter::GetKeySize() const {
   return key_size_;
 }
@@ -8,6 +8,7 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "third_party/boringssl/src/include/openssl/aead.h"
 #include "quic/core/crypto/quic_encrypter.h"
 #include "quic/platform/api/quic_export.h"
@@ -38,6 +39,14 @@ class QUIC_EXPORT_PRIVATE AeadBaseEncrypter : public QuicEncrypter {
                      char* output,
                      size_t* output_length,
                      size_t max_output_length) override;
+  bool EncryptPackets(absl::Span<PacketToEncrypt> packets) override;
+  bool EncryptPacketWithTrailingData(uint64_t packet_number,
+                                     absl::string_view associated_data,
+                                     absl::string_view plaintext,
+                                     absl::string_view trailing_plaintext,
+                                     char* output,
+                                     size_t* output_length,
+                                     size_t max_output_length) override;
   size_t GetKeySize() const override;
   size_t GetNoncePrefixSize() const override;
   size_t GetIVSize() const override;
@@ -61,6 +70,10 @@ class QUIC_EXPORT_PRIVATE AeadBaseEncrypter : public QuicEncrypter {
   enum : size_t { kMaxNonceSize = 12 };
 
  private:
+  // Writes the nonce of |packet_number| to |nonce|, which must be
+  // |nonce_size_| bytes long.
+  void MakeNonce(uint64_t packet_number, char* nonce) const;
+
   const EVP_AEAD* const aead_alg_;
   const size_t key_size_;
   const size_t auth_tag_size_;
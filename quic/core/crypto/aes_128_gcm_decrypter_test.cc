@@ -6,9 +6,12 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/escaping.h"
+#include "absl/types/span.h"
+#include "quic/core/crypto/aes_128_gcm_encrypter.h"
 #include "quic/core/quic_utils.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/quic_test_utils.h"
@@ -287,5 +290,90 @@ TEST_F(Aes128GcmDecrypterTest, GenerateHeaderProtectionMask) {
       expected_mask.size());
 }
 
+TEST_F(Aes128GcmDecrypterTest, WriteHeaderProtectionMasks) {
+  Aes128GcmDecrypter decrypter;
+  std::string key = absl::HexStringToBytes("d9132370cb18476ab833649cf080d970");
+  ASSERT_TRUE(decrypter.SetHeaderProtectionKey(key));
+  // More samples than are encrypted in one call.
+  const size_t kNumSamples = 150;
+  std::string samples;
+  for (size_t i = 0; i < kNumSamples * kHeaderProtectionSampleSize; ++i) {
+    samples.push_back(static_cast<char>(i * 7));
+  }
+  std::string masks(kNumSamples * kHeaderProtectionMaskSize, 0);
+  ASSERT_TRUE(decrypter.WriteHeaderProtectionMasks(samples.data(), kNumSamples,
+                                                   &masks[0]));
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    QuicDataReader sample_reader(
+        samples.data() + i * kHeaderProtectionSampleSize,
+        kHeaderProtectionSampleSize);
+    std::string expected_mask =
+        decrypter.GenerateHeaderProtectionMask(&sample_reader);
+    quiche::test::CompareCharArraysWithHexError(
+        "header protection mask", masks.data() + i * kHeaderProtectionMaskSize,
+        kHeaderProtectionMaskSize, expected_mask.data(),
+        kHeaderProtectionMaskSize);
+
+    char mask[kHeaderProtectionMaskSize];
+    ASSERT_TRUE(decrypter.WriteHeaderProtectionMask(
+        absl::string_view(samples).substr(i * kHeaderProtectionSampleSize,
+                                          kHeaderProtectionSampleSize),
+        mask));
+    quiche::test::CompareCharArraysWithHexError(
+        "header protection mask", mask, sizeof(mask), expected_mask.data(),
+        kHeaderProtectionMaskSize);
+  }
+}
+
+TEST_F(Aes128GcmDecrypterTest, DecryptPackets) {
+  const std::string key =
+      absl::HexStringToBytes("d9132370cb18476ab833649cf080d970");
+  const std::string iv = absl::HexStringToBytes("ffffffff0000000000000000");
+  Aes128GcmEncrypter encrypter;
+  ASSERT_TRUE(encrypter.SetKey(key));
+  ASSERT_TRUE(encrypter.SetIV(iv));
+  Aes128GcmDecrypter decrypter;
+  ASSERT_TRUE(decrypter.SetKey(key));
+  ASSERT_TRUE(decrypter.SetIV(iv));
+
+  const size_t kNumPackets = 10;
+  std::vector<std::string> plaintexts;
+  std::vector<std::string> ciphertexts;
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    plaintexts.push_back(std::string(100 + i, static_cast<char>(i)));
+    std::string ciphertext(encrypter.GetCiphertextSize(plaintexts[i].size()),
+                           0);
+    size_t ciphertext_length;
+    ASSERT_TRUE(encrypter.EncryptPacket(0xfffffff0 + i, "associated data",
+                                        plaintexts[i], &ciphertext[0],
+                                        &ciphertext_length, ciphertext.size()));
+    ciphertexts.push_back(ciphertext);
+  }
+  // Corrupt one packet, and truncate another below the tag size.
+  ciphertexts[3][0] ^= 0x01;
+  ciphertexts[7].resize(4);
+
+  std::vector<std::string> outputs(kNumPackets, std::string(200, 0));
+  std::vector<QuicDecrypter::PacketToDecrypt> packets(kNumPackets);
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    packets[i].packet_number = 0xfffffff0 + i;
+    packets[i].associated_data = "associated data";
+    packets[i].ciphertext = ciphertexts[i];
+    packets[i].output = &outputs[i][0];
+    packets[i].max_output_length = outputs[i].size();
+  }
+  EXPECT_EQ(kNumPackets - 2, decrypter.DecryptPackets(absl::MakeSpan(packets)));
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    if (i == 3 || i == 7) {
+      EXPECT_FALSE(packets[i].decrypted);
+      continue;
+    }
+    ASSERT_TRUE(packets[i].decrypted);
+    quiche::test::CompareCharArraysWithHexError(
+        "plaintext", outputs[i].data(), packets[i].output_length,
+        plaintexts[i].data(), plaintexts[i].size());
+  }
+}
+
 }  // namespace test
 }  // namespace quic
@@ -15,12 +15,7 @@ bool AesBaseDecrypter::SetHeaderProtectionKey(absl::string_view key) {
     QUIC_BUG(quic_bug_10649_1) << "Invalid key size for header protection";
     return false;
   }
-  if (AES_set_encrypt_key(reinterpret_cast<const uint8_t*>(key.data()),
-                          key.size() * 8, &pne_key_) != 0) {
-    QUIC_BUG(quic_bug_10649_2) << "Unexpected failure of AES_set_encrypt_key";
-    return false;
-  }
-  return true;
+  return header_protection_.SetKey(key);
 }
 
 std::string AesBaseDecrypter::GenerateHeaderProtectionMask(
@@ -29,11 +24,18 @@ std::string AesBaseDecrypter::GenerateHeaderProtectionMask(
   if (!sample_reader->ReadStringPiece(&sample, AES_BLOCK_SIZE)) {
     return std::string();
   }
-  std::string out(AES_BLOCK_SIZE, 0);
-  AES_encrypt(reinterpret_cast<const uint8_t*>(sample.data()),
-              reinterpret_cast<uint8_t*>(const_cast<char*>(out.data())),
-              &pne_key_);
-  return out;
+  return header_protection_.GenerateMask(sample);
+}
+
+bool AesBaseDecrypter::WriteHeaderProtectionMask(absl::string_view sample,
+                                                 char* mask) {
+  return header_protection_.WriteMask(sample, mask);
+}
+
+bool AesBaseDecrypter::WriteHeaderProtectionMasks(const char* samples,
+                                                  size_t num_samples,
+                                                  char* masks) {
+  return header_protection_.WriteMasks(samples, num_samples, masks);
 }
 
 QuicPacketCount AesBaseDecrypter::GetIntegrityLimit() const {
@@ -8,8 +8,8 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
-#include "third_party/boringssl/src/include/openssl/aes.h"
 #include "quic/core/crypto/aead_base_decrypter.h"
+#include "quic/core/crypto/aes_header_protection.h"
 #include "quic/platform/api/quic_export.h"
 
 namespace quic {
@@ -21,11 +21,15 @@ class QUIC_EXPORT_PRIVATE AesBaseDecrypter : public AeadBaseDecrypter {
   bool SetHeaderProtectionKey(absl::string_view key) override;
   std::string GenerateHeaderProtectionMask(
       QuicDataReader* sample_reader) override;
+  bool WriteHeaderProtectionMask(absl::string_view sample, char* mask) override;
+  bool WriteHeaderProtectionMasks(const char* samples,
+                                  size_t num_samples,
+                                  char* masks) override;
   QuicPacketCount GetIntegrityLimit() const override;
 
  private:
-  // The key used for packet number encryption.
-  AES_KEY pne_key_;
+  // Generates the masks used for packet number encryption.
+  AesHeaderProtection header_protection_;
 };
 
 }  // namespace quic
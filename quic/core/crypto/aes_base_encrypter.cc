@@ -16,24 +16,23 @@ bool AesBaseEncrypter::SetHeaderProtectionKey(absl::string_view key) {
         << "Invalid key size for header protection: " << key.size();
     return false;
   }
-  if (AES_set_encrypt_key(reinterpret_cast<const uint8_t*>(key.data()),
-                          key.size() * 8, &pne_key_) != 0) {
-    QUIC_BUG(quic_bug_10726_2) << "Unexpected failure of AES_set_encrypt_key";
-    return false;
-  }
-  return true;
+  return header_protection_.SetKey(key);
 }
 
 std::string AesBaseEncrypter::GenerateHeaderProtectionMask(
     absl::string_view sample) {
-  if (sample.size() != AES_BLOCK_SIZE) {
-    return std::string();
-  }
-  std::string out(AES_BLOCK_SIZE, 0);
-  AES_encrypt(reinterpret_cast<const uint8_t*>(sample.data()),
-              reinterpret_cast<uint8_t*>(const_cast<char*>(out.data())),
-              &pne_key_);
-  return out;
+  return header_protection_.GenerateMask(sample);
+}
+
+bool AesBaseEncrypter::WriteHeaderProtectionMask(absl::string_view sample,
+                                                 char* mask) {
+  return header_protection_.WriteMask(sample, mask);
+}
+
+bool AesBaseEncrypter::WriteHeaderProtectionMasks(const char* samples,
+                                                  size_t num_samples,
+                                                  char* masks) {
+  return header_protection_.WriteMasks(samples, num_samples, masks);
 }
 
 QuicPacketCount AesBaseEncrypter::GetConfidentialityLimit() const {
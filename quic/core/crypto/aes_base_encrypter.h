@@ -8,8 +8,8 @@
 #include <cstddef>
 
 #include "absl/strings/string_view.h"
-#include "third_party/boringssl/src/include/openssl/aes.h"
 #include "quic/core/crypto/aead_base_encrypter.h"
+#include "quic/core/crypto/aes_header_protection.h"
 #include "quic/platform/api/quic_export.h"
 
 namespace quic {
@@ -20,11 +20,15 @@ class QUIC_EXPORT_PRIVATE AesBaseEncrypter : public AeadBaseEncrypter {
 
   bool SetHeaderProtectionKey(absl::string_view key) override;
   std::string GenerateHeaderProtectionMask(absl::string_view sample) override;
+  bool WriteHeaderProtectionMask(absl::string_view sample, char* mask) override;
+  bool WriteHeaderProtectionMasks(const char* samples,
+                                  size_t num_samples,
+                                  char* masks) override;
   QuicPacketCount GetConfidentialityLimit() const override;
 
  private:
-  // The key used for packet number encryption.
-  AES_KEY pne_key_;
+  // Generates the masks used for packet number encryption.
+  AesHeaderProtection header_protection_;
 };
 
 }  // namespace quic
@@ -0,0 +1,90 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/crypto/aes_header_protection.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "quic/core/quic_constants.h"
+#include "quic/platform/api/quic_bug_tracker.h"
+
+namespace quic {
+
+bool AesHeaderProtection::SetKey(absl::string_view key) {
+  if (AES_set_encrypt_key(reinterpret_cast<const uint8_t*>(key.data()),
+                          key.size() * 8, &key_) != 0) {
+    QUIC_BUG(quic_bug_aes_header_protection_set_key)
+        << "Unexpected failure of AES_set_encrypt_key";
+    return false;
+  }
+  // Only full blocks are ever encrypted, so no padding is needed.
+  const EVP_CIPHER* ecb_cipher =
+      key.size() == 32 ? EVP_aes_256_ecb() : EVP_aes_128_ecb();
+  if (!EVP_EncryptInit_ex(ecb_ctx_.get(), ecb_cipher, nullptr,
+                          reinterpret_cast<const uint8_t*>(key.data()),
+                          nullptr) ||
+      !EVP_CIPHER_CTX_set_padding(ecb_ctx_.get(), 0)) {
+    QUIC_BUG(quic_bug_aes_header_protection_ecb_init)
+        << "Unexpected failure of EVP_EncryptInit_ex";
+    return false;
+  }
+  return true;
+}
+
+std::string AesHeaderProtection::GenerateMask(absl::string_view sample) const {
+  if (sample.size() != AES_BLOCK_SIZE) {
+    return std::string();
+  }
+  std::string out(AES_BLOCK_SIZE, 0);
+  AES_encrypt(reinterpret_cast<const uint8_t*>(sample.data()),
+              reinterpret_cast<uint8_t*>(const_cast<char*>(out.data())),
+              &key_);
+  return out;
+}
+
+bool AesHeaderProtection::WriteMask(absl::string_view sample,
+                                    char* mask) const {
+  if (sample.size() != AES_BLOCK_SIZE) {
+    return false;
+  }
+  uint8_t out[AES_BLOCK_SIZE];
+  AES_encrypt(reinterpret_cast<const uint8_t*>(sample.data()), out, &key_);
+  memcpy(mask, out, kHeaderProtectionMaskSize);
+  return true;
+}
+
+bool AesHeaderProtection::WriteMasks(const char* samples,
+                                     size_t num_samples,
+                                     char* masks) {
+  static_assert(kHeaderProtectionSampleSize == AES_BLOCK_SIZE,
+                "Samples must be AES blocks");
+  // Encrypt up to kMaxSamplesPerCall samples at a time, so that the blocks fit
+  // on the stack.
+  const size_t kMaxSamplesPerCall = 64;
+  uint8_t out[kMaxSamplesPerCall * AES_BLOCK_SIZE];
+  while (num_samples > 0) {
+    const size_t num_blocks = std::min(num_samples, kMaxSamplesPerCall);
+    int out_len = 0;
+    if (!EVP_EncryptUpdate(ecb_ctx_.get(), out, &out_len,
+                           reinterpret_cast<const uint8_t*>(samples),
+                           num_blocks * AES_BLOCK_SIZE) ||
+        static_cast<size_t>(out_len) != num_blocks * AES_BLOCK_SIZE) {
+      QUIC_BUG(quic_bug_aes_header_protection_masks)
+          << "Unexpected failure to generate header protection masks";
+      return false;
+    }
+    for (size_t i = 0; i < num_blocks; ++i) {
+      memcpy(masks + i * kHeaderProtectionMaskSize, out + i * AES_BLOCK_SIZE,
+             kHeaderProtectionMaskSize);
+    }
+    samples += num_blocks * AES_BLOCK_SIZE;
+    masks += num_blocks * kHeaderProtectionMaskSize;
+    num_samples -= num_blocks;
+  }
+  return true;
+}
+
+}  // namespace quic
@@ -0,0 +1,45 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CRYPTO_AES_HEADER_PROTECTION_H_
+#define QUICHE_QUIC_CORE_CRYPTO_AES_HEADER_PROTECTION_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "third_party/boringssl/src/include/openssl/aes.h"
+#include "third_party/boringssl/src/include/openssl/cipher.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Generates the header protection masks of AesBaseEncrypter and
+// AesBaseDecrypter, which are the AES encryption of the sample.
+class QUIC_EXPORT_PRIVATE AesHeaderProtection {
+ public:
+  // Sets the AES-128 or AES-256 |key|. Returns false on failure.
+  bool SetKey(absl::string_view key);
+
+  // Returns the mask of |sample|, or an empty string if |sample| is not one
+  // AES block long.
+  std::string GenerateMask(absl::string_view sample) const;
+
+  // Writes the first kHeaderProtectionMaskSize bytes of the mask of |sample| to
+  // |mask|. Returns false if |sample| is not one AES block long.
+  bool WriteMask(absl::string_view sample, char* mask) const;
+
+  // Writes the masks of |num_samples| consecutive samples to |masks|, with one
+  // AES-ECB encryption per batch of samples. Returns false on failure.
+  bool WriteMasks(const char* samples, size_t num_samples, char* masks);
+
+ private:
+  AES_KEY key_;
+  // AES-ECB with the same key, which encrypts a batch of samples in one call.
+  bssl::ScopedEVP_CIPHER_CTX ecb_ctx_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CRYPTO_AES_HEADER_PROTECTION_H_
@@ -6,12 +6,17 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "quic/core/crypto/chacha20_poly1305_tls_decrypter.h"
 #include "quic/core/quic_utils.h"
+#include "quic/platform/api/quic_logging.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/quic_test_utils.h"
 #include "common/test_tools/quiche_test_utils.h"
@@ -169,5 +174,69 @@ TEST_F(ChaCha20Poly1305TlsEncrypterTest, GenerateHeaderProtectionMask) {
       expected_mask.size());
 }
 
+TEST_F(ChaCha20Poly1305TlsEncrypterTest, WriteHeaderProtectionMasks) {
+  ChaCha20Poly1305TlsEncrypter encrypter;
+  std::string key = absl::HexStringToBytes(
+      "6a067f432787bd6034dd3f08f07fc9703a27e58c70e2d88d948b7f6489923cc7");
+  std::string sample =
+      absl::HexStringToBytes("1210d91cceb45c716b023f492c29e612");
+  ASSERT_TRUE(encrypter.SetHeaderProtectionKey(key));
+  std::string samples = sample + sample;
+  char masks[2 * kHeaderProtectionMaskSize];
+  ASSERT_TRUE(encrypter.WriteHeaderProtectionMasks(samples.data(), 2, masks));
+  std::string expected_mask = absl::HexStringToBytes("1cc2cd98dc");
+  quiche::test::CompareCharArraysWithHexError(
+      "header protection masks", masks, sizeof(masks),
+      (expected_mask + expected_mask).data(), 2 * expected_mask.size());
+}
+
+// Logs the throughput of encrypting full size packets one at a time and in
+// batches the size of a GSO write. Results are logged rather than asserted,
+// since they depend on the machine.
+TEST_F(ChaCha20Poly1305TlsEncrypterTest, DISABLED_EncryptPacketsThroughput) {
+  ChaCha20Poly1305TlsEncrypter encrypter;
+  ASSERT_TRUE(encrypter.SetKey(std::string(encrypter.GetKeySize(), 'k')));
+  ASSERT_TRUE(encrypter.SetIV(std::string(encrypter.GetIVSize(), 'i')));
+  const size_t kPlaintextSize = 1350;
+  const size_t kBatchSize = 32;
+  const int kNumBatches = 2000;
+  const std::string associated_data(20, 'a');
+  const std::string plaintext(kPlaintextSize, 'p');
+  std::vector<std::string> outputs(
+      kBatchSize, std::string(encrypter.GetCiphertextSize(kPlaintextSize), 0));
+
+  absl::Time start = absl::Now();
+  uint64_t packet_number = 0;
+  for (int i = 0; i < kNumBatches; ++i) {
+    for (std::string& output : outputs) {
+      size_t output_length;
+      ASSERT_TRUE(encrypter.EncryptPacket(++packet_number, associated_data,
+                                          plaintext, &output[0],
+                                          &output_length, output.size()));
+    }
+  }
+  const absl::Duration single_duration = absl::Now() - start;
+
+  std::vector<QuicEncrypter::PacketToEncrypt> packets(kBatchSize);
+  start = absl::Now();
+  for (int i = 0; i < kNumBatches; ++i) {
+    for (size_t j = 0; j < kBatchSize; ++j) {
+      packets[j].packet_number = ++packet_number;
+      packets[j].associated_data = associated_data;
+      packets[j].plaintext = plaintext;
+      packets[j].output = &outputs[j][0];
+      packets[j].max_output_length = outputs[j].size();
+    }
+    ASSERT_TRUE(encrypter.EncryptPackets(absl::MakeSpan(packets)));
+  }
+  const absl::Duration batch_duration = absl::Now() - start;
+
+  const double bits = 8.0 * kPlaintextSize * kBatchSize * kNumBatches;
+  QUIC_LOG(INFO) << "ChaCha20-Poly1305 Gbit/s per core: one at a time "
+                 << bits / absl::ToDoubleSeconds(single_duration) / 1e9
+                 << ", batches of " << kBatchSize << " "
+                 << bits / absl::ToDoubleSeconds(batch_duration) / 1e9;
+}
+
 }  // namespace test
 }  // namespace quic
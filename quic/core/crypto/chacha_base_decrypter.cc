@@ -6,12 +6,9 @@
 
 #include <cstdint>
 
-#include "absl/base/macros.h"
 #include "absl/strings/string_view.h"
-#include "third_party/boringssl/src/include/openssl/chacha.h"
 #include "quic/core/quic_data_reader.h"
 #include "quic/platform/api/quic_bug_tracker.h"
-#include "common/quiche_endian.h"
 
 namespace quic {
 
@@ -20,25 +17,21 @@ bool ChaChaBaseDecrypter::SetHeaderProtectionKey(absl::string_view key) {
     QUIC_BUG(quic_bug_10620_1) << "Invalid key size for header protection";
     return false;
   }
-  memcpy(pne_key_, key.data(), key.size());
-  return true;
+  return header_protection_.SetKey(key);
 }
 
 std::string ChaChaBaseDecrypter::GenerateHeaderProtectionMask(
     QuicDataReader* sample_reader) {
   absl::string_view sample;
-  if (!sample_reader->ReadStringPiece(&sample, 16)) {
+  if (!sample_reader->ReadStringPiece(&sample, kHeaderProtectionSampleSize)) {
     return std::string();
   }
-  const uint8_t* nonce = reinterpret_cast<const uint8_t*>(sample.data()) + 4;
-  uint32_t counter;
-  QuicDataReader(sample.data(), 4, quiche::HOST_BYTE_ORDER)
-      .ReadUInt32(&counter);
-  const uint8_t zeroes[] = {0, 0, 0, 0, 0};
-  std::string out(ABSL_ARRAYSIZE(zeroes), 0);
-  CRYPTO_chacha_20(reinterpret_cast<uint8_t*>(const_cast<char*>(out.data())),
-                   zeroes, ABSL_ARRAYSIZE(zeroes), pne_key_, nonce, counter);
-  return out;
+  return header_protection_.GenerateMask(sample);
+}
+
+bool ChaChaBaseDecrypter::WriteHeaderProtectionMask(absl::string_view sample,
+                                                    char* mask) {
+  return header_protection_.WriteMask(sample, mask);
 }
 
 }  // namespace quic
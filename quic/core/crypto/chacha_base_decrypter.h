@@ -9,6 +9,7 @@
 
 #include "absl/strings/string_view.h"
 #include "quic/core/crypto/aead_base_decrypter.h"
+#include "quic/core/crypto/chacha_header_protection.h"
 #include "quic/platform/api/quic_export.h"
 
 namespace quic {
@@ -20,10 +21,10 @@ class QUIC_EXPORT_PRIVATE ChaChaBaseDecrypter : public AeadBaseDecrypter {
   bool SetHeaderProtectionKey(absl::string_view key) override;
   std::string GenerateHeaderProtectionMask(
       QuicDataReader* sample_reader) override;
+  bool WriteHeaderProtectionMask(absl::string_view sample, char* mask) override;
 
  private:
-  // The key used for packet number encryption.
-  unsigned char pne_key_[kMaxKeySize];
+  ChaChaHeaderProtection header_protection_;
 };
 
 }  // namespace quic
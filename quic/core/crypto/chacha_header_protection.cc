@@ -0,0 +1,50 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/crypto/chacha_header_protection.h"
+
+#include <string.h>
+
+#include "third_party/boringssl/src/include/openssl/chacha.h"
+#include "quic/core/quic_constants.h"
+#include "quic/core/quic_data_reader.h"
+#include "common/quiche_endian.h"
+
+namespace quic {
+
+bool ChaChaHeaderProtection::SetKey(absl::string_view key) {
+  if (key.size() != kKeySize) {
+    return false;
+  }
+  memcpy(key_, key.data(), key.size());
+  return true;
+}
+
+std::string ChaChaHeaderProtection::GenerateMask(
+    absl::string_view sample) const {
+  std::string out(kHeaderProtectionMaskSize, 0);
+  if (!WriteMask(sample, const_cast<char*>(out.data()))) {
+    return std::string();
+  }
+  return out;
+}
+
+bool ChaChaHeaderProtection::WriteMask(absl::string_view sample,
+                                       char* mask) const {
+  if (sample.size() != kHeaderProtectionSampleSize) {
+    return false;
+  }
+  // The first 4 bytes of the sample are the block counter, and the remaining
+  // 12 bytes are the nonce.
+  const uint8_t* nonce = reinterpret_cast<const uint8_t*>(sample.data()) + 4;
+  uint32_t counter;
+  QuicDataReader(sample.data(), 4, quiche::HOST_BYTE_ORDER)
+      .ReadUInt32(&counter);
+  static const uint8_t kZeroes[kHeaderProtectionMaskSize] = {0};
+  CRYPTO_chacha_20(reinterpret_cast<uint8_t*>(mask), kZeroes,
+                   kHeaderProtectionMaskSize, key_, nonce, counter);
+  return true;
+}
+
+}  // namespace quic
@@ -0,0 +1,41 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_CRYPTO_CHACHA_HEADER_PROTECTION_H_
+#define QUICHE_QUIC_CORE_CRYPTO_CHACHA_HEADER_PROTECTION_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Generates the header protection masks of ChaChaBaseEncrypter and
+// ChaChaBaseDecrypter, which are the ChaCha20 keystream for the counter and
+// nonce taken from the sample (RFC 9001, Section 5.4.4).
+class QUIC_EXPORT_PRIVATE ChaChaHeaderProtection {
+ public:
+  static constexpr size_t kKeySize = 32;
+
+  // Sets the ChaCha20 |key|. Returns false if |key| is not kKeySize bytes long.
+  bool SetKey(absl::string_view key);
+
+  // Returns the kHeaderProtectionMaskSize bytes long mask of |sample|, or an
+  // empty string if |sample| is not kHeaderProtectionSampleSize bytes long.
+  std::string GenerateMask(absl::string_view sample) const;
+
+  // Writes the kHeaderProtectionMaskSize bytes long mask of |sample| to
+  // |mask|. Returns false if |sample| is not kHeaderProtectionSampleSize bytes
+  // long.
+  bool WriteMask(absl::string_view sample, char* mask) const;
+
+ private:
+  uint8_t key_[kKeySize];
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_CRYPTO_CHACHA_HEADER_PROTECTION_H_
@@ -4,6 +4,8 @@
 
 #include "quic/core/crypto/null_decrypter.h"
 
+#include <string.h>
+
 #include <cstdint>
 
 #include "absl/numeric/int128.h"
@@ -79,6 +81,12 @@ std::string NullDecrypter::GenerateHeaderProtectionMask(
   return std::string(5, 0);
 }
 
+bool NullDecrypter::WriteHeaderProtectionMask(absl::string_view /*sample*/,
+                                              char* mask) {
+  memset(mask, 0, kHeaderProtectionMaskSize);
+  return true;
+}
+
 size_t NullDecrypter::GetKeySize() const {
   return 0;
 }
@@ -43,6 +43,7 @@ class QUIC_EXPORT_PRIVATE NullDecrypter : public QuicDecrypter {
                      size_t max_output_length) override;
   std::string GenerateHeaderProtectionMask(
       QuicDataReader* sample_reader) override;
+  bool WriteHeaderProtectionMask(absl::string_view sample, char* mask) override;
   size_t GetKeySize() const override;
   size_t GetNoncePrefixSize() const override;
   size_t GetIVSize() const override;
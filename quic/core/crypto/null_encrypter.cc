@@ -4,6 +4,8 @@
 
 #include "quic/core/crypto/null_encrypter.h"
 
+#include <string.h>
+
 #include "absl/numeric/int128.h"
 #include "absl/strings/string_view.h"
 #include "quic/core/quic_data_writer.h"
@@ -64,6 +66,12 @@ std::string NullEncrypter::GenerateHeaderProtectionMask(
   return std::string(5, 0);
 }
 
+bool NullEncrypter::WriteHeaderProtectionMask(absl::string_view /*sample*/,
+                                              char* mask) {
+  memset(mask, 0, kHeaderProtectionMaskSize);
+  return true;
+}
+
 size_t NullEncrypter::GetKeySize() const {
   return 0;
 }
@@ -98,5 +98,20 @@ TEST_F(NullEncrypterTest, GetCiphertextSize) {
   EXPECT_EQ(22u, encrypter.GetCiphertextSize(10));
 }
 
+TEST_F(NullEncrypterTest, EncryptPacketWithTrailingData) {
+  char expected[256];
+  size_t expected_len = 0;
+  NullEncrypter encrypter(Perspective::IS_CLIENT);
+  ASSERT_TRUE(encrypter.EncryptPacket(0, "hello world!", "goodbye!", expected,
+                                      &expected_len, 256));
+
+  char encrypted[256];
+  size_t encrypted_len = 0;
+  ASSERT_TRUE(encrypter.EncryptPacketWithTrailingData(
+      0, "hello world!", "good", "bye!", encrypted, &encrypted_len, 256));
+  quiche::test::CompareCharArraysWithHexError(
+      "encrypted data", encrypted, encrypted_len, expected, expected_len);
+}
+
 }  // namespace test
 }  // namespace quic
@@ -4,6 +4,7 @@
 
 #include "quic/core/crypto/quic_crypter.h"
 #include "absl/strings/string_view.h"
+#include "quic/core/quic_constants.h"
 
 namespace quic {
 
@@ -15,4 +16,18 @@ bool QuicCrypter::SetNoncePrefixOrIV(const ParsedQuicVersion& version,
   return SetNoncePrefix(nonce_prefix_or_iv);
 }
 
+bool QuicCrypter::WriteHeaderProtectionMasks(const char* samples,
+                                             size_t num_samples,
+                                             char* masks) {
+  for (size_t i = 0; i < num_samples; ++i) {
+    if (!WriteHeaderProtectionMask(
+            absl::string_view(samples + i * kHeaderProtectionSampleSize,
+                              kHeaderProtectionSampleSize),
+            masks + i * kHeaderProtectionMaskSize)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace quic
@@ -5,6 +5,8 @@
 #ifndef QUICHE_QUIC_CORE_CRYPTO_QUIC_CRYPTER_H_
 #define QUICHE_QUIC_CORE_CRYPTO_QUIC_CRYPTER_H_
 
+#include <cstddef>
+
 #include "absl/strings/string_view.h"
 #include "quic/core/quic_versions.h"
 #include "quic/platform/api/quic_export.h"
@@ -78,6 +80,21 @@ class QUIC_EXPORT_PRIVATE QuicCrypter {
   // Sets the key to use for header protection.
   virtual bool SetHeaderProtectionKey(absl::string_view key) = 0;
 
+  // Uses the header protection key to generate the mask of a |sample| of
+  // kHeaderProtectionSampleSize bytes of ciphertext, and writes its first
+  // kHeaderProtectionMaskSize bytes to |mask|. Returns false on failure.
+  virtual bool WriteHeaderProtectionMask(absl::string_view sample,
+                                         char* mask) = 0;
+
+  // Writes the masks of |num_samples| consecutive samples, each
+  // kHeaderProtectionSampleSize bytes long, to |masks|, each
+  // kHeaderProtectionMaskSize bytes long. Crypters which can compute several
+  // masks in one call, like AES, override this to amortize its cost over a
+  // batch of packets. Returns false on failure.
+  virtual bool WriteHeaderProtectionMasks(const char* samples,
+                                          size_t num_samples,
+                                          char* masks);
+
   // GetKeySize, GetIVSize, and GetNoncePrefixSize are used to know how many
   // bytes of key material needs to be derived from the master secret.
 
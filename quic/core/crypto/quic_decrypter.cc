@@ -4,6 +4,8 @@
 
 #include "quic/core/crypto/quic_decrypter.h"
 
+#include <string.h>
+
 #include <string>
 #include <utility>
 
@@ -61,6 +63,33 @@ std::unique_ptr<QuicDecrypter> QuicDecrypter::CreateFromCipherSuite(
   }
 }
 
+size_t QuicDecrypter::DecryptPackets(absl::Span<PacketToDecrypt> packets) {
+  size_t num_decrypted = 0;
+  for (PacketToDecrypt& packet : packets) {
+    packet.decrypted = DecryptPacket(
+        packet.packet_number, packet.associated_data, packet.ciphertext,
+        packet.output, &packet.output_length, packet.max_output_length);
+    if (packet.decrypted) {
+      ++num_decrypted;
+    }
+  }
+  return num_decrypted;
+}
+
+bool QuicDecrypter::WriteHeaderProtectionMask(absl::string_view sample,
+                                              char* mask) {
+  if (sample.size() != kHeaderProtectionSampleSize) {
+    return false;
+  }
+  QuicDataReader sample_reader(sample);
+  std::string generated_mask = GenerateHeaderProtectionMask(&sample_reader);
+  if (generated_mask.size() < kHeaderProtectionMaskSize) {
+    return false;
+  }
+  memcpy(mask, generated_mask.data(), kHeaderProtectionMaskSize);
+  return true;
+}
+
 // static
 void QuicDecrypter::DiversifyPreliminaryKey(absl::string_view preliminary_key,
                                             absl::string_view nonce_prefix,
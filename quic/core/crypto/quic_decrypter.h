@@ -11,6 +11,7 @@
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quic/core/crypto/quic_crypter.h"
 #include "quic/core/quic_data_reader.h"
 #include "quic/core/quic_packets.h"
@@ -62,6 +63,26 @@ class QUIC_EXPORT_PRIVATE QuicDecrypter : public QuicCrypter {
                              size_t* output_length,
                              size_t max_output_length) = 0;
 
+  // A packet decrypted by DecryptPackets. The fields have the meaning of the
+  // arguments of DecryptPacket.
+  struct QUIC_EXPORT_PRIVATE PacketToDecrypt {
+    uint64_t packet_number = 0;
+    absl::string_view associated_data;
+    absl::string_view ciphertext;
+    char* output = nullptr;
+    size_t max_output_length = 0;
+    // Set by DecryptPackets.
+    size_t output_length = 0;
+    bool decrypted = false;
+  };
+
+  // Decrypts a batch of |packets|, such as those read by one recvmmsg call,
+  // as DecryptPacket would one at a time. AEADs override this to share their
+  // per-packet setup across the batch. Each packet is decrypted or fails on
+  // its own, as reported by its |decrypted| field. Returns the number of
+  // packets decrypted.
+  virtual size_t DecryptPackets(absl::Span<PacketToDecrypt> packets);
+
   // Reads a sample of ciphertext from |sample_reader| and uses the header
   // protection key to generate a mask to use for header protection. If
   // successful, this function returns this mask, which is at least 5 bytes
@@ -69,6 +90,9 @@ class QUIC_EXPORT_PRIVATE QuicDecrypter : public QuicCrypter {
   virtual std::string GenerateHeaderProtectionMask(
       QuicDataReader* sample_reader) = 0;
 
+  // Writes the mask generated by GenerateHeaderProtectionMask by default.
+  bool WriteHeaderProtectionMask(absl::string_view sample, char* mask) override;
+
   // The ID of the cipher. Return 0x03000000 ORed with the 'cryptographic suite
   // selector'.
   virtual uint32_t cipher_id() const = 0;
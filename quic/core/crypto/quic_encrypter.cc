@@ -4,6 +4,9 @@
 
 #include "quic/core/crypto/quic_encrypter.h"
 
+#include <string.h>
+
+#include <string>
 #include <utility>
 
 #include "third_party/boringssl/src/include/openssl/tls1.h"
@@ -58,4 +61,51 @@ std::unique_ptr<QuicEncrypter> QuicEncrypter::CreateFromCipherSuite(
   }
 }
 
+bool QuicEncrypter::EncryptPackets(absl::Span<PacketToEncrypt> packets) {
+  for (PacketToEncrypt& packet : packets) {
+    if (!EncryptPacket(packet.packet_number, packet.associated_data,
+                       packet.plaintext, packet.output, &packet.output_length,
+                       packet.max_output_length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool QuicEncrypter::EncryptPacketWithTrailingData(
+    uint64_t packet_number,
+    absl::string_view associated_data,
+    absl::string_view plaintext,
+    absl::string_view trailing_plaintext,
+    char* output,
+    size_t* output_length,
+    size_t max_output_length) {
+  const size_t plaintext_length =
+      plaintext.length() + trailing_plaintext.length();
+  if (max_output_length < GetCiphertextSize(plaintext_length)) {
+    return false;
+  }
+  if (output != plaintext.data()) {
+    memcpy(output, plaintext.data(), plaintext.length());
+  }
+  memcpy(output + plaintext.length(), trailing_plaintext.data(),
+         trailing_plaintext.length());
+  return EncryptPacket(packet_number, associated_data,
+                       absl::string_view(output, plaintext_length), output,
+                       output_length, max_output_length);
+}
+
+bool QuicEncrypter::WriteHeaderProtectionMask(absl::string_view sample,
+                                              char* mask) {
+  if (sample.size() != kHeaderProtectionSampleSize) {
+    return false;
+  }
+  std::string generated_mask = GenerateHeaderProtectionMask(sample);
+  if (generated_mask.size() < kHeaderProtectionMaskSize) {
+    return false;
+  }
+  memcpy(mask, generated_mask.data(), kHeaderProtectionMaskSize);
+  return true;
+}
+
 }  // namespace quic
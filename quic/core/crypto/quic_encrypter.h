@@ -9,6 +9,7 @@
 #include <memory>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "quic/core/crypto/quic_crypter.h"
 #include "quic/core/quic_packets.h"
 #include "quic/platform/api/quic_export.h"
@@ -42,6 +43,39 @@ class QUIC_EXPORT_PRIVATE QuicEncrypter : public QuicCrypter {
                              size_t* output_length,
                              size_t max_output_length) = 0;
 
+  // A packet encrypted by EncryptPackets. The fields have the meaning of the
+  // arguments of EncryptPacket.
+  struct QUIC_EXPORT_PRIVATE PacketToEncrypt {
+    uint64_t packet_number = 0;
+    absl::string_view associated_data;
+    absl::string_view plaintext;
+    char* output = nullptr;
+    size_t max_output_length = 0;
+    // Set by EncryptPackets.
+    size_t output_length = 0;
+  };
+
+  // Encrypts a batch of |packets|, such as the segments of one GSO write, as
+  // EncryptPacket would one at a time. AEADs override this to share their
+  // per-packet setup across the batch. Returns false if any packet fails to
+  // encrypt, in which case the outputs of the packets are undefined.
+  virtual bool EncryptPackets(absl::Span<PacketToEncrypt> packets);
+
+  // Like EncryptPacket, but the plaintext is |plaintext| followed by
+  // |trailing_plaintext|, such as the data of the last STREAM frame in the
+  // packet, which is read from where it is buffered. |output| must either be
+  // |plaintext| or not overlap it, and must not overlap |trailing_plaintext|.
+  // The default implementation copies |trailing_plaintext| after |plaintext|
+  // in |output|; AEADs override this to encrypt it without the copy.
+  virtual bool EncryptPacketWithTrailingData(
+      uint64_t packet_number,
+      absl::string_view associated_data,
+      absl::string_view plaintext,
+      absl::string_view trailing_plaintext,
+      char* output,
+      size_t* output_length,
+      size_t max_output_length);
+
   // Takes a |sample| of ciphertext and uses the header protection key to
   // generate a mask to use for header protection, and returns that mask. On
   // success, the mask will be at least 5 bytes long; on failure the string will
@@ -49,6 +83,9 @@ class QUIC_EXPORT_PRIVATE QuicEncrypter : public QuicCrypter {
   virtual std::string GenerateHeaderProtectionMask(
       absl::string_view sample) = 0;
 
+  // Writes the mask generated by GenerateHeaderProtectionMask by default.
+  bool WriteHeaderProtectionMask(absl::string_view sample, char* mask) override;
+
   // Returns the maximum length of plaintext that can be encrypted
   // to ciphertext no larger than |ciphertext_size|.
   virtual size_t GetMaxPlaintextSize(size_t ciphertext_size) const = 0;
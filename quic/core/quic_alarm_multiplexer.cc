@@ -0,0 +1,164 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_alarm_multiplexer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+class QuicAlarmMultiplexer::MultiplexedAlarm : public QuicAlarm {
+ public:
+  MultiplexedAlarm(QuicAlarmMultiplexer* multiplexer,
+                   QuicArenaScopedPtr<QuicAlarm::Delegate> delegate)
+      : QuicAlarm(std::move(delegate)), multiplexer_(multiplexer) {}
+
+  ~MultiplexedAlarm() override { multiplexer_->OnAlarmDestroyed(this); }
+
+  // Called by the multiplexer when the deadline has passed.
+  using QuicAlarm::Fire;
+
+ protected:
+  void SetImpl() override {
+    QUICHE_DCHECK(deadline().IsInitialized());
+    multiplexer_->OnAlarmSet(this);
+  }
+
+  // The platform alarm is left as is.  If it fires for nothing, it is set for
+  // the earliest remaining deadline then.
+  void CancelImpl() override {
+    QUICHE_DCHECK(!deadline().IsInitialized());
+  }
+
+  void UpdateImpl() override { SetImpl(); }
+
+ private:
+  QuicAlarmMultiplexer* multiplexer_;
+};
+
+class QuicAlarmMultiplexer::PlatformAlarmDelegate
+    : public QuicAlarm::DelegateWithoutContext {
+ public:
+  explicit PlatformAlarmDelegate(QuicAlarmMultiplexer* multiplexer)
+      : multiplexer_(multiplexer) {}
+
+  void OnAlarm() override { multiplexer_->FireAlarms(); }
+
+ private:
+  QuicAlarmMultiplexer* multiplexer_;
+};
+
+QuicAlarmMultiplexer::QuicAlarmMultiplexer(const QuicClock* clock,
+                                           QuicAlarmFactory* alarm_factory,
+                                           QuicConnectionArena* arena)
+    : clock_(clock),
+      alarm_factory_(alarm_factory),
+      arena_(arena),
+      firing_(false) {}
+
+QuicAlarmMultiplexer::~QuicAlarmMultiplexer() {
+  QUICHE_DCHECK(alarms_.empty());
+  if (platform_alarm_ != nullptr) {
+    platform_alarm_->PermanentCancel();
+  }
+}
+
+QuicAlarm* QuicAlarmMultiplexer::CreateAlarm(QuicAlarm::Delegate* delegate) {
+  MultiplexedAlarm* alarm = new MultiplexedAlarm(
+      this, QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate));
+  alarms_.push_back(alarm);
+  return alarm;
+}
+
+QuicArenaScopedPtr<QuicAlarm> QuicAlarmMultiplexer::CreateAlarm(
+    QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+    QuicConnectionArena* arena) {
+  QuicArenaScopedPtr<MultiplexedAlarm> alarm =
+      arena != nullptr
+          ? arena->New<MultiplexedAlarm>(this, std::move(delegate))
+          : QuicArenaScopedPtr<MultiplexedAlarm>(
+                new MultiplexedAlarm(this, std::move(delegate)));
+  alarms_.push_back(alarm.get());
+  return QuicArenaScopedPtr<QuicAlarm>(std::move(alarm));
+}
+
+QuicTime QuicAlarmMultiplexer::platform_alarm_deadline() const {
+  return platform_alarm_ == nullptr ? QuicTime::Zero()
+                                    : platform_alarm_->deadline();
+}
+
+void QuicAlarmMultiplexer::OnAlarmSet(MultiplexedAlarm* alarm) {
+  // FireAlarms() sets the platform alarm once it is done.
+  if (firing_) {
+    return;
+  }
+  if (platform_alarm_ != nullptr && platform_alarm_->IsSet() &&
+      platform_alarm_->deadline() <= alarm->deadline()) {
+    return;
+  }
+  SetPlatformAlarm(alarm->deadline());
+}
+
+void QuicAlarmMultiplexer::OnAlarmDestroyed(MultiplexedAlarm* alarm) {
+  alarms_.erase(std::find(alarms_.begin(), alarms_.end(), alarm));
+  std::replace(due_alarms_.begin(), due_alarms_.end(), alarm,
+               static_cast<MultiplexedAlarm*>(nullptr));
+}
+
+void QuicAlarmMultiplexer::FireAlarms() {
+  const QuicTime now = clock_->ApproximateNow();
+  QUICHE_DCHECK(due_alarms_.empty());
+  for (MultiplexedAlarm* alarm : alarms_) {
+    if (alarm->IsSet() && alarm->deadline() <= now) {
+      due_alarms_.push_back(alarm);
+    }
+  }
+  std::stable_sort(due_alarms_.begin(), due_alarms_.end(),
+                   [](const MultiplexedAlarm* a, const MultiplexedAlarm* b) {
+                     return a->deadline() < b->deadline();
+                   });
+
+  // Alarms which are set again while firing, even in the past, fire on the
+  // next wakeup, so that an alarm cannot keep the others from firing.
+  firing_ = true;
+  for (size_t i = 0; i < due_alarms_.size(); ++i) {
+    MultiplexedAlarm* alarm = due_alarms_[i];
+    // Earlier alarms may have destroyed, cancelled or moved this one.
+    if (alarm != nullptr && alarm->IsSet() && alarm->deadline() <= now) {
+      alarm->Fire();
+    }
+  }
+  due_alarms_.clear();
+  firing_ = false;
+
+  QuicTime earliest = QuicTime::Infinite();
+  for (const MultiplexedAlarm* alarm : alarms_) {
+    if (alarm->IsSet()) {
+      earliest = std::min(earliest, alarm->deadline());
+    }
+  }
+  if (earliest != QuicTime::Infinite()) {
+    SetPlatformAlarm(earliest);
+  }
+}
+
+void QuicAlarmMultiplexer::SetPlatformAlarm(QuicTime deadline) {
+  if (platform_alarm_ == nullptr) {
+    if (arena_ != nullptr) {
+      platform_alarm_ = alarm_factory_->CreateAlarm(
+          arena_->New<PlatformAlarmDelegate>(this), arena_);
+    } else {
+      platform_alarm_ = alarm_factory_->CreateAlarm(
+          QuicArenaScopedPtr<PlatformAlarmDelegate>(
+              new PlatformAlarmDelegate(this)),
+          nullptr);
+    }
+  }
+  platform_alarm_->Update(deadline, QuicTime::Delta::Zero());
+}
+
+}  // namespace quic
@@ -0,0 +1,85 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_ALARM_MULTIPLEXER_H_
+#define QUICHE_QUIC_CORE_QUIC_ALARM_MULTIPLEXER_H_
+
+#include <vector>
+
+#include "quic/core/quic_alarm.h"
+#include "quic/core/quic_alarm_factory.h"
+#include "quic/core/quic_arena_scoped_ptr.h"
+#include "quic/core/quic_clock.h"
+#include "quic/core/quic_one_block_arena.h"
+#include "quic/core/quic_time.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+namespace test {
+class QuicAlarmMultiplexerPeer;
+}  // namespace test
+
+// A QuicAlarmFactory whose alarms share a single alarm of an underlying,
+// platform alarm factory.  It is meant for the dozen or so alarms of a
+// connection, most of which are updated on almost every packet: the
+// multiplexer keeps their deadlines itself, and only sets the platform alarm
+// for the earliest of them.  Setting or updating an alarm only touches the
+// platform alarm if the alarm becomes the earliest, and cancelling an alarm
+// never does, at the cost of an occasional wakeup for nothing.
+//
+// The multiplexer must outlive its alarms, and must not be destroyed by their
+// delegates.
+class QUIC_EXPORT_PRIVATE QuicAlarmMultiplexer : public QuicAlarmFactory {
+ public:
+  // |arena| is where the platform alarm is allocated, if not null.
+  QuicAlarmMultiplexer(const QuicClock* clock,
+                       QuicAlarmFactory* alarm_factory,
+                       QuicConnectionArena* arena);
+  QuicAlarmMultiplexer(const QuicAlarmMultiplexer&) = delete;
+  QuicAlarmMultiplexer& operator=(const QuicAlarmMultiplexer&) = delete;
+  ~QuicAlarmMultiplexer() override;
+
+  // QuicAlarmFactory interface.
+  QuicAlarm* CreateAlarm(QuicAlarm::Delegate* delegate) override;
+  QuicArenaScopedPtr<QuicAlarm> CreateAlarm(
+      QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
+      QuicConnectionArena* arena) override;
+
+  // Returns the deadline the platform alarm is set for, or QuicTime::Zero()
+  // if it is not set.  Never later than the earliest deadline of the alarms.
+  QuicTime platform_alarm_deadline() const;
+
+ private:
+  friend class test::QuicAlarmMultiplexerPeer;
+
+  class MultiplexedAlarm;
+  class PlatformAlarmDelegate;
+
+  // Called by the alarms.
+  void OnAlarmSet(MultiplexedAlarm* alarm);
+  void OnAlarmDestroyed(MultiplexedAlarm* alarm);
+
+  // Fires the alarms which are due, in order of deadline, and sets the
+  // platform alarm for the earliest remaining one.
+  void FireAlarms();
+
+  // Sets the platform alarm for |deadline|, creating it if needed.
+  void SetPlatformAlarm(QuicTime deadline);
+
+  const QuicClock* clock_;
+  QuicAlarmFactory* alarm_factory_;
+  QuicConnectionArena* arena_;
+  // Created when an alarm is first set.
+  QuicArenaScopedPtr<QuicAlarm> platform_alarm_;
+  std::vector<MultiplexedAlarm*> alarms_;
+  // The alarms which are due while FireAlarms() runs.  Destroyed alarms are
+  // replaced by nullptr.
+  std::vector<MultiplexedAlarm*> due_alarms_;
+  bool firing_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_ALARM_MULTIPLEXER_H_
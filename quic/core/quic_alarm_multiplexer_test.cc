@@ -0,0 +1,281 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_alarm_multiplexer.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/quic_epoll_alarm_factory.h"
+#include "quic/core/quic_epoll_clock.h"
+#include "quic/core/quic_time.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_test.h"
+#include "common/platform/api/quiche_epoll_test_tools.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// Counts the operations on the alarms of the epoll server, which are what the
+// multiplexer saves.
+class CountingEpollServer : public quiche::QuicheFakeEpollServer {
+ public:
+  void RegisterAlarm(int64_t timeout_time_in_us, AlarmCB* alarm) override {
+    ++num_alarm_operations_;
+    quiche::QuicheFakeEpollServer::RegisterAlarm(timeout_time_in_us, alarm);
+  }
+
+  void UnregisterAlarm(const AlarmRegToken& token) override {
+    ++num_alarm_operations_;
+    quiche::QuicheFakeEpollServer::UnregisterAlarm(token);
+  }
+
+  AlarmRegToken ReregisterAlarm(AlarmRegToken token,
+                                int64_t timeout_time_in_us) override {
+    ++num_alarm_operations_;
+    return quiche::QuicheFakeEpollServer::ReregisterAlarm(token,
+                                                          timeout_time_in_us);
+  }
+
+  int64_t num_alarm_operations() const { return num_alarm_operations_; }
+
+ private:
+  int64_t num_alarm_operations_ = 0;
+};
+
+// Records the order in which alarms fire, and runs |on_alarm| if set.
+class RecordingDelegate : public QuicAlarm::DelegateWithoutContext {
+ public:
+  RecordingDelegate(int id, std::vector<int>* fired) : id_(id), fired_(fired) {}
+
+  void OnAlarm() override {
+    fired_->push_back(id_);
+    if (on_alarm_) {
+      on_alarm_();
+    }
+  }
+
+  void set_on_alarm(std::function<void()> on_alarm) {
+    on_alarm_ = std::move(on_alarm);
+  }
+
+ private:
+  const int id_;
+  std::vector<int>* fired_;
+  std::function<void()> on_alarm_;
+};
+
+class QuicAlarmMultiplexerTest : public QuicTest {
+ protected:
+  QuicAlarmMultiplexerTest()
+      : clock_(&epoll_server_),
+        alarm_factory_(&epoll_server_),
+        multiplexer_(&clock_, &alarm_factory_, &arena_) {
+    for (int i = 0; i < 4; ++i) {
+      RecordingDelegate* delegate = new RecordingDelegate(i, &fired_);
+      delegates_.push_back(delegate);
+      alarms_.push_back(multiplexer_.CreateAlarm(
+          QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate), &arena_));
+    }
+  }
+
+  QuicTime TimeAt(int64_t microseconds) {
+    return start_ + QuicTime::Delta::FromMicroseconds(microseconds);
+  }
+
+  CountingEpollServer epoll_server_;
+  const QuicEpollClock clock_;
+  QuicEpollAlarmFactory alarm_factory_;
+  QuicConnectionArena arena_;
+  QuicAlarmMultiplexer multiplexer_;
+  const QuicTime start_ = clock_.Now();
+  std::vector<int> fired_;
+  std::vector<RecordingDelegate*> delegates_;
+  std::vector<QuicArenaScopedPtr<QuicAlarm>> alarms_;
+};
+
+TEST_F(QuicAlarmMultiplexerTest, FireInOrder) {
+  alarms_[0]->Set(TimeAt(30));
+  alarms_[1]->Set(TimeAt(10));
+  alarms_[2]->Set(TimeAt(20));
+  alarms_[3]->Set(TimeAt(1000));
+  EXPECT_EQ(TimeAt(10), multiplexer_.platform_alarm_deadline());
+  EXPECT_EQ(2, epoll_server_.num_alarm_operations());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(30);
+  EXPECT_EQ(std::vector<int>({1, 2, 0}), fired_);
+  EXPECT_FALSE(alarms_[0]->IsSet());
+  EXPECT_TRUE(alarms_[3]->IsSet());
+  EXPECT_EQ(TimeAt(1000), multiplexer_.platform_alarm_deadline());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(970);
+  EXPECT_EQ(std::vector<int>({1, 2, 0, 3}), fired_);
+  EXPECT_EQ(QuicTime::Zero(), multiplexer_.platform_alarm_deadline());
+}
+
+// Moving alarms later and cancelling them does not touch the platform alarm,
+// which then fires for nothing once.
+TEST_F(QuicAlarmMultiplexerTest, MoveLaterAndCancel) {
+  alarms_[0]->Set(TimeAt(10));
+  alarms_[1]->Set(TimeAt(20));
+  const int64_t num_alarm_operations = epoll_server_.num_alarm_operations();
+
+  alarms_[1]->Update(TimeAt(30), QuicTime::Delta::Zero());
+  alarms_[0]->Cancel();
+  alarms_[2]->Set(TimeAt(40));
+  EXPECT_EQ(num_alarm_operations, epoll_server_.num_alarm_operations());
+  EXPECT_EQ(TimeAt(10), multiplexer_.platform_alarm_deadline());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(10);
+  EXPECT_TRUE(fired_.empty());
+  EXPECT_EQ(TimeAt(30), multiplexer_.platform_alarm_deadline());
+
+  // Moving an alarm earlier than the platform alarm does touch it.
+  alarms_[2]->Update(TimeAt(25), QuicTime::Delta::Zero());
+  EXPECT_EQ(TimeAt(25), multiplexer_.platform_alarm_deadline());
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(20);
+  EXPECT_EQ(std::vector<int>({2, 1}), fired_);
+}
+
+// Alarms set in the past while alarms fire wait for the next wakeup.
+TEST_F(QuicAlarmMultiplexerTest, SetWhileFiring) {
+  delegates_[0]->set_on_alarm([this]() {
+    alarms_[0]->Set(TimeAt(1));
+    alarms_[1]->Set(TimeAt(5));
+  });
+  alarms_[0]->Set(TimeAt(10));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(10);
+  EXPECT_EQ(std::vector<int>({0}), fired_);
+  EXPECT_TRUE(alarms_[0]->IsSet());
+  EXPECT_EQ(TimeAt(1), multiplexer_.platform_alarm_deadline());
+
+  delegates_[0]->set_on_alarm(nullptr);
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(1);
+  EXPECT_EQ(std::vector<int>({0, 0, 1}), fired_);
+}
+
+TEST_F(QuicAlarmMultiplexerTest, DestroyWhileFiring) {
+  delegates_[0]->set_on_alarm([this]() { alarms_[1].reset(); });
+  alarms_[0]->Set(TimeAt(10));
+  alarms_[1]->Set(TimeAt(10));
+  alarms_[2]->Set(TimeAt(10));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(10);
+  EXPECT_EQ(std::vector<int>({0, 2}), fired_);
+}
+
+TEST_F(QuicAlarmMultiplexerTest, PermanentCancel) {
+  alarms_[0]->Set(TimeAt(10));
+  alarms_[0]->PermanentCancel();
+  alarms_[1]->Set(TimeAt(20));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(20);
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+}
+
+// Measures the operations on the alarms of the epoll server, and the CPU
+// time, per packet of |kNumConnections| mostly idle connections.  Each
+// connection gets a request about once a second, which it acks after a delay
+// and responds to, and the peer acks the response an RTT later.  The alarms
+// are updated the way QuicConnection updates them, and the connections have
+// as many alarms which are not set as QuicConnection.
+TEST(QuicAlarmMultiplexerBenchmark, DISABLED_IdleConnections) {
+  const int kNumConnections = 50000;
+  const QuicTime::Delta kRequestInterval =
+      QuicTime::Delta::FromMicroseconds(1000000 / kNumConnections);
+  const int kNumRequests = 5 * kNumConnections;
+  const QuicTime::Delta kRtt = QuicTime::Delta::FromMilliseconds(50);
+  const QuicTime::Delta kAckDelay = QuicTime::Delta::FromMilliseconds(25);
+  const QuicTime::Delta kPto = QuicTime::Delta::FromMilliseconds(150);
+  const QuicTime::Delta kPingTimeout = QuicTime::Delta::FromSeconds(15);
+  const QuicTime::Delta kIdleTimeout = QuicTime::Delta::FromSeconds(30);
+  const QuicTime::Delta kAlarmGranularity =
+      QuicTime::Delta::FromMilliseconds(1);
+  enum { kAck, kRetransmission, kPing, kIdle, kNumAlarms = 11 };
+
+  class NoopDelegate : public QuicAlarm::DelegateWithoutContext {
+   public:
+    void OnAlarm() override {}
+  };
+  struct Connection {
+    std::unique_ptr<QuicAlarmMultiplexer> multiplexer;
+    std::vector<std::unique_ptr<QuicAlarm>> alarms;
+  };
+
+  for (bool multiplex : {false, true}) {
+    CountingEpollServer epoll_server;
+    QuicEpollClock clock(&epoll_server);
+    QuicEpollAlarmFactory epoll_alarm_factory(&epoll_server);
+    std::vector<Connection> connections(kNumConnections);
+    for (Connection& connection : connections) {
+      QuicAlarmFactory* alarm_factory = &epoll_alarm_factory;
+      if (multiplex) {
+        connection.multiplexer = std::make_unique<QuicAlarmMultiplexer>(
+            &clock, &epoll_alarm_factory, /*arena=*/nullptr);
+        alarm_factory = connection.multiplexer.get();
+      }
+      for (int i = 0; i < kNumAlarms; ++i) {
+        connection.alarms.emplace_back(
+            alarm_factory->CreateAlarm(new NoopDelegate()));
+      }
+      connection.alarms[kPing]->Set(clock.Now() + kPingTimeout);
+      connection.alarms[kIdle]->Set(clock.Now() + kIdleTimeout);
+    }
+
+    // The connections which the peer acks a response of, in order.
+    std::deque<std::pair<QuicTime, Connection*>> peer_acks;
+    const int64_t initial_operations = epoll_server.num_alarm_operations();
+    int64_t num_packets = 0;
+    uint64_t connection_index = 0;
+    const absl::Time start = absl::Now();
+    for (int request = 0; request < kNumRequests; ++request) {
+      epoll_server.AdvanceByExactlyAndCallCallbacks(
+          kRequestInterval.ToMicroseconds());
+      const QuicTime now = clock.Now();
+      while (!peer_acks.empty() && peer_acks.front().first <= now) {
+        std::vector<std::unique_ptr<QuicAlarm>>& alarms =
+            peer_acks.front().second->alarms;
+        alarms[kRetransmission]->Cancel();
+        alarms[kPing]->Update(now + kPingTimeout, kAlarmGranularity);
+        alarms[kIdle]->Update(now + kIdleTimeout, kAlarmGranularity);
+        peer_acks.pop_front();
+        ++num_packets;
+      }
+
+      // Visit the connections in a scattered order.
+      connection_index = (connection_index + 7919) % kNumConnections;
+      Connection* connection = &connections[connection_index];
+      std::vector<std::unique_ptr<QuicAlarm>>& alarms = connection->alarms;
+      if (!alarms[kAck]->IsSet()) {
+        alarms[kAck]->Set(now + kAckDelay);
+      }
+      alarms[kPing]->Update(now + kPingTimeout, kAlarmGranularity);
+      alarms[kIdle]->Update(now + kIdleTimeout, kAlarmGranularity);
+      alarms[kRetransmission]->Update(now + kPto, kAlarmGranularity);
+      peer_acks.push_back({now + kRtt, connection});
+      ++num_packets;
+    }
+    const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+    const int64_t operations =
+        epoll_server.num_alarm_operations() - initial_operations;
+    QUIC_LOG(INFO) << (multiplex ? "Multiplexed" : "Separate") << " alarms, "
+                   << kNumConnections << " connections: " << num_packets
+                   << " packets, "
+                   << static_cast<double>(operations) / num_packets
+                   << " epoll alarm operations per packet, "
+                   << seconds * 1e9 / num_packets << " ns per packet";
+
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -4,10 +4,14 @@
 
 #include "quic/core/quic_buffered_packet_store.h"
 
+#include <string.h>
+
 #include <string>
 
 #include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_flag_utils.h"
 #include "quic/platform/api/quic_flags.h"
+#include "common/simple_buffer_allocator.h"
 
 namespace quic {
 
@@ -74,7 +78,16 @@ QuicBufferedPacketStore::QuicBufferedPacketStore(
       visitor_(visitor),
       clock_(clock),
       expiration_alarm_(
-          alarm_factory->CreateAlarm(new ConnectionExpireAlarm(this))) {}
+          alarm_factory->CreateAlarm(new ConnectionExpireAlarm(this))),
+      bounded_store_(GetQuicRestartFlag(quic_bounded_buffered_packet_store)),
+      num_buffered_packets_(0),
+      num_buffered_bytes_(0) {
+  if (bounded_store_) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_bounded_buffered_packet_store, 1, 3);
+    packet_buffer_pool_ = std::make_unique<QuicReceiveBufferPool>(
+        quiche::SimpleBufferAllocator::Get(), kMaxIncomingPacketSize);
+  }
+}
 
 QuicBufferedPacketStore::~QuicBufferedPacketStore() {
   if (expiration_alarm_ != nullptr) {
@@ -96,6 +109,16 @@ EnqueuePacketResult QuicBufferedPacketStore::EnqueuePacket(
   QUIC_BUG_IF(quic_bug_12410_4, is_chlo && !version.IsKnown())
       << "Should have version for CHLO packet.";
 
+  const QuicByteCount buffered_bytes = ShouldCopyIntoPool(packet)
+                                           ? packet_buffer_pool_->buffer_size()
+                                           : packet.length();
+  if (bounded_store_ &&
+      num_buffered_bytes_ + buffered_bytes >
+          GetQuicFlag(FLAGS_quic_buffered_packet_store_max_bytes)) {
+    QUIC_CODE_COUNT(quic_buffered_packet_store_too_many_bytes);
+    return TOO_MANY_BYTES;
+  }
+
   const bool is_first_packet = !undecryptable_packets_.contains(connection_id);
   if (is_first_packet) {
     if (ShouldNotBufferPacket(is_chlo)) {
@@ -131,8 +154,11 @@ EnqueuePacketResult QuicBufferedPacketStore::EnqueuePacket(
     queue.creation_time = clock_->ApproximateNow();
   }
 
-  BufferedPacket new_entry(std::unique_ptr<QuicReceivedPacket>(packet.Clone()),
-                           self_address, peer_address);
+  BufferedPacket new_entry(CopyPacket(packet), self_address, peer_address);
+  new_entry.buffered_bytes = buffered_bytes;
+  ++num_buffered_packets_;
+  num_buffered_bytes_ += buffered_bytes;
+  UpdateMaxFreePacketBuffers();
   if (is_chlo) {
     // Add CHLO to the beginning of buffered packets so that it can be delivered
     // first later.
@@ -175,6 +201,7 @@ BufferedPacketList QuicBufferedPacketStore::DeliverPackets(
   BufferedPacketList packets_to_deliver;
   auto it = undecryptable_packets_.find(connection_id);
   if (it != undecryptable_packets_.end()) {
+    OnPacketsRemoved(it->second);
     packets_to_deliver = std::move(it->second);
     undecryptable_packets_.erase(connection_id);
   }
@@ -182,13 +209,20 @@ BufferedPacketList QuicBufferedPacketStore::DeliverPackets(
 }
 
 void QuicBufferedPacketStore::DiscardPackets(QuicConnectionId connection_id) {
-  undecryptable_packets_.erase(connection_id);
+  auto it = undecryptable_packets_.find(connection_id);
+  if (it != undecryptable_packets_.end()) {
+    OnPacketsRemoved(it->second);
+    undecryptable_packets_.erase(it);
+  }
   connections_with_chlo_.erase(connection_id);
 }
 
 void QuicBufferedPacketStore::DiscardAllPackets() {
   undecryptable_packets_.clear();
   connections_with_chlo_.clear();
+  num_buffered_packets_ = 0;
+  num_buffered_bytes_ = 0;
+  UpdateMaxFreePacketBuffers();
   expiration_alarm_->Cancel();
 }
 
@@ -200,13 +234,27 @@ void QuicBufferedPacketStore::OnExpirationTimeout() {
       break;
     }
     QuicConnectionId connection_id = entry.first;
+    OnPacketsRemoved(entry.second);
     visitor_->OnExpiredPackets(connection_id, std::move(entry.second));
     undecryptable_packets_.pop_front();
     connections_with_chlo_.erase(connection_id);
   }
-  if (!undecryptable_packets_.empty()) {
-    MaybeSetExpirationAlarm();
+  if (undecryptable_packets_.empty()) {
+    return;
+  }
+  if (bounded_store_) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_bounded_buffered_packet_store, 2, 3);
+    // Connections are in the order they were created in, so the next one to
+    // expire is the first one. Connections are therefore expired on time, at a
+    // constant cost each, without scanning the store or keeping a timer per
+    // connection.
+    expiration_alarm_->Update(
+        undecryptable_packets_.front().second.creation_time +
+            connection_life_span_,
+        QuicTime::Delta::Zero());
+    return;
   }
+  MaybeSetExpirationAlarm();
 }
 
 void QuicBufferedPacketStore::MaybeSetExpirationAlarm() {
@@ -249,6 +297,69 @@ BufferedPacketList QuicBufferedPacketStore::DeliverPacketsForNextConnection(
   return packets;
 }
 
+size_t QuicBufferedPacketStore::GetPacketBufferMemoryUsage() const {
+  if (packet_buffer_pool_ == nullptr) {
+    return 0;
+  }
+  return packet_buffer_pool_->num_buffers() *
+         packet_buffer_pool_->buffer_size();
+}
+
+std::unique_ptr<QuicReceivedPacket> QuicBufferedPacketStore::CopyPacket(
+    const QuicReceivedPacket& packet) {
+  if (!ShouldCopyIntoPool(packet)) {
+    return packet.Clone();
+  }
+  const size_t headers_length =
+      packet.packet_headers() != nullptr ? packet.headers_length() : 0;
+  QUIC_RESTART_FLAG_COUNT_N(quic_bounded_buffered_packet_store, 3, 3);
+  // The packet headers are copied right after the packet, so that a buffered
+  // packet only takes a pooled buffer and the packet object.
+  QuicReceiveBufferReference buffer = packet_buffer_pool_->Acquire();
+  char* data = buffer.data();
+  memcpy(data, packet.data(), packet.length());
+  char* headers = nullptr;
+  if (headers_length > 0) {
+    headers = data + packet.length();
+    memcpy(headers, packet.packet_headers(), headers_length);
+  }
+  return std::make_unique<QuicReceivedPacket>(
+      data, packet.length(), packet.receipt_time(), packet.ttl(),
+      packet.ttl() >= 0, headers, headers_length,
+      /*owns_header_buffer=*/false, std::move(buffer));
+}
+
+bool QuicBufferedPacketStore::ShouldCopyIntoPool(
+    const QuicReceivedPacket& packet) const {
+  if (!bounded_store_ || packet.receive_buffer()) {
+    return false;
+  }
+  const size_t headers_length =
+      packet.packet_headers() != nullptr ? packet.headers_length() : 0;
+  return packet.length() + headers_length <= packet_buffer_pool_->buffer_size();
+}
+
+void QuicBufferedPacketStore::OnPacketsRemoved(
+    const BufferedPacketList& packets) {
+  for (const BufferedPacket& packet : packets.buffered_packets) {
+    --num_buffered_packets_;
+    num_buffered_bytes_ -= packet.buffered_bytes;
+  }
+  UpdateMaxFreePacketBuffers();
+}
+
+void QuicBufferedPacketStore::UpdateMaxFreePacketBuffers() {
+  if (packet_buffer_pool_ == nullptr) {
+    return;
+  }
+  const QuicByteCount max_bytes =
+      GetQuicFlag(FLAGS_quic_buffered_packet_store_max_bytes);
+  const QuicByteCount uncharged_bytes =
+      max_bytes > num_buffered_bytes_ ? max_bytes - num_buffered_bytes_ : 0;
+  packet_buffer_pool_->SetMaxFreeBuffers(uncharged_bytes /
+                                         packet_buffer_pool_->buffer_size());
+}
+
 bool QuicBufferedPacketStore::HasChloForConnection(
     QuicConnectionId connection_id) {
   return connections_with_chlo_.contains(connection_id);
@@ -12,6 +12,7 @@
 #include "quic/core/quic_alarm_factory.h"
 #include "quic/core/quic_clock.h"
 #include "quic/core/quic_packets.h"
+#include "quic/core/quic_receive_buffer_pool.h"
 #include "quic/core/quic_time.h"
 #include "quic/core/tls_chlo_extractor.h"
 #include "quic/platform/api/quic_export.h"
@@ -33,12 +34,18 @@ class QuicBufferedPacketStorePeer;
 // of connections: connections with CHLO buffered and those without CHLO. The
 // latter has its own upper limit along with the max number of connections this
 // store can hold. The former pool can grow till this store is full.
+//
+// If quic_restart_flag_quic_bounded_buffered_packet_store is true, the memory
+// held by the buffered packets is also bounded, packet copies are backed by a
+// pool of reusable buffers, and the packets of each connection expire exactly
+// after their lifetime.
 class QUIC_NO_EXPORT QuicBufferedPacketStore {
  public:
   enum EnqueuePacketResult {
     SUCCESS = 0,
     TOO_MANY_PACKETS,  // Too many packets stored up for a certain connection.
-    TOO_MANY_CONNECTIONS  // Too many connections stored up in the store.
+    TOO_MANY_CONNECTIONS,  // Too many connections stored up in the store.
+    TOO_MANY_BYTES  // Too many bytes of packets stored up in the store.
   };
 
   struct QUIC_NO_EXPORT BufferedPacket {
@@ -54,6 +61,8 @@ class QUIC_NO_EXPORT QuicBufferedPacketStore {
     std::unique_ptr<QuicReceivedPacket> packet;
     QuicSocketAddress self_address;
     QuicSocketAddress peer_address;
+    // The bytes the packet is charged against the byte budget of the store.
+    QuicByteCount buffered_bytes = 0;
   };
 
   // A queue of BufferedPackets for a connection.
@@ -159,9 +168,37 @@ class QUIC_NO_EXPORT QuicBufferedPacketStore {
   // Is there any CHLO buffered in the store?
   bool HasChlosBuffered() const;
 
+  // The number of packets buffered in the store, and the bytes they are
+  // charged: a whole pooled buffer for packets copied into one, and their
+  // length otherwise.
+  size_t num_buffered_packets() const { return num_buffered_packets_; }
+  QuicByteCount num_buffered_bytes() const { return num_buffered_bytes_; }
+
+  // Heap memory held by the pool backing the copies of buffered packets, which
+  // includes the buffers kept for reuse.
+  size_t GetPacketBufferMemoryUsage() const;
+
  private:
   friend class test::QuicBufferedPacketStorePeer;
 
+  // Returns a copy of |packet| to be buffered. If the packet is in a pooled
+  // receive buffer, the copy shares it. Otherwise, if the store is bounded, the
+  // packet is copied into a buffer of |packet_buffer_pool_|.
+  std::unique_ptr<QuicReceivedPacket> CopyPacket(
+      const QuicReceivedPacket& packet);
+
+  // Whether CopyPacket() copies |packet| into a buffer of
+  // |packet_buffer_pool_|.
+  bool ShouldCopyIntoPool(const QuicReceivedPacket& packet) const;
+
+  // Updates the packet counters for |packets| leaving the store.
+  void OnPacketsRemoved(const BufferedPacketList& packets);
+
+  // Limits the free buffers of |packet_buffer_pool_| to the part of the byte
+  // budget which is not charged to buffered packets, so that the pool does
+  // not hold more than the budget once a burst is over.
+  void UpdateMaxFreePacketBuffers();
+
   // Set expiration alarm if it hasn't been set.
   void MaybeSetExpirationAlarm();
 
@@ -187,6 +224,17 @@ class QUIC_NO_EXPORT QuicBufferedPacketStore {
   // arrive.
   quiche::QuicheLinkedHashMap<QuicConnectionId, bool, QuicConnectionIdHash>
       connections_with_chlo_;
+
+  // Latched value of quic_restart_flag_quic_bounded_buffered_packet_store.
+  const bool bounded_store_;
+
+  // Backs the copies of buffered packets, so that buffering stops allocating
+  // packet buffers once the number of buffered packets stabilizes. Only used if
+  // |bounded_store_|.
+  std::unique_ptr<QuicReceiveBufferPool> packet_buffer_pool_;
+
+  size_t num_buffered_packets_;
+  QuicByteCount num_buffered_bytes_;
 };
 
 }  // namespace quic
@@ -4,9 +4,14 @@
 
 #include "quic/core/quic_buffered_packet_store.h"
 
+#include <algorithm>
 #include <list>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "quic/core/quic_versions.h"
 #include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_test.h"
@@ -497,6 +502,201 @@ TEST_F(QuicBufferedPacketStoreTest, IngestPacketForTlsChloExtraction) {
   EXPECT_FALSE(resumption_attempted);
   EXPECT_FALSE(early_data_attempted);
 }
+
+class QuicBoundedBufferedPacketStoreTest : public QuicBufferedPacketStoreTest {
+ public:
+  QuicBoundedBufferedPacketStoreTest() {
+    SetQuicRestartFlag(quic_bounded_buffered_packet_store, true);
+    bounded_store_ = std::make_unique<QuicBufferedPacketStore>(
+        &visitor_, &clock_, &alarm_factory_);
+  }
+
+ protected:
+  EnqueuePacketResult EnqueuePacket(QuicConnectionId connection_id) {
+    return bounded_store_->EnqueuePacket(connection_id, false, packet_,
+                                         self_address_, peer_address_,
+                                         invalid_version_, kNoParsedChlo);
+  }
+
+  std::unique_ptr<QuicBufferedPacketStore> bounded_store_;
+};
+
+TEST_F(QuicBoundedBufferedPacketStoreTest, CopyPacketsIntoPooledBuffers) {
+  QuicConnectionId connection_id = TestConnectionId(1);
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(connection_id));
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(connection_id));
+  EXPECT_EQ(2u, bounded_store_->num_buffered_packets());
+  // Each packet is charged the whole buffer it is copied into.
+  EXPECT_EQ(2 * kMaxIncomingPacketSize, bounded_store_->num_buffered_bytes());
+
+  std::list<BufferedPacket> packets =
+      bounded_store_->DeliverPackets(connection_id).buffered_packets;
+  EXPECT_EQ(0u, bounded_store_->num_buffered_packets());
+  EXPECT_EQ(0u, bounded_store_->num_buffered_bytes());
+  ASSERT_EQ(2u, packets.size());
+  for (const BufferedPacket& packet : packets) {
+    EXPECT_TRUE(packet.packet->receive_buffer());
+    EXPECT_EQ(packet_content_, packet.packet->AsStringPiece());
+    EXPECT_EQ(packet_time_, packet.packet->receipt_time());
+  }
+  const size_t memory_usage = bounded_store_->GetPacketBufferMemoryUsage();
+  EXPECT_EQ(2 * kMaxIncomingPacketSize, memory_usage);
+  packets.clear();
+
+  // The buffers of the delivered packets are reused.
+  for (uint64_t i = 2; i <= 3; ++i) {
+    EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(TestConnectionId(i)));
+  }
+  EXPECT_EQ(memory_usage, bounded_store_->GetPacketBufferMemoryUsage());
+  bounded_store_->DiscardPackets(TestConnectionId(2));
+  EXPECT_EQ(1u, bounded_store_->num_buffered_packets());
+  bounded_store_->DiscardAllPackets();
+  EXPECT_EQ(0u, bounded_store_->num_buffered_packets());
+  EXPECT_EQ(0u, bounded_store_->num_buffered_bytes());
+}
+
+TEST_F(QuicBoundedBufferedPacketStoreTest, ByteBudget) {
+  SetQuicFlag(FLAGS_quic_buffered_packet_store_max_bytes,
+              3 * kMaxIncomingPacketSize);
+  QuicConnectionId connection_id = TestConnectionId(1);
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(connection_id));
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(connection_id));
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(TestConnectionId(2)));
+  EXPECT_EQ(EnqueuePacketResult::TOO_MANY_BYTES, EnqueuePacket(connection_id));
+  // Connections are not added for packets over the budget.
+  EXPECT_EQ(EnqueuePacketResult::TOO_MANY_BYTES,
+            EnqueuePacket(TestConnectionId(3)));
+  EXPECT_FALSE(bounded_store_->HasBufferedPackets(TestConnectionId(3)));
+  EXPECT_EQ(
+      EnqueuePacketResult::TOO_MANY_BYTES,
+      bounded_store_->EnqueuePacket(TestConnectionId(3), false, packet_,
+                                    self_address_, peer_address_,
+                                    valid_version_, kDefaultParsedChlo));
+
+  // Delivering packets frees up the budget.
+  EXPECT_EQ(2u, bounded_store_->DeliverPackets(connection_id)
+                    .buffered_packets.size());
+  EXPECT_EQ(kMaxIncomingPacketSize, bounded_store_->num_buffered_bytes());
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(TestConnectionId(3)));
+}
+
+TEST_F(QuicBoundedBufferedPacketStoreTest, FreeBuffersAreBoundedByBudget) {
+  SetQuicFlag(FLAGS_quic_buffered_packet_store_max_bytes,
+              3 * kMaxIncomingPacketSize);
+  for (uint64_t i = 1; i <= 3; ++i) {
+    EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(TestConnectionId(i)));
+  }
+  {
+    std::list<BufferedPacket> delivered;
+    for (uint64_t i = 1; i <= 3; ++i) {
+      delivered.splice(
+          delivered.end(),
+          bounded_store_->DeliverPackets(TestConnectionId(i)).buffered_packets);
+    }
+  }
+  // The buffers of the delivered packets fit in the budget, and are kept.
+  EXPECT_EQ(3 * kMaxIncomingPacketSize,
+            bounded_store_->GetPacketBufferMemoryUsage());
+
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(TestConnectionId(4)));
+  EXPECT_EQ(EnqueuePacketResult::SUCCESS, EnqueuePacket(TestConnectionId(5)));
+  EXPECT_EQ(3 * kMaxIncomingPacketSize,
+            bounded_store_->GetPacketBufferMemoryUsage());
+
+  // Once the budget shrinks, buffers released above it are deleted.
+  SetQuicFlag(FLAGS_quic_buffered_packet_store_max_bytes,
+              2 * kMaxIncomingPacketSize);
+  bounded_store_->DiscardPackets(TestConnectionId(4));
+  EXPECT_EQ(2 * kMaxIncomingPacketSize,
+            bounded_store_->GetPacketBufferMemoryUsage());
+  bounded_store_->DiscardAllPackets();
+  EXPECT_EQ(2 * kMaxIncomingPacketSize,
+            bounded_store_->GetPacketBufferMemoryUsage());
+}
+
+TEST_F(QuicBoundedBufferedPacketStoreTest, ExpireConnectionsOnTime) {
+  const QuicTime::Delta kLifeSpan =
+      QuicTime::Delta::FromSeconds(kInitialIdleTimeoutSecs);
+  QuicAlarm* alarm =
+      QuicBufferedPacketStorePeer::expiration_alarm(bounded_store_.get());
+  const QuicTime start = clock_.ApproximateNow();
+  EnqueuePacket(TestConnectionId(1));
+  EXPECT_EQ(start + kLifeSpan, alarm->deadline());
+  clock_.AdvanceTime(kLifeSpan * 0.5);
+  EnqueuePacket(TestConnectionId(2));
+  EnqueuePacket(TestConnectionId(2));
+
+  clock_.AdvanceTime(alarm->deadline() - clock_.ApproximateNow());
+  alarm_factory_.FireAlarm(alarm);
+  EXPECT_FALSE(bounded_store_->HasBufferedPackets(TestConnectionId(1)));
+  EXPECT_TRUE(bounded_store_->HasBufferedPackets(TestConnectionId(2)));
+  EXPECT_EQ(2u, bounded_store_->num_buffered_packets());
+  // The alarm fires again when connection 2 expires, rather than a whole life
+  // span later.
+  EXPECT_EQ(start + kLifeSpan * 1.5, alarm->deadline());
+
+  clock_.AdvanceTime(alarm->deadline() - clock_.ApproximateNow());
+  alarm_factory_.FireAlarm(alarm);
+  EXPECT_FALSE(bounded_store_->HasBufferedPackets(TestConnectionId(2)));
+  EXPECT_EQ(2u, visitor_.last_expired_packet_queue_.buffered_packets.size());
+  EXPECT_EQ(0u, bounded_store_->num_buffered_bytes());
+  EXPECT_FALSE(alarm->IsSet());
+}
+
+// Replays multi-packet TLS CHLO flights the way QuicDispatcher buffers them:
+// the first packet of each flight is buffered until the second one completes
+// the CHLO.
+TEST_F(QuicBoundedBufferedPacketStoreTest, DISABLED_MultiPacketChloFlights) {
+  const size_t kConnectionsPerRound = kMaxConnectionsWithoutCHLO;
+  const size_t kNumRounds = 200;
+  QuicConfig config;
+  config.custom_transport_parameters_to_send()
+      [static_cast<TransportParameters::TransportParameterId>(0xff33)] =
+      std::string(2000, '-');
+  auto flight = GetFirstFlightOfPackets(valid_version_, config);
+  ASSERT_EQ(2u, flight.size());
+
+  for (bool bounded : {false, true}) {
+    SetQuicRestartFlag(quic_bounded_buffered_packet_store, bounded);
+    QuicBufferedPacketStore store(&visitor_, &clock_, &alarm_factory_);
+    std::vector<std::string> alpns;
+    std::string sni;
+    bool resumption_attempted;
+    bool early_data_attempted;
+    size_t num_chlos = 0;
+    size_t max_buffered_bytes = 0;
+
+    const absl::Time start = absl::Now();
+    for (size_t round = 0; round < kNumRounds; ++round) {
+      for (size_t i = 0; i < kConnectionsPerRound; ++i) {
+        store.EnqueuePacket(TestConnectionId(i), true, *flight[0],
+                            self_address_, peer_address_, valid_version_,
+                            kNoParsedChlo);
+      }
+      max_buffered_bytes =
+          std::max<size_t>(max_buffered_bytes, store.num_buffered_bytes());
+      for (size_t i = 0; i < kConnectionsPerRound; ++i) {
+        if (store.IngestPacketForTlsChloExtraction(
+                TestConnectionId(i), valid_version_, *flight[1], &alpns, &sni,
+                &resumption_attempted, &early_data_attempted)) {
+          ++num_chlos;
+          store.DeliverPackets(TestConnectionId(i));
+        }
+      }
+    }
+    const absl::Duration elapsed = absl::Now() - start;
+
+    EXPECT_EQ(kConnectionsPerRound * kNumRounds, num_chlos);
+    EXPECT_EQ(0u, store.num_buffered_packets());
+    QUIC_LOG(INFO) << (bounded ? "Bounded" : "Unbounded") << " store: "
+                   << absl::ToDoubleMicroseconds(elapsed) / num_chlos
+                   << " us/CHLO, " << max_buffered_bytes
+                   << " bytes buffered at most, "
+                   << store.GetPacketBufferMemoryUsage()
+                   << " bytes of pooled packet buffers.";
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
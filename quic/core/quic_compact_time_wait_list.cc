@@ -0,0 +1,243 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_compact_time_wait_list.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+namespace {
+
+QuicTime::Delta GetSlotDuration(QuicTime::Delta time_wait_period) {
+  return QuicTime::Delta::FromMicroseconds(std::max<int64_t>(
+      1, time_wait_period.ToMicroseconds() /
+             QuicCompactTimeWaitList::kNumWheelSlots));
+}
+
+}  // namespace
+
+QuicCompactTimeWaitList::QuicCompactTimeWaitList(
+    QuicTime::Delta time_wait_period)
+    : time_wait_period_(time_wait_period),
+      slot_duration_(GetSlotDuration(time_wait_period)) {}
+
+QuicCompactTimeWaitList::~QuicCompactTimeWaitList() = default;
+
+QuicCompactTimeWaitList::Connection* QuicCompactTimeWaitList::Find(
+    const QuicConnectionId& connection_id) {
+  auto it = connection_ids_.find(connection_id);
+  if (it == connection_ids_.end()) {
+    return nullptr;
+  }
+  return &connections_[it->second];
+}
+
+bool QuicCompactTimeWaitList::Contains(
+    const QuicConnectionId& connection_id) const {
+  return connection_ids_.contains(connection_id);
+}
+
+void QuicCompactTimeWaitList::Add(
+    QuicTime time_added,
+    int num_packets,
+    QuicTimeWaitListManager::TimeWaitAction action,
+    TimeWaitConnectionInfo info) {
+  QUICHE_DCHECK(!info.active_connection_ids.empty());
+  uint32_t index;
+  if (!free_indices_.empty()) {
+    index = free_indices_.back();
+    free_indices_.pop_back();
+  } else {
+    if (connections_.size() >= std::numeric_limits<uint32_t>::max()) {
+      QUIC_BUG(quic_bug_compact_time_wait_list_full)
+          << "Too many connections in time wait";
+      return;
+    }
+    index = connections_.size();
+    connections_.emplace_back();
+  }
+
+  Connection& connection = connections_[index];
+  connection.canonical_connection_id = info.active_connection_ids.front();
+  connection.time_added = time_added;
+  connection.srtt = info.srtt;
+  connection.num_packets = num_packets;
+  connection.action = action;
+  connection.ietf_quic = info.ietf_quic;
+  connection.has_additional_connection_ids =
+      info.active_connection_ids.size() > 1;
+  if (info.termination_packet_template.has_value()) {
+    connection.template_index =
+        AddTemplateReference(*info.termination_packet_template);
+  }
+  if (connection.template_index == kNoTemplate &&
+      !info.termination_packets.empty()) {
+    size_t length = 0;
+    for (const auto& packet : info.termination_packets) {
+      length += sizeof(QuicPacketLength) + packet->length();
+    }
+    connection.termination_packets = std::make_unique<char[]>(length);
+    char* data = connection.termination_packets.get();
+    for (const auto& packet : info.termination_packets) {
+      const QuicPacketLength packet_length = packet->length();
+      memcpy(data, &packet_length, sizeof(packet_length));
+      data += sizeof(packet_length);
+      if (packet_length > 0) {
+        memcpy(data, packet->data(), packet_length);
+        data += packet_length;
+      }
+    }
+    connection.num_termination_packets = info.termination_packets.size();
+  }
+
+  for (const QuicConnectionId& connection_id : info.active_connection_ids) {
+    const bool inserted = connection_ids_.emplace(connection_id, index).second;
+    QUICHE_DCHECK(inserted) << connection_id << " is already in time wait";
+  }
+  if (connection.has_additional_connection_ids) {
+    info.active_connection_ids.erase(info.active_connection_ids.begin());
+    additional_connection_ids_[index] = std::move(info.active_connection_ids);
+  }
+
+  const int64_t slot_number = SlotNumber(time_added + time_wait_period_);
+  if (wheel_.empty() || wheel_.back().number < slot_number) {
+    wheel_.emplace_back();
+    wheel_.back().number = slot_number;
+  }
+  wheel_.back().entries.push_back({index, connection.generation});
+}
+
+void QuicCompactTimeWaitList::Remove(const QuicConnectionId& connection_id) {
+  auto it = connection_ids_.find(connection_id);
+  if (it != connection_ids_.end()) {
+    RemoveAt(it->second);
+  }
+}
+
+bool QuicCompactTimeWaitList::MaybeRemoveOldest(QuicTime expiration_time) {
+  const WheelEntry* entry = OldestEntry();
+  if (entry == nullptr ||
+      connections_[entry->index].time_added > expiration_time) {
+    return false;
+  }
+  QUIC_DLOG(INFO) << "Connection "
+                  << connections_[entry->index].canonical_connection_id
+                  << " expired from time wait list";
+  RemoveAt(entry->index);
+  ++wheel_.front().begin;
+  return true;
+}
+
+QuicTime QuicCompactTimeWaitList::NextExpirationTime() const {
+  for (const WheelSlot& slot : wheel_) {
+    for (size_t i = slot.begin; i < slot.entries.size(); ++i) {
+      if (connections_[slot.entries[i].index].generation ==
+          slot.entries[i].generation) {
+        return QuicTime::Zero() +
+               QuicTime::Delta::FromMicroseconds(
+                   slot_duration_.ToMicroseconds() * (slot.number + 1));
+      }
+    }
+  }
+  return QuicTime::Zero();
+}
+
+const TerminationPacketTemplate* QuicCompactTimeWaitList::GetTemplate(
+    const Connection& connection) const {
+  if (connection.template_index == kNoTemplate) {
+    return nullptr;
+  }
+  return &templates_[connection.template_index].termination_template;
+}
+
+void QuicCompactTimeWaitList::CopyTerminationPackets(
+    const Connection& connection,
+    std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) const {
+  const char* data = connection.termination_packets.get();
+  for (uint16_t i = 0; i < connection.num_termination_packets; ++i) {
+    QuicPacketLength packet_length;
+    memcpy(&packet_length, data, sizeof(packet_length));
+    data += sizeof(packet_length);
+    packets->push_back(QuicEncryptedPacket(data, packet_length).Clone());
+    data += packet_length;
+  }
+}
+
+uint16_t QuicCompactTimeWaitList::AddTemplateReference(
+    const TerminationPacketTemplate& termination_template) {
+  auto it = template_indices_.find(termination_template);
+  if (it != template_indices_.end()) {
+    ++templates_[it->second].num_connections;
+    return it->second;
+  }
+  uint16_t index;
+  if (!free_template_indices_.empty()) {
+    index = free_template_indices_.back();
+    free_template_indices_.pop_back();
+  } else {
+    if (templates_.size() >= kNoTemplate) {
+      return kNoTemplate;
+    }
+    index = templates_.size();
+    templates_.emplace_back();
+  }
+  templates_[index].termination_template = termination_template;
+  templates_[index].num_connections = 1;
+  template_indices_.emplace(termination_template, index);
+  return index;
+}
+
+void QuicCompactTimeWaitList::RemoveAt(uint32_t index) {
+  Connection& connection = connections_[index];
+  connection_ids_.erase(connection.canonical_connection_id);
+  if (connection.has_additional_connection_ids) {
+    auto it = additional_connection_ids_.find(index);
+    for (const QuicConnectionId& connection_id : it->second) {
+      connection_ids_.erase(connection_id);
+    }
+    additional_connection_ids_.erase(it);
+  }
+  if (connection.template_index != kNoTemplate) {
+    TemplateRecord& record = templates_[connection.template_index];
+    if (--record.num_connections == 0) {
+      template_indices_.erase(record.termination_template);
+      record.termination_template = TerminationPacketTemplate();
+      free_template_indices_.push_back(connection.template_index);
+    }
+  }
+  const uint32_t generation = connection.generation + 1;
+  connection = Connection();
+  connection.generation = generation;
+  free_indices_.push_back(index);
+}
+
+const QuicCompactTimeWaitList::WheelEntry*
+QuicCompactTimeWaitList::OldestEntry() {
+  while (!wheel_.empty()) {
+    WheelSlot& slot = wheel_.front();
+    for (; slot.begin < slot.entries.size(); ++slot.begin) {
+      const WheelEntry& entry = slot.entries[slot.begin];
+      if (connections_[entry.index].generation == entry.generation) {
+        return &entry;
+      }
+    }
+    wheel_.pop_front();
+  }
+  return nullptr;
+}
+
+int64_t QuicCompactTimeWaitList::SlotNumber(QuicTime expiration_time) const {
+  return (expiration_time - QuicTime::Zero()).ToMicroseconds() /
+         slot_duration_.ToMicroseconds();
+}
+
+}  // namespace quic
@@ -0,0 +1,182 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_COMPACT_TIME_WAIT_LIST_H_
+#define QUICHE_QUIC_CORE_QUIC_COMPACT_TIME_WAIT_LIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "quic/core/quic_connection_id.h"
+#include "quic/core/quic_packets.h"
+#include "quic/core/quic_time.h"
+#include "quic/core/quic_time_wait_list_manager.h"
+#include "quic/platform/api/quic_export.h"
+#include "common/quiche_circular_deque.h"
+
+namespace quic {
+
+// Stores the connections of a QuicTimeWaitListManager in a compact form, for
+// servers which may have millions of connections in time wait after a mass
+// disconnect:
+// - Connection IDs are keys of a flat hash table, whose values are indices
+//   into a vector of fixed-size connection records.
+// - Termination packets described by a TerminationPacketTemplate are not
+//   stored, but rebuilt on demand. Connections refer to a table of the
+//   distinct templates instead. Other termination packets are concatenated
+//   into a single buffer per connection.
+// - Connections are expired by a timing wheel, whose slots hold the
+//   connections expiring within the same 1/kNumWheelSlots of the time wait
+//   period, in the order they were added. Expiring connections therefore
+//   neither requires a linked list through the connection records nor an
+//   alarm per connection.
+class QUIC_NO_EXPORT QuicCompactTimeWaitList {
+ public:
+  // State of a connection in time wait, other than its connection IDs and
+  // termination packets.
+  struct QUIC_NO_EXPORT Connection {
+    // The first connection ID of the connection, which its templated
+    // termination packets are built for.
+    QuicConnectionId canonical_connection_id;
+    QuicTime time_added = QuicTime::Zero();
+    QuicTime::Delta srtt = QuicTime::Delta::Zero();
+    int num_packets = 0;
+    QuicTimeWaitListManager::TimeWaitAction action =
+        QuicTimeWaitListManager::DO_NOTHING;
+    bool ietf_quic = false;
+
+   private:
+    friend class QuicCompactTimeWaitList;
+
+    // The number of packets in |termination_packets|, each of which is
+    // preceded by its QuicPacketLength.
+    uint16_t num_termination_packets = 0;
+    // Index of the termination packet template in |templates_|, or
+    // kNoTemplate.
+    uint16_t template_index = kNoTemplate;
+    bool has_additional_connection_ids = false;
+    // Incremented whenever the record is removed, so that wheel entries
+    // referring to the previous connection are ignored.
+    uint32_t generation = 0;
+    std::unique_ptr<char[]> termination_packets;
+  };
+
+  // Number of slots of the timing wheel per time wait period.
+  static const int kNumWheelSlots = 64;
+
+  explicit QuicCompactTimeWaitList(QuicTime::Delta time_wait_period);
+  QuicCompactTimeWaitList(const QuicCompactTimeWaitList&) = delete;
+  QuicCompactTimeWaitList& operator=(const QuicCompactTimeWaitList&) = delete;
+  ~QuicCompactTimeWaitList();
+
+  // Returns the connection |connection_id| belongs to, or nullptr if it is not
+  // in the list.
+  Connection* Find(const QuicConnectionId& connection_id);
+  bool Contains(const QuicConnectionId& connection_id) const;
+
+  // Adds a connection with the connection IDs of |info|, none of which may be
+  // in the list. The termination packets of |info| are not used if it has a
+  // termination packet template.
+  void Add(QuicTime time_added,
+           int num_packets,
+           QuicTimeWaitListManager::TimeWaitAction action,
+           TimeWaitConnectionInfo info);
+
+  // Removes the connection |connection_id| belongs to, with all its connection
+  // IDs.
+  void Remove(const QuicConnectionId& connection_id);
+
+  // Removes the oldest connection if it was added at or before
+  // |expiration_time|. Returns false if the list is empty or the oldest
+  // connection has not expired.
+  bool MaybeRemoveOldest(QuicTime expiration_time);
+
+  // Returns the time at which all the connections of the oldest slot of the
+  // timing wheel will have expired, or QuicTime::Zero() if the list is empty.
+  QuicTime NextExpirationTime() const;
+
+  // Returns the termination packet template of |connection|, or nullptr if it
+  // has none.
+  const TerminationPacketTemplate* GetTemplate(
+      const Connection& connection) const;
+
+  // Appends copies of the stored termination packets of |connection| to
+  // |packets|.
+  void CopyTerminationPackets(
+      const Connection& connection,
+      std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) const;
+
+  // The number of connections in the list.
+  size_t size() const { return connections_.size() - free_indices_.size(); }
+  bool empty() const { return size() == 0; }
+
+ private:
+  static const uint16_t kNoTemplate = UINT16_MAX;
+
+  struct QUIC_NO_EXPORT WheelEntry {
+    uint32_t index;
+    uint32_t generation;
+  };
+
+  // The entries of the connections expiring in a slot of the timing wheel.
+  struct QUIC_NO_EXPORT WheelSlot {
+    // Absolute number of the slot, counted from QuicTime::Zero().
+    int64_t number;
+    // Index of the first entry which has not been removed.
+    size_t begin = 0;
+    std::vector<WheelEntry> entries;
+  };
+
+  struct QUIC_NO_EXPORT TemplateRecord {
+    TerminationPacketTemplate termination_template;
+    // Zero if the record is unused.
+    size_t num_connections = 0;
+  };
+
+  // Returns the index of the record of |termination_template| in |templates_|,
+  // which is added if needed, or kNoTemplate if there is no room for it.
+  uint16_t AddTemplateReference(
+      const TerminationPacketTemplate& termination_template);
+
+  // Removes the connection at |index| of |connections_|.
+  void RemoveAt(uint32_t index);
+
+  // Returns the live connection at the front of the oldest slot of the wheel,
+  // after dropping any stale entries and empty slots in front of it, or
+  // nullptr if the list is empty.
+  const WheelEntry* OldestEntry();
+
+  // Number of the wheel slot of connections expiring at |expiration_time|.
+  int64_t SlotNumber(QuicTime expiration_time) const;
+
+  const QuicTime::Delta time_wait_period_;
+  const QuicTime::Delta slot_duration_;
+
+  absl::flat_hash_map<QuicConnectionId, uint32_t, QuicConnectionIdHash>
+      connection_ids_;
+  std::vector<Connection> connections_;
+  // Indices of the unused records of |connections_|.
+  std::vector<uint32_t> free_indices_;
+  // The connection IDs other than the canonical one, of the connections which
+  // have several, keyed by connection index.
+  absl::flat_hash_map<uint32_t, std::vector<QuicConnectionId>>
+      additional_connection_ids_;
+  std::vector<TemplateRecord> templates_;
+  // Indices into |templates_| of the records in use, keyed by their template.
+  absl::flat_hash_map<TerminationPacketTemplate, uint16_t> template_indices_;
+  // Indices of the unused records of |templates_|.
+  std::vector<uint16_t> free_template_indices_;
+  // Slots of the timing wheel which have entries, oldest first. A slot is only
+  // created when a connection is added to it, so that connections added while
+  // expiration lags behind never share a slot with newer ones.
+  quiche::QuicheCircularDeque<WheelSlot> wheel_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_COMPACT_TIME_WAIT_LIST_H_
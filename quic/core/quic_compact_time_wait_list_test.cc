@@ -0,0 +1,207 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_compact_time_wait_list.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "quic/core/quic_connection_id.h"
+#include "quic/core/quic_packets.h"
+#include "quic/core/quic_time.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const QuicTime::Delta kTimeWaitPeriod = QuicTime::Delta::FromSeconds(64);
+
+class QuicCompactTimeWaitListTest : public QuicTest {
+ protected:
+  QuicCompactTimeWaitListTest()
+      : list_(kTimeWaitPeriod),
+        now_(QuicTime::Zero() + QuicTime::Delta::FromSeconds(1000)) {}
+
+  void Add(std::vector<QuicConnectionId> connection_ids,
+           std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+    list_.Add(now_, /*num_packets=*/0,
+              QuicTimeWaitListManager::SEND_TERMINATION_PACKETS,
+              TimeWaitConnectionInfo(/*ietf_quic=*/true, packets,
+                                     std::move(connection_ids)));
+  }
+
+  void Add(QuicConnectionId connection_id) { Add({connection_id}, nullptr); }
+
+  QuicCompactTimeWaitList list_;
+  QuicTime now_;
+};
+
+TEST_F(QuicCompactTimeWaitListTest, AddFindRemove) {
+  EXPECT_TRUE(list_.empty());
+  EXPECT_EQ(nullptr, list_.Find(TestConnectionId(1)));
+
+  Add(TestConnectionId(1));
+  Add({TestConnectionId(2), TestConnectionId(3)}, nullptr);
+  EXPECT_EQ(2u, list_.size());
+  EXPECT_TRUE(list_.Contains(TestConnectionId(1)));
+  EXPECT_TRUE(list_.Contains(TestConnectionId(3)));
+  EXPECT_FALSE(list_.Contains(TestConnectionId(4)));
+
+  QuicCompactTimeWaitList::Connection* connection =
+      list_.Find(TestConnectionId(3));
+  ASSERT_NE(nullptr, connection);
+  EXPECT_EQ(connection, list_.Find(TestConnectionId(2)));
+  EXPECT_EQ(TestConnectionId(2), connection->canonical_connection_id);
+  EXPECT_EQ(now_, connection->time_added);
+  EXPECT_EQ(QuicTimeWaitListManager::SEND_TERMINATION_PACKETS,
+            connection->action);
+  EXPECT_TRUE(connection->ietf_quic);
+
+  // Removing any connection ID removes all the connection IDs of the
+  // connection.
+  list_.Remove(TestConnectionId(3));
+  EXPECT_FALSE(list_.Contains(TestConnectionId(2)));
+  EXPECT_FALSE(list_.Contains(TestConnectionId(3)));
+  EXPECT_TRUE(list_.Contains(TestConnectionId(1)));
+  EXPECT_EQ(1u, list_.size());
+
+  // The removed record is reused.
+  Add(TestConnectionId(4));
+  EXPECT_EQ(2u, list_.size());
+  EXPECT_EQ(TestConnectionId(4),
+            list_.Find(TestConnectionId(4))->canonical_connection_id);
+}
+
+TEST_F(QuicCompactTimeWaitListTest, StoredTerminationPackets) {
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> packets;
+  packets.push_back(std::make_unique<QuicEncryptedPacket>("close", 5));
+  packets.push_back(std::make_unique<QuicEncryptedPacket>(nullptr, 0));
+  packets.push_back(std::make_unique<QuicEncryptedPacket>("close2", 6));
+  Add({TestConnectionId(1)}, &packets);
+
+  const QuicCompactTimeWaitList::Connection* connection =
+      list_.Find(TestConnectionId(1));
+  EXPECT_EQ(nullptr, list_.GetTemplate(*connection));
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> copies;
+  list_.CopyTerminationPackets(*connection, &copies);
+  ASSERT_EQ(3u, copies.size());
+  EXPECT_EQ("close", copies[0]->AsStringPiece());
+  EXPECT_EQ("", copies[1]->AsStringPiece());
+  EXPECT_EQ("close2", copies[2]->AsStringPiece());
+}
+
+TEST_F(QuicCompactTimeWaitListTest, TemplatesAreShared) {
+  TerminationPacketTemplate termination_template;
+  termination_template.type = TerminationPacketTemplate::CONNECTION_CLOSE;
+  termination_template.version = CurrentSupportedVersions().front();
+  termination_template.error_code = QUIC_HANDSHAKE_FAILED;
+  termination_template.error_details = "Reject connection";
+  for (uint64_t i = 1; i <= 2; ++i) {
+    TimeWaitConnectionInfo info(/*ietf_quic=*/true, nullptr,
+                                {TestConnectionId(i)});
+    info.termination_packet_template = termination_template;
+    list_.Add(now_, 0, QuicTimeWaitListManager::SEND_TERMINATION_PACKETS,
+              std::move(info));
+  }
+
+  const TerminationPacketTemplate* template1 =
+      list_.GetTemplate(*list_.Find(TestConnectionId(1)));
+  ASSERT_NE(nullptr, template1);
+  EXPECT_EQ(termination_template, *template1);
+  EXPECT_EQ(template1, list_.GetTemplate(*list_.Find(TestConnectionId(2))));
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> copies;
+  list_.CopyTerminationPackets(*list_.Find(TestConnectionId(1)), &copies);
+  EXPECT_TRUE(copies.empty());
+}
+
+TEST_F(QuicCompactTimeWaitListTest, UnusedTemplatesAreReleased) {
+  TerminationPacketTemplate template1;
+  template1.version = CurrentSupportedVersions().front();
+  template1.error_code = QUIC_HANDSHAKE_FAILED;
+  template1.error_details = "Reject connection";
+  TerminationPacketTemplate template2 = template1;
+  template2.error_details = "Other reason";
+  auto add_with_template = [this](uint64_t i,
+                                  const TerminationPacketTemplate& t) {
+    TimeWaitConnectionInfo info(/*ietf_quic=*/true, nullptr,
+                                {TestConnectionId(i)});
+    info.termination_packet_template = t;
+    list_.Add(now_, 0, QuicTimeWaitListManager::SEND_TERMINATION_PACKETS,
+              std::move(info));
+  };
+
+  add_with_template(1, template1);
+  const TerminationPacketTemplate* first_record =
+      list_.GetTemplate(*list_.Find(TestConnectionId(1)));
+  list_.Remove(TestConnectionId(1));
+
+  // The record of the template no connection refers to is reused.
+  add_with_template(2, template2);
+  EXPECT_EQ(first_record, list_.GetTemplate(*list_.Find(TestConnectionId(2))));
+  EXPECT_EQ(template2, *list_.GetTemplate(*list_.Find(TestConnectionId(2))));
+
+  // And the released template is no longer matched.
+  add_with_template(3, template1);
+  const TerminationPacketTemplate* third =
+      list_.GetTemplate(*list_.Find(TestConnectionId(3)));
+  EXPECT_NE(first_record, third);
+  EXPECT_EQ(template1, *third);
+}
+
+TEST_F(QuicCompactTimeWaitListTest, ExpiresInOrderAdded) {
+  const QuicTime start = now_;
+  for (uint64_t i = 1; i <= 3; ++i) {
+    Add(TestConnectionId(i));
+    now_ = now_ + QuicTime::Delta::FromSeconds(10);
+  }
+  // Replacing a connection moves it to the end.
+  list_.Remove(TestConnectionId(1));
+  Add(TestConnectionId(1));
+
+  EXPECT_FALSE(list_.MaybeRemoveOldest(start));
+  const QuicTime expiration_time = start + QuicTime::Delta::FromSeconds(20);
+  EXPECT_TRUE(list_.MaybeRemoveOldest(expiration_time));
+  EXPECT_FALSE(list_.Contains(TestConnectionId(2)));
+  EXPECT_TRUE(list_.MaybeRemoveOldest(expiration_time));
+  EXPECT_FALSE(list_.Contains(TestConnectionId(3)));
+  EXPECT_FALSE(list_.MaybeRemoveOldest(expiration_time));
+  EXPECT_TRUE(list_.Contains(TestConnectionId(1)));
+  // Trimming removes the oldest connection regardless of its age.
+  EXPECT_TRUE(list_.MaybeRemoveOldest(QuicTime::Infinite()));
+  EXPECT_TRUE(list_.empty());
+  EXPECT_FALSE(list_.MaybeRemoveOldest(QuicTime::Infinite()));
+}
+
+TEST_F(QuicCompactTimeWaitListTest, NextExpirationTimeIsEndOfSlot) {
+  EXPECT_EQ(QuicTime::Zero(), list_.NextExpirationTime());
+  const QuicTime::Delta slot_duration =
+      kTimeWaitPeriod * (1.0 / QuicCompactTimeWaitList::kNumWheelSlots);
+
+  // Connections added within a slot duration of each other expire together.
+  Add(TestConnectionId(1));
+  now_ = now_ + slot_duration * 0.5;
+  Add(TestConnectionId(2));
+  const QuicTime next_expiration_time = list_.NextExpirationTime();
+  EXPECT_LE(now_ + kTimeWaitPeriod, next_expiration_time);
+  EXPECT_GT(now_ + kTimeWaitPeriod + slot_duration, next_expiration_time);
+
+  // Connections of the next slot expire one slot duration later.
+  now_ = now_ + slot_duration;
+  Add(TestConnectionId(3));
+  EXPECT_TRUE(list_.MaybeRemoveOldest(QuicTime::Infinite()));
+  EXPECT_EQ(next_expiration_time, list_.NextExpirationTime());
+  EXPECT_TRUE(list_.MaybeRemoveOldest(QuicTime::Infinite()));
+  EXPECT_EQ(next_expiration_time + slot_duration, list_.NextExpirationTime());
+
+  // Slots only holding removed connections are skipped.
+  list_.Remove(TestConnectionId(3));
+  EXPECT_EQ(QuicTime::Zero(), list_.NextExpirationTime());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
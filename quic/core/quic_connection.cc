@@ -264,23 +264,36 @@ QuicConnection::QuicConnection(
       consecutive_retransmittable_on_wire_ping_count_(0),
       retransmittable_on_wire_ping_count_(0),
       arena_(),
-      ack_alarm_(alarm_factory_->CreateAlarm(arena_.New<AckAlarmDelegate>(this),
-                                             &arena_)),
-      retransmission_alarm_(alarm_factory_->CreateAlarm(
+      alarm_multiplexer_(
+          GetQuicRestartFlag(quic_multiplex_connection_alarms)
+              ? std::make_unique<QuicAlarmMultiplexer>(clock_, alarm_factory_,
+                                                       &arena_)
+              : nullptr),
+      connection_alarm_factory_(alarm_multiplexer_ != nullptr
+                                    ? alarm_multiplexer_.get()
+                                    : alarm_factory_),
+      ack_alarm_(connection_alarm_factory_->CreateAlarm(
+          arena_.New<AckAlarmDelegate>(this), &arena_)),
+      retransmission_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<RetransmissionAlarmDelegate>(this), &arena_)),
-      send_alarm_(alarm_factory_->CreateAlarm(
+      send_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<SendAlarmDelegate>(this), &arena_)),
-      ping_alarm_(alarm_factory_->CreateAlarm(
+      ping_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<PingAlarmDelegate>(this), &arena_)),
-      mtu_discovery_alarm_(alarm_factory_->CreateAlarm(
+      mtu_discovery_alarm_(connection_alarm_factory_->CreateAlarm(
           arena_.New<MtuDiscoveryAlarmDelegate>(this), &arena_)),
-      process_undecryptable_packets_alarm_(alarm_factory_->CreateAlarm(
-          arena_.New<ProcessUndecryptablePacketsAlarmDelegate>(this), &arena_)),
-      discard_previous_one_rtt_keys_alarm_(alarm_factory_->CreateAlarm(
-          arena_.New<DiscardPreviousOneRttKeysAlarmDelegate>(this), &arena_)),
-      discard_zero_rtt_decryption_keys_alarm_(alarm_factory_->CreateAlarm(
-          arena_.New<DiscardZeroRttDecryptionKeysAlarmDelegate>(this),
-          &arena_)),
+      process_undecryptable_packets_alarm_(
+          connection_alarm_factory_->CreateAlarm(
+              arena_.New<ProcessUndecryptablePacketsAlarmDelegate>(this),
+              &arena_)),
+      discard_previous_one_rtt_keys_alarm_(
+          connection_alarm_factory_->CreateAlarm(
+              arena_.New<DiscardPreviousOneRttKeysAlarmDelegate>(this),
+              &arena_)),
+      discard_zero_rtt_decryption_keys_alarm_(
+          connection_alarm_factory_->CreateAlarm(
+              arena_.New<DiscardZeroRttDecryptionKeysAlarmDelegate>(this),
+              &arena_)),
       visitor_(nullptr),
       debug_visitor_(nullptr),
       packet_creator_(server_connection_id, &framer_, random_generator_, this),
@@ -308,11 +321,12 @@ QuicConnection::QuicConnection(
       processing_ack_frame_(false),
       supports_release_time_(false),
       release_time_into_future_(QuicTime::Delta::Zero()),
-      blackhole_detector_(this, &arena_, alarm_factory_, &context_),
+      blackhole_detector_(this, &arena_, connection_alarm_factory_,
+                          &context_),
       idle_network_detector_(this, clock_->ApproximateNow(), &arena_,
-                             alarm_factory_, &context_),
-      path_validator_(alarm_factory_, &arena_, this, random_generator_,
-                      &context_),
+                             connection_alarm_factory_, &context_),
+      path_validator_(connection_alarm_factory_, &arena_, this,
+                      random_generator_, &context_),
       most_recent_frame_type_(NUM_FRAME_TYPES) {
   QUICHE_DCHECK(perspective_ == Perspective::IS_CLIENT ||
                 default_path_.self_address.IsInitialized());
@@ -326,6 +340,9 @@ QuicConnection::QuicConnection(
       << "QuicConnection: attempted to use server connection ID "
       << server_connection_id << " which is invalid with version " << version();
   framer_.set_visitor(this);
+  if (alarm_multiplexer_ != nullptr) {
+    QUIC_RESTART_FLAG_COUNT(quic_multiplex_connection_alarms);
+  }
   stats_.connection_creation_time = clock_->ApproximateNow();
   // TODO(ianswett): Supply the NetworkChangeVisitor as a constructor argument
   // and make it required non-null, because it's always used.
@@ -2998,7 +3015,7 @@ void QuicConnection::ReplaceInitialServerConnectionId(
         peer_issued_cid_manager_ =
             std::make_unique<QuicPeerIssuedConnectionIdManager>(
                 kMinNumOfActiveConnectionIds, new_server_connection_id, clock_,
-                alarm_factory_, this, context());
+                connection_alarm_factory_, this, context());
       }
     }
   }
@@ -3532,6 +3549,11 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
           break;
         }
       }
+      if (packet->encryption_level != ENCRYPTION_INITIAL) {
+        // INITIAL packets are re-serialized when the coalesced packet is
+        // flushed, other packets are copied into the coalescer.
+        ++stats_.num_serialized_packet_copies;
+      }
       if (coalesced_packet_.length() < coalesced_packet_.max_packet_length()) {
         QUIC_DVLOG(1) << ENDPOINT << "Trying to set soft max packet length to "
                       << coalesced_packet_.max_packet_length() -
@@ -3544,8 +3566,15 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
       QUIC_DVLOG(1) << ENDPOINT << "Adding packet: " << packet->packet_number
                     << " to buffered packets";
       buffered_packets_.emplace_back(*packet, self_address(), send_to_address);
+      ++stats_.num_serialized_packet_copies;
       break;
     case SEND_TO_WRITER:
+      if (writer_->IsBatchMode() && version().CanSendCoalescedPackets() &&
+          !coalescing_done_) {
+        // GetPacketBuffer() did not return the writer's buffer when this
+        // packet was serialized, so the writer copies it.
+        ++stats_.num_serialized_packet_copies;
+      }
       // Stop using coalescer from now on.
       coalescing_done_ = true;
       // At this point, packet->release_encrypted_buffer is either nullptr,
@@ -3605,6 +3634,7 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
         // Buffer the packet.
         buffered_packets_.emplace_back(*packet, self_address(),
                                        send_to_address);
+        ++stats_.num_serialized_packet_copies;
       } else {  // Send the packet to the writer.
         // writer_->WritePacket transfers buffer ownership back to the writer.
         packet->release_encrypted_buffer = nullptr;
@@ -3636,6 +3666,7 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
       QUIC_DVLOG(1) << ENDPOINT << "Adding packet: " << packet->packet_number
                     << " to buffered packets";
       buffered_packets_.emplace_back(*packet, self_address(), send_to_address);
+      ++stats_.num_serialized_packet_copies;
     }
   }
 
@@ -3752,7 +3783,7 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
           packet->encryption_level,
           sent_packet_manager_.unacked_packets()
               .rbegin()
-              ->retransmittable_frames,
+              ->retransmittable_frames.frames(),
           packet->nonretransmittable_frames, packet_send_time);
     }
   }
@@ -4099,7 +4130,7 @@ QuicConnection::MakeSelfIssuedConnectionIdManager() {
       perspective_ == Perspective::IS_CLIENT
           ? default_path_.client_connection_id
           : default_path_.server_connection_id,
-      clock_, alarm_factory_, this, context());
+      perspective_, clock_, connection_alarm_factory_, this, context());
 }
 
 void QuicConnection::MaybeSendConnectionIdToClient() {
@@ -5207,7 +5238,7 @@ bool QuicConnection::WritePacketUsingWriter(
           packet->encryption_level,
           sent_packet_manager_.unacked_packets()
               .rbegin()
-              ->retransmittable_frames,
+              ->retransmittable_frames.frames(),
           packet->nonretransmittable_frames, packet_send_time);
     }
   }
@@ -6060,7 +6091,21 @@ bool QuicConnection::FlushCoalescedPacket() {
     return true;
   }
 
-  char buffer[kMaxOutgoingPacketSize];
+  char stack_buffer[kMaxOutgoingPacketSize];
+  // Serialize into the writer's buffer if it has one, so that batch writers do
+  // not copy the coalesced packet again. The buffer is released on return,
+  // unless it is handed over to the writer.
+  QuicOwnedPacketBuffer writer_buffer(
+      GetQuicRestartFlag(quic_serialize_coalesced_packet_into_writer_buffer)
+          ? writer_->GetNextWriteLocation(
+                coalesced_packet_.self_address().host(),
+                coalesced_packet_.peer_address())
+          : QuicPacketBuffer());
+  char* buffer = stack_buffer;
+  if (writer_buffer.buffer != nullptr) {
+    QUIC_RESTART_FLAG_COUNT(quic_serialize_coalesced_packet_into_writer_buffer);
+    buffer = writer_buffer.buffer;
+  }
   const size_t length = packet_creator_.SerializeCoalescedPacket(
       coalesced_packet_, buffer, coalesced_packet_.max_packet_length());
   if (length == 0) {
@@ -6080,6 +6125,10 @@ bool QuicConnection::FlushCoalescedPacket() {
   }
   QUIC_DVLOG(1) << ENDPOINT << "Sending coalesced packet "
                 << coalesced_packet_.ToString(length);
+  // All packets but the INITIAL one are copied out of the coalescer.
+  stats_.num_serialized_packet_copies +=
+      coalesced_packet_.NumberOfPackets() -
+      (coalesced_packet_.initial_packet() != nullptr ? 1 : 0);
 
   if (!buffered_packets_.empty() || HandleWriteBlocked()) {
     QUIC_DVLOG(1) << ENDPOINT
@@ -6087,9 +6136,15 @@ bool QuicConnection::FlushCoalescedPacket() {
     buffered_packets_.emplace_back(
         buffer, static_cast<QuicPacketLength>(length),
         coalesced_packet_.self_address(), coalesced_packet_.peer_address());
+    ++stats_.num_serialized_packet_copies;
     return true;
   }
 
+  if (buffer == stack_buffer && writer_->IsBatchMode()) {
+    ++stats_.num_serialized_packet_copies;
+  }
+  // writer_->WritePacket transfers buffer ownership back to the writer.
+  writer_buffer.release_buffer = nullptr;
   WriteResult result = writer_->WritePacket(
       buffer, length, coalesced_packet_.self_address().host(),
       coalesced_packet_.peer_address(), per_packet_options_);
@@ -6105,6 +6160,7 @@ bool QuicConnection::FlushCoalescedPacket() {
       buffered_packets_.emplace_back(
           buffer, static_cast<QuicPacketLength>(length),
           coalesced_packet_.self_address(), coalesced_packet_.peer_address());
+      ++stats_.num_serialized_packet_copies;
     }
   }
   // Account for added padding.
@@ -6296,7 +6352,7 @@ void QuicConnection::set_client_connection_id(
       peer_issued_cid_manager_ =
           std::make_unique<QuicPeerIssuedConnectionIdManager>(
               kMinNumOfActiveConnectionIds, client_connection_id, clock_,
-              alarm_factory_, this, context());
+              connection_alarm_factory_, this, context());
     } else {
       // Note in Chromium client, set_client_connection_id is not called and
       // thus self_issued_cid_manager_ should be null.
@@ -6906,7 +6962,7 @@ void QuicConnection::CreateConnectionIdManager() {
       peer_issued_cid_manager_ =
           std::make_unique<QuicPeerIssuedConnectionIdManager>(
               kMinNumOfActiveConnectionIds, default_path_.server_connection_id,
-              clock_, alarm_factory_, this, context());
+              clock_, connection_alarm_factory_, this, context());
     }
   } else {
     if (!default_path_.server_connection_id.IsEmpty()) {
@@ -35,6 +35,7 @@
 #include "quic/core/proto/cached_network_parameters_proto.h"
 #include "quic/core/quic_alarm.h"
 #include "quic/core/quic_alarm_factory.h"
+#include "quic/core/quic_alarm_multiplexer.h"
 #include "quic/core/quic_blocked_writer_interface.h"
 #include "quic/core/quic_connection_context.h"
 #include "quic/core/quic_connection_id.h"
@@ -2062,6 +2063,15 @@ class QUIC_EXPORT_PRIVATE QuicConnection
   // Arena to store class implementations within the QuicConnection.
   QuicConnectionArena arena_;
 
+  // Keeps the deadlines of the alarms of the connection and of the objects it
+  // owns, and sets a single alarm of |alarm_factory_| for the earliest of
+  // them.  Only created if quic_restart_flag_quic_multiplex_connection_alarms
+  // is true.
+  std::unique_ptr<QuicAlarmMultiplexer> alarm_multiplexer_;
+  // Creates the alarms of the connection and of the objects it owns, either
+  // |alarm_multiplexer_| or |alarm_factory_|.
+  QuicAlarmFactory* connection_alarm_factory_;
+
   // An alarm that fires when an ACK should be sent to the peer.
   QuicArenaScopedPtr<QuicAlarm> ack_alarm_;
   // An alarm that fires when a packet needs to be retransmitted.
@@ -10,6 +10,8 @@
 #include "quic/core/quic_connection_id.h"
 #include "quic/core/quic_error_codes.h"
 #include "quic/core/quic_utils.h"
+#include "quic/platform/api/quic_flag_utils.h"
+#include "quic/platform/api/quic_flags.h"
 #include "common/platform/api/quiche_logging.h"
 
 namespace quic {
@@ -276,11 +278,12 @@ class RetireSelfIssuedConnectionIdAlarmDelegate
 
 QuicSelfIssuedConnectionIdManager::QuicSelfIssuedConnectionIdManager(
     size_t active_connection_id_limit,
-    const QuicConnectionId& initial_connection_id, const QuicClock* clock,
-    QuicAlarmFactory* alarm_factory,
+    const QuicConnectionId& initial_connection_id, Perspective perspective,
+    const QuicClock* clock, QuicAlarmFactory* alarm_factory,
     QuicConnectionIdManagerVisitorInterface* visitor,
     QuicConnectionContext* context)
     : active_connection_id_limit_(active_connection_id_limit),
+      perspective_(perspective),
       clock_(clock),
       visitor_(visitor),
       retire_connection_id_alarm_(alarm_factory->CreateAlarm(
@@ -297,7 +300,18 @@ QuicSelfIssuedConnectionIdManager::~QuicSelfIssuedConnectionIdManager() {
 
 QuicConnectionId QuicSelfIssuedConnectionIdManager::GenerateNewConnectionId(
     const QuicConnectionId& old_connection_id) const {
-  return QuicUtils::CreateReplacementConnectionId(old_connection_id);
+  QuicConnectionId new_connection_id =
+      QuicUtils::CreateReplacementConnectionId(old_connection_id);
+  // Only servers steer packets by connection ID. Client connection IDs do not
+  // keep the first byte, which would let observers link them.
+  if (GetQuicRestartFlag(quic_preserve_server_connection_id_first_byte) &&
+      perspective_ == Perspective::IS_SERVER && !old_connection_id.IsEmpty() &&
+      !new_connection_id.IsEmpty()) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_preserve_server_connection_id_first_byte, 1,
+                              3);
+    new_connection_id.mutable_data()[0] = old_connection_id.data()[0];
+  }
+  return new_connection_id;
 }
 
 QuicNewConnectionIdFrame
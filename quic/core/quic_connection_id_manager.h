@@ -123,7 +123,8 @@ class QUIC_EXPORT_PRIVATE QuicSelfIssuedConnectionIdManager {
  public:
   QuicSelfIssuedConnectionIdManager(
       size_t active_connection_id_limit,
-      const QuicConnectionId& initial_connection_id, const QuicClock* clock,
+      const QuicConnectionId& initial_connection_id, Perspective perspective,
+      const QuicClock* clock,
       QuicAlarmFactory* alarm_factory,
       QuicConnectionIdManagerVisitorInterface* visitor,
       QuicConnectionContext* context);
@@ -171,6 +172,8 @@ class QUIC_EXPORT_PRIVATE QuicSelfIssuedConnectionIdManager {
   // (1) # of active connection IDs that peer can maintain.
   // (2) maximum # of active connection IDs self plans to issue.
   size_t active_connection_id_limit_;
+  // Whether the connection IDs are server or client connection IDs.
+  const Perspective perspective_;
   const QuicClock* clock_;
   QuicConnectionIdManagerVisitorInterface* visitor_;
   // This tracks connection IDs issued to the peer but not retired by the peer.
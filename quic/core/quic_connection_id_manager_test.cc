@@ -7,6 +7,7 @@
 
 #include "quic/core/quic_connection_id.h"
 #include "quic/core/quic_error_codes.h"
+#include "quic/core/quic_utils.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/mock_clock.h"
 #include "quic/test_tools/quic_connection_id_manager_peer.h"
@@ -537,8 +538,8 @@ class QuicSelfIssuedConnectionIdManagerTest : public QuicTest {
  public:
   QuicSelfIssuedConnectionIdManagerTest()
       : cid_manager_(/*active_connection_id_limit*/ 2, initial_connection_id_,
-                     &clock_, &alarm_factory_, &cid_manager_visitor_,
-                     /*context=*/nullptr) {
+                     Perspective::IS_SERVER, &clock_, &alarm_factory_,
+                     &cid_manager_visitor_, /*context=*/nullptr) {
     clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(10));
     retire_self_issued_cid_alarm_ =
         QuicConnectionIdManagerPeer::GetRetireSelfIssuedConnectionIdAlarm(
@@ -960,5 +961,33 @@ TEST_F(QuicSelfIssuedConnectionIdManagerTest,
   cid_manager_.MaybeSendNewConnectionIds();
 }
 
+TEST_F(QuicSelfIssuedConnectionIdManagerTest, PreserveFirstByte) {
+  SetQuicRestartFlag(quic_preserve_server_connection_id_first_byte, true);
+  QuicConnectionId cid = initial_connection_id_;
+  for (int i = 0; i < 10; ++i) {
+    QuicConnectionId new_cid = cid_manager_.GenerateNewConnectionId(cid);
+    EXPECT_NE(cid, new_cid);
+    ASSERT_EQ(cid.length(), new_cid.length());
+    EXPECT_EQ(initial_connection_id_.data()[0], new_cid.data()[0]);
+    cid = new_cid;
+  }
+}
+
+TEST_F(QuicSelfIssuedConnectionIdManagerTest, ClientDoesNotPreserveFirstByte) {
+  SetQuicRestartFlag(quic_preserve_server_connection_id_first_byte, true);
+  QuicSelfIssuedConnectionIdManager client_cid_manager(
+      /*active_connection_id_limit*/ 2, initial_connection_id_,
+      Perspective::IS_CLIENT, &clock_, &alarm_factory_, &cid_manager_visitor_,
+      /*context=*/nullptr);
+  // A client connection ID which replaces another one is generated the same
+  // way as without the flag.
+  QuicConnectionId cid = initial_connection_id_;
+  for (int i = 0; i < 10; ++i) {
+    QuicConnectionId new_cid = client_cid_manager.GenerateNewConnectionId(cid);
+    EXPECT_EQ(QuicUtils::CreateReplacementConnectionId(cid), new_cid);
+    cid = new_cid;
+  }
+}
+
 }  // namespace
 }  // namespace quic
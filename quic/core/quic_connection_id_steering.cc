@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_connection_id_steering.h"
+
+#include <errno.h>
+#include <linux/filter.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "absl/base/macros.h"
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_logging.h"
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace quic {
+namespace {
+
+// Offset of the first destination connection ID byte in short header packets.
+const size_t kShortHeaderConnectionIdOffset = 1;
+// Offsets of the destination connection ID length and its first byte in long
+// header packets.
+const size_t kLongHeaderConnectionIdLengthOffset = 5;
+const size_t kLongHeaderConnectionIdOffset = 6;
+
+const uint8_t kLongHeaderBit = 0x80;
+
+}  // namespace
+
+// static
+absl::optional<size_t> QuicConnectionIdSteering::GetWorkerIndex(
+    absl::string_view packet,
+    size_t num_workers) {
+  QUICHE_DCHECK_LT(0u, num_workers);
+  if (packet.length() <= kShortHeaderConnectionIdOffset) {
+    return absl::nullopt;
+  }
+  size_t offset = kShortHeaderConnectionIdOffset;
+  if (static_cast<uint8_t>(packet[0]) & kLongHeaderBit) {
+    if (packet.length() <= kLongHeaderConnectionIdOffset ||
+        packet[kLongHeaderConnectionIdLengthOffset] == 0) {
+      return absl::nullopt;
+    }
+    offset = kLongHeaderConnectionIdOffset;
+  }
+  return static_cast<uint8_t>(packet[offset]) % num_workers;
+}
+
+// static
+bool QuicConnectionIdSteering::AttachReusePortProgram(QuicUdpSocketFd fd,
+                                                      size_t num_workers) {
+  if (num_workers == 0 || num_workers > 256) {
+    QUIC_BUG(quic_bug_invalid_steering_num_workers)
+        << "Invalid number of workers: " << num_workers;
+    return false;
+  }
+  // The program sees the UDP payload. Returning an index that is out of range
+  // of the reuseport group makes the kernel fall back to hashing.
+  const uint32_t n = static_cast<uint32_t>(num_workers);
+  sock_filter code[] = {
+      // 0: A = packet length.
+      BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+      // 1: Fall back if shorter than a short header connection ID.
+      BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, kShortHeaderConnectionIdOffset + 1,
+               0, 12),
+      // 2: X = packet length.
+      BPF_STMT(BPF_MISC | BPF_TAX, 0),
+      // 3: A = first byte.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+      // 4: Long header packets continue at 7.
+      BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, kLongHeaderBit, 2, 0),
+      // 5: Short header: A = first connection ID byte.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kShortHeaderConnectionIdOffset),
+      // 6: Continue at 12.
+      BPF_JUMP(BPF_JMP | BPF_JA, 5, 0, 0),
+      // 7: A = packet length.
+      BPF_STMT(BPF_MISC | BPF_TXA, 0),
+      // 8: Fall back if shorter than a long header connection ID.
+      BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, kLongHeaderConnectionIdOffset + 1, 0,
+               5),
+      // 9: A = destination connection ID length.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kLongHeaderConnectionIdLengthOffset),
+      // 10: Fall back if the destination connection ID is empty.
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 3, 0),
+      // 11: A = first connection ID byte.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kLongHeaderConnectionIdOffset),
+      // 12: Return A % num_workers.
+      BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, n),
+      BPF_STMT(BPF_RET | BPF_A, 0),
+      // 14: Fall back to hashing.
+      BPF_STMT(BPF_RET | BPF_K, n),
+  };
+  sock_fprog program;
+  program.len = ABSL_ARRAYSIZE(code);
+  program.filter = code;
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                 sizeof(program)) != 0) {
+    QUIC_LOG(WARNING) << "Failed to attach reuseport steering program: "
+                      << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace quic
@@ -0,0 +1,49 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_CONNECTION_ID_STEERING_H_
+#define QUICHE_QUIC_CORE_QUIC_CONNECTION_ID_STEERING_H_
+
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "quic/core/quic_udp_socket.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// QuicConnectionIdSteering maps incoming packets to one of N workers, each of
+// which owns a socket in the same SO_REUSEPORT group, by the first byte of the
+// destination connection ID:
+//   - Long header packets use byte 6, the first byte after the version and
+//     the destination connection ID length.
+//   - Short header packets, and Google QUIC packets with a public header, use
+//     byte 1.
+// The worker index is that byte modulo N. Packets too short to contain a
+// connection ID, and long header packets with an empty destination
+// connection ID, have no preferred worker.
+//
+// Steering only keeps a connection on one worker if every server connection
+// ID derived from the client-chosen one keeps its first byte, which is what
+// quic_restart_flag_quic_preserve_server_connection_id_first_byte does.
+class QUIC_EXPORT_PRIVATE QuicConnectionIdSteering {
+ public:
+  // Returns the index of the worker |packet| should be processed by, or
+  // nullopt if it can be processed by any worker.
+  static absl::optional<size_t> GetWorkerIndex(absl::string_view packet,
+                                               size_t num_workers);
+
+  // Attaches a classic BPF program to the SO_REUSEPORT group of |fd| which
+  // selects sockets the same way as GetWorkerIndex(), so the kernel delivers
+  // packets to the socket at that index in the group. Sockets are indexed in
+  // the order they were bound. Packets without a preferred worker fall back
+  // to the kernel's 4-tuple hash. Returns false if the program can not be
+  // attached, in which case the kernel distributes all packets by hash.
+  static bool AttachReusePortProgram(QuicUdpSocketFd fd, size_t num_workers);
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_CONNECTION_ID_STEERING_H_
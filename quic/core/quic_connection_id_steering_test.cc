@@ -0,0 +1,154 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_connection_id_steering.h"
+
+#include <sys/socket.h>
+
+#include <string>
+#include <vector>
+
+#include "quic/core/quic_udp_socket.h"
+#include "quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const size_t kNumWorkers = 4;
+
+std::string ShortHeaderPacket(uint8_t first_connection_id_byte) {
+  std::string packet(30, '\0');
+  packet[0] = 0x40;
+  packet[1] = first_connection_id_byte;
+  return packet;
+}
+
+std::string LongHeaderPacket(uint8_t connection_id_length,
+                             uint8_t first_connection_id_byte) {
+  std::string packet(1200, '\0');
+  packet[0] = 0xc0;
+  // Version.
+  packet[4] = 1;
+  packet[5] = connection_id_length;
+  packet[6] = first_connection_id_byte;
+  return packet;
+}
+
+TEST(QuicConnectionIdSteeringTest, GetWorkerIndex) {
+  EXPECT_EQ(1u, QuicConnectionIdSteering::GetWorkerIndex(ShortHeaderPacket(5),
+                                                         kNumWorkers));
+  EXPECT_EQ(3u, QuicConnectionIdSteering::GetWorkerIndex(
+                    ShortHeaderPacket(0xff), kNumWorkers));
+  EXPECT_EQ(2u, QuicConnectionIdSteering::GetWorkerIndex(
+                    LongHeaderPacket(8, 6), kNumWorkers));
+  EXPECT_EQ(0u, QuicConnectionIdSteering::GetWorkerIndex(
+                    LongHeaderPacket(20, 0x80), kNumWorkers));
+  EXPECT_EQ(0u,
+            QuicConnectionIdSteering::GetWorkerIndex(ShortHeaderPacket(7), 1));
+}
+
+TEST(QuicConnectionIdSteeringTest, NoPreferredWorker) {
+  EXPECT_FALSE(
+      QuicConnectionIdSteering::GetWorkerIndex("", kNumWorkers).has_value());
+  EXPECT_FALSE(
+      QuicConnectionIdSteering::GetWorkerIndex("\x40", kNumWorkers)
+          .has_value());
+  EXPECT_FALSE(QuicConnectionIdSteering::GetWorkerIndex(
+                   std::string("\xc0\x00\x00\x00\x01\x08", 6), kNumWorkers)
+                   .has_value());
+  EXPECT_FALSE(QuicConnectionIdSteering::GetWorkerIndex(
+                   LongHeaderPacket(0, 3), kNumWorkers)
+                   .has_value());
+}
+
+// Verifies that the kernel delivers packets to the socket chosen by
+// GetWorkerIndex().
+TEST(QuicConnectionIdSteeringTest, KernelSteering) {
+  QuicUdpSocketApi api;
+  std::vector<QuicUdpSocketFd> worker_fds;
+  QuicSocketAddress server_address(QuicIpAddress::Loopback4(), 0);
+  for (size_t i = 0; i < kNumWorkers; ++i) {
+    QuicUdpSocketFd fd = api.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, fd);
+    worker_fds.push_back(fd);
+    if (!api.EnableReusePort(fd)) {
+      QUIC_LOG(WARNING) << "Test skipped since SO_REUSEPORT is not supported.";
+      for (QuicUdpSocketFd worker_fd : worker_fds) {
+        api.Destroy(worker_fd);
+      }
+      return;
+    }
+    ASSERT_TRUE(api.Bind(fd, server_address));
+    if (i == 0) {
+      ASSERT_EQ(0, server_address.FromSocket(fd));
+    }
+  }
+  if (!QuicConnectionIdSteering::AttachReusePortProgram(worker_fds[0],
+                                                        kNumWorkers)) {
+    QUIC_LOG(WARNING) << "Test skipped since reuseport BPF is not supported.";
+    for (QuicUdpSocketFd fd : worker_fds) {
+      api.Destroy(fd);
+    }
+    return;
+  }
+
+  // Send from several source ports, so 4-tuple hashing alone would not
+  // deliver the packets as expected.
+  std::vector<QuicUdpSocketFd> client_fds;
+  for (size_t i = 0; i < 8; ++i) {
+    QuicUdpSocketFd fd = api.Create(AF_INET, kDefaultSocketReceiveBuffer,
+                                    kDefaultSocketReceiveBuffer);
+    ASSERT_NE(kQuicInvalidSocketFd, fd);
+    ASSERT_TRUE(
+        api.Bind(fd, QuicSocketAddress(QuicIpAddress::Loopback4(), 0)));
+    client_fds.push_back(fd);
+  }
+
+  std::vector<std::string> packets;
+  for (int byte = 0; byte < 32; ++byte) {
+    packets.push_back(ShortHeaderPacket(byte));
+    packets.push_back(LongHeaderPacket(8, byte));
+  }
+  for (size_t i = 0; i < packets.size(); ++i) {
+    QuicUdpPacketInfo packet_info;
+    packet_info.SetPeerAddress(server_address);
+    WriteResult result =
+        api.WritePacket(client_fds[i % client_fds.size()], packets[i].data(),
+                        packets[i].size(), packet_info);
+    ASSERT_EQ(WRITE_STATUS_OK, result.status);
+  }
+
+  size_t num_received = 0;
+  for (size_t worker = 0; worker < kNumWorkers; ++worker) {
+    while (api.WaitUntilReadable(worker_fds[worker],
+                                 QuicTime::Delta::FromMilliseconds(100))) {
+      char buffer[1500];
+      char control_buffer[kDefaultUdpPacketControlBufferSize];
+      QuicUdpSocketApi::ReadPacketResult result;
+      result.packet_buffer = {buffer, sizeof(buffer)};
+      result.control_buffer = {control_buffer, sizeof(control_buffer)};
+      api.ReadPacket(worker_fds[worker], BitMask64(), &result);
+      ASSERT_TRUE(result.ok);
+      EXPECT_EQ(worker, QuicConnectionIdSteering::GetWorkerIndex(
+                            absl::string_view(buffer,
+                                              result.packet_buffer.buffer_len),
+                            kNumWorkers));
+      ++num_received;
+    }
+  }
+  EXPECT_EQ(packets.size(), num_received);
+
+  for (QuicUdpSocketFd fd : worker_fds) {
+    api.Destroy(fd);
+  }
+  for (QuicUdpSocketFd fd : client_fds) {
+    api.Destroy(fd);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
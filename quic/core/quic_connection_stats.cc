@@ -67,6 +67,7 @@ std::ostream& operator<<(std::ostream& os, const QuicConnectionStats& s) {
   os << " num_coalesced_packets_received: " << s.num_coalesced_packets_received;
   os << " num_coalesced_packets_processed: "
      << s.num_coalesced_packets_processed;
+  os << " num_serialized_packet_copies: " << s.num_serialized_packet_copies;
   os << " num_ack_aggregation_epochs: " << s.num_ack_aggregation_epochs;
   os << " sent_legacy_version_encapsulated_packets: "
      << s.sent_legacy_version_encapsulated_packets;
@@ -166,6 +166,11 @@ struct QUIC_EXPORT_PRIVATE QuicConnectionStats {
   uint64_t num_coalesced_packets_received = 0;
   // Number of successfully processed coalesced packets.
   uint64_t num_coalesced_packets_processed = 0;
+  // Number of times the bytes of serialized packets were copied on their way
+  // to the socket: into and out of the coalescer, into the buffer of packets
+  // waiting for the writer to unblock, and into the buffer of a batch writer
+  // when the packet was not serialized there.
+  uint64_t num_serialized_packet_copies = 0;
   // Number of ack aggregation epochs. For the same number of bytes acked, the
   // smaller this value, the more ack aggregation is going on.
   uint64_t num_ack_aggregation_epochs = 0;
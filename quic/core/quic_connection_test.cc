@@ -6,10 +6,12 @@
 
 #include <errno.h>
 
+#include <algorithm>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/strings/str_cat.h"
@@ -25,6 +27,7 @@
 #include "quic/core/frames/quic_new_connection_id_frame.h"
 #include "quic/core/frames/quic_path_response_frame.h"
 #include "quic/core/frames/quic_rst_stream_frame.h"
+#include "quic/core/quic_alarm_multiplexer.h"
 #include "quic/core/quic_connection_id.h"
 #include "quic/core/quic_constants.h"
 #include "quic/core/quic_error_codes.h"
@@ -43,6 +46,7 @@
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/mock_clock.h"
 #include "quic/test_tools/mock_random.h"
+#include "quic/test_tools/quic_alarm_multiplexer_peer.h"
 #include "quic/test_tools/quic_coalesced_packet_peer.h"
 #include "quic/test_tools/quic_config_peer.h"
 #include "quic/test_tools/quic_connection_peer.h"
@@ -548,14 +552,17 @@ enum class AckResponse { kDefer, kImmediate };
 // Run tests with combinations of {ParsedQuicVersion, AckResponse}.
 struct TestParams {
   TestParams(ParsedQuicVersion version, AckResponse ack_response,
-             bool no_stop_waiting)
+             bool no_stop_waiting, bool multiplex_connection_alarms = false)
       : version(version),
         ack_response(ack_response),
-        no_stop_waiting(no_stop_waiting) {}
+        no_stop_waiting(no_stop_waiting),
+        multiplex_connection_alarms(multiplex_connection_alarms) {}
 
   ParsedQuicVersion version;
   AckResponse ack_response;
   bool no_stop_waiting;
+  // Value of quic_restart_flag_quic_multiplex_connection_alarms.
+  bool multiplex_connection_alarms;
 };
 
 // Used by ::testing::PrintToStringParamName().
@@ -563,7 +570,8 @@ std::string PrintToString(const TestParams& p) {
   return absl::StrCat(
       ParsedQuicVersionToString(p.version), "_",
       (p.ack_response == AckResponse::kDefer ? "defer" : "immediate"), "_",
-      (p.no_stop_waiting ? "No" : ""), "StopWaiting");
+      (p.no_stop_waiting ? "No" : ""), "StopWaiting",
+      (p.multiplex_connection_alarms ? "_MultiplexedAlarms" : ""));
 }
 
 // Constructs various test permutations.
@@ -581,6 +589,8 @@ std::vector<TestParams> GetTestParams() {
             TestParams(all_supported_versions[i], ack_response, false));
       }
     }
+    params.push_back(TestParams(all_supported_versions[i], AckResponse::kDefer,
+                                true, /*multiplex_connection_alarms=*/true));
   }
   return params;
 }
@@ -599,7 +609,8 @@ class QuicConnectionTest : public QuicTestWithParam<TestParams> {
 
  protected:
   QuicConnectionTest()
-      : connection_id_(TestConnectionId()),
+      : multiplex_connection_alarms_(SetRestartFlags(GetParam())),
+        connection_id_(TestConnectionId()),
         framer_(SupportedVersions(version()), QuicTime::Zero(),
                 Perspective::IS_CLIENT, connection_id_.length()),
         send_algorithm_(new StrictMock<MockSendAlgorithm>),
@@ -1461,6 +1472,17 @@ class QuicConnectionTest : public QuicTestWithParam<TestParams> {
 
   void TestReplaceConnectionIdFromInitial();
 
+  // Sets the restart flags |params| runs with, and returns the value of
+  // quic_restart_flag_quic_multiplex_connection_alarms.
+  static bool SetRestartFlags(const TestParams& params) {
+    SetQuicRestartFlag(quic_multiplex_connection_alarms,
+                       params.multiplex_connection_alarms);
+    return params.multiplex_connection_alarms;
+  }
+
+  // Initialized first, as the connection latches the restart flags when it is
+  // created.
+  const bool multiplex_connection_alarms_;
   QuicConnectionId connection_id_;
   QuicFramer framer_;
 
@@ -4743,6 +4765,95 @@ TEST_P(QuicConnectionTest, Buffer100NonDecryptablePacketsThenKeyChange) {
   ProcessDataPacketAtLevel(102, !kHasStopWaiting, ENCRYPTION_ZERO_RTT);
 }
 
+TEST_P(QuicConnectionTest, AlarmMultiplexer) {
+  QuicAlarmMultiplexer* multiplexer =
+      QuicConnectionPeer::GetAlarmMultiplexer(&connection_);
+  if (!multiplex_connection_alarms_) {
+    EXPECT_EQ(nullptr, multiplexer);
+    return;
+  }
+  ASSERT_NE(nullptr, multiplexer);
+
+  EXPECT_CALL(*send_algorithm_, OnPacketSent(_, _, _, _, _)).Times(1);
+  connection_.SendStreamDataWithString(3, "foo", 0, NO_FIN);
+  ASSERT_TRUE(connection_.GetRetransmissionAlarm()->IsSet());
+
+  // The platform alarm is set no later than the earliest alarm of the
+  // connection.
+  QuicTime earliest_deadline = QuicTime::Infinite();
+  for (QuicAlarm* alarm : std::vector<QuicAlarm*>{
+           connection_.GetAckAlarm(), connection_.GetPingAlarm(),
+           connection_.GetRetransmissionAlarm(), connection_.GetSendAlarm(),
+           connection_.GetTimeoutAlarm(), connection_.GetMtuDiscoveryAlarm(),
+           connection_.GetBlackholeDetectorAlarm()}) {
+    if (alarm->IsSet()) {
+      earliest_deadline = std::min(earliest_deadline, alarm->deadline());
+    }
+  }
+  EXPECT_TRUE(multiplexer->platform_alarm_deadline().IsInitialized());
+  EXPECT_LE(multiplexer->platform_alarm_deadline(), earliest_deadline);
+}
+
+// The other tests fire the alarms of the connection directly.  This one fires
+// the platform alarm, so that the delayed ack alarm fires through the
+// multiplexer.
+TEST_P(QuicConnectionTest, AlarmMultiplexerFiresDueAlarms) {
+  if (!multiplex_connection_alarms_) {
+    return;
+  }
+  QuicAlarmMultiplexer* multiplexer =
+      QuicConnectionPeer::GetAlarmMultiplexer(&connection_);
+  ASSERT_NE(nullptr, multiplexer);
+
+  QuicTime ack_time = clock_.ApproximateNow() + DefaultDelayedAckTime();
+  EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
+  const uint8_t tag = 0x07;
+  SetDecrypter(ENCRYPTION_ZERO_RTT,
+               std::make_unique<StrictTaggingDecrypter>(tag));
+  peer_framer_.SetEncrypter(ENCRYPTION_ZERO_RTT,
+                            std::make_unique<TaggingEncrypter>(tag));
+  frame1_.stream_id = 3;
+  EXPECT_CALL(visitor_, OnStreamFrame(_)).Times(1);
+  ProcessDataPacketAtLevel(1, !kHasStopWaiting, ENCRYPTION_ZERO_RTT);
+  EXPECT_TRUE(connection_.HasPendingAcks());
+  EXPECT_EQ(ack_time, connection_.GetAckAlarm()->deadline());
+
+  QuicAlarm* platform_alarm =
+      QuicAlarmMultiplexerPeer::GetPlatformAlarm(multiplexer);
+  ASSERT_NE(nullptr, platform_alarm);
+  ASSERT_TRUE(platform_alarm->IsSet());
+  EXPECT_LE(platform_alarm->deadline(), ack_time);
+
+  // Fire the platform alarm until the ack alarm is due.  Earlier wakeups may
+  // fire other alarms, or nothing.
+  while (connection_.HasPendingAcks()) {
+    ASSERT_TRUE(platform_alarm->IsSet());
+    ASSERT_LE(platform_alarm->deadline(), ack_time);
+    if (platform_alarm->deadline() > clock_.ApproximateNow()) {
+      clock_.AdvanceTime(platform_alarm->deadline() -
+                         clock_.ApproximateNow());
+    }
+    reinterpret_cast<TestAlarmFactory::TestAlarm*>(platform_alarm)->Fire();
+  }
+  EXPECT_EQ(ack_time, clock_.ApproximateNow());
+  EXPECT_FALSE(writer_->ack_frames().empty());
+  EXPECT_FALSE(connection_.GetAckAlarm()->IsSet());
+
+  // The platform alarm is set for the earliest remaining alarm, if any.
+  QuicTime earliest_deadline = QuicTime::Zero();
+  for (QuicAlarm* alarm : std::vector<QuicAlarm*>{
+           connection_.GetAckAlarm(), connection_.GetPingAlarm(),
+           connection_.GetRetransmissionAlarm(), connection_.GetSendAlarm(),
+           connection_.GetTimeoutAlarm(), connection_.GetMtuDiscoveryAlarm(),
+           connection_.GetBlackholeDetectorAlarm()}) {
+    if (alarm->IsSet() && (!earliest_deadline.IsInitialized() ||
+                           alarm->deadline() < earliest_deadline)) {
+      earliest_deadline = alarm->deadline();
+    }
+  }
+  EXPECT_EQ(earliest_deadline, multiplexer->platform_alarm_deadline());
+}
+
 TEST_P(QuicConnectionTest, SetRTOAfterWritingToSocket) {
   BlockOnNextWrite();
   EXPECT_CALL(*send_algorithm_, OnPacketSent(_, _, _, _, _)).Times(1);
@@ -10318,6 +10429,40 @@ TEST_P(QuicConnectionTest, SendCoalescedPackets) {
   EXPECT_NE(nullptr, writer_->coalesced_packet());
 }
 
+// Verifies that the packets of a coalesced INITIAL, HANDSHAKE and 1-RTT flight
+// are not copied again by a batch writer.
+TEST_P(QuicConnectionTest, SerializeCoalescedPacketIntoWriterBuffer) {
+  if (!connection_.version().CanSendCoalescedPackets()) {
+    return;
+  }
+  SetQuicRestartFlag(quic_serialize_coalesced_packet_into_writer_buffer, true);
+  writer_->SetBatchMode(true);
+  EXPECT_CALL(visitor_, OnHandshakePacketSent()).Times(1);
+  {
+    QuicConnection::ScopedPacketFlusher flusher(&connection_);
+    use_tagging_decrypter();
+    connection_.SetEncrypter(ENCRYPTION_INITIAL,
+                             std::make_unique<TaggingEncrypter>(0x01));
+    connection_.SetDefaultEncryptionLevel(ENCRYPTION_INITIAL);
+    connection_.SendCryptoDataWithString("foo", 0);
+    connection_.SetEncrypter(ENCRYPTION_HANDSHAKE,
+                             std::make_unique<TaggingEncrypter>(0x02));
+    connection_.SetDefaultEncryptionLevel(ENCRYPTION_HANDSHAKE);
+    connection_.SendCryptoDataWithString("bar", 3);
+    connection_.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                             std::make_unique<TaggingEncrypter>(0x03));
+    connection_.SetDefaultEncryptionLevel(ENCRYPTION_FORWARD_SECURE);
+    SendStreamDataToPeer(2, "baz", 3, NO_FIN, nullptr);
+  }
+  EXPECT_EQ(1u, writer_->packets_write_attempts());
+  EXPECT_EQ(0x03030303u, writer_->final_bytes_of_last_packet());
+  EXPECT_EQ(connection_.max_packet_length(), writer_->last_packet_size());
+  // The HANDSHAKE and 1-RTT packets are copied into and out of the coalescer,
+  // the INITIAL packet is re-serialized. Without serializing into the
+  // writer's buffer, the writer would copy the coalesced packet once more.
+  EXPECT_EQ(4u, connection_.GetStats().num_serialized_packet_copies);
+}
+
 TEST_P(QuicConnectionTest, FailToCoalescePacket) {
   // EXPECT_QUIC_BUG tests are expensive so only run one instance of them.
   if (!IsDefaultTestConfiguration() ||
@@ -211,6 +211,14 @@ const uint64_t kUFloat16MaxValue =  // 0x3FFC0000000
 // duplicated.
 const size_t kDiversificationNonceSize = 32;
 
+// The size, in bytes, of the ciphertext samples from which header protection
+// masks are computed.
+const size_t kHeaderProtectionSampleSize = 16;
+
+// The number of header protection mask bytes applied to a packet: one for the
+// first byte and up to four for the packet number.
+const size_t kHeaderProtectionMaskSize = 5;
+
 // The largest gap in packets we'll accept without closing the connection.
 // This will likely have to be tuned.
 const QuicPacketCount kMaxPacketGap = 5000;
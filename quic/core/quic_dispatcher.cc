@@ -174,6 +174,22 @@ class StatelessConnectionTerminator {
                        const std::string& error_details,
                        bool ietf_quic,
                        std::vector<QuicConnectionId> active_connection_ids) {
+    if (GetQuicRestartFlag(quic_compact_time_wait_list) &&
+        active_connection_ids.front() == server_connection_id_) {
+      // Let the time wait list manager build the packet when needed.
+      TimeWaitConnectionInfo info(ietf_quic, nullptr,
+                                  std::move(active_connection_ids),
+                                  /*srtt=*/QuicTime::Delta::Zero());
+      info.termination_packet_template.emplace();
+      info.termination_packet_template->type =
+          TerminationPacketTemplate::CONNECTION_CLOSE;
+      info.termination_packet_template->version = framer_.version();
+      info.termination_packet_template->error_code = error_code;
+      info.termination_packet_template->error_details = error_details;
+      time_wait_list_manager_->AddConnectionIdToTimeWait(
+          QuicTimeWaitListManager::SEND_TERMINATION_PACKETS, std::move(info));
+      return;
+    }
     SerializeConnectionClosePacket(error_code, error_details);
 
     time_wait_list_manager_->AddConnectionIdToTimeWait(
@@ -183,6 +199,19 @@ class StatelessConnectionTerminator {
                                /*srtt=*/QuicTime::Delta::Zero()));
   }
 
+  // Generates a packet containing a CONNECTION_CLOSE frame specifying
+  // |error_code| and |error_details| and appends it to |packets|.
+  void BuildConnectionClosePacket(
+      QuicErrorCode error_code,
+      const std::string& error_details,
+      std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+    SerializeConnectionClosePacket(error_code, error_details);
+    for (auto& packet : *collector_.packets()) {
+      packets->push_back(std::move(packet));
+    }
+    collector_.packets()->clear();
+  }
+
  private:
   void SerializeConnectionClosePacket(QuicErrorCode error_code,
                                       const std::string& error_details) {
@@ -367,6 +396,8 @@ QuicDispatcher::~QuicDispatcher() {
     clear_stateless_reset_addresses_alarm_->PermanentCancel();
   }
   reference_counted_session_map_.clear();
+  session_index_.Clear();
+  indexed_sessions_.clear();
   closed_session_list_.clear();
   num_sessions_in_session_map_ = 0;
 }
@@ -377,6 +408,13 @@ void QuicDispatcher::InitializeWithWriter(QuicPacketWriter* writer) {
   time_wait_list_manager_.reset(CreateQuicTimeWaitListManager());
 }
 
+void QuicDispatcher::InitializeWithWriters(
+    QuicPacketWriter* writer,
+    std::unique_ptr<QuicPacketWriter> time_wait_list_writer) {
+  time_wait_list_writer_ = std::move(time_wait_list_writer);
+  InitializeWithWriter(writer);
+}
+
 void QuicDispatcher::ProcessPacket(const QuicSocketAddress& self_address,
                                    const QuicSocketAddress& peer_address,
                                    const QuicReceivedPacket& packet) {
@@ -480,8 +518,15 @@ QuicConnectionId QuicDispatcher::ReplaceShortServerConnectionId(
     uint8_t expected_server_connection_id_length) const {
   QUICHE_DCHECK_LT(server_connection_id.length(),
                    expected_server_connection_id_length);
-  return QuicUtils::CreateReplacementConnectionId(
+  QuicConnectionId new_connection_id = QuicUtils::CreateReplacementConnectionId(
       server_connection_id, expected_server_connection_id_length);
+  if (GetQuicRestartFlag(quic_preserve_server_connection_id_first_byte) &&
+      !server_connection_id.IsEmpty() && !new_connection_id.IsEmpty()) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_preserve_server_connection_id_first_byte, 2,
+                              3);
+    new_connection_id.mutable_data()[0] = server_connection_id.data()[0];
+  }
+  return new_connection_id;
 }
 
 QuicConnectionId QuicDispatcher::ReplaceLongServerConnectionId(
@@ -490,8 +535,15 @@ QuicConnectionId QuicDispatcher::ReplaceLongServerConnectionId(
     uint8_t expected_server_connection_id_length) const {
   QUICHE_DCHECK_GT(server_connection_id.length(),
                    expected_server_connection_id_length);
-  return QuicUtils::CreateReplacementConnectionId(
+  QuicConnectionId new_connection_id = QuicUtils::CreateReplacementConnectionId(
       server_connection_id, expected_server_connection_id_length);
+  if (GetQuicRestartFlag(quic_preserve_server_connection_id_first_byte) &&
+      !server_connection_id.IsEmpty() && !new_connection_id.IsEmpty()) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_preserve_server_connection_id_first_byte, 3,
+                              3);
+    new_connection_id.mutable_data()[0] = server_connection_id.data()[0];
+  }
+  return new_connection_id;
 }
 
 namespace {
@@ -577,11 +629,11 @@ bool QuicDispatcher::MaybeDispatchPacket(
 
   // Packets with connection IDs for active connections are processed
   // immediately.
-  auto it = reference_counted_session_map_.find(server_connection_id);
-  if (it != reference_counted_session_map_.end()) {
+  QuicSession* session = FindSession(server_connection_id);
+  if (session != nullptr) {
     QUICHE_DCHECK(!buffered_packets_.HasBufferedPackets(server_connection_id));
     if (packet_info.version_flag &&
-        packet_info.version != it->second->version() &&
+        packet_info.version != session->version() &&
         packet_info.version == LegacyVersionForEncapsulation()) {
       // This packet is using the Legacy Version Encapsulation version but the
       // corresponding session isn't, attempt extraction of inner packet.
@@ -598,8 +650,8 @@ bool QuicDispatcher::MaybeDispatchPacket(
         }
       }
     }
-    it->second->ProcessUdpPacket(packet_info.self_address,
-                                 packet_info.peer_address, packet_info.packet);
+    session->ProcessUdpPacket(packet_info.self_address,
+                              packet_info.peer_address, packet_info.packet);
     return true;
   }
   if (packet_info.version.IsKnown()) {
@@ -613,13 +665,13 @@ bool QuicDispatcher::MaybeDispatchPacket(
         server_connection_id, packet_info.version);
     if (replaced_connection_id != server_connection_id) {
       // Search for the replacement.
-      auto it2 = reference_counted_session_map_.find(replaced_connection_id);
-      if (it2 != reference_counted_session_map_.end()) {
+      QuicSession* replaced_session = FindSession(replaced_connection_id);
+      if (replaced_session != nullptr) {
         QUICHE_DCHECK(
             !buffered_packets_.HasBufferedPackets(replaced_connection_id));
-        it2->second->ProcessUdpPacket(packet_info.self_address,
-                                      packet_info.peer_address,
-                                      packet_info.packet);
+        replaced_session->ProcessUdpPacket(packet_info.self_address,
+                                           packet_info.peer_address,
+                                           packet_info.packet);
         return true;
       }
     }
@@ -935,6 +987,12 @@ void QuicDispatcher::StopAcceptingNewConnections() {
 
 void QuicDispatcher::PerformActionOnActiveSessions(
     std::function<void(QuicSession*)> operation) const {
+  if (use_session_index_) {
+    for (const auto& kv : indexed_sessions_) {
+      operation(kv.first);
+    }
+    return;
+  }
   absl::flat_hash_set<QuicSession*> visited_session;
   visited_session.reserve(reference_counted_session_map_.size());
   for (auto const& kv : reference_counted_session_map_) {
@@ -949,6 +1007,13 @@ void QuicDispatcher::PerformActionOnActiveSessions(
 std::vector<std::shared_ptr<QuicSession>> QuicDispatcher::GetSessionsSnapshot()
     const {
   std::vector<std::shared_ptr<QuicSession>> snapshot;
+  if (use_session_index_) {
+    snapshot.reserve(indexed_sessions_.size());
+    for (const auto& kv : indexed_sessions_) {
+      snapshot.push_back(kv.second);
+    }
+    return snapshot;
+  }
   snapshot.reserve(reference_counted_session_map_.size());
   absl::flat_hash_set<QuicSession*> visited_session;
   visited_session.reserve(reference_counted_session_map_.size());
@@ -1015,16 +1080,23 @@ bool QuicDispatcher::HasPendingWrites() const {
   return !write_blocked_list_.empty();
 }
 
+void QuicDispatcher::FlushTimeWaitListWrites() {
+  if (time_wait_list_manager_ == nullptr ||
+      !GetQuicRestartFlag(quic_batch_time_wait_list_writes)) {
+    return;
+  }
+  QUIC_RESTART_FLAG_COUNT_N(quic_batch_time_wait_list_writes, 3, 3);
+  time_wait_list_manager_->FlushWrites();
+}
+
 void QuicDispatcher::Shutdown() {
-  while (!reference_counted_session_map_.empty()) {
-    QuicSession* session = reference_counted_session_map_.begin()->second.get();
+  for (QuicSession* session = GetFirstSession(); session != nullptr;
+       session = GetFirstSession()) {
     session->connection()->CloseConnection(
         QUIC_PEER_GOING_AWAY, "Server shutdown imminent",
         ConnectionCloseBehavior::SEND_CONNECTION_CLOSE_PACKET);
     // Validate that the session removes itself from the session map on close.
-    QUICHE_DCHECK(reference_counted_session_map_.empty() ||
-                  reference_counted_session_map_.begin()->second.get() !=
-                      session);
+    QUICHE_DCHECK(GetFirstSession() != session);
   }
   DeleteSessions();
 }
@@ -1033,21 +1105,25 @@ void QuicDispatcher::OnConnectionClosed(QuicConnectionId server_connection_id,
                                         QuicErrorCode error,
                                         const std::string& error_details,
                                         ConnectionCloseSource source) {
-  auto it = reference_counted_session_map_.find(server_connection_id);
-  if (it == reference_counted_session_map_.end()) {
+  QuicSession* session = FindSession(server_connection_id);
+  if (session == nullptr) {
     QUIC_BUG(quic_bug_10287_3) << "ConnectionId " << server_connection_id
                                << " does not exist in the session map.  Error: "
                                << QuicErrorCodeToString(error);
     QUIC_BUG(quic_bug_10287_4) << QuicStackTrace();
     return;
   }
+  std::shared_ptr<QuicSession>& owned_session =
+      use_session_index_
+          ? indexed_sessions_.find(session)->second
+          : reference_counted_session_map_.find(server_connection_id)->second;
 
   QUIC_DLOG_IF(INFO, error != QUIC_NO_ERROR)
       << "Closing connection (" << server_connection_id
       << ") due to error: " << QuicErrorCodeToString(error)
       << ", with details: " << error_details;
 
-  QuicConnection* connection = it->second->connection();
+  QuicConnection* connection = session->connection();
   if (ShouldDestroySessionAsynchronously()) {
     // Set up alarm to fire immediately to bring destruction of this session
     // out of current call stack.
@@ -1055,12 +1131,21 @@ void QuicDispatcher::OnConnectionClosed(QuicConnectionId server_connection_id,
       delete_sessions_alarm_->Update(helper()->GetClock()->ApproximateNow(),
                                      QuicTime::Delta::Zero());
     }
-    closed_session_list_.push_back(std::move(it->second));
+    closed_session_list_.push_back(std::move(owned_session));
   }
-  CleanUpSession(it->first, connection, error, error_details, source);
+  CleanUpSession(server_connection_id, connection, error, error_details,
+                 source);
   for (const QuicConnectionId& cid :
        connection->GetActiveServerConnectionIds()) {
-    reference_counted_session_map_.erase(cid);
+    if (use_session_index_) {
+      session_index_.Erase(cid);
+    } else {
+      reference_counted_session_map_.erase(cid);
+    }
+  }
+  if (use_session_index_) {
+    // Destroys the session unless it was moved to |closed_session_list_|.
+    indexed_sessions_.erase(session);
   }
   --num_sessions_in_session_map_;
 }
@@ -1088,8 +1173,8 @@ void QuicDispatcher::OnStopSendingReceived(
 void QuicDispatcher::OnNewConnectionIdSent(
     const QuicConnectionId& server_connection_id,
     const QuicConnectionId& new_connection_id) {
-  auto it = reference_counted_session_map_.find(server_connection_id);
-  if (it == reference_counted_session_map_.end()) {
+  QuicSession* session = FindSession(server_connection_id);
+  if (session == nullptr) {
     QUIC_BUG(quic_bug_10287_7)
         << "Couldn't locate the session that issues the connection ID in "
            "reference_counted_session_map_.  server_connection_id:"
@@ -1098,6 +1183,12 @@ void QuicDispatcher::OnNewConnectionIdSent(
   }
   // Count new connection ID added to the dispatcher map.
   QUIC_RELOADABLE_FLAG_COUNT_N(quic_connection_migration_use_new_cid_v2, 6, 6);
+  if (use_session_index_) {
+    const bool inserted = session_index_.Insert(new_connection_id, session);
+    QUICHE_DCHECK(inserted);
+    return;
+  }
+  auto it = reference_counted_session_map_.find(server_connection_id);
   auto insertion_result = reference_counted_session_map_.insert(
       std::make_pair(new_connection_id, it->second));
   QUICHE_DCHECK(insertion_result.second);
@@ -1105,6 +1196,10 @@ void QuicDispatcher::OnNewConnectionIdSent(
 
 void QuicDispatcher::OnConnectionIdRetired(
     const QuicConnectionId& server_connection_id) {
+  if (use_session_index_) {
+    session_index_.Erase(server_connection_id);
+    return;
+  }
   reference_counted_session_map_.erase(server_connection_id);
 }
 
@@ -1114,6 +1209,20 @@ void QuicDispatcher::OnConnectionAddedToTimeWaitList(
                   << " added to time wait list.";
 }
 
+void QuicDispatcher::BuildConnectionClosePacket(
+    const TerminationPacketTemplate& termination_template,
+    QuicConnectionId server_connection_id,
+    std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+  QUICHE_DCHECK_EQ(TerminationPacketTemplate::CONNECTION_CLOSE,
+                   termination_template.type);
+  StatelessConnectionTerminator terminator(
+      server_connection_id, termination_template.version, helper_.get(),
+      time_wait_list_manager_.get());
+  terminator.BuildConnectionClosePacket(termination_template.error_code,
+                                        termination_template.error_details,
+                                        packets);
+}
+
 void QuicDispatcher::StatelesslyTerminateConnection(
     QuicConnectionId server_connection_id,
     PacketHeaderFormat format,
@@ -1162,6 +1271,18 @@ void QuicDispatcher::StatelesslyTerminateConnection(
       << ", error_details:" << error_details;
   // Version is unknown or unsupported by framer, send a version negotiation
   // with an empty version list, which can be understood by the client.
+  if (GetQuicRestartFlag(quic_compact_time_wait_list)) {
+    // Let the time wait list manager build the packet when needed.
+    TimeWaitConnectionInfo info(/*ietf_quic=*/format != GOOGLE_QUIC_PACKET,
+                                nullptr, {server_connection_id});
+    info.termination_packet_template.emplace();
+    info.termination_packet_template->type =
+        TerminationPacketTemplate::VERSION_NEGOTIATION;
+    info.termination_packet_template->use_length_prefix = use_length_prefix;
+    time_wait_list_manager()->AddConnectionIdToTimeWait(
+        QuicTimeWaitListManager::SEND_TERMINATION_PACKETS, std::move(info));
+    return;
+  }
   std::vector<std::unique_ptr<QuicEncryptedPacket>> termination_packets;
   termination_packets.push_back(QuicFramer::BuildVersionNegotiationPacket(
       server_connection_id, EmptyQuicConnectionId(),
@@ -1226,18 +1347,21 @@ void QuicDispatcher::ProcessBufferedChlos(size_t max_connections_to_create) {
     }
     QUIC_DLOG(INFO) << "Created new session for " << server_connection_id;
 
-    auto insertion_result = reference_counted_session_map_.insert(
-        std::make_pair(server_connection_id,
-                       std::shared_ptr<QuicSession>(std::move(session))));
-    if (!insertion_result.second) {
+    QuicSession* session_ptr =
+        AddSession(server_connection_id, std::move(session));
+    if (session_ptr == nullptr) {
       QUIC_BUG(quic_bug_12724_5)
           << "Tried to add a session to session_map with existing connection "
              "id: "
           << server_connection_id;
+      session_ptr = FindSession(server_connection_id);
+      if (session_ptr == nullptr) {
+        continue;
+      }
     } else {
       ++num_sessions_in_session_map_;
     }
-    DeliverPacketsToSession(packets, insertion_result.first->second.get());
+    DeliverPacketsToSession(packets, session_ptr);
   }
 }
 
@@ -1265,7 +1389,10 @@ void QuicDispatcher::OnBufferPacketFailure(
 }
 
 QuicTimeWaitListManager* QuicDispatcher::CreateQuicTimeWaitListManager() {
-  return new QuicTimeWaitListManager(writer_.get(), this, helper_->GetClock(),
+  QuicPacketWriter* writer = time_wait_list_writer_ != nullptr
+                                 ? time_wait_list_writer_.get()
+                                 : writer_.get();
+  return new QuicTimeWaitListManager(writer, this, helper_->GetClock(),
                                      alarm_factory_.get());
 }
 
@@ -1334,19 +1461,20 @@ void QuicDispatcher::ProcessChlo(ParsedClientHello parsed_chlo,
   QUIC_DLOG(INFO) << "Created new session for "
                   << packet_info->destination_connection_id;
 
-  QuicSession* session_ptr;
-  auto insertion_result = reference_counted_session_map_.insert(std::make_pair(
-      packet_info->destination_connection_id,
-      std::shared_ptr<QuicSession>(std::move(session.release()))));
-  if (!insertion_result.second) {
+  QuicSession* session_ptr =
+      AddSession(packet_info->destination_connection_id, std::move(session));
+  if (session_ptr == nullptr) {
     QUIC_BUG(quic_bug_10287_9)
         << "Tried to add a session to session_map with existing "
            "connection id: "
         << packet_info->destination_connection_id;
+    session_ptr = FindSession(packet_info->destination_connection_id);
+    if (session_ptr == nullptr) {
+      return;
+    }
   } else {
     ++num_sessions_in_session_map_;
   }
-  session_ptr = insertion_result.first->second.get();
   std::list<BufferedPacket> packets =
       buffered_packets_.DeliverPackets(packet_info->destination_connection_id)
           .buffered_packets;
@@ -1449,6 +1577,46 @@ void QuicDispatcher::MaybeResetPacketsWithNoVersion(
       GetPerPacketContext());
 }
 
+QuicSession* QuicDispatcher::FindSession(
+    const QuicConnectionId& server_connection_id) const {
+  if (use_session_index_) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_dispatcher_use_session_index, 2, 2);
+    return session_index_.Find(server_connection_id);
+  }
+  auto it = reference_counted_session_map_.find(server_connection_id);
+  return it == reference_counted_session_map_.end() ? nullptr
+                                                    : it->second.get();
+}
+
+QuicSession* QuicDispatcher::AddSession(
+    const QuicConnectionId& server_connection_id,
+    std::unique_ptr<QuicSession> session) {
+  if (!use_session_index_) {
+    auto insertion_result = reference_counted_session_map_.insert(
+        std::make_pair(server_connection_id,
+                       std::shared_ptr<QuicSession>(std::move(session))));
+    return insertion_result.second ? insertion_result.first->second.get()
+                                   : nullptr;
+  }
+  QUIC_RESTART_FLAG_COUNT_N(quic_dispatcher_use_session_index, 1, 2);
+  QuicSession* session_ptr = session.get();
+  if (!session_index_.Insert(server_connection_id, session_ptr)) {
+    return nullptr;
+  }
+  indexed_sessions_.emplace(session_ptr, std::move(session));
+  return session_ptr;
+}
+
+QuicSession* QuicDispatcher::GetFirstSession() const {
+  if (use_session_index_) {
+    return indexed_sessions_.empty() ? nullptr
+                                     : indexed_sessions_.begin()->first;
+  }
+  return reference_counted_session_map_.empty()
+             ? nullptr
+             : reference_counted_session_map_.begin()->second.get();
+}
+
 size_t QuicDispatcher::NumSessions() const {
   return num_sessions_in_session_map_;
 }
@@ -25,6 +25,7 @@
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_process_packet_interface.h"
 #include "quic/core/quic_session.h"
+#include "quic/core/quic_session_index.h"
 #include "quic/core/quic_time_wait_list_manager.h"
 #include "quic/core/quic_version_manager.h"
 #include "quic/platform/api/quic_socket_address.h"
@@ -64,6 +65,13 @@ class QUIC_NO_EXPORT QuicDispatcher
   // Takes ownership of |writer|.
   void InitializeWithWriter(QuicPacketWriter* writer);
 
+  // Takes ownership of |writer| and |time_wait_list_writer|. The time wait list
+  // manager sends its packets with |time_wait_list_writer| instead of |writer|,
+  // which must write to the same socket.
+  void InitializeWithWriters(
+      QuicPacketWriter* writer,
+      std::unique_ptr<QuicPacketWriter> time_wait_list_writer);
+
   // Process the incoming packet by creating a new session, passing it to
   // an existing session, or passing it to the time wait list.
   void ProcessPacket(const QuicSocketAddress& self_address,
@@ -76,6 +84,11 @@ class QUIC_NO_EXPORT QuicDispatcher
   // Returns true if there's anything in the blocked writer list.
   virtual bool HasPendingWrites() const;
 
+  // Called once the packets of a read loop have been processed, to flush the
+  // packets the time wait list manager has sent in response to them as a
+  // single batch.
+  void FlushTimeWaitListWrites();
+
   // Sends ConnectionClose frames to all connected clients.
   void Shutdown();
 
@@ -121,6 +134,14 @@ class QUIC_NO_EXPORT QuicDispatcher
   void OnConnectionAddedToTimeWaitList(
       QuicConnectionId server_connection_id) override;
 
+  // QuicTimeWaitListManager::Visitor interface implementation
+  // Serializes the CONNECTION_CLOSE packet of a connection which was
+  // statelessly terminated.
+  void BuildConnectionClosePacket(
+      const TerminationPacketTemplate& termination_template,
+      QuicConnectionId server_connection_id,
+      std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) override;
+
   using ReferenceCountedSessionMap =
       absl::flat_hash_map<QuicConnectionId,
                           std::shared_ptr<QuicSession>,
@@ -396,6 +417,19 @@ class QUIC_NO_EXPORT QuicDispatcher
   // Returns true if |version| is a supported protocol version.
   bool IsSupportedVersion(const ParsedQuicVersion version);
 
+  // Returns the session of |server_connection_id|, or nullptr if there is
+  // none.
+  QuicSession* FindSession(const QuicConnectionId& server_connection_id) const;
+
+  // Takes ownership of |session| and maps |server_connection_id| to it.
+  // Returns the session, or nullptr, and destroys |session|, if
+  // |server_connection_id| is already mapped.
+  QuicSession* AddSession(const QuicConnectionId& server_connection_id,
+                          std::unique_ptr<QuicSession> session);
+
+  // Returns any of the sessions, or nullptr if there is none.
+  QuicSession* GetFirstSession() const;
+
   const QuicConfig* config_;
 
   const QuicCryptoServerConfig* crypto_config_;
@@ -406,8 +440,17 @@ class QUIC_NO_EXPORT QuicDispatcher
   // The list of connections waiting to write.
   WriteBlockedList write_blocked_list_;
 
+  // Only used if |use_session_index_| is false.
   ReferenceCountedSessionMap reference_counted_session_map_;
 
+  // If |use_session_index_| is true, replaces |reference_counted_session_map_|:
+  // |session_index_| maps the connection IDs to the sessions, and
+  // |indexed_sessions_| owns each session once, however many connection IDs
+  // it has.
+  QuicSessionIndex session_index_;
+  absl::flat_hash_map<QuicSession*, std::shared_ptr<QuicSession>>
+      indexed_sessions_;
+
   // Entity that manages connection_ids in time wait state.
   std::unique_ptr<QuicTimeWaitListManager> time_wait_list_manager_;
 
@@ -429,6 +472,9 @@ class QUIC_NO_EXPORT QuicDispatcher
   // The writer to write to the socket with.
   std::unique_ptr<QuicPacketWriter> writer_;
 
+  // If set, the writer the time wait list manager writes to the socket with.
+  std::unique_ptr<QuicPacketWriter> time_wait_list_writer_;
+
   // Packets which are buffered until a connection can be created to handle
   // them.
   QuicBufferedPacketStore buffered_packets_;
@@ -477,6 +523,9 @@ class QUIC_NO_EXPORT QuicDispatcher
 
   const bool use_recent_reset_addresses_ =
       GetQuicRestartFlag(quic_use_recent_reset_addresses);
+
+  const bool use_session_index_ =
+      GetQuicRestartFlag(quic_dispatcher_use_session_index);
 };
 
 }  // namespace quic
@@ -2357,6 +2357,87 @@ TEST_P(QuicDispatcherSupportMultipleConnectionIdPerConnectionTest,
   dispatcher_->Shutdown();
 }
 
+// Sessions are mapped to by a QuicSessionIndex rather than by the session map.
+class QuicDispatcherSessionIndexTest
+    : public QuicDispatcherSupportMultipleConnectionIdPerConnectionTest {
+ public:
+  QuicDispatcherSessionIndexTest() {
+    SetQuicRestartFlag(quic_dispatcher_use_session_index, true);
+    dispatcher_ = std::make_unique<NiceMock<TestDispatcher>>(
+        &config_, &crypto_config_, &version_manager_,
+        mock_helper_.GetRandomGenerator());
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(QuicDispatcherSessionIndexTests,
+                         QuicDispatcherSessionIndexTest,
+                         ::testing::Values(CurrentSupportedVersions().front()),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicDispatcherSessionIndexTest, AddAndRetireConnectionIds) {
+  AddConnection1();
+  AddConnection2();
+  ASSERT_EQ(dispatcher_->NumSessions(), 2u);
+  EXPECT_EQ(2u, dispatcher_->GetSessionsSnapshot().size());
+  MockServerConnection* mock_server_connection1 =
+      reinterpret_cast<MockServerConnection*>(connection1());
+
+  mock_server_connection1->AddNewConnectionId(TestConnectionId(3));
+  mock_server_connection1->AddNewConnectionId(TestConnectionId(4));
+  EXPECT_EQ(dispatcher_->NumSessions(), 2u);
+  EXPECT_EQ(2u, dispatcher_->GetSessionsSnapshot().size());
+  EXPECT_EQ(session1_, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                       TestConnectionId(3)));
+  EXPECT_EQ(session1_, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                       TestConnectionId(4)));
+  EXPECT_EQ(session2_, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                       TestConnectionId(2)));
+
+  mock_server_connection1->RetireConnectionId(TestConnectionId(1));
+  EXPECT_EQ(nullptr, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                     TestConnectionId(1)));
+  EXPECT_EQ(session1_, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                       TestConnectionId(3)));
+
+  // Packets to a new connection ID are dispatched to the session.
+  EXPECT_CALL(*connection1(), ProcessUdpPacket(_, _, _))
+      .WillOnce(WithArg<2>(Invoke([this](const QuicEncryptedPacket& packet) {
+        ValidatePacket(TestConnectionId(4), packet);
+      })));
+  ProcessPacket(QuicSocketAddress(QuicIpAddress::Loopback4(), 1),
+                TestConnectionId(4), false, "data");
+
+  EXPECT_CALL(*connection1(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  EXPECT_CALL(*connection2(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  dispatcher_->Shutdown();
+  EXPECT_EQ(0u, dispatcher_->NumSessions());
+}
+
+TEST_P(QuicDispatcherSessionIndexTest, CloseConnection) {
+  AddConnection1();
+  AddConnection2();
+  MockServerConnection* mock_server_connection1 =
+      reinterpret_cast<MockServerConnection*>(connection1());
+  mock_server_connection1->AddNewConnectionId(TestConnectionId(3));
+
+  EXPECT_CALL(*connection1(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  connection1()->CloseConnection(
+      QUIC_PEER_GOING_AWAY, "Close for testing",
+      ConnectionCloseBehavior::SEND_CONNECTION_CLOSE_PACKET);
+  EXPECT_EQ(1u, dispatcher_->NumSessions());
+  EXPECT_EQ(nullptr, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                     TestConnectionId(1)));
+  EXPECT_EQ(nullptr, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                     TestConnectionId(3)));
+  EXPECT_EQ(session2_, QuicDispatcherPeer::FindSession(dispatcher_.get(),
+                                                       TestConnectionId(2)));
+  ASSERT_EQ(1u, dispatcher_->GetSessionsSnapshot().size());
+  EXPECT_EQ(session2_, dispatcher_->GetSessionsSnapshot().front().get());
+
+  EXPECT_CALL(*connection2(), CloseConnection(QUIC_PEER_GOING_AWAY, _, _));
+  dispatcher_->Shutdown();
+}
+
 class BufferedPacketStoreTest : public QuicDispatcherTestBase {
  public:
   BufferedPacketStoreTest()
@@ -0,0 +1,78 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_double_mapped_buffer.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/memfd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "absl/memory/memory.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+// static
+std::unique_ptr<QuicDoubleMappedBuffer> QuicDoubleMappedBuffer::Create(
+    size_t min_size) {
+#if defined(__linux__)
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  const size_t size = (min_size + page_size - 1) / page_size * page_size;
+  if (size == 0) {
+    return nullptr;
+  }
+  const int fd = syscall(SYS_memfd_create, "quic_double_mapped_buffer",
+                         MFD_CLOEXEC);
+  if (fd < 0) {
+    QUIC_LOG_FIRST_N(INFO, 1) << "memfd_create failed: " << strerror(errno);
+    return nullptr;
+  }
+  if (ftruncate(fd, size) != 0) {
+    QUIC_LOG_FIRST_N(INFO, 1) << "ftruncate failed: " << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+  // Reserve the address space of both mappings first, so that they are
+  // adjacent.
+  void* reserved = mmap(nullptr, 2 * size, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserved == MAP_FAILED) {
+    QUIC_LOG_FIRST_N(INFO, 1) << "mmap failed: " << strerror(errno);
+    close(fd);
+    return nullptr;
+  }
+  char* data = static_cast<char*>(reserved);
+  for (char* mapping : {data, data + size}) {
+    if (mmap(mapping, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             0) == MAP_FAILED) {
+      QUIC_LOG_FIRST_N(INFO, 1) << "mmap failed: " << strerror(errno);
+      munmap(reserved, 2 * size);
+      close(fd);
+      return nullptr;
+    }
+  }
+  // The mappings keep the memory file alive.
+  close(fd);
+  return absl::WrapUnique(new QuicDoubleMappedBuffer(data, size));
+#else
+  (void)min_size;
+  return nullptr;
+#endif
+}
+
+QuicDoubleMappedBuffer::QuicDoubleMappedBuffer(char* data, size_t size)
+    : data_(data), size_(size) {}
+
+QuicDoubleMappedBuffer::~QuicDoubleMappedBuffer() {
+#if defined(__linux__)
+  munmap(data_, 2 * size_);
+#endif
+}
+
+}  // namespace quic
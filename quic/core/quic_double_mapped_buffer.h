@@ -0,0 +1,51 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_DOUBLE_MAPPED_BUFFER_H_
+#define QUICHE_QUIC_CORE_QUIC_DOUBLE_MAPPED_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// QuicDoubleMappedBuffer is a circular buffer whose memory is mapped twice,
+// back to back, in the address space. Any range of up to size() bytes starting
+// anywhere in the buffer is therefore contiguous in memory, even if it wraps
+// around the end of the buffer.
+//
+// Pages are backed by an anonymous shared memory file and only use memory once
+// they are written to. They are not released until the buffer is destroyed,
+// since a circular buffer writes to them again when it wraps around.
+//
+// Only supported on Linux.
+class QUIC_EXPORT_PRIVATE QuicDoubleMappedBuffer {
+ public:
+  // Creates a buffer of at least |min_size| bytes, rounded up to the page
+  // size. Returns nullptr if double mapping is not supported, or fails.
+  static std::unique_ptr<QuicDoubleMappedBuffer> Create(size_t min_size);
+
+  QuicDoubleMappedBuffer(const QuicDoubleMappedBuffer&) = delete;
+  QuicDoubleMappedBuffer& operator=(const QuicDoubleMappedBuffer&) = delete;
+  ~QuicDoubleMappedBuffer();
+
+  // Returns the address of byte |offset| of the circular buffer, ie
+  // |offset| % size(). size() bytes can be accessed from the returned address.
+  char* At(uint64_t offset) const { return data_ + offset % size_; }
+
+  size_t size() const { return size_; }
+
+ private:
+  QuicDoubleMappedBuffer(char* data, size_t size);
+
+  char* data_;
+  const size_t size_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_DOUBLE_MAPPED_BUFFER_H_
@@ -0,0 +1,60 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_double_mapped_buffer.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicDoubleMappedBufferTest : public QuicTest {
+ protected:
+  QuicDoubleMappedBufferTest()
+      : buffer_(QuicDoubleMappedBuffer::Create(/*min_size=*/10000)) {}
+
+  bool IsSupported() {
+    if (buffer_ == nullptr) {
+      QUIC_LOG(WARNING) << "Test skipped since double mapping is not "
+                           "supported.";
+      return false;
+    }
+    return true;
+  }
+
+  std::unique_ptr<QuicDoubleMappedBuffer> buffer_;
+};
+
+TEST_F(QuicDoubleMappedBufferTest, SizeRoundedUpToPages) {
+  if (!IsSupported()) {
+    return;
+  }
+  EXPECT_LE(10000u, buffer_->size());
+  EXPECT_EQ(buffer_->At(0), buffer_->At(buffer_->size()));
+  EXPECT_EQ(buffer_->At(1), buffer_->At(3 * buffer_->size() + 1));
+}
+
+TEST_F(QuicDoubleMappedBufferTest, WrapAround) {
+  if (!IsSupported()) {
+    return;
+  }
+  // Write across the end of the buffer in one go.
+  const std::string data(1000, 'a');
+  const uint64_t offset = buffer_->size() - 300;
+  memcpy(buffer_->At(offset), data.data(), data.size());
+  EXPECT_EQ(data, std::string(buffer_->At(offset), data.size()));
+  // The data after the end of the buffer is at its start.
+  EXPECT_EQ(std::string(700, 'a'), std::string(buffer_->At(0), 700));
+  EXPECT_EQ(0, memcmp(buffer_->At(offset) + 300, buffer_->At(0), 700));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
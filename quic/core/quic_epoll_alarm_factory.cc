@@ -4,9 +4,14 @@
 
 #include "quic/core/quic_epoll_alarm_factory.h"
 
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 #include "quic/core/quic_arena_scoped_ptr.h"
+#include "quic/core/quic_timing_wheel.h"
+#include "quic/platform/api/quic_flag_utils.h"
+#include "quic/platform/api/quic_flags.h"
 
 namespace quic {
 namespace {
@@ -66,12 +71,135 @@ class QuicEpollAlarm : public QuicAlarm {
 
 }  // namespace
 
+// Keeps the deadlines of the alarms of a factory, and is the only alarm the
+// factory registers with the epoll server.  It is registered for the
+// earliest deadline, and only reregistered when an alarm is set earlier than
+// that, so that most alarm updates are O(1).
+class QuicEpollAlarmFactory::TimingWheel
+    : public QuicEpollAlarmBase,
+      public std::enable_shared_from_this<TimingWheel> {
+ public:
+  using int64_epoll = decltype(QuicEpollAlarmBase().OnAlarm());
+
+  TimingWheel(QuicEpollServer* epoll_server, QuicTime::Delta granularity)
+      : epoll_server_(epoll_server),
+        wheel_(granularity),
+        wake_time_(QuicTime::Zero()),
+        firing_(false) {}
+
+  void Schedule(QuicTimingWheel::Timer* timer, QuicTime deadline) {
+    wheel_.Schedule(timer, deadline);
+    // Alarms set while firing are taken care of once firing is done.
+    if (!firing_) {
+      WakeUpBy(deadline);
+    }
+  }
+
+  // The epoll alarm stays registered, as waking up for nothing once is
+  // cheaper than reregistering it on every cancellation.
+  void Cancel(QuicTimingWheel::Timer* timer) { wheel_.Cancel(timer); }
+
+  // Use the same integer type as the base class.
+  int64_epoll OnAlarm() override;
+
+ private:
+  // Makes sure the epoll alarm fires at or before |deadline|.
+  void WakeUpBy(QuicTime deadline) {
+    if (registered() && wake_time_ <= deadline) {
+      return;
+    }
+    const int64_t deadline_us = (deadline - QuicTime::Zero()).ToMicroseconds();
+    if (registered()) {
+      ReregisterAlarm(deadline_us);
+    } else {
+      epoll_server_->RegisterAlarm(deadline_us, this);
+    }
+    wake_time_ = deadline;
+  }
+
+  QuicEpollServer* epoll_server_;
+  QuicTimingWheel wheel_;
+  // When the epoll alarm is registered for, if it is.
+  QuicTime wake_time_;
+  bool firing_;
+};
+
+class QuicEpollAlarmFactory::TimingWheelAlarm : public QuicAlarm,
+                                                public QuicTimingWheel::Timer {
+ public:
+  TimingWheelAlarm(std::shared_ptr<TimingWheel> timing_wheel,
+                   QuicArenaScopedPtr<QuicAlarm::Delegate> delegate)
+      : QuicAlarm(std::move(delegate)),
+        timing_wheel_(std::move(timing_wheel)) {}
+
+  ~TimingWheelAlarm() override { timing_wheel_->Cancel(this); }
+
+  using QuicAlarm::deadline;
+  // Called by the timing wheel when the deadline has passed.
+  using QuicAlarm::Fire;
+
+ protected:
+  void SetImpl() override {
+    QUICHE_DCHECK(deadline().IsInitialized());
+    timing_wheel_->Schedule(this, deadline());
+  }
+
+  void CancelImpl() override {
+    QUICHE_DCHECK(!deadline().IsInitialized());
+    timing_wheel_->Cancel(this);
+  }
+
+  // Moves the alarm within the wheel, rather than cancelling and setting it.
+  void UpdateImpl() override { SetImpl(); }
+
+ private:
+  std::shared_ptr<TimingWheel> timing_wheel_;
+};
+
+QuicEpollAlarmFactory::TimingWheel::int64_epoll
+QuicEpollAlarmFactory::TimingWheel::OnAlarm() {
+  QuicEpollAlarmBase::OnAlarm();
+  // An alarm may destroy the factory and the other alarms.
+  std::shared_ptr<TimingWheel> self = shared_from_this();
+  const QuicTime now =
+      QuicTime::Zero() +
+      QuicTime::Delta::FromMicroseconds(epoll_server_->ApproximateNowInUsec());
+  firing_ = true;
+  while (QuicTimingWheel::Timer* timer = wheel_.PopExpired(now)) {
+    static_cast<TimingWheelAlarm*>(timer)->Fire();
+  }
+  firing_ = false;
+  if (!wheel_.empty()) {
+    WakeUpBy(wheel_.NextDeadline());
+  }
+  // WakeUpBy will take care of registering the alarm, if needed.
+  return 0;
+}
+
 QuicEpollAlarmFactory::QuicEpollAlarmFactory(QuicEpollServer* epoll_server)
-    : epoll_server_(epoll_server) {}
+    : epoll_server_(epoll_server) {
+  if (GetQuicRestartFlag(quic_epoll_alarm_timing_wheel)) {
+    QUIC_RESTART_FLAG_COUNT(quic_epoll_alarm_timing_wheel);
+    timing_wheel_ = std::make_shared<TimingWheel>(
+        epoll_server, QuicTime::Delta::FromMicroseconds(GetQuicFlag(
+                          FLAGS_quic_epoll_alarm_timing_wheel_granularity_us)));
+  }
+}
+
+QuicEpollAlarmFactory::QuicEpollAlarmFactory(
+    QuicEpollServer* epoll_server,
+    QuicTime::Delta timing_wheel_granularity)
+    : epoll_server_(epoll_server),
+      timing_wheel_(std::make_shared<TimingWheel>(epoll_server,
+                                                  timing_wheel_granularity)) {}
 
 QuicEpollAlarmFactory::~QuicEpollAlarmFactory() = default;
 
 QuicAlarm* QuicEpollAlarmFactory::CreateAlarm(QuicAlarm::Delegate* delegate) {
+  if (timing_wheel_ != nullptr) {
+    return new TimingWheelAlarm(
+        timing_wheel_, QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate));
+  }
   return new QuicEpollAlarm(epoll_server_,
                             QuicArenaScopedPtr<QuicAlarm::Delegate>(delegate));
 }
@@ -79,6 +207,13 @@ QuicAlarm* QuicEpollAlarmFactory::CreateAlarm(QuicAlarm::Delegate* delegate) {
 QuicArenaScopedPtr<QuicAlarm> QuicEpollAlarmFactory::CreateAlarm(
     QuicArenaScopedPtr<QuicAlarm::Delegate> delegate,
     QuicConnectionArena* arena) {
+  if (timing_wheel_ != nullptr) {
+    if (arena != nullptr) {
+      return arena->New<TimingWheelAlarm>(timing_wheel_, std::move(delegate));
+    }
+    return QuicArenaScopedPtr<QuicAlarm>(
+        new TimingWheelAlarm(timing_wheel_, std::move(delegate)));
+  }
   if (arena != nullptr) {
     return arena->New<QuicEpollAlarm>(epoll_server_, std::move(delegate));
   }
@@ -5,9 +5,12 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_EPOLL_ALARM_FACTORY_H_
 #define QUICHE_QUIC_CORE_QUIC_EPOLL_ALARM_FACTORY_H_
 
+#include <memory>
+
 #include "quic/core/quic_alarm.h"
 #include "quic/core/quic_alarm_factory.h"
 #include "quic/core/quic_one_block_arena.h"
+#include "quic/core/quic_time.h"
 #include "quic/platform/api/quic_epoll.h"
 
 namespace quic {
@@ -16,6 +19,12 @@ namespace quic {
 class QUIC_EXPORT_PRIVATE QuicEpollAlarmFactory : public QuicAlarmFactory {
  public:
   explicit QuicEpollAlarmFactory(QuicEpollServer* epoll_server);
+  // Creates a factory which keeps its alarms in a QuicTimingWheel of
+  // |timing_wheel_granularity|, and registers a single alarm with
+  // |epoll_server| for the earliest of them, so that updating an alarm
+  // usually does not touch the alarms of the epoll server.
+  QuicEpollAlarmFactory(QuicEpollServer* epoll_server,
+                        QuicTime::Delta timing_wheel_granularity);
   QuicEpollAlarmFactory(const QuicEpollAlarmFactory&) = delete;
   QuicEpollAlarmFactory& operator=(const QuicEpollAlarmFactory&) = delete;
   ~QuicEpollAlarmFactory() override;
@@ -27,7 +36,13 @@ class QUIC_EXPORT_PRIVATE QuicEpollAlarmFactory : public QuicAlarmFactory {
       QuicConnectionArena* arena) override;
 
  private:
+  class TimingWheel;
+  class TimingWheelAlarm;
+
   QuicEpollServer* epoll_server_;  // Not owned.
+  // Shared with the alarms, which may outlive the factory.  nullptr if each
+  // alarm registers itself with the epoll server.
+  std::shared_ptr<TimingWheel> timing_wheel_;
 };
 
 }  // namespace quic
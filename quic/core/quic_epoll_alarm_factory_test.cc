@@ -4,6 +4,9 @@
 
 #include "quic/core/quic_epoll_alarm_factory.h"
 
+#include <memory>
+#include <vector>
+
 #include "quic/core/quic_epoll_clock.h"
 #include "quic/platform/api/quic_test.h"
 #include "common/platform/api/quiche_epoll_test_tools.h"
@@ -136,6 +139,111 @@ TEST_P(QuicEpollAlarmFactoryTest, CreateAlarmAndUpdate) {
   EXPECT_FALSE(alarm->IsSet());
 }
 
+// Records the order in which alarms fire.
+class RecordingDelegate : public QuicAlarm::DelegateWithoutContext {
+ public:
+  RecordingDelegate(int id, std::vector<int>* fired) : id_(id), fired_(fired) {}
+
+  void OnAlarm() override { fired_->push_back(id_); }
+
+ private:
+  const int id_;
+  std::vector<int>* fired_;
+};
+
+class QuicEpollAlarmFactoryTimingWheelTest : public QuicTest {
+ protected:
+  QuicEpollAlarmFactoryTimingWheelTest()
+      : clock_(&epoll_server_),
+        alarm_factory_(std::make_unique<QuicEpollAlarmFactory>(
+            &epoll_server_,
+            QuicTime::Delta::FromMicroseconds(1))) {}
+
+  std::unique_ptr<QuicAlarm> CreateAlarm(int id) {
+    return std::unique_ptr<QuicAlarm>(
+        alarm_factory_->CreateAlarm(new RecordingDelegate(id, &fired_)));
+  }
+
+  quiche::QuicheFakeEpollServer epoll_server_;
+  const QuicEpollClock clock_;
+  std::unique_ptr<QuicEpollAlarmFactory> alarm_factory_;
+  std::vector<int> fired_;
+};
+
+TEST_F(QuicEpollAlarmFactoryTimingWheelTest, FireInOrder) {
+  std::vector<std::unique_ptr<QuicAlarm>> alarms;
+  for (int i = 0; i < 4; ++i) {
+    alarms.push_back(CreateAlarm(i));
+  }
+  const QuicTime start = clock_.Now();
+  alarms[0]->Set(start + QuicTime::Delta::FromMicroseconds(30));
+  alarms[1]->Set(start + QuicTime::Delta::FromMicroseconds(10));
+  alarms[2]->Set(start + QuicTime::Delta::FromMicroseconds(20));
+  alarms[3]->Set(start + QuicTime::Delta::FromMicroseconds(100000));
+  // The alarms share a single alarm of the epoll server.
+  EXPECT_EQ(1u, epoll_server_.NumberOfAlarms());
+  alarms[2]->Update(start + QuicTime::Delta::FromMicroseconds(40),
+                    QuicTime::Delta::Zero());
+  alarms[0]->Cancel();
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(50);
+  EXPECT_EQ(std::vector<int>({1, 2}), fired_);
+  EXPECT_FALSE(alarms[1]->IsSet());
+  EXPECT_TRUE(alarms[3]->IsSet());
+  EXPECT_EQ(1u, epoll_server_.NumberOfAlarms());
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(99949);
+  EXPECT_EQ(std::vector<int>({1, 2}), fired_);
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(1);
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), fired_);
+  EXPECT_EQ(0u, epoll_server_.NumberOfAlarms());
+}
+
+TEST_F(QuicEpollAlarmFactoryTimingWheelTest, SetEarlierAlarm) {
+  std::unique_ptr<QuicAlarm> late_alarm = CreateAlarm(0);
+  std::unique_ptr<QuicAlarm> early_alarm = CreateAlarm(1);
+  const QuicTime start = clock_.Now();
+  late_alarm->Set(start + QuicTime::Delta::FromMilliseconds(10));
+  early_alarm->Set(start + QuicTime::Delta::FromMilliseconds(1));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(999);
+  EXPECT_TRUE(fired_.empty());
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(1);
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+  EXPECT_TRUE(late_alarm->IsSet());
+}
+
+// Alarms may be set from the callbacks of other alarms, and destroyed after
+// the factory.
+TEST_F(QuicEpollAlarmFactoryTimingWheelTest, SetFromAlarmAndOutliveFactory) {
+  std::unique_ptr<QuicAlarm> next_alarm = CreateAlarm(1);
+
+  class SettingDelegate : public QuicAlarm::DelegateWithoutContext {
+   public:
+    SettingDelegate(QuicAlarm* alarm, QuicTime deadline)
+        : alarm_(alarm), deadline_(deadline) {}
+
+    void OnAlarm() override { alarm_->Set(deadline_); }
+
+   private:
+    QuicAlarm* alarm_;
+    QuicTime deadline_;
+  };
+  const QuicTime start = clock_.Now();
+  std::unique_ptr<QuicAlarm> alarm(alarm_factory_->CreateAlarm(
+      new SettingDelegate(next_alarm.get(),
+                          start + QuicTime::Delta::FromMicroseconds(15))));
+  alarm->Set(start + QuicTime::Delta::FromMicroseconds(10));
+
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(10);
+  EXPECT_TRUE(fired_.empty());
+  EXPECT_TRUE(next_alarm->IsSet());
+
+  alarm_factory_.reset();
+  epoll_server_.AdvanceByExactlyAndCallCallbacks(5);
+  EXPECT_EQ(std::vector<int>({1}), fired_);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
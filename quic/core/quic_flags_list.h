@@ -123,6 +123,46 @@ QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_bbr2_exit_startup_on_persistent_queue2
 QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_bbr2_add_bytes_acked_after_inflight_hi_limited, true)
 // When true, the BBR4 copt sets the extra_acked window to 20 RTTs and BBR5 sets it to 40 RTTs.
 QUIC_FLAG(FLAGS_quic_reloadable_flag_quic_bbr2_extra_acked_window, true)
+// If true, QuicServer enables UDP GRO on its listening socket and reads coalesced datagrams into large super-buffers.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_server_use_udp_gro, false)
+// If true, QuicServer and QuicClientEpollNetworkHelper read and write packets with io_uring when the kernel supports it.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_use_io_uring_for_udp, false)
+// If true, server connection IDs that replace or succeed another connection ID keep its first byte, so that packets can be steered to the owning worker by that byte. Client connection IDs are not affected.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_preserve_server_connection_id_first_byte, false)
+// If true, QuicPacketReader reads packets into reference counted pooled buffers, so that retained packets share the buffer instead of copying it.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_pool_packet_reader_buffers, false)
+// If true, QuicDispatcher looks up sessions in a QuicSessionIndex instead of its session map.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_dispatcher_use_session_index, false)
+// If true, QuicTimeWaitListManager stores connections in a QuicCompactTimeWaitList, and QuicDispatcher lets it build the termination packets of statelessly terminated connections on demand.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_compact_time_wait_list, false)
+// If true, QuicTimeWaitListManager leaves the packets buffered by a batch writer for QuicDispatcher::FlushTimeWaitListWrites() to flush once per read loop. QuicServer then gives the time wait list manager its own sendmmsg batch writer.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_batch_time_wait_list_writes, false)
+// If true, QuicTimeWaitListManager rate limits the packets it sends per IP address.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_rate_limit_time_wait_list_packets, false)
+// If true, QuicBufferedPacketStore bounds the total length of the packets it buffers, copies packets into pooled buffers, and expires connections when their lifetime ends.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_bounded_buffered_packet_store, false)
+// If true, QuicServer computes TLS handshake signatures on a pool of FLAGS_quic_handshake_signature_threads worker threads, and resumes the handshakes from its event loop.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_offload_handshake_signatures, false)
+// If true, QuicGsoBatchWriter batches paced packets whose release times are within FLAGS_quic_gso_max_release_time_spread_us of the packets it has buffered, and releases them together.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_gso_batch_paced_packets, false)
+// If true, QuicConnection serializes coalesced packets directly into the packet writer's buffer.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_serialize_coalesced_packet_into_writer_buffer, false)
+// If true, QuicUnackedPacketMap reuses the out of line frame lists of removed packets for the retransmittable frames of newly sent packets.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_reuse_retransmittable_frame_lists, false)
+// If true, QuicUnackedPacketMap aggregates the acked stream data of up to 4 streams at once, rather than of the last acked stream only, before notifying the session notifier.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_aggregate_acked_stream_frames_per_stream, false)
+// If true, QuicReceivedPacketManager tracks received packets in a QuicReceivedPacketBitmap, and only builds the intervals of the ack frame when it is sent.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_use_received_packet_bitmap, false)
+// If true, QuicStreamSequencerBuffer moves stream data into a double mapped circular buffer once the unread data spans more than kBlockSizeBytes, so that all readable data is contiguous from then on. Smaller unread data stays in blocks and may straddle a block boundary.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_contiguous_stream_sequencer_buffer, false)
+// If true, QuicSession allocates the send buffer slices of its streams from slabs, and streams append small writes to their last slice.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_pool_stream_send_buffer_slices, false)
+// If true, QuicPacketCreator encrypts the data of the last STREAM frame of a packet straight from the stream send buffer, rather than copying it into the packet first.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_scatter_gather_stream_frame_data, false)
+// If true, QuicEpollAlarmFactory keeps its alarms in a timing wheel, and registers a single alarm with the epoll server for the earliest of them.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_epoll_alarm_timing_wheel, false)
+// If true, QuicConnection keeps the deadlines of its alarms in a QuicAlarmMultiplexer, which only sets a platform alarm for the earliest of them.
+QUIC_FLAG(FLAGS_quic_restart_flag_quic_multiplex_connection_alarms, false)
 
 #endif
 
@@ -4717,6 +4717,15 @@ size_t QuicFramer::EncryptInPlace(EncryptionLevel level,
                                   QuicPacketNumber packet_number, size_t ad_len,
                                   size_t total_len, size_t buffer_len,
                                   char* buffer) {
+  return EncryptInPlaceWithTrailingData(level, packet_number, ad_len, total_len,
+                                        absl::string_view(), buffer_len,
+                                        buffer);
+}
+
+size_t QuicFramer::EncryptInPlaceWithTrailingData(
+    EncryptionLevel level, QuicPacketNumber packet_number, size_t ad_len,
+    size_t total_len, absl::string_view trailing_data, size_t buffer_len,
+    char* buffer) {
   QUICHE_DCHECK(packet_number.IsInitialized());
   if (encrypter_[level] == nullptr) {
     QUIC_BUG(quic_bug_10850_59)
@@ -4727,13 +4736,18 @@ size_t QuicFramer::EncryptInPlace(EncryptionLevel level,
   }
 
   size_t output_length = 0;
-  if (!encrypter_[level]->EncryptPacket(
-          packet_number.ToUint64(),
-          absl::string_view(buffer, ad_len),  // Associated data
-          absl::string_view(buffer + ad_len,
-                            total_len - ad_len),  // Plaintext
-          buffer + ad_len,                        // Destination buffer
-          &output_length, buffer_len - ad_len)) {
+  const absl::string_view associated_data(buffer, ad_len);
+  const absl::string_view plaintext(buffer + ad_len, total_len - ad_len);
+  const bool success =
+      trailing_data.empty()
+          ? encrypter_[level]->EncryptPacket(
+                packet_number.ToUint64(), associated_data, plaintext,
+                buffer + ad_len, &output_length, buffer_len - ad_len)
+          : encrypter_[level]->EncryptPacketWithTrailingData(
+                packet_number.ToUint64(), associated_data, plaintext,
+                trailing_data, buffer + ad_len, &output_length,
+                buffer_len - ad_len);
+  if (!success) {
     RaiseError(QUIC_ENCRYPTION_FAILURE);
     return 0;
   }
@@ -4749,8 +4763,6 @@ size_t QuicFramer::EncryptInPlace(EncryptionLevel level,
 
 namespace {
 
-const size_t kHPSampleLen = 16;
-
 constexpr bool IsLongHeader(uint8_t type_byte) {
   return (type_byte & FLAGS_LONG_HEADER) != 0;
 }
@@ -4771,10 +4783,11 @@ bool QuicFramer::ApplyHeaderProtection(EncryptionLevel level, char* buffer,
   QuicDataReader sample_reader(buffer, buffer_len);
   absl::string_view sample;
   if (!sample_reader.Seek(sample_offset) ||
-      !sample_reader.ReadStringPiece(&sample, kHPSampleLen)) {
+      !sample_reader.ReadStringPiece(&sample, kHeaderProtectionSampleSize)) {
     QUIC_BUG(quic_bug_10850_60)
         << "Not enough bytes to sample: sample_offset " << sample_offset
-        << ", sample len: " << kHPSampleLen << ", buffer len: " << buffer_len;
+        << ", sample len: " << kHeaderProtectionSampleSize
+        << ", buffer len: " << buffer_len;
     return false;
   }
 
@@ -4786,12 +4799,12 @@ bool QuicFramer::ApplyHeaderProtection(EncryptionLevel level, char* buffer,
     return false;
   }
 
-  std::string mask = encrypter_[level]->GenerateHeaderProtectionMask(sample);
-  if (mask.empty()) {
+  char mask[kHeaderProtectionMaskSize];
+  if (!encrypter_[level]->WriteHeaderProtectionMask(sample, mask)) {
     QUIC_BUG(quic_bug_10850_61) << "Unable to generate header protection mask.";
     return false;
   }
-  QuicDataReader mask_reader(mask.data(), mask.size());
+  QuicDataReader mask_reader(mask, sizeof(mask));
 
   // Apply the mask to the 4 or 5 least significant bits of the first byte.
   uint8_t bitmask = 0x1f;
@@ -4883,12 +4896,14 @@ bool QuicFramer::RemoveHeaderProtection(QuicDataReader* reader,
       return false;
     }
   }
-  std::string mask = decrypter->GenerateHeaderProtectionMask(&sample_reader);
-  QuicDataReader mask_reader(mask.data(), mask.size());
-  if (mask.empty()) {
+  absl::string_view sample;
+  char mask[kHeaderProtectionMaskSize];
+  if (!sample_reader.ReadStringPiece(&sample, kHeaderProtectionSampleSize) ||
+      !decrypter->WriteHeaderProtectionMask(sample, mask)) {
     QUIC_DVLOG(1) << "Failed to compute mask";
     return false;
   }
+  QuicDataReader mask_reader(mask, sizeof(mask));
 
   // Unmask the rest of the type byte.
   uint8_t bitmask = 0x1f;
@@ -5776,6 +5791,27 @@ bool QuicFramer::AppendIetfStreamFrame(const QuicStreamFrame& frame,
   return true;
 }
 
+// Append the last stream frame of a packet. If the data producer has the
+// frame data in contiguous memory, only the frame header is written, and the
+// data is returned in |trailing_data| to be encrypted in place.
+bool QuicFramer::AppendLastStreamFrame(const QuicStreamFrame& frame,
+                                       QuicDataWriter* writer,
+                                       absl::string_view* trailing_data) {
+  *trailing_data = absl::string_view();
+  if (data_producer_ == nullptr || frame.data_length == 0 ||
+      !data_producer_->GetContiguousStreamData(frame.stream_id, frame.offset,
+                                               frame.data_length,
+                                               trailing_data)) {
+    return AppendStreamFrame(frame, /*no_stream_frame_length=*/true, writer);
+  }
+  // The last frame in a packet has no length field, so without data only its
+  // header is written.
+  QuicStreamFrame header_only_frame = frame;
+  header_only_frame.data_length = 0;
+  return AppendStreamFrame(header_only_frame, /*no_stream_frame_length=*/true,
+                           writer);
+}
+
 bool QuicFramer::AppendCryptoFrame(const QuicCryptoFrame& frame,
                                    QuicDataWriter* writer) {
   if (!writer->WriteVarInt62(static_cast<uint64_t>(frame.offset))) {
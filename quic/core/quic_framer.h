@@ -551,6 +551,14 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
   size_t AppendIetfFrames(const QuicFrames& frames, QuicDataWriter* writer);
   bool AppendStreamFrame(const QuicStreamFrame& frame,
                          bool no_stream_frame_length, QuicDataWriter* writer);
+  // Like AppendStreamFrame() for the last frame in a packet, but if the data
+  // producer has the data of |frame| in contiguous memory, points
+  // |trailing_data| at it instead of writing it to |writer|. The data is then
+  // encrypted by EncryptInPlaceWithTrailingData(). Otherwise, writes the data
+  // and leaves |trailing_data| empty.
+  bool AppendLastStreamFrame(const QuicStreamFrame& frame,
+                             QuicDataWriter* writer,
+                             absl::string_view* trailing_data);
   bool AppendCryptoFrame(const QuicCryptoFrame& frame, QuicDataWriter* writer);
   bool AppendAckFrequencyFrame(const QuicAckFrequencyFrame& frame,
                                QuicDataWriter* writer);
@@ -612,6 +620,16 @@ class QUIC_EXPORT_PRIVATE QuicFramer {
                         size_t buffer_len,
                         char* buffer);
 
+  // Like EncryptInPlace(), but the plaintext in |buffer| is followed by
+  // |trailing_data|, which is encrypted from where it is into |buffer|.
+  size_t EncryptInPlaceWithTrailingData(EncryptionLevel level,
+                                        QuicPacketNumber packet_number,
+                                        size_t ad_len,
+                                        size_t total_len,
+                                        absl::string_view trailing_data,
+                                        size_t buffer_len,
+                                        char* buffer);
+
   // Returns the length of the data encrypted into |buffer| if |buffer_len| is
   // long enough, and otherwise 0.
   size_t EncryptPayload(EncryptionLevel level,
@@ -17,6 +17,10 @@
 #include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/crypto/aes_128_gcm_encrypter.h"
+#include "quic/core/crypto/chacha20_poly1305_tls_encrypter.h"
 #include "quic/core/crypto/null_decrypter.h"
 #include "quic/core/crypto/null_encrypter.h"
 #include "quic/core/crypto/quic_decrypter.h"
@@ -16368,6 +16372,99 @@ TEST_P(QuicFramerTest, ErrorWhenUnexpectedFrameTypeEncountered) {
       framer_.detailed_error());
 }
 
+// Logs the rate at which packets go through the framer's seal and header
+// protection path, and the cost of generating header protection masks one
+// string at a time, into caller provided buffers, and in batches.
+TEST_P(QuicFramerTest, DISABLED_SealAndProtectPacketsPerSecond) {
+  if (framer_.version() != ParsedQuicVersion::RFCv1()) {
+    return;
+  }
+  const int kNumPackets = 100000;
+  const size_t kPayloadSize = 1200;
+
+  QuicPacketHeader header;
+  header.destination_connection_id = FramerTestConnectionId();
+  header.reset_flag = false;
+  header.version_flag = false;
+  header.packet_number = kPacketNumber;
+  header.packet_number_length = PACKET_4BYTE_PACKET_NUMBER;
+  const std::string payload(kPayloadSize, 'a');
+  QuicStreamFrame stream_frame(kStreamId, false, kStreamOffset, payload);
+  QuicFrames frames = {QuicFrame(stream_frame)};
+  std::unique_ptr<QuicPacket> raw_packet(BuildDataPacket(header, frames));
+  ASSERT_TRUE(raw_packet != nullptr);
+
+  std::vector<std::pair<std::string, std::unique_ptr<QuicEncrypter>>>
+      encrypters;
+  encrypters.emplace_back("AES-128-GCM",
+                          std::make_unique<Aes128GcmEncrypter>());
+  encrypters.emplace_back("ChaCha20-Poly1305",
+                          std::make_unique<ChaCha20Poly1305TlsEncrypter>());
+  for (auto& name_and_encrypter : encrypters) {
+    const std::string& name = name_and_encrypter.first;
+    QuicEncrypter* encrypter = name_and_encrypter.second.get();
+    ASSERT_TRUE(encrypter->SetKey(std::string(encrypter->GetKeySize(), 'k')));
+    ASSERT_TRUE(encrypter->SetIV(std::string(encrypter->GetIVSize(), 'i')));
+    ASSERT_TRUE(encrypter->SetHeaderProtectionKey(
+        std::string(encrypter->GetKeySize(), 'h')));
+
+    // Masks only, from the samples of a batch of packets.
+    const size_t kNumSamples = 64;
+    std::string samples;
+    for (size_t i = 0; i < kNumSamples * kHeaderProtectionSampleSize; ++i) {
+      samples.push_back(static_cast<char>(i));
+    }
+    char masks[kNumSamples * kHeaderProtectionMaskSize];
+    const int kNumBatches = kNumPackets / kNumSamples;
+    absl::Time start = absl::Now();
+    for (int i = 0; i < kNumBatches; ++i) {
+      for (size_t j = 0; j < kNumSamples; ++j) {
+        std::string mask = encrypter->GenerateHeaderProtectionMask(
+            absl::string_view(samples).substr(j * kHeaderProtectionSampleSize,
+                                              kHeaderProtectionSampleSize));
+        ASSERT_FALSE(mask.empty());
+        masks[j * kHeaderProtectionMaskSize] = mask[0];
+      }
+    }
+    const absl::Duration string_duration = absl::Now() - start;
+    start = absl::Now();
+    for (int i = 0; i < kNumBatches; ++i) {
+      for (size_t j = 0; j < kNumSamples; ++j) {
+        ASSERT_TRUE(encrypter->WriteHeaderProtectionMask(
+            absl::string_view(samples).substr(j * kHeaderProtectionSampleSize,
+                                              kHeaderProtectionSampleSize),
+            masks + j * kHeaderProtectionMaskSize));
+      }
+    }
+    const absl::Duration buffer_duration = absl::Now() - start;
+    start = absl::Now();
+    for (int i = 0; i < kNumBatches; ++i) {
+      ASSERT_TRUE(encrypter->WriteHeaderProtectionMasks(samples.data(),
+                                                        kNumSamples, masks));
+    }
+    const absl::Duration batch_duration = absl::Now() - start;
+    const int num_masks = kNumBatches * kNumSamples;
+    QUIC_LOG(INFO) << name << " header protection mask: string "
+                   << string_duration / num_masks << ", buffer "
+                   << buffer_duration / num_masks << ", batch of "
+                   << kNumSamples << " " << batch_duration / num_masks;
+
+    framer_.SetEncrypter(ENCRYPTION_FORWARD_SECURE,
+                         std::move(name_and_encrypter.second));
+    char buffer[kMaxOutgoingPacketSize];
+    start = absl::Now();
+    for (int i = 0; i < kNumPackets; ++i) {
+      ASSERT_NE(0u, framer_.EncryptPayload(
+                        ENCRYPTION_FORWARD_SECURE, kPacketNumber + i,
+                        *raw_packet, buffer, kMaxOutgoingPacketSize));
+    }
+    const absl::Duration seal_duration = absl::Now() - start;
+    QUIC_LOG(INFO) << name << " seal and protect: "
+                   << kNumPackets / absl::ToDoubleSeconds(seal_duration)
+                   << " packets/s of " << raw_packet->length() << " bytes";
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
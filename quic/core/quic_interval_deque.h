@@ -237,6 +237,10 @@ class QUIC_NO_EXPORT QuicIntervalDeque {
   // will move the |cached_index_| as the iterator moves.
   Iterator DataAt(const std::size_t interval_begin);
 
+  // Returns the last item. Its interval may only be extended at its end, and
+  // the structure must not be empty.
+  T& Back();
+
   // Returns the number of items contained inside the structure.
   std::size_t Size() const;
   // Returns whether the structure is empty.
@@ -346,6 +350,12 @@ typename QuicIntervalDeque<T, C>::Iterator QuicIntervalDeque<T, C>::DataAt(
   return ret;
 }
 
+template <class T, class C>
+T& QuicIntervalDeque<T, C>::Back() {
+  QUICHE_DCHECK(!container_.empty());
+  return container_.back();
+}
+
 template <class T, class C>
 std::size_t QuicIntervalDeque<T, C>::Size() const {
   return container_.size();
@@ -348,6 +348,18 @@ TEST_F(QuicIntervalDequeTest, ZeroSizedInterval) {
                   "Trying to save empty interval to .");
 }
 
+// The goal of this test is to show that the last item can be extended, and
+// is found at its new interval afterwards.
+TEST_F(QuicIntervalDequeTest, ExtendBack) {
+  EXPECT_EQ(kSize - 1, qid_.Back().val);
+  const std::size_t end = kIntervalStep * kSize;
+  EXPECT_EQ(qid_.DataAt(end), qid_.DataEnd());
+  qid_.Back().interval_end += kIntervalStep;
+  auto it = qid_.DataAt(end);
+  ASSERT_NE(it, qid_.DataEnd());
+  EXPECT_EQ(kSize - 1, it->val);
+}
+
 // The goal of this test is to show that an iterator to an empty container
 // returns |DataEnd|.
 TEST_F(QuicIntervalDequeTest, IteratorEmpty) {
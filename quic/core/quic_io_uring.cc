@@ -0,0 +1,350 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_io_uring.h"
+
+#include <errno.h>
+
+#if QUIC_IO_URING_SUPPORTED
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#endif
+
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+#if QUIC_IO_URING_SUPPORTED
+
+namespace {
+
+int IoUringSetup(uint32_t entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd,
+                 uint32_t to_submit,
+                 uint32_t min_complete,
+                 uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int ring_fd, uint32_t opcode, void* arg, uint32_t nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+uint32_t LoadAcquire(const uint32_t* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(uint32_t* p, uint32_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+T* Offset(void* base, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+bool ProbeSupport() {
+  std::unique_ptr<QuicIoUring> ring = QuicIoUring::Create(2);
+  if (ring == nullptr) {
+    return false;
+  }
+
+  // Provided buffer rings are the newest kernel feature used.
+  if (!ring->RegisterBufferRing(/*group_id=*/0, /*num_buffers=*/1,
+                                /*buffer_size=*/64)) {
+    return false;
+  }
+
+  const size_t probe_size =
+      sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+  std::unique_ptr<char[]> probe_buffer(new char[probe_size]);
+  memset(probe_buffer.get(), 0, probe_size);
+  auto* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.get());
+  if (IoUringRegister(ring->ring_fd(), IORING_REGISTER_PROBE, probe,
+                      IORING_OP_LAST) < 0) {
+    return false;
+  }
+  for (uint8_t op : {IORING_OP_RECVMSG, IORING_OP_SENDMSG,
+                     IORING_OP_ASYNC_CANCEL}) {
+    if (op > probe->last_op ||
+        !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<QuicIoUring> QuicIoUring::Create(uint32_t entries) {
+  std::unique_ptr<QuicIoUring> ring(new QuicIoUring());
+  if (!ring->Initialize(entries)) {
+    return nullptr;
+  }
+  return ring;
+}
+
+// static
+bool QuicIoUring::IsSupported() {
+  static const bool supported = ProbeSupport();
+  return supported;
+}
+
+QuicIoUring::~QuicIoUring() {
+  UnregisterBufferRing();
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+bool QuicIoUring::Initialize(uint32_t entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    QUIC_LOG_FIRST_N(INFO, 1)
+        << "io_uring_setup failed: " << strerror(errno);
+    ring_fd_ = -1;
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    QUIC_LOG(ERROR) << "Failed to map io_uring SQ: " << strerror(errno);
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      QUIC_LOG(ERROR) << "Failed to map io_uring CQ: " << strerror(errno);
+      return false;
+    }
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    QUIC_LOG(ERROR) << "Failed to map io_uring SQEs: " << strerror(errno);
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sq_head_ = Offset<uint32_t>(sq_ring_, params.sq_off.head);
+  sq_tail_ = Offset<uint32_t>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = *Offset<uint32_t>(sq_ring_, params.sq_off.ring_mask);
+  sq_entries_ = *Offset<uint32_t>(sq_ring_, params.sq_off.ring_entries);
+  sq_array_ = Offset<uint32_t>(sq_ring_, params.sq_off.array);
+  sqe_head_ = sqe_tail_ = *sq_tail_;
+
+  cq_head_ = Offset<uint32_t>(cq_ring_, params.cq_off.head);
+  cq_tail_ = Offset<uint32_t>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *Offset<uint32_t>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = Offset<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  return true;
+}
+
+io_uring_sqe* QuicIoUring::GetSqe() {
+  if (sqe_tail_ - LoadAcquire(sq_head_) >= sq_entries_) {
+    return nullptr;
+  }
+  io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+  ++sqe_tail_;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+int QuicIoUring::Submit(uint32_t min_complete) {
+  const uint32_t to_submit = num_pending_sqes();
+  uint32_t tail = *sq_tail_;
+  for (; sqe_head_ != sqe_tail_; ++sqe_head_, ++tail) {
+    sq_array_[tail & sq_mask_] = sqe_head_ & sq_mask_;
+  }
+  StoreRelease(sq_tail_, tail);
+
+  if (to_submit == 0 && min_complete == 0) {
+    return 0;
+  }
+
+  int rc;
+  do {
+    rc = IoUringEnter(ring_fd_, to_submit, min_complete,
+                      min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+  } while (rc < 0 && errno == EINTR);
+  if (rc < 0) {
+    return -errno;
+  }
+  return rc;
+}
+
+io_uring_cqe* QuicIoUring::PeekCqe() {
+  const uint32_t head = *cq_head_;
+  if (head == LoadAcquire(cq_tail_)) {
+    return nullptr;
+  }
+  return &cqes_[head & cq_mask_];
+}
+
+void QuicIoUring::AdvanceCq() { StoreRelease(cq_head_, *cq_head_ + 1); }
+
+bool QuicIoUring::RegisterEventFd(int event_fd) {
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_EVENTFD_ASYNC, &event_fd, 1) <
+      0) {
+    QUIC_LOG(ERROR) << "IORING_REGISTER_EVENTFD_ASYNC failed: "
+                    << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool QuicIoUring::RegisterBufferRing(uint16_t group_id,
+                                     uint16_t num_buffers,
+                                     size_t buffer_size) {
+  if (buffer_ring_ != nullptr) {
+    QUIC_BUG(quic_io_uring_buffer_ring_registered)
+        << "Only one provided buffer ring is supported.";
+    return false;
+  }
+  if (num_buffers == 0 || (num_buffers & (num_buffers - 1)) != 0) {
+    QUIC_BUG(quic_io_uring_invalid_num_buffers)
+        << "num_buffers must be a power of 2: " << num_buffers;
+    return false;
+  }
+
+  const size_t ring_size = num_buffers * sizeof(io_uring_buf);
+  void* ring_memory = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE,
+                           MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (ring_memory == MAP_FAILED) {
+    QUIC_LOG(ERROR) << "Failed to map buffer ring: " << strerror(errno);
+    return false;
+  }
+
+  io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring_memory);
+  reg.ring_entries = num_buffers;
+  reg.bgid = group_id;
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    QUIC_LOG_FIRST_N(INFO, 1)
+        << "IORING_REGISTER_PBUF_RING failed: " << strerror(errno);
+    munmap(ring_memory, ring_size);
+    return false;
+  }
+
+  buffer_ring_ = static_cast<io_uring_buf_ring*>(ring_memory);
+  buffer_ring_size_ = ring_size;
+  buffer_group_id_ = group_id;
+  num_provided_buffers_ = num_buffers;
+  provided_buffer_size_ = buffer_size;
+  provided_buffers_.reset(new char[num_buffers * buffer_size]);
+  buffer_ring_->tail = 0;
+  for (uint16_t i = 0; i < num_buffers; ++i) {
+    RecycleProvidedBuffer(i);
+  }
+  return true;
+}
+
+char* QuicIoUring::GetProvidedBuffer(uint16_t buffer_id) const {
+  QUICHE_DCHECK_LT(buffer_id, num_provided_buffers_);
+  return provided_buffers_.get() + buffer_id * provided_buffer_size_;
+}
+
+void QuicIoUring::RecycleProvidedBuffer(uint16_t buffer_id) {
+  QUICHE_DCHECK(buffer_ring_ != nullptr);
+  const uint16_t tail = buffer_ring_->tail;
+  // The ring is indexed as a plain array rather than through |bufs|, since in
+  // C++ __DECLARE_FLEX_ARRAY may not place |bufs| at offset 0.
+  io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buffer_ring_) +
+                      (tail & (num_provided_buffers_ - 1));
+  buf->addr = reinterpret_cast<uint64_t>(GetProvidedBuffer(buffer_id));
+  buf->len = provided_buffer_size_;
+  buf->bid = buffer_id;
+  __atomic_store_n(&buffer_ring_->tail, static_cast<uint16_t>(tail + 1),
+                   __ATOMIC_RELEASE);
+}
+
+void QuicIoUring::UnregisterBufferRing() {
+  if (buffer_ring_ == nullptr) {
+    return;
+  }
+  io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = buffer_group_id_;
+  IoUringRegister(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  munmap(buffer_ring_, buffer_ring_size_);
+  buffer_ring_ = nullptr;
+}
+
+#else  // QUIC_IO_URING_SUPPORTED
+
+// static
+std::unique_ptr<QuicIoUring> QuicIoUring::Create(uint32_t /*entries*/) {
+  QUIC_LOG_FIRST_N(INFO, 1) << "io_uring is not supported by this build.";
+  return nullptr;
+}
+
+// static
+bool QuicIoUring::IsSupported() { return false; }
+
+QuicIoUring::~QuicIoUring() = default;
+
+io_uring_sqe* QuicIoUring::GetSqe() { return nullptr; }
+
+int QuicIoUring::Submit(uint32_t /*min_complete*/) { return -ENOSYS; }
+
+io_uring_cqe* QuicIoUring::PeekCqe() { return nullptr; }
+
+void QuicIoUring::AdvanceCq() {}
+
+bool QuicIoUring::RegisterEventFd(int /*event_fd*/) { return false; }
+
+bool QuicIoUring::RegisterBufferRing(uint16_t /*group_id*/,
+                                     uint16_t /*num_buffers*/,
+                                     size_t /*buffer_size*/) {
+  return false;
+}
+
+char* QuicIoUring::GetProvidedBuffer(uint16_t /*buffer_id*/) const {
+  return nullptr;
+}
+
+void QuicIoUring::RecycleProvidedBuffer(uint16_t /*buffer_id*/) {}
+
+#endif  // QUIC_IO_URING_SUPPORTED
+
+}  // namespace quic
@@ -0,0 +1,147 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_IO_URING_H_
+#define QUICHE_QUIC_CORE_QUIC_IO_URING_H_
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "quic/platform/api/quic_export.h"
+
+// Multishot recvmsg, added in Linux 6.0, is the newest io_uring feature used.
+// Without it, e.g. on other platforms or with older kernel headers, QuicIoUring
+// is a stub whose Create() always returns nullptr.
+#if defined(IORING_RECV_MULTISHOT)
+#define QUIC_IO_URING_SUPPORTED 1
+#else
+#define QUIC_IO_URING_SUPPORTED 0
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+#endif
+
+namespace quic {
+
+// QuicIoUring is a minimal wrapper around a Linux io_uring instance, using the
+// raw io_uring_setup/io_uring_enter/io_uring_register syscalls. It owns the
+// ring fd and the memory mappings of the submission and completion queues.
+//
+// Example:
+//   std::unique_ptr<QuicIoUring> ring = QuicIoUring::Create(64);
+//   if (ring == nullptr) { /* Fall back to non-io_uring IO. */ }
+//   io_uring_sqe* sqe = ring->GetSqe();
+//   ... (Populate sqe) ...
+//   ring->Submit(/*min_complete=*/0);
+//   while (io_uring_cqe* cqe = ring->PeekCqe()) {
+//     ... (Handle cqe) ...
+//     ring->AdvanceCq();
+//   }
+class QUIC_EXPORT_PRIVATE QuicIoUring {
+ public:
+  // Creates a ring with at least |entries| submission queue entries. Returns
+  // nullptr if io_uring is not supported by the kernel, or disabled.
+  static std::unique_ptr<QuicIoUring> Create(uint32_t entries);
+
+  QuicIoUring(const QuicIoUring&) = delete;
+  QuicIoUring& operator=(const QuicIoUring&) = delete;
+  ~QuicIoUring();
+
+  // Whether io_uring supports all operations used by the QUIC io_uring reader
+  // and writer on this kernel. The result is computed once per process.
+  static bool IsSupported();
+
+  // The ring fd. It is readable when completions are available, so it can be
+  // registered with an epoll server.
+  int ring_fd() const { return ring_fd_; }
+
+  // Returns the next zeroed submission queue entry, or nullptr if the
+  // submission queue is full. The entry is submitted on the next Submit().
+  io_uring_sqe* GetSqe();
+
+  // Number of entries obtained by GetSqe() and not yet submitted.
+  uint32_t num_pending_sqes() const { return sqe_tail_ - sqe_head_; }
+
+  // Submits all pending entries and waits until at least |min_complete|
+  // completions are available. Returns the number of entries submitted, or
+  // -errno on failure.
+  int Submit(uint32_t min_complete);
+
+  // Returns the oldest unconsumed completion, or nullptr if there is none. The
+  // completion stays valid until AdvanceCq() is called.
+  io_uring_cqe* PeekCqe();
+
+  // Consumes the completion returned by the last PeekCqe().
+  void AdvanceCq();
+
+  // Makes the kernel signal |event_fd| whenever a request completes
+  // asynchronously, i.e. not during the Submit() call which submitted it.
+  // Returns false on failure.
+  bool RegisterEventFd(int event_fd);
+
+  // Registers a ring of provided buffers, identified by |group_id|, with
+  // |num_buffers| entries (must be a power of 2) that are carved out of a
+  // single allocation of |num_buffers| * |buffer_size| bytes. All buffers are
+  // initially available to the kernel. Returns false on failure.
+  bool RegisterBufferRing(uint16_t group_id,
+                          uint16_t num_buffers,
+                          size_t buffer_size);
+
+  // Returns the memory of provided buffer |buffer_id|.
+  char* GetProvidedBuffer(uint16_t buffer_id) const;
+  size_t provided_buffer_size() const { return provided_buffer_size_; }
+
+  // Gives provided buffer |buffer_id| back to the kernel.
+  void RecycleProvidedBuffer(uint16_t buffer_id);
+
+ private:
+  QuicIoUring() = default;
+
+  bool Initialize(uint32_t entries);
+  void UnregisterBufferRing();
+
+  int ring_fd_ = -1;
+
+  // Submission queue.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t sq_entries_ = 0;
+  uint32_t* sq_array_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  // Entries in [sqe_head_, sqe_tail_) have been handed out by GetSqe() but not
+  // yet published to the kernel.
+  uint32_t sqe_head_ = 0;
+  uint32_t sqe_tail_ = 0;
+
+  // Completion queue. May share its mapping with the submission queue.
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  // Provided buffer ring.
+  io_uring_buf_ring* buffer_ring_ = nullptr;
+  size_t buffer_ring_size_ = 0;
+  uint16_t buffer_group_id_ = 0;
+  uint16_t num_provided_buffers_ = 0;
+  std::unique_ptr<char[]> provided_buffers_;
+  size_t provided_buffer_size_ = 0;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_IO_URING_H_
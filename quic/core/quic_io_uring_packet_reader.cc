@@ -0,0 +1,302 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_io_uring_packet_reader.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "quic/core/quic_packets.h"
+#include "quic/core/quic_process_packet_interface.h"
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_flag_utils.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_server_stats.h"
+
+namespace quic {
+
+#if QUIC_IO_URING_SUPPORTED
+
+namespace {
+
+const uint16_t kReadBufferGroupId = 0;
+
+// user_data of cancellation requests. Receive requests use the fd.
+const uint64_t kCancelUserData = ~uint64_t{0};
+
+// Each provided buffer holds an io_uring_recvmsg_out header, followed by the
+// peer address, the control messages and the payload.
+const size_t kReadBufferSize = sizeof(io_uring_recvmsg_out) +
+                               sizeof(sockaddr_storage) +
+                               kDefaultUdpPacketControlBufferSize +
+                               kMaxIncomingPacketSize;
+
+const BitMask64 kPacketInfoInterested(
+    QuicUdpPacketInfoBit::DROPPED_PACKETS, QuicUdpPacketInfoBit::V4_SELF_IP,
+    QuicUdpPacketInfoBit::V6_SELF_IP, QuicUdpPacketInfoBit::RECV_TIMESTAMP,
+    QuicUdpPacketInfoBit::TTL, QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER);
+
+QuicIpAddress GetSelfIp(const QuicUdpPacketInfo& packet_info,
+                        bool prefer_v6_ip) {
+  const bool has_v4 = packet_info.HasValue(QuicUdpPacketInfoBit::V4_SELF_IP);
+  const bool has_v6 = packet_info.HasValue(QuicUdpPacketInfoBit::V6_SELF_IP);
+  if (has_v6 && (prefer_v6_ip || !has_v4)) {
+    return packet_info.self_v6_ip();
+  }
+  if (has_v4) {
+    return packet_info.self_v4_ip();
+  }
+  return QuicIpAddress();
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<QuicIoUringPacketReader> QuicIoUringPacketReader::Create() {
+  if (!QuicIoUring::IsSupported()) {
+    return nullptr;
+  }
+  // Leave room in the completion queue for every provided buffer, plus
+  // cancellation and termination completions.
+  std::unique_ptr<QuicIoUring> ring =
+      QuicIoUring::Create(kNumIoUringReadBuffers);
+  if (ring == nullptr ||
+      !ring->RegisterBufferRing(kReadBufferGroupId, kNumIoUringReadBuffers,
+                                kReadBufferSize)) {
+    return nullptr;
+  }
+  return std::unique_ptr<QuicIoUringPacketReader>(
+      new QuicIoUringPacketReader(std::move(ring)));
+}
+
+QuicIoUringPacketReader::QuicIoUringPacketReader(
+    std::unique_ptr<QuicIoUring> ring)
+    : ring_(std::move(ring)),
+      armed_fd_(-1),
+      needs_rearm_(false),
+      fall_back_to_recvmmsg_(false) {
+  memset(&recv_msg_template_, 0, sizeof(recv_msg_template_));
+  recv_msg_template_.msg_namelen = sizeof(sockaddr_storage);
+  recv_msg_template_.msg_controllen = kDefaultUdpPacketControlBufferSize;
+}
+
+QuicIoUringPacketReader::~QuicIoUringPacketReader() = default;
+
+bool QuicIoUringPacketReader::ArmMultishotRecv(int fd) {
+  if (armed_fd_ >= 0 && armed_fd_ != fd && !needs_rearm_) {
+    io_uring_sqe* cancel_sqe = ring_->GetSqe();
+    if (cancel_sqe == nullptr) {
+      return false;
+    }
+    cancel_sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    cancel_sqe->fd = -1;
+    cancel_sqe->addr = static_cast<uint64_t>(armed_fd_);
+    cancel_sqe->user_data = kCancelUserData;
+  }
+
+  io_uring_sqe* sqe = ring_->GetSqe();
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&recv_msg_template_);
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kReadBufferGroupId;
+  sqe->user_data = static_cast<uint64_t>(fd);
+
+  int rc = ring_->Submit(/*min_complete=*/0);
+  if (rc < 0) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to submit multishot recvmsg: " << strerror(-rc);
+    return false;
+  }
+  armed_fd_ = fd;
+  needs_rearm_ = false;
+  return true;
+}
+
+bool QuicIoUringPacketReader::ReadAndDispatchPackets(
+    int fd,
+    int port,
+    const QuicClock& clock,
+    ProcessPacketInterface* processor,
+    QuicPacketCount* packets_dropped) {
+  if (fall_back_to_recvmmsg_) {
+    return QuicPacketReader::ReadAndDispatchPackets(fd, port, clock, processor,
+                                                    packets_dropped);
+  }
+
+  if ((armed_fd_ != fd || needs_rearm_) && !ArmMultishotRecv(fd)) {
+    // The request will be retried on the next call.
+    QUIC_CODE_COUNT(quic_io_uring_reader_arm_failure);
+    return false;
+  }
+
+  // Use clock.Now() as the packet receipt time, the time between packet
+  // arriving at the host and now is considered part of the network delay.
+  QuicTime now = clock.Now();
+
+  int completions = 0;
+  while (completions < kMaxIoUringCompletionsPerRead) {
+    io_uring_cqe* cqe = ring_->PeekCqe();
+    if (cqe == nullptr) {
+      break;
+    }
+    ++completions;
+    const io_uring_cqe completion = *cqe;
+    ring_->AdvanceCq();
+
+    if (completion.user_data == kCancelUserData) {
+      continue;
+    }
+    const bool is_current_fd =
+        completion.user_data == static_cast<uint64_t>(armed_fd_);
+    if (is_current_fd && !(completion.flags & IORING_CQE_F_MORE)) {
+      // The multishot request terminated, typically with -ENOBUFS because
+      // all provided buffers were in use.
+      needs_rearm_ = true;
+    }
+    if (completion.res < 0) {
+      if (completion.res == -EINVAL || completion.res == -EOPNOTSUPP) {
+        QUIC_LOG_FIRST_N(WARNING, 1)
+            << "Multishot recvmsg not supported, falling back to recvmmsg.";
+        fall_back_to_recvmmsg_ = true;
+        return QuicPacketReader::ReadAndDispatchPackets(
+            fd, port, clock, processor, packets_dropped);
+      }
+      if (completion.res != -ENOBUFS && completion.res != -ECANCELED) {
+        QUIC_LOG_FIRST_N(ERROR, 100)
+            << "Error reading packets: " << strerror(-completion.res);
+      }
+      continue;
+    }
+    if (!(completion.flags & IORING_CQE_F_BUFFER)) {
+      QUIC_BUG(quic_io_uring_reader_no_buffer)
+          << "Completion without a provided buffer.";
+      continue;
+    }
+    if (is_current_fd) {
+      DispatchCompletion(completion, port, now, processor, packets_dropped);
+    } else {
+      // Datagrams received on a previously armed fd are dropped.
+      ring_->RecycleProvidedBuffer(completion.flags >>
+                                   IORING_CQE_BUFFER_SHIFT);
+    }
+  }
+
+  if (needs_rearm_) {
+    ArmMultishotRecv(fd);
+  }
+
+  // There may be more completions in the queue.
+  return completions == kMaxIoUringCompletionsPerRead;
+}
+
+void QuicIoUringPacketReader::DispatchCompletion(
+    const io_uring_cqe& cqe,
+    int port,
+    QuicTime now,
+    ProcessPacketInterface* processor,
+    QuicPacketCount* packets_dropped) {
+  const uint16_t buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+  char* buffer = ring_->GetProvidedBuffer(buffer_id);
+  const size_t buffer_len = static_cast<size_t>(cqe.res);
+
+  const auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+  char* name = buffer + sizeof(io_uring_recvmsg_out);
+  char* control = name + recv_msg_template_.msg_namelen;
+  char* payload = control + recv_msg_template_.msg_controllen;
+  const size_t header_len = payload - buffer;
+
+  if (buffer_len < header_len ||
+      out->namelen > recv_msg_template_.msg_namelen) {
+    QUIC_BUG(quic_io_uring_reader_invalid_buffer)
+        << "Invalid recvmsg buffer. length:" << buffer_len;
+  } else if (QUIC_PREDICT_FALSE(out->flags & MSG_CTRUNC)) {
+    QUIC_BUG(quic_io_uring_reader_control_truncated)
+        << "Control buffer too small. size:"
+        << recv_msg_template_.msg_controllen;
+  } else if (QUIC_PREDICT_FALSE(out->flags & MSG_TRUNC) ||
+             header_len + out->payloadlen > buffer_len) {
+    QUIC_LOG_FIRST_N(WARNING, 100)
+        << "Received truncated QUIC packet. packet size:" << out->payloadlen;
+  } else {
+    QuicUdpPacketInfo packet_info;
+    socket_api_.PopulatePacketInfoFromControlBuffer(
+        BufferSpan(control, out->controllen), kPacketInfoInterested,
+        &packet_info);
+    if (packets_dropped != nullptr &&
+        packet_info.HasValue(QuicUdpPacketInfoBit::DROPPED_PACKETS)) {
+      *packets_dropped = packet_info.dropped_packets();
+    }
+
+    QuicSocketAddress peer_address =
+        QuicSocketAddress(*reinterpret_cast<sockaddr_storage*>(name))
+            .Normalized();
+    QuicIpAddress self_ip =
+        GetSelfIp(packet_info, peer_address.host().IsIPv6());
+    if (!self_ip.IsInitialized()) {
+      QUIC_BUG(quic_io_uring_reader_no_self_ip)
+          << "Unable to get self IP address.";
+    } else {
+      bool has_ttl = packet_info.HasValue(QuicUdpPacketInfoBit::TTL);
+      int ttl = has_ttl ? packet_info.ttl() : 0;
+      char* headers = nullptr;
+      size_t headers_length = 0;
+      if (packet_info.HasValue(QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER)) {
+        headers = packet_info.google_packet_headers().buffer;
+        headers_length = packet_info.google_packet_headers().buffer_len;
+      }
+      QuicReceivedPacket packet(payload, out->payloadlen, now,
+                                /*owns_buffer=*/false, ttl, has_ttl, headers,
+                                headers_length, /*owns_header_buffer=*/false);
+      processor->ProcessPacket(QuicSocketAddress(self_ip, port), peer_address,
+                               packet);
+    }
+  }
+
+  ring_->RecycleProvidedBuffer(buffer_id);
+}
+
+#else  // QUIC_IO_URING_SUPPORTED
+
+// static
+std::unique_ptr<QuicIoUringPacketReader> QuicIoUringPacketReader::Create() {
+  return nullptr;
+}
+
+QuicIoUringPacketReader::QuicIoUringPacketReader(
+    std::unique_ptr<QuicIoUring> ring)
+    : ring_(std::move(ring)),
+      armed_fd_(-1),
+      needs_rearm_(false),
+      fall_back_to_recvmmsg_(true) {}
+
+QuicIoUringPacketReader::~QuicIoUringPacketReader() = default;
+
+bool QuicIoUringPacketReader::ReadAndDispatchPackets(
+    int fd,
+    int port,
+    const QuicClock& clock,
+    ProcessPacketInterface* processor,
+    QuicPacketCount* packets_dropped) {
+  return QuicPacketReader::ReadAndDispatchPackets(fd, port, clock, processor,
+                                                  packets_dropped);
+}
+
+bool QuicIoUringPacketReader::ArmMultishotRecv(int /*fd*/) { return false; }
+
+void QuicIoUringPacketReader::DispatchCompletion(
+    const io_uring_cqe& /*cqe*/,
+    int /*port*/,
+    QuicTime /*now*/,
+    ProcessPacketInterface* /*processor*/,
+    QuicPacketCount* /*packets_dropped*/) {}
+
+#endif  // QUIC_IO_URING_SUPPORTED
+
+}  // namespace quic
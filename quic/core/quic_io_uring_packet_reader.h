@@ -0,0 +1,86 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A QuicPacketReader that receives packets with io_uring multishot recvmsg.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_IO_URING_PACKET_READER_H_
+#define QUICHE_QUIC_CORE_QUIC_IO_URING_PACKET_READER_H_
+
+#include <sys/socket.h>
+
+#include <memory>
+
+#include "quic/core/quic_io_uring.h"
+#include "quic/core/quic_packet_reader.h"
+#include "quic/core/quic_udp_socket.h"
+
+namespace quic {
+
+// Number of provided buffers the kernel can fill before the reader drains them.
+const uint16_t kNumIoUringReadBuffers = 256;
+
+// Maximum number of completions handled per ReadAndDispatchPackets call.
+const int kMaxIoUringCompletionsPerRead = 64;
+
+// QuicIoUringPacketReader keeps a multishot recvmsg armed on the socket, so
+// the kernel places incoming datagrams into a ring of provided buffers without
+// a syscall per batch. ReadAndDispatchPackets() drains the completion queue
+// and dispatches each datagram directly out of its provided buffer.
+//
+// Because datagrams are consumed from the socket asynchronously, the socket fd
+// may not become readable again while the reader has completions pending.
+// Callers must also watch ring_fd() for readability, and call
+// ReadAndDispatchPackets() with the socket fd when it is readable.
+//
+// If the kernel rejects multishot recvmsg at runtime, the reader falls back to
+// the recvmmsg implementation of QuicPacketReader.
+class QUIC_EXPORT_PRIVATE QuicIoUringPacketReader : public QuicPacketReader {
+ public:
+  // Returns nullptr if io_uring is not supported, in which case the caller
+  // should use a QuicPacketReader instead.
+  static std::unique_ptr<QuicIoUringPacketReader> Create();
+
+  ~QuicIoUringPacketReader() override;
+
+  bool ReadAndDispatchPackets(int fd,
+                              int port,
+                              const QuicClock& clock,
+                              ProcessPacketInterface* processor,
+                              QuicPacketCount* packets_dropped) override;
+
+  int ring_fd() const { return ring_->ring_fd(); }
+
+  // True if the reader permanently fell back to recvmmsg.
+  bool fell_back_to_recvmmsg() const { return fall_back_to_recvmmsg_; }
+
+ private:
+  explicit QuicIoUringPacketReader(std::unique_ptr<QuicIoUring> ring);
+
+  // Arms a multishot recvmsg on |fd|, cancelling the one on the previously
+  // armed fd, if any. Returns false if the submission queue is full.
+  bool ArmMultishotRecv(int fd);
+
+  // Dispatches the datagram in the provided buffer of |cqe|.
+  void DispatchCompletion(const io_uring_cqe& cqe,
+                          int port,
+                          QuicTime now,
+                          ProcessPacketInterface* processor,
+                          QuicPacketCount* packets_dropped);
+
+  std::unique_ptr<QuicIoUring> ring_;
+  QuicUdpSocketApi socket_api_;
+  // The fd with an armed multishot recvmsg, or -1.
+  int armed_fd_;
+  // Whether the multishot request on |armed_fd_| terminated and must be
+  // re-armed, e.g. because provided buffers ran out.
+  bool needs_rearm_;
+  bool fall_back_to_recvmmsg_;
+  // Template used by the kernel to lay out each provided buffer. It must stay
+  // valid while the multishot request is armed.
+  msghdr recv_msg_template_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_IO_URING_PACKET_READER_H_
@@ -0,0 +1,282 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_io_uring_packet_reader.h"
+
+#include <sys/socket.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/batch_writer/quic_sendmmsg_batch_writer.h"
+#include "quic/core/quic_process_packet_interface.h"
+#include "quic/core/quic_udp_socket.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/mock_clock.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const size_t kTestPacketSize = 1200;
+
+class CountingPacketProcessor : public ProcessPacketInterface {
+ public:
+  void ProcessPacket(const QuicSocketAddress& self_address,
+                     const QuicSocketAddress& peer_address,
+                     const QuicReceivedPacket& packet) override {
+    last_self_address_ = self_address;
+    last_peer_address_ = peer_address;
+    first_bytes_.push_back(packet.length() > 0 ? packet.data()[0] : '\0');
+    ++num_packets_;
+    num_bytes_ += packet.length();
+  }
+
+  const std::vector<char>& first_bytes() const { return first_bytes_; }
+  const QuicSocketAddress& last_self_address() const {
+    return last_self_address_;
+  }
+  const QuicSocketAddress& last_peer_address() const {
+    return last_peer_address_;
+  }
+  size_t num_packets() const { return num_packets_; }
+  size_t num_bytes() const { return num_bytes_; }
+
+ private:
+  std::vector<char> first_bytes_;
+  QuicSocketAddress last_self_address_;
+  QuicSocketAddress last_peer_address_;
+  size_t num_packets_ = 0;
+  size_t num_bytes_ = 0;
+};
+
+class QuicIoUringPacketReaderTest : public QuicTest {
+ protected:
+  QuicIoUringPacketReaderTest() {
+    receiver_fd_ = CreateBoundSocket(&receiver_address_);
+    sender_fd_ = CreateBoundSocket(&sender_address_);
+  }
+
+  ~QuicIoUringPacketReaderTest() override {
+    socket_api_.Destroy(receiver_fd_);
+    socket_api_.Destroy(sender_fd_);
+  }
+
+  QuicUdpSocketFd CreateBoundSocket(QuicSocketAddress* address) {
+    QuicUdpSocketFd fd =
+        socket_api_.Create(AF_INET,
+                           /*receive_buffer_size=*/kDefaultSocketReceiveBuffer,
+                           /*send_buffer_size=*/kDefaultSocketReceiveBuffer);
+    EXPECT_NE(kQuicInvalidSocketFd, fd);
+    EXPECT_TRUE(socket_api_.Bind(
+        fd, QuicSocketAddress(QuicIpAddress::Loopback4(), 0)));
+    EXPECT_EQ(0, address->FromSocket(fd));
+    return fd;
+  }
+
+  // Sends |num_packets| packets to |destination| with sendmmsg. The first
+  // byte of the i-th packet is |first_content| + i.
+  void SendPackets(size_t num_packets,
+                   char first_content,
+                   const QuicSocketAddress& destination) {
+    QuicSendmmsgBatchWriter writer(std::make_unique<QuicBatchWriterBuffer>(),
+                                   sender_fd_);
+    std::string packet(kTestPacketSize, '\0');
+    for (size_t i = 0; i < num_packets; ++i) {
+      packet[0] = static_cast<char>(first_content + i);
+      WriteResult result =
+          writer.WritePacket(packet.data(), packet.size(),
+                             sender_address_.host(), destination, nullptr);
+      ASSERT_EQ(WRITE_STATUS_OK, result.status);
+    }
+    ASSERT_EQ(WRITE_STATUS_OK, writer.Flush().status);
+  }
+
+  // Reads from |fd| until |processor| has seen |expected_packets| packets and
+  // the reader has nothing left to read. Returns the number of reads.
+  size_t ReadUntil(QuicPacketReader* reader,
+                   int fd,
+                   int port,
+                   size_t expected_packets,
+                   CountingPacketProcessor* processor) {
+    const size_t kMaxReads = 10000;
+    size_t num_reads = 0;
+    bool more_to_read = true;
+    while (num_reads < kMaxReads &&
+           (more_to_read || processor->num_packets() < expected_packets)) {
+      more_to_read =
+          reader->ReadAndDispatchPackets(fd, port, clock_, processor, nullptr);
+      ++num_reads;
+    }
+    return num_reads;
+  }
+
+  QuicSocketAddress receiver_address_;
+  QuicSocketAddress sender_address_;
+  QuicUdpSocketFd receiver_fd_;
+  QuicUdpSocketFd sender_fd_;
+  QuicUdpSocketApi socket_api_;
+  MockClock clock_;
+};
+
+TEST_F(QuicIoUringPacketReaderTest, ReadPackets) {
+  std::unique_ptr<QuicIoUringPacketReader> reader =
+      QuicIoUringPacketReader::Create();
+  if (reader == nullptr) {
+    QUIC_LOG(WARNING) << "Test skipped since io_uring is not supported.";
+    return;
+  }
+  EXPECT_LE(0, reader->ring_fd());
+
+  // Packets queued before the first read are received once the multishot
+  // request is armed.
+  SendPackets(5, 'a', receiver_address_);
+  CountingPacketProcessor processor;
+  ReadUntil(reader.get(), receiver_fd_, receiver_address_.port(), 5,
+            &processor);
+
+  // Packets received while the request is armed.
+  SendPackets(5, 'f', receiver_address_);
+  ReadUntil(reader.get(), receiver_fd_, receiver_address_.port(), 10,
+            &processor);
+
+  EXPECT_FALSE(reader->fell_back_to_recvmmsg());
+  ASSERT_EQ(10u, processor.num_packets());
+  EXPECT_EQ(10 * kTestPacketSize, processor.num_bytes());
+  for (size_t i = 0; i < processor.first_bytes().size(); ++i) {
+    EXPECT_EQ(static_cast<char>('a' + i), processor.first_bytes()[i]);
+  }
+  EXPECT_EQ(receiver_address_, processor.last_self_address());
+  EXPECT_EQ(sender_address_, processor.last_peer_address());
+}
+
+TEST_F(QuicIoUringPacketReaderTest, RecycleBuffers) {
+  std::unique_ptr<QuicIoUringPacketReader> reader =
+      QuicIoUringPacketReader::Create();
+  if (reader == nullptr) {
+    QUIC_LOG(WARNING) << "Test skipped since io_uring is not supported.";
+    return;
+  }
+
+  // Receive many more packets than there are provided buffers.
+  CountingPacketProcessor processor;
+  const size_t kPacketsPerBurst = kNumIoUringReadBuffers / 4;
+  for (size_t i = 0; i < 20; ++i) {
+    SendPackets(kPacketsPerBurst, 0, receiver_address_);
+    ReadUntil(reader.get(), receiver_fd_, receiver_address_.port(),
+              (i + 1) * kPacketsPerBurst, &processor);
+  }
+  EXPECT_EQ(20 * kPacketsPerBurst, processor.num_packets());
+}
+
+TEST_F(QuicIoUringPacketReaderTest, SwitchSocket) {
+  std::unique_ptr<QuicIoUringPacketReader> reader =
+      QuicIoUringPacketReader::Create();
+  if (reader == nullptr) {
+    QUIC_LOG(WARNING) << "Test skipped since io_uring is not supported.";
+    return;
+  }
+
+  CountingPacketProcessor processor;
+  SendPackets(3, 'a', receiver_address_);
+  ReadUntil(reader.get(), receiver_fd_, receiver_address_.port(), 3,
+            &processor);
+  ASSERT_EQ(3u, processor.num_packets());
+
+  // Reading from a new socket moves the multishot request to it.
+  QuicSocketAddress new_receiver_address;
+  QuicUdpSocketFd new_receiver_fd = CreateBoundSocket(&new_receiver_address);
+  SendPackets(3, 'd', new_receiver_address);
+  ReadUntil(reader.get(), new_receiver_fd, new_receiver_address.port(), 6,
+            &processor);
+  ASSERT_EQ(6u, processor.num_packets());
+  EXPECT_EQ(new_receiver_address, processor.last_self_address());
+  EXPECT_EQ('f', processor.first_bytes().back());
+  socket_api_.Destroy(new_receiver_fd);
+}
+
+// Loopback throughput comparison between the recvmmsg and io_uring read paths.
+TEST_F(QuicIoUringPacketReaderTest, ReportDroppedPackets) {
+  std::unique_ptr<QuicIoUringPacketReader> reader =
+      QuicIoUringPacketReader::Create();
+  if (reader == nullptr) {
+    QUIC_LOG(WARNING) << "Test skipped since io_uring is not supported.";
+    return;
+  }
+  QuicUdpSocketFd fd =
+      socket_api_.Create(AF_INET, /*receive_buffer_size=*/kTestPacketSize,
+                         /*send_buffer_size=*/kDefaultSocketReceiveBuffer);
+  ASSERT_NE(kQuicInvalidSocketFd, fd);
+  ASSERT_TRUE(
+      socket_api_.Bind(fd, QuicSocketAddress(QuicIpAddress::Loopback4(), 0)));
+  QuicSocketAddress address;
+  ASSERT_EQ(0, address.FromSocket(fd));
+  if (!socket_api_.EnableDroppedPacketCount(fd)) {
+    QUIC_LOG(WARNING) << "Test skipped since SO_RXQ_OVFL is not supported.";
+    socket_api_.Destroy(fd);
+    return;
+  }
+
+  // Overflow the receive buffer and drain it. The kernel reports the drop
+  // count with the packets queued after the drops.
+  SendPackets(100, 'a', address);
+  size_t packets_drained = 0;
+  char buffer[kTestPacketSize];
+  while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+    ++packets_drained;
+  }
+  ASSERT_LT(packets_drained, 100u);
+
+  SendPackets(1, 'z', address);
+  CountingPacketProcessor processor;
+  QuicPacketCount packets_dropped = 0;
+  for (size_t i = 0; i < 10000 && processor.num_packets() == 0; ++i) {
+    reader->ReadAndDispatchPackets(fd, address.port(), clock_, &processor,
+                                   &packets_dropped);
+  }
+  ASSERT_EQ(1u, processor.num_packets());
+  EXPECT_EQ(100 - packets_drained, packets_dropped);
+  socket_api_.Destroy(fd);
+}
+
+TEST_F(QuicIoUringPacketReaderTest, DISABLED_LoopbackThroughput) {
+  std::unique_ptr<QuicIoUringPacketReader> io_uring_reader =
+      QuicIoUringPacketReader::Create();
+  if (io_uring_reader == nullptr) {
+    QUIC_LOG(WARNING) << "Test skipped since io_uring is not supported.";
+    return;
+  }
+  QuicPacketReader recvmmsg_reader;
+  const size_t kPacketsPerBurst = 32;
+  const size_t kNumBursts = 2000;
+
+  for (QuicPacketReader* reader :
+       {&recvmmsg_reader,
+        static_cast<QuicPacketReader*>(io_uring_reader.get())}) {
+    CountingPacketProcessor processor;
+    size_t num_reads = 0;
+    const absl::Time start = absl::Now();
+    for (size_t burst = 0; burst < kNumBursts; ++burst) {
+      SendPackets(kPacketsPerBurst, 0, receiver_address_);
+      num_reads += ReadUntil(reader, receiver_fd_, receiver_address_.port(),
+                             (burst + 1) * kPacketsPerBurst, &processor);
+    }
+    const absl::Duration elapsed = absl::Now() - start;
+
+    EXPECT_EQ(kPacketsPerBurst * kNumBursts, processor.num_packets());
+    QUIC_LOG(INFO) << (reader == &recvmmsg_reader ? "recvmmsg" : "io_uring")
+                   << ": received " << processor.num_packets() << " packets in "
+                   << num_reads << " reads, "
+                   << processor.num_bytes() * 8 /
+                          absl::ToDoubleMicroseconds(elapsed)
+                   << " Mbps including send time.";
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -663,7 +663,17 @@ void QuicPacketCreator::CreateAndSerializeStreamFrame(
     QUIC_BUG(quic_bug_10752_10) << ENDPOINT << "AppendTypeByte failed";
     return;
   }
-  if (!framer_->AppendStreamFrame(frame, omit_frame_length, &writer)) {
+  // Data which is left out of |writer| and encrypted from the send buffer.
+  absl::string_view trailing_data;
+  if (scatter_gather_stream_frame_data_ && omit_frame_length &&
+      length_field_offset == 0) {
+    QUIC_RESTART_FLAG_COUNT(quic_scatter_gather_stream_frame_data);
+    if (!framer_->AppendLastStreamFrame(frame, &writer, &trailing_data)) {
+      QUIC_BUG(quic_bug_append_last_stream_frame_failed)
+          << ENDPOINT << "AppendLastStreamFrame failed";
+      return;
+    }
+  } else if (!framer_->AppendStreamFrame(frame, omit_frame_length, &writer)) {
     QUIC_BUG(quic_bug_10752_11) << ENDPOINT << "AppendStreamFrame failed";
     return;
   }
@@ -685,10 +695,11 @@ void QuicPacketCreator::CreateAndSerializeStreamFrame(
   QUICHE_DCHECK(packet_.encryption_level == ENCRYPTION_FORWARD_SECURE ||
                 packet_.encryption_level == ENCRYPTION_ZERO_RTT)
       << ENDPOINT << packet_.encryption_level;
-  size_t encrypted_length = framer_->EncryptInPlace(
+  size_t encrypted_length = framer_->EncryptInPlaceWithTrailingData(
       packet_.encryption_level, packet_.packet_number,
       GetStartOfEncryptedData(framer_->transport_version(), header),
-      writer.length(), kMaxOutgoingPacketSize, encrypted_buffer);
+      writer.length(), trailing_data, kMaxOutgoingPacketSize,
+      encrypted_buffer);
   if (encrypted_length == 0) {
     QUIC_BUG(quic_bug_10752_13)
         << ENDPOINT << "Failed to encrypt packet number "
@@ -725,6 +725,11 @@ class QUIC_EXPORT_PRIVATE QuicPacketCreator {
   const bool close_connection_if_fail_to_serialzie_coalesced_packet_ =
       GetQuicReloadableFlag(
           quic_close_connection_if_fail_to_serialzie_coalesced_packet2);
+
+  // Whether CreateAndSerializeStreamFrame() encrypts stream data straight
+  // from the send buffer when it is contiguous there.
+  const bool scatter_gather_stream_frame_data_ =
+      GetQuicRestartFlag(quic_scatter_gather_stream_frame_data);
 };
 
 }  // namespace quic
@@ -1513,6 +1513,40 @@ TEST_P(QuicPacketCreatorTest, SerializeAndSendStreamFrame) {
   EXPECT_FALSE(creator_.HasPendingFrames());
 }
 
+TEST_P(QuicPacketCreatorTest, SerializeStreamFrameWithTrailingData) {
+  // Serializes the same stream frame with and without encrypting its data
+  // straight from the send buffer, using a new creator each time so that the
+  // restart flag is latched, and the packet numbers match.
+  const std::string data(2 * kDefaultMaxPacketSize, 'a');
+  producer_.SaveStreamData(GetNthClientInitiatedStreamId(0), data);
+  std::string encrypted_packets[2];
+  for (bool scatter_gather : {false, true}) {
+    SetQuicRestartFlag(quic_scatter_gather_stream_frame_data, scatter_gather);
+    QuicPacketCreator creator(connection_id_, &client_framer_, &delegate_,
+                              &producer_);
+    creator.SetEncrypter(
+        ENCRYPTION_FORWARD_SECURE,
+        std::make_unique<NullEncrypter>(Perspective::IS_CLIENT));
+    creator.set_encryption_level(ENCRYPTION_FORWARD_SECURE);
+    if (!GetParam().version_serialization) {
+      creator.StopSendingVersion();
+    }
+    EXPECT_CALL(delegate_, OnSerializedPacket(_))
+        .WillOnce(Invoke(this, &QuicPacketCreatorTest::SaveSerializedPacket));
+    size_t num_bytes_consumed;
+    creator.CreateAndSerializeStreamFrame(
+        GetNthClientInitiatedStreamId(0), data.length(), 0, 0, true,
+        NOT_RETRANSMISSION, &num_bytes_consumed);
+    EXPECT_LT(0u, num_bytes_consumed);
+    ASSERT_TRUE(serialized_packet_->encrypted_buffer);
+    encrypted_packets[scatter_gather] =
+        std::string(serialized_packet_->encrypted_buffer,
+                    serialized_packet_->encrypted_length);
+    DeleteSerializedPacket();
+  }
+  EXPECT_EQ(encrypted_packets[0], encrypted_packets[1]);
+}
+
 TEST_P(QuicPacketCreatorTest, SerializeStreamFrameWithPadding) {
   // Regression test to check that CreateAndSerializeStreamFrame uses a
   // correctly formatted stream frame header when appending padding.
@@ -4,7 +4,10 @@
 
 #include "quic/core/quic_packet_reader.h"
 
+#include <algorithm>
+
 #include "absl/base/macros.h"
+#include "common/simple_buffer_allocator.h"
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_process_packet_interface.h"
 #include "quic/platform/api/quic_bug_tracker.h"
@@ -17,18 +20,41 @@
 
 namespace quic {
 
-QuicPacketReader::QuicPacketReader()
-    : read_buffers_(kNumPacketsPerReadMmsgCall),
-      read_results_(kNumPacketsPerReadMmsgCall) {
-  QUICHE_DCHECK_EQ(read_buffers_.size(), read_results_.size());
+QuicPacketReader::QuicPacketReader() : QuicPacketReader(false) {}
+
+QuicPacketReader::QuicPacketReader(bool use_udp_gro)
+    : use_udp_gro_(use_udp_gro),
+      packet_buffer_size_(use_udp_gro ? sizeof(GroReadBuffer::packet_buffer)
+                                      : sizeof(ReadBuffer::packet_buffer)) {
+  if (use_udp_gro_) {
+    gro_read_buffers_.resize(kNumGroBuffersPerReadMmsgCall);
+    InitializeReadResults(&gro_read_buffers_);
+  } else {
+    read_buffers_.resize(kNumPacketsPerReadMmsgCall);
+    InitializeReadResults(&read_buffers_);
+    if (GetQuicRestartFlag(quic_pool_packet_reader_buffers)) {
+      QUIC_RESTART_FLAG_COUNT(quic_pool_packet_reader_buffers);
+      receive_buffer_pool_ = std::make_unique<QuicReceiveBufferPool>(
+          quiche::SimpleBufferAllocator::Get(), packet_buffer_size_);
+      receive_buffers_.resize(read_results_.size());
+      for (size_t i = 0; i < read_results_.size(); ++i) {
+        receive_buffers_[i] = receive_buffer_pool_->Acquire();
+        read_results_[i].packet_buffer.buffer = receive_buffers_[i].data();
+      }
+    }
+  }
+}
+
+template <typename BufferT>
+void QuicPacketReader::InitializeReadResults(std::vector<BufferT>* buffers) {
+  read_results_.resize(buffers->size());
   for (size_t i = 0; i < read_results_.size(); ++i) {
-    read_results_[i].packet_buffer.buffer = read_buffers_[i].packet_buffer;
-    read_results_[i].packet_buffer.buffer_len =
-        sizeof(read_buffers_[i].packet_buffer);
+    BufferT& buffer = (*buffers)[i];
+    read_results_[i].packet_buffer.buffer = buffer.packet_buffer;
+    read_results_[i].packet_buffer.buffer_len = sizeof(buffer.packet_buffer);
 
-    read_results_[i].control_buffer.buffer = read_buffers_[i].control_buffer;
-    read_results_[i].control_buffer.buffer_len =
-        sizeof(read_buffers_[i].control_buffer);
+    read_results_[i].control_buffer.buffer = buffer.control_buffer;
+    read_results_[i].control_buffer.buffer_len = sizeof(buffer.control_buffer);
   }
 }
 
@@ -39,26 +65,33 @@ bool QuicPacketReader::ReadAndDispatchPackets(
     int port,
     const QuicClock& clock,
     ProcessPacketInterface* processor,
-    QuicPacketCount* /*packets_dropped*/) {
+    QuicPacketCount* packets_dropped) {
   // Reset all read_results for reuse.
   for (size_t i = 0; i < read_results_.size(); ++i) {
-    read_results_[i].Reset(
-        /*packet_buffer_length=*/sizeof(read_buffers_[i].packet_buffer));
+    if (receive_buffer_pool_ != nullptr &&
+        !receive_buffers_[i].HasUniqueReference()) {
+      // A packet read into this buffer has been retained, so read into a new
+      // one.
+      receive_buffers_[i] = receive_buffer_pool_->Acquire();
+      read_results_[i].packet_buffer.buffer = receive_buffers_[i].data();
+    }
+    read_results_[i].Reset(/*packet_buffer_length=*/packet_buffer_size_);
   }
 
   // Use clock.Now() as the packet receipt time, the time between packet
   // arriving at the host and now is considered part of the network delay.
   QuicTime now = clock.Now();
 
+  BitMask64 packet_info_interested(
+      QuicUdpPacketInfoBit::DROPPED_PACKETS, QuicUdpPacketInfoBit::PEER_ADDRESS,
+      QuicUdpPacketInfoBit::V4_SELF_IP, QuicUdpPacketInfoBit::V6_SELF_IP,
+      QuicUdpPacketInfoBit::RECV_TIMESTAMP, QuicUdpPacketInfoBit::TTL,
+      QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER);
+  if (use_udp_gro_) {
+    packet_info_interested.Set(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE);
+  }
   size_t packets_read = socket_api_.ReadMultiplePackets(
-      fd,
-      BitMask64(QuicUdpPacketInfoBit::DROPPED_PACKETS,
-                QuicUdpPacketInfoBit::PEER_ADDRESS,
-                QuicUdpPacketInfoBit::V4_SELF_IP,
-                QuicUdpPacketInfoBit::V6_SELF_IP,
-                QuicUdpPacketInfoBit::RECV_TIMESTAMP, QuicUdpPacketInfoBit::TTL,
-                QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER),
-      &read_results_);
+      fd, packet_info_interested, &read_results_);
   for (size_t i = 0; i < packets_read; ++i) {
     auto& result = read_results_[i];
     if (!result.ok) {
@@ -71,6 +104,11 @@ bool QuicPacketReader::ReadAndDispatchPackets(
       continue;
     }
 
+    if (packets_dropped != nullptr &&
+        result.packet_info.HasValue(QuicUdpPacketInfoBit::DROPPED_PACKETS)) {
+      *packets_dropped = result.packet_info.dropped_packets();
+    }
+
     QuicSocketAddress peer_address =
         result.packet_info.peer_address().Normalized();
 
@@ -97,17 +135,44 @@ bool QuicPacketReader::ReadAndDispatchPackets(
       QUIC_CODE_COUNT(quic_packet_reader_no_google_packet_header);
     }
 
-    QuicReceivedPacket packet(
-        result.packet_buffer.buffer, result.packet_buffer.buffer_len, now,
-        /*owns_buffer=*/false, ttl, has_ttl, headers, headers_length,
-        /*owns_header_buffer=*/false);
-
     QuicSocketAddress self_address(self_ip, port);
-    processor->ProcessPacket(self_address, peer_address, packet);
+
+    // Without GRO, or if the kernel did not coalesce anything, the whole
+    // buffer is a single datagram.
+    size_t segment_size = result.packet_buffer.buffer_len;
+    if (result.packet_info.HasValue(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE) &&
+        result.packet_info.gro_segment_size() > 0) {
+      segment_size = std::min<size_t>(result.packet_info.gro_segment_size(),
+                                      result.packet_buffer.buffer_len);
+    }
+
+    // Each coalesced datagram is dispatched as its own packet, pointing into
+    // the super-buffer without copying.
+    for (size_t offset = 0; offset < result.packet_buffer.buffer_len;
+         offset += segment_size) {
+      const size_t packet_length =
+          std::min(segment_size, result.packet_buffer.buffer_len - offset);
+      if (receive_buffer_pool_ != nullptr) {
+        QuicReceivedPacket packet(
+            result.packet_buffer.buffer + offset, packet_length, now, ttl,
+            has_ttl, headers, headers_length, /*owns_header_buffer=*/false,
+            receive_buffers_[i]);
+        processor->ProcessPacket(self_address, peer_address, packet);
+        continue;
+      }
+      QuicReceivedPacket packet(
+          result.packet_buffer.buffer + offset, packet_length, now,
+          /*owns_buffer=*/false, ttl, has_ttl, headers, headers_length,
+          /*owns_header_buffer=*/false);
+      processor->ProcessPacket(self_address, peer_address, packet);
+    }
+    if (segment_size < result.packet_buffer.buffer_len) {
+      QUIC_CODE_COUNT(quic_packet_reader_gro_coalesced_packets);
+    }
   }
 
   // We may not have read all of the packets available on the socket.
-  return packets_read == kNumPacketsPerReadMmsgCall;
+  return packets_read == read_results_.size();
 }
 
 // static
@@ -11,6 +11,7 @@
 #include "quic/core/quic_clock.h"
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_process_packet_interface.h"
+#include "quic/core/quic_receive_buffer_pool.h"
 #include "quic/core/quic_udp_socket.h"
 #include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_socket_address.h"
@@ -20,9 +21,20 @@ namespace quic {
 // Read in larger batches to minimize recvmmsg overhead.
 const int kNumPacketsPerReadMmsgCall = 16;
 
+// Number of super-buffers read per recvmmsg call when UDP GRO is used. Each
+// super-buffer may hold up to kMaxGroPacketSize bytes of coalesced datagrams.
+const int kNumGroBuffersPerReadMmsgCall = 8;
+
 class QUIC_EXPORT_PRIVATE QuicPacketReader {
  public:
   QuicPacketReader();
+  // If |use_udp_gro| is true, the reader reads into super-buffers large enough
+  // to hold the output of UDP GRO and splits each of them into per-datagram
+  // QuicReceivedPackets that point into the super-buffer, without copying. The
+  // caller is responsible for enabling GRO on the socket with
+  // QuicUdpSocketApi::EnableUdpGro. Datagrams that are not coalesced by the
+  // kernel are dispatched as usual.
+  explicit QuicPacketReader(bool use_udp_gro);
   QuicPacketReader(const QuicPacketReader&) = delete;
   QuicPacketReader& operator=(const QuicPacketReader&) = delete;
 
@@ -41,6 +53,14 @@ class QUIC_EXPORT_PRIVATE QuicPacketReader {
                                       ProcessPacketInterface* processor,
                                       QuicPacketCount* packets_dropped);
 
+  bool use_udp_gro() const { return use_udp_gro_; }
+
+  // The pool packets are read into, or nullptr if packets are read into fixed
+  // buffers, which retained packets must copy.
+  const QuicReceiveBufferPool* receive_buffer_pool() const {
+    return receive_buffer_pool_.get();
+  }
+
  private:
   // Return the self ip from |packet_info|.
   // For dual stack sockets, |packet_info| may contain both a v4 and a v6 ip, in
@@ -57,8 +77,31 @@ class QUIC_EXPORT_PRIVATE QuicPacketReader {
     ABSL_CACHELINE_ALIGNED char packet_buffer[kMaxIncomingPacketSize];
   };
 
+  struct QUIC_EXPORT_PRIVATE GroReadBuffer {
+    ABSL_CACHELINE_ALIGNED char
+        control_buffer[kDefaultUdpPacketControlBufferSize];  // For ancillary
+                                                             // data.
+    ABSL_CACHELINE_ALIGNED char packet_buffer[kMaxGroPacketSize];
+  };
+
+  // Points |read_results_| at the control and packet buffers of |buffers|.
+  template <typename BufferT>
+  void InitializeReadResults(std::vector<BufferT>* buffers);
+
+  const bool use_udp_gro_;
+  // Size of each packet buffer in |read_results_|.
+  const size_t packet_buffer_size_;
   QuicUdpSocketApi socket_api_;
+  // Only one of |read_buffers_| and |gro_read_buffers_| is populated, depending
+  // on |use_udp_gro_|.
   std::vector<ReadBuffer> read_buffers_;
+  std::vector<GroReadBuffer> gro_read_buffers_;
+  // Only populated if quic_pool_packet_reader_buffers is true and GRO is not
+  // used, since retaining a GRO packet would hold on to a whole super-buffer.
+  // The packet buffers of |read_results_| then point into |receive_buffers_|
+  // instead of |read_buffers_|.
+  std::unique_ptr<QuicReceiveBufferPool> receive_buffer_pool_;
+  std::vector<QuicReceiveBufferReference> receive_buffers_;
   QuicUdpSocketApi::ReadPacketResults read_results_;
 };
 
@@ -0,0 +1,353 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_packet_reader.h"
+
+#include <sys/socket.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/batch_writer/quic_gso_batch_writer.h"
+#include "quic/core/quic_linux_socket_utils.h"
+#include "quic/core/quic_process_packet_interface.h"
+#include "quic/core/quic_udp_socket.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/mock_clock.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const size_t kTestPacketSize = 1200;
+
+// Records the payload of every dispatched packet.
+class RecordingPacketProcessor : public ProcessPacketInterface {
+ public:
+  void ProcessPacket(const QuicSocketAddress& /*self_address*/,
+                     const QuicSocketAddress& peer_address,
+                     const QuicReceivedPacket& packet) override {
+    peer_addresses_.push_back(peer_address);
+    if (record_payloads_) {
+      payloads_.push_back(std::string(packet.data(), packet.length()));
+    }
+    ++num_packets_;
+    num_bytes_ += packet.length();
+  }
+
+  void set_record_payloads(bool record_payloads) {
+    record_payloads_ = record_payloads;
+  }
+
+  const std::vector<std::string>& payloads() const { return payloads_; }
+  const std::vector<QuicSocketAddress>& peer_addresses() const {
+    return peer_addresses_;
+  }
+  size_t num_packets() const { return num_packets_; }
+  size_t num_bytes() const { return num_bytes_; }
+
+ private:
+  bool record_payloads_ = true;
+  std::vector<std::string> payloads_;
+  std::vector<QuicSocketAddress> peer_addresses_;
+  size_t num_packets_ = 0;
+  size_t num_bytes_ = 0;
+};
+
+// Retains a clone of every dispatched packet until |capacity| newer packets
+// have been retained, similar to the buffered packet store during a CHLO flood.
+class RetainingPacketProcessor : public ProcessPacketInterface {
+ public:
+  explicit RetainingPacketProcessor(size_t capacity) : capacity_(capacity) {}
+
+  void ProcessPacket(const QuicSocketAddress& /*self_address*/,
+                     const QuicSocketAddress& /*peer_address*/,
+                     const QuicReceivedPacket& packet) override {
+    if (retained_packets_.size() == capacity_) {
+      retained_packets_.pop_front();
+    }
+    retained_packets_.push_back(packet.Clone());
+    if (retained_packets_.back()->data() != packet.data()) {
+      ++num_copies_;
+    }
+    ++num_packets_;
+  }
+
+  size_t num_packets() const { return num_packets_; }
+  // Number of clones which allocated and copied the packet data.
+  size_t num_copies() const { return num_copies_; }
+
+ private:
+  const size_t capacity_;
+  std::deque<std::unique_ptr<QuicReceivedPacket>> retained_packets_;
+  size_t num_packets_ = 0;
+  size_t num_copies_ = 0;
+};
+
+class QuicPacketReaderTest : public QuicTest {
+ protected:
+  ~QuicPacketReaderTest() override { CloseSockets(); }
+
+  // Creates a receiver and a sender socket on IPv4 loopback, closing any
+  // previously created ones. Returns false if the sockets cannot be created, or
+  // if |enable_gro| is true and the kernel does not support UDP GRO or GSO.
+  bool CreateSockets(bool enable_gro) {
+    CloseSockets();
+    receiver_fd_ = CreateBoundSocket(&receiver_address_);
+    sender_fd_ = CreateBoundSocket(&sender_address_);
+    if (receiver_fd_ == kQuicInvalidSocketFd ||
+        sender_fd_ == kQuicInvalidSocketFd) {
+      return false;
+    }
+    if (!enable_gro) {
+      return true;
+    }
+    return QuicLinuxSocketUtils::GetUDPSegmentSize(sender_fd_) >= 0 &&
+           socket_api_.EnableUdpGro(receiver_fd_);
+  }
+
+  void CloseSockets() {
+    socket_api_.Destroy(receiver_fd_);
+    socket_api_.Destroy(sender_fd_);
+    receiver_fd_ = kQuicInvalidSocketFd;
+    sender_fd_ = kQuicInvalidSocketFd;
+  }
+
+  // Sends |num_packets| packets of |packet_size| bytes from the sender socket
+  // using GSO, so that the receiving kernel is able to coalesce them. The
+  // first byte of the i-th packet is |first_content| + i.
+  void SendPackets(size_t num_packets, size_t packet_size, char first_content) {
+    QuicGsoBatchWriter writer(sender_fd_);
+    std::string packet(packet_size, '\0');
+    for (size_t i = 0; i < num_packets; ++i) {
+      packet[0] = static_cast<char>(first_content + i);
+      WriteResult result = writer.WritePacket(
+          packet.data(), packet.size(), sender_address_.host(),
+          receiver_address_, nullptr);
+      ASSERT_EQ(WRITE_STATUS_OK, result.status);
+    }
+    ASSERT_EQ(WRITE_STATUS_OK, writer.Flush().status);
+  }
+
+  // Reads until the receiver socket is drained. Returns the number of calls
+  // to ReadAndDispatchPackets.
+  size_t ReadAll(QuicPacketReader* reader,
+                 RecordingPacketProcessor* processor) {
+    size_t num_reads = 0;
+    bool more_to_read = true;
+    while (more_to_read) {
+      more_to_read = reader->ReadAndDispatchPackets(
+          receiver_fd_, receiver_address_.port(), clock_, processor, nullptr);
+      ++num_reads;
+    }
+    return num_reads;
+  }
+
+  QuicSocketAddress receiver_address_;
+  QuicSocketAddress sender_address_;
+  QuicUdpSocketFd receiver_fd_ = kQuicInvalidSocketFd;
+  QuicUdpSocketFd sender_fd_ = kQuicInvalidSocketFd;
+  QuicUdpSocketApi socket_api_;
+  MockClock clock_;
+
+ private:
+  QuicUdpSocketFd CreateBoundSocket(QuicSocketAddress* address) {
+    QuicUdpSocketFd fd =
+        socket_api_.Create(AF_INET,
+                           /*receive_buffer_size=*/kDefaultSocketReceiveBuffer,
+                           /*send_buffer_size=*/kDefaultSocketReceiveBuffer);
+    if (fd == kQuicInvalidSocketFd) {
+      return kQuicInvalidSocketFd;
+    }
+    if (!socket_api_.Bind(fd, QuicSocketAddress(QuicIpAddress::Loopback4(),
+                                                0)) ||
+        address->FromSocket(fd) != 0) {
+      socket_api_.Destroy(fd);
+      return kQuicInvalidSocketFd;
+    }
+    return fd;
+  }
+};
+
+TEST_F(QuicPacketReaderTest, ReadWithoutGro) {
+  ASSERT_TRUE(CreateSockets(/*enable_gro=*/false));
+  QuicPacketReader reader;
+  EXPECT_FALSE(reader.use_udp_gro());
+
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(receiver_address_);
+  for (char i = 0; i < 5; ++i) {
+    std::string packet(kTestPacketSize, i);
+    WriteResult result = socket_api_.WritePacket(sender_fd_, packet.data(),
+                                                 packet.size(), packet_info);
+    ASSERT_EQ(WRITE_STATUS_OK, result.status);
+  }
+
+  RecordingPacketProcessor processor;
+  ReadAll(&reader, &processor);
+  ASSERT_EQ(5u, processor.payloads().size());
+  for (size_t i = 0; i < processor.payloads().size(); ++i) {
+    EXPECT_EQ(std::string(kTestPacketSize, static_cast<char>(i)),
+              processor.payloads()[i]);
+    EXPECT_EQ(sender_address_, processor.peer_addresses()[i]);
+  }
+}
+
+TEST_F(QuicPacketReaderTest, SplitGroSuperBuffer) {
+  if (!CreateSockets(/*enable_gro=*/true)) {
+    QUIC_LOG(WARNING) << "Test skipped since UDP GRO is not supported.";
+    return;
+  }
+  QuicPacketReader reader(/*use_udp_gro=*/true);
+  EXPECT_TRUE(reader.use_udp_gro());
+
+  // The last packet is shorter than the others, as allowed by GSO.
+  const size_t kNumPackets = 20;
+  SendPackets(kNumPackets - 1, kTestPacketSize, 'a');
+  SendPackets(1, kTestPacketSize / 2, 'a' + kNumPackets - 1);
+
+  RecordingPacketProcessor processor;
+  ReadAll(&reader, &processor);
+  ASSERT_EQ(kNumPackets, processor.payloads().size());
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    const std::string& payload = processor.payloads()[i];
+    EXPECT_EQ(i + 1 == kNumPackets ? kTestPacketSize / 2 : kTestPacketSize,
+              payload.size());
+    EXPECT_EQ(static_cast<char>('a' + i), payload[0]);
+    EXPECT_EQ(sender_address_, processor.peer_addresses()[i]);
+  }
+}
+
+TEST_F(QuicPacketReaderTest, RetainedPacketsShareReceiveBuffer) {
+  SetQuicRestartFlag(quic_pool_packet_reader_buffers, true);
+  ASSERT_TRUE(CreateSockets(/*enable_gro=*/false));
+  QuicPacketReader reader;
+  ASSERT_NE(nullptr, reader.receive_buffer_pool());
+
+  QuicUdpPacketInfo packet_info;
+  packet_info.SetPeerAddress(receiver_address_);
+  for (char i = 0; i < 5; ++i) {
+    std::string packet(kTestPacketSize, i);
+    WriteResult result = socket_api_.WritePacket(sender_fd_, packet.data(),
+                                                 packet.size(), packet_info);
+    ASSERT_EQ(WRITE_STATUS_OK, result.status);
+  }
+  RetainingPacketProcessor retaining_processor(/*capacity=*/5);
+  while (reader.ReadAndDispatchPackets(receiver_fd_, receiver_address_.port(),
+                                       clock_, &retaining_processor, nullptr)) {
+  }
+  EXPECT_EQ(5u, retaining_processor.num_packets());
+  EXPECT_EQ(0u, retaining_processor.num_copies());
+
+  // The next read must not overwrite the retained packets.
+  for (char i = 5; i < 10; ++i) {
+    std::string packet(kTestPacketSize, i);
+    WriteResult result = socket_api_.WritePacket(sender_fd_, packet.data(),
+                                                 packet.size(), packet_info);
+    ASSERT_EQ(WRITE_STATUS_OK, result.status);
+  }
+  RecordingPacketProcessor processor;
+  ReadAll(&reader, &processor);
+  ASSERT_EQ(5u, processor.payloads().size());
+  for (size_t i = 0; i < processor.payloads().size(); ++i) {
+    EXPECT_EQ(std::string(kTestPacketSize, static_cast<char>(5 + i)),
+              processor.payloads()[i]);
+  }
+  EXPECT_EQ(0u, retaining_processor.num_copies());
+}
+
+// Packet buffer allocations per packet when every packet of a CHLO flood is
+// retained for a while, as done by the buffered packet store, with and without
+// pooled receive buffers.
+TEST_F(QuicPacketReaderTest, DISABLED_ChloFloodAllocations) {
+  const size_t kPacketsPerBurst = 40;
+  const size_t kNumBursts = 250;
+  // Maximum number of connections in the buffered packet store.
+  const size_t kNumRetainedPackets = 100;
+
+  for (bool pool_buffers : {false, true}) {
+    SetQuicRestartFlag(quic_pool_packet_reader_buffers, pool_buffers);
+    ASSERT_TRUE(CreateSockets(/*enable_gro=*/false));
+    QuicPacketReader reader;
+    RetainingPacketProcessor processor(kNumRetainedPackets);
+
+    QuicUdpPacketInfo packet_info;
+    packet_info.SetPeerAddress(receiver_address_);
+    // Long header packets padded like client Initials.
+    std::string chlo(kTestPacketSize, '\0');
+    chlo[0] = static_cast<char>(0xc0);
+    for (size_t burst = 0; burst < kNumBursts; ++burst) {
+      for (size_t i = 0; i < kPacketsPerBurst; ++i) {
+        WriteResult result = socket_api_.WritePacket(sender_fd_, chlo.data(),
+                                                     chlo.size(), packet_info);
+        ASSERT_EQ(WRITE_STATUS_OK, result.status);
+      }
+      while (reader.ReadAndDispatchPackets(receiver_fd_,
+                                           receiver_address_.port(), clock_,
+                                           &processor, nullptr)) {
+      }
+    }
+
+    const size_t num_allocations =
+        pool_buffers ? reader.receive_buffer_pool()->num_allocations()
+                     : processor.num_copies();
+    EXPECT_EQ(kPacketsPerBurst * kNumBursts, processor.num_packets());
+    if (pool_buffers) {
+      EXPECT_EQ(0u, processor.num_copies());
+      // Retained packets and the reader's own buffers.
+      EXPECT_GE(kNumRetainedPackets + kNumPacketsPerReadMmsgCall + 1,
+                num_allocations);
+    } else {
+      EXPECT_EQ(processor.num_packets(), num_allocations);
+    }
+    QUIC_LOG(INFO) << (pool_buffers ? "Pooled" : "Fixed")
+                   << " receive buffers: " << num_allocations
+                   << " packet buffer allocations for "
+                   << processor.num_packets() << " packets, "
+                   << static_cast<double>(num_allocations) /
+                          processor.num_packets()
+                   << " per packet.";
+  }
+}
+
+// Loopback throughput comparison between the recvmmsg and the GRO read paths.
+TEST_F(QuicPacketReaderTest, DISABLED_LoopbackThroughput) {
+  const size_t kPacketsPerBurst = 40;
+  const size_t kNumBursts = 2000;
+
+  for (bool use_udp_gro : {false, true}) {
+    if (!CreateSockets(use_udp_gro)) {
+      QUIC_LOG(WARNING) << "Test skipped since GRO or GSO is not supported.";
+      return;
+    }
+    QuicPacketReader reader(use_udp_gro);
+    RecordingPacketProcessor processor;
+    processor.set_record_payloads(false);
+    size_t num_reads = 0;
+
+    const absl::Time start = absl::Now();
+    for (size_t burst = 0; burst < kNumBursts; ++burst) {
+      SendPackets(kPacketsPerBurst, kTestPacketSize, 0);
+      num_reads += ReadAll(&reader, &processor);
+    }
+    const absl::Duration elapsed = absl::Now() - start;
+
+    EXPECT_EQ(kPacketsPerBurst * kNumBursts, processor.num_packets());
+    QUIC_LOG(INFO) << (use_udp_gro ? "GRO" : "recvmmsg") << ": received "
+                   << processor.num_packets() << " packets ("
+                   << processor.num_bytes() << " bytes) in " << num_reads
+                   << " reads, "
+                   << processor.num_bytes() * 8 /
+                          absl::ToDoubleMicroseconds(elapsed)
+                   << " Mbps including send time.";
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -399,6 +399,32 @@ QuicReceivedPacket::QuicReceivedPacket(const char* buffer,
       headers_length_(headers_length),
       owns_header_buffer_(owns_header_buffer) {}
 
+QuicReceivedPacket::QuicReceivedPacket(
+    const char* buffer,
+    size_t length,
+    QuicTime receipt_time,
+    int ttl,
+    bool ttl_valid,
+    char* packet_headers,
+    size_t headers_length,
+    bool owns_header_buffer,
+    QuicReceiveBufferReference receive_buffer)
+    : QuicReceivedPacket(buffer,
+                         length,
+                         receipt_time,
+                         false /* owns_buffer */,
+                         ttl,
+                         ttl_valid,
+                         packet_headers,
+                         headers_length,
+                         owns_header_buffer) {
+  QUICHE_DCHECK(receive_buffer);
+  QUICHE_DCHECK(buffer >= receive_buffer.data() &&
+                buffer + length <=
+                    receive_buffer.data() + receive_buffer.size());
+  receive_buffer_ = std::move(receive_buffer);
+}
+
 QuicReceivedPacket::~QuicReceivedPacket() {
   if (owns_header_buffer_) {
     delete[] static_cast<char*>(packet_headers_);
@@ -406,6 +432,20 @@ QuicReceivedPacket::~QuicReceivedPacket() {
 }
 
 std::unique_ptr<QuicReceivedPacket> QuicReceivedPacket::Clone() const {
+  if (receive_buffer_) {
+    // Share the receive buffer rather than copying the data. Packet headers are
+    // not part of the receive buffer, so they are still copied.
+    char* headers_buffer = nullptr;
+    if (this->packet_headers()) {
+      headers_buffer = new char[this->headers_length()];
+      memcpy(headers_buffer, this->packet_headers(), this->headers_length());
+    }
+    return std::make_unique<QuicReceivedPacket>(
+        this->data(), this->length(), receipt_time(), ttl(), ttl() >= 0,
+        headers_buffer, this->headers_length(), headers_buffer != nullptr,
+        receive_buffer_);
+  }
+
   char* buffer = new char[this->length()];
   memcpy(buffer, this->data(), this->length());
   if (this->packet_headers()) {
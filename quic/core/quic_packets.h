@@ -18,6 +18,7 @@
 #include "quic/core/quic_bandwidth.h"
 #include "quic/core/quic_constants.h"
 #include "quic/core/quic_error_codes.h"
+#include "quic/core/quic_receive_buffer_pool.h"
 #include "quic/core/quic_time.h"
 #include "quic/core/quic_types.h"
 #include "quic/core/quic_versions.h"
@@ -316,11 +317,25 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacket : public QuicEncryptedPacket {
                      char* packet_headers,
                      size_t headers_length,
                      bool owns_header_buffer);
+  // Creates a packet which points into |receive_buffer| rather than owning its
+  // data. The packet holds a reference to |receive_buffer|, so that it stays
+  // valid for as long as the packet, and shares it with its clones.
+  QuicReceivedPacket(const char* buffer,
+                     size_t length,
+                     QuicTime receipt_time,
+                     int ttl,
+                     bool ttl_valid,
+                     char* packet_headers,
+                     size_t headers_length,
+                     bool owns_header_buffer,
+                     QuicReceiveBufferReference receive_buffer);
   ~QuicReceivedPacket();
   QuicReceivedPacket(const QuicReceivedPacket&) = delete;
   QuicReceivedPacket& operator=(const QuicReceivedPacket&) = delete;
 
-  // Clones the packet into a new packet which owns the buffer.
+  // Clones the packet into a new packet which owns the buffer. If the packet
+  // points into a receive buffer, the clone shares the receive buffer instead
+  // of copying the data.
   std::unique_ptr<QuicReceivedPacket> Clone() const;
 
   // Returns the time at which the packet was received.
@@ -335,6 +350,12 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacket : public QuicEncryptedPacket {
   // Length of packet headers.
   int headers_length() const { return headers_length_; }
 
+  // The pooled buffer the packet data points into, which is empty if the packet
+  // is not in a pooled buffer.
+  const QuicReceiveBufferReference& receive_buffer() const {
+    return receive_buffer_;
+  }
+
   // By default, gtest prints the raw bytes of an object. The bool data
   // member (in the base class QuicData) causes this object to have padding
   // bytes, which causes the default gtest object printer to read
@@ -352,6 +373,8 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacket : public QuicEncryptedPacket {
   int headers_length_;
   // Whether owns the buffer for packet headers.
   bool owns_header_buffer_;
+  // The pooled buffer the packet data points into, if any.
+  QuicReceiveBufferReference receive_buffer_;
 };
 
 // SerializedPacket contains information of a serialized(encrypted) packet.
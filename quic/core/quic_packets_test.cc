@@ -107,6 +107,41 @@ TEST_F(QuicPacketsTest, CopySerializedPacket) {
   EXPECT_EQ(1000u, copy2->encrypted_length);
 }
 
+TEST_F(QuicPacketsTest, CloneReceivedPacket) {
+  char data[] = "packet data";
+  QuicReceivedPacket packet(data, sizeof(data), QuicTime::Zero());
+  std::unique_ptr<QuicReceivedPacket> copy = packet.Clone();
+  EXPECT_NE(packet.data(), copy->data());
+  EXPECT_EQ(packet.AsStringPiece(), copy->AsStringPiece());
+}
+
+TEST_F(QuicPacketsTest, CloneReceivedPacketSharesReceiveBuffer) {
+  QuicReceiveBufferPool pool(quiche::SimpleBufferAllocator::Get(),
+                             kMaxIncomingPacketSize);
+  QuicReceiveBufferReference receive_buffer = pool.Acquire();
+  memset(receive_buffer.data(), 'a', 100);
+  char headers[] = "headers";
+  std::unique_ptr<QuicReceivedPacket> copy;
+  {
+    QuicReceivedPacket packet(receive_buffer.data() + 10, 90, QuicTime::Zero(),
+                              /*ttl=*/5, /*ttl_valid=*/true, headers,
+                              sizeof(headers), /*owns_header_buffer=*/false,
+                              receive_buffer);
+    copy = packet.Clone();
+    EXPECT_EQ(packet.data(), copy->data());
+    EXPECT_EQ(90u, copy->length());
+    EXPECT_EQ(5, copy->ttl());
+    EXPECT_NE(headers, copy->packet_headers());
+    EXPECT_EQ(std::string(headers, sizeof(headers)),
+              std::string(copy->packet_headers(), copy->headers_length()));
+  }
+  // The copy keeps the buffer alive after the original packet is gone.
+  EXPECT_FALSE(receive_buffer.HasUniqueReference());
+  EXPECT_EQ(std::string(90, 'a'), copy->AsStringPiece());
+  copy.reset();
+  EXPECT_TRUE(receive_buffer.HasUniqueReference());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
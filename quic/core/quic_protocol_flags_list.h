@@ -67,6 +67,44 @@ QUIC_PROTOCOL_FLAG(
     uint64_t, quic_recent_stateless_reset_addresses_lifetime_ms, 1000,
     "Max time that a client address lives in recent reset addresses set.")
 
+// Only used if quic_restart_flag_quic_rate_limit_time_wait_list_packets is
+// true. The time-wait list sends at most this many packets to an IP address per
+// FLAGS_quic_time_wait_list_rate_limit_interval_ms, so that spoofed packets
+// cannot make it flood a victim.
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_time_wait_list_max_packets_per_source, 16,
+    "Max number of packets the time-wait list sends to an IP address per "
+    "rate limiting interval.")
+
+// Bounds the memory used to rate limit the time-wait list per IP address. Once
+// this many addresses are tracked, the address tracked for the longest is
+// forgotten to make room for a new one, so that a flood from spoofed addresses
+// cannot stop the time-wait list from answering other peers.
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_time_wait_list_max_rate_limited_sources, 4096,
+    "Max number of IP addresses the time-wait list tracks the packets it sends "
+    "to.")
+
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_time_wait_list_rate_limit_interval_ms, 1000,
+    "Interval over which the time-wait list rate limits packets per IP "
+    "address.")
+
+// Only used if quic_restart_flag_quic_bounded_buffered_packet_store is true.
+// The default fits a full CHLO flight and the undecryptable packets following
+// it for about 100 connections.
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_buffered_packet_store_max_bytes, 2 * 1024 * 1024,
+    "Max bytes charged to the packets buffered in QuicBufferedPacketStore: "
+    "a whole buffer for packets copied into its buffer pool, and their length "
+    "otherwise.")
+
+// Only used if quic_restart_flag_quic_offload_handshake_signatures is true.
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_handshake_signature_threads, 2,
+    "Number of worker threads QuicServer computes TLS handshake signatures "
+    "on.")
+
 QUIC_PROTOCOL_FLAG(double,
                    quic_bbr_cwnd_gain,
                    2.0f,
@@ -116,6 +154,22 @@ QUIC_PROTOCOL_FLAG(
     0.125f,  // One-eighth smoothed RTT
     "Smoothed RTT fraction that a connection can pace packets into the future.")
 
+// Only used if quic_restart_flag_quic_gso_batch_paced_packets is true. Paced
+// packets are released up to this early or late so that they share a GSO
+// batch, and thus a sendmsg, with other packets.
+QUIC_PROTOCOL_FLAG(
+    uint64_t, quic_gso_max_release_time_spread_us, 250,
+    "Max difference between the ideal release time of a paced packet and the "
+    "release time of the GSO batch it is added to, in microseconds.")
+
+// Only used if quic_restart_flag_quic_epoll_alarm_timing_wheel is true.
+// Alarms whose deadlines are within the same tick of the timing wheel may fire
+// in any order, but never before their deadlines.
+QUIC_PROTOCOL_FLAG(
+    int64_t, quic_epoll_alarm_timing_wheel_granularity_us, 1,
+    "Tick of the timing wheel QuicEpollAlarmFactory keeps its alarms in, in "
+    "microseconds.")
+
 QUIC_PROTOCOL_FLAG(bool,
                    quic_export_write_path_stats_at_server,
                    false,
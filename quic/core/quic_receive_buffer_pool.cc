@@ -0,0 +1,211 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_receive_buffer_pool.h"
+
+#include <atomic>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "quic/platform/api/quic_mutex.h"
+
+namespace quic {
+
+// The pool state shared by the pool and its buffers.
+struct QuicReceiveBufferPool::Core {
+  explicit Core(quiche::QuicheBufferAllocator* allocator)
+      : allocator(allocator) {}
+
+  quiche::QuicheBufferAllocator* const allocator;
+
+  mutable QuicMutex mutex;
+  // Set when the pool is destroyed, after which released buffers are deleted.
+  bool pool_destroyed QUIC_GUARDED_BY(mutex) = false;
+  std::vector<QuicReceiveBufferReference::Buffer*> free_buffers
+      QUIC_GUARDED_BY(mutex);
+  size_t num_allocations QUIC_GUARDED_BY(mutex) = 0;
+  size_t num_buffers QUIC_GUARDED_BY(mutex) = 0;
+  size_t max_free_buffers QUIC_GUARDED_BY(mutex) =
+      std::numeric_limits<size_t>::max();
+};
+
+// Header of a pooled buffer. The data follows in the same allocation, padded to
+// a multiple of the cache line size.
+struct QuicReceiveBufferReference::Buffer {
+  Buffer(std::shared_ptr<QuicReceiveBufferPool::Core> core, size_t size)
+      : core(std::move(core)), size(size) {}
+
+  // Offset of the data from the start of the allocation.
+  static constexpr size_t DataOffset() {
+    return (sizeof(Buffer) + ABSL_CACHELINE_SIZE - 1) / ABSL_CACHELINE_SIZE *
+           ABSL_CACHELINE_SIZE;
+  }
+
+  char* data() { return reinterpret_cast<char*>(this) + DataOffset(); }
+
+  std::atomic<int> ref_count{1};
+  std::shared_ptr<QuicReceiveBufferPool::Core> core;
+  const size_t size;
+};
+
+QuicReceiveBufferReference::QuicReceiveBufferReference(
+    const QuicReceiveBufferReference& other)
+    : buffer_(other.buffer_) {
+  if (buffer_ != nullptr) {
+    buffer_->ref_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+QuicReceiveBufferReference::QuicReceiveBufferReference(
+    QuicReceiveBufferReference&& other)
+    : buffer_(other.buffer_) {
+  other.buffer_ = nullptr;
+}
+
+QuicReceiveBufferReference& QuicReceiveBufferReference::operator=(
+    const QuicReceiveBufferReference& other) {
+  if (buffer_ != other.buffer_) {
+    Reset();
+    buffer_ = other.buffer_;
+    if (buffer_ != nullptr) {
+      buffer_->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return *this;
+}
+
+QuicReceiveBufferReference& QuicReceiveBufferReference::operator=(
+    QuicReceiveBufferReference&& other) {
+  if (this != &other) {
+    Reset();
+    buffer_ = other.buffer_;
+    other.buffer_ = nullptr;
+  }
+  return *this;
+}
+
+QuicReceiveBufferReference::~QuicReceiveBufferReference() {
+  Reset();
+}
+
+char* QuicReceiveBufferReference::data() const {
+  return buffer_ == nullptr ? nullptr : buffer_->data();
+}
+
+size_t QuicReceiveBufferReference::size() const {
+  return buffer_ == nullptr ? 0 : buffer_->size;
+}
+
+bool QuicReceiveBufferReference::HasUniqueReference() const {
+  return buffer_ != nullptr &&
+         buffer_->ref_count.load(std::memory_order_acquire) == 1;
+}
+
+void QuicReceiveBufferReference::Reset() {
+  if (buffer_ == nullptr) {
+    return;
+  }
+  if (buffer_->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    QuicReceiveBufferPool::Release(buffer_);
+  }
+  buffer_ = nullptr;
+}
+
+QuicReceiveBufferPool::QuicReceiveBufferPool(
+    quiche::QuicheBufferAllocator* allocator,
+    size_t buffer_size)
+    : buffer_size_(buffer_size), core_(std::make_shared<Core>(allocator)) {}
+
+QuicReceiveBufferPool::~QuicReceiveBufferPool() {
+  std::vector<QuicReceiveBufferReference::Buffer*> free_buffers;
+  {
+    QuicWriterMutexLock lock(&core_->mutex);
+    core_->pool_destroyed = true;
+    free_buffers.swap(core_->free_buffers);
+  }
+  for (QuicReceiveBufferReference::Buffer* buffer : free_buffers) {
+    Delete(buffer);
+  }
+}
+
+QuicReceiveBufferReference QuicReceiveBufferPool::Acquire() {
+  {
+    QuicWriterMutexLock lock(&core_->mutex);
+    if (!core_->free_buffers.empty()) {
+      // Reuse the most recently released buffer, which is the most likely to
+      // still be cached.
+      QuicReceiveBufferReference::Buffer* buffer = core_->free_buffers.back();
+      core_->free_buffers.pop_back();
+      buffer->ref_count.store(1, std::memory_order_relaxed);
+      return QuicReceiveBufferReference(buffer);
+    }
+    ++core_->num_allocations;
+    ++core_->num_buffers;
+  }
+  char* memory = core_->allocator->New(
+      QuicReceiveBufferReference::Buffer::DataOffset() + buffer_size_);
+  return QuicReceiveBufferReference(
+      new (memory) QuicReceiveBufferReference::Buffer(core_, buffer_size_));
+}
+
+size_t QuicReceiveBufferPool::num_allocations() const {
+  QuicReaderMutexLock lock(&core_->mutex);
+  return core_->num_allocations;
+}
+
+size_t QuicReceiveBufferPool::num_buffers() const {
+  QuicReaderMutexLock lock(&core_->mutex);
+  return core_->num_buffers;
+}
+
+size_t QuicReceiveBufferPool::num_free_buffers() const {
+  QuicReaderMutexLock lock(&core_->mutex);
+  return core_->free_buffers.size();
+}
+
+void QuicReceiveBufferPool::SetMaxFreeBuffers(size_t max_free_buffers) {
+  std::vector<QuicReceiveBufferReference::Buffer*> excess_buffers;
+  {
+    QuicWriterMutexLock lock(&core_->mutex);
+    core_->max_free_buffers = max_free_buffers;
+    while (core_->free_buffers.size() > max_free_buffers) {
+      excess_buffers.push_back(core_->free_buffers.back());
+      core_->free_buffers.pop_back();
+    }
+  }
+  for (QuicReceiveBufferReference::Buffer* buffer : excess_buffers) {
+    Delete(buffer);
+  }
+}
+
+// static
+void QuicReceiveBufferPool::Release(
+    QuicReceiveBufferReference::Buffer* buffer) {
+  {
+    QuicWriterMutexLock lock(&buffer->core->mutex);
+    if (!buffer->core->pool_destroyed &&
+        buffer->core->free_buffers.size() < buffer->core->max_free_buffers) {
+      buffer->core->free_buffers.push_back(buffer);
+      return;
+    }
+  }
+  Delete(buffer);
+}
+
+// static
+void QuicReceiveBufferPool::Delete(
+    QuicReceiveBufferReference::Buffer* buffer) {
+  // The buffer may hold the last reference to the core, which must outlive the
+  // call to its allocator.
+  std::shared_ptr<Core> core = std::move(buffer->core);
+  buffer->~Buffer();
+  core->allocator->Delete(reinterpret_cast<char*>(buffer));
+  QuicWriterMutexLock lock(&core->mutex);
+  --core->num_buffers;
+}
+
+}  // namespace quic
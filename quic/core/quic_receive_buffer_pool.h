@@ -0,0 +1,113 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_RECEIVE_BUFFER_POOL_H_
+#define QUICHE_QUIC_CORE_QUIC_RECEIVE_BUFFER_POOL_H_
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "common/quiche_buffer_allocator.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// A counted reference to a buffer of a QuicReceiveBufferPool. Copying the
+// reference shares the buffer, which is returned to its pool once the last
+// reference to it is dropped. References may be copied and dropped on any
+// thread.
+class QUIC_EXPORT_PRIVATE QuicReceiveBufferReference {
+ public:
+  QuicReceiveBufferReference() = default;
+  QuicReceiveBufferReference(const QuicReceiveBufferReference& other);
+  QuicReceiveBufferReference(QuicReceiveBufferReference&& other);
+  QuicReceiveBufferReference& operator=(
+      const QuicReceiveBufferReference& other);
+  QuicReceiveBufferReference& operator=(QuicReceiveBufferReference&& other);
+  ~QuicReceiveBufferReference();
+
+  // Start of the buffer, which is writable by the holder of the only
+  // reference.
+  char* data() const;
+  // Size of the buffer.
+  size_t size() const;
+
+  // Whether this is the only reference to the buffer, in which case it can be
+  // overwritten without affecting anyone else.
+  bool HasUniqueReference() const;
+
+  explicit operator bool() const { return buffer_ != nullptr; }
+
+ private:
+  friend class QuicReceiveBufferPool;
+  struct Buffer;
+
+  // Adopts the reference held by the caller.
+  explicit QuicReceiveBufferReference(Buffer* buffer) : buffer_(buffer) {}
+
+  // Drops the reference to |buffer_|, if any.
+  void Reset();
+
+  Buffer* buffer_ = nullptr;
+};
+
+// A pool of fixed-size, reference counted buffers for received packets. Packets
+// read into pooled buffers can be retained by sharing the buffer rather than
+// copying it, see QuicReceivedPacket::Clone(). Released buffers are kept for
+// reuse, so a reader whose packets are retained for a while only allocates
+// until the number of buffers in flight stabilizes. The number of buffers kept
+// for reuse can be limited, so that a burst does not pin memory forever.
+//
+// Buffers may be released on any thread. The pool may be destroyed while some
+// of its buffers are still referenced, in which case they are deleted when they
+// are released.
+class QUIC_EXPORT_PRIVATE QuicReceiveBufferPool {
+ public:
+  // |allocator| must outlive all buffers of the pool.
+  QuicReceiveBufferPool(quiche::QuicheBufferAllocator* allocator,
+                        size_t buffer_size);
+  QuicReceiveBufferPool(const QuicReceiveBufferPool&) = delete;
+  QuicReceiveBufferPool& operator=(const QuicReceiveBufferPool&) = delete;
+  ~QuicReceiveBufferPool();
+
+  // Returns the only reference to a buffer of buffer_size() bytes, reusing a
+  // released buffer if there is one.
+  QuicReceiveBufferReference Acquire();
+
+  size_t buffer_size() const { return buffer_size_; }
+
+  // Number of buffers obtained from the allocator since the pool was created.
+  size_t num_allocations() const;
+
+  // Number of buffers which have been allocated and not deleted yet, whether
+  // they are in use or free.
+  size_t num_buffers() const;
+
+  // Number of released buffers available for reuse.
+  size_t num_free_buffers() const;
+
+  // Buffers released while |max_free_buffers| buffers are free are deleted
+  // rather than kept for reuse. Free buffers above the limit are deleted right
+  // away. Unlimited by default.
+  void SetMaxFreeBuffers(size_t max_free_buffers);
+
+ private:
+  friend class QuicReceiveBufferReference;
+  struct Core;
+
+  // Returns |buffer| to its pool, or deletes it if the pool is gone. Called
+  // when the last reference to |buffer| is dropped.
+  static void Release(QuicReceiveBufferReference::Buffer* buffer);
+  static void Delete(QuicReceiveBufferReference::Buffer* buffer);
+
+  const size_t buffer_size_;
+  // Shared with all buffers of the pool, so that they can be released after
+  // the pool is destroyed.
+  std::shared_ptr<Core> core_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_RECEIVE_BUFFER_POOL_H_
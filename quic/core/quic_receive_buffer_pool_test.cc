@@ -0,0 +1,172 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_receive_buffer_pool.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/simple_buffer_allocator.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/platform/api/quic_thread.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const size_t kBufferSize = 1500;
+
+// Counts buffers which have not been deleted yet.
+class CountingAllocator : public quiche::SimpleBufferAllocator {
+ public:
+  ~CountingAllocator() override { EXPECT_EQ(0, num_live_buffers_); }
+
+  char* New(size_t size) override {
+    ++num_live_buffers_;
+    return SimpleBufferAllocator::New(size);
+  }
+  void Delete(char* buffer) override {
+    --num_live_buffers_;
+    SimpleBufferAllocator::Delete(buffer);
+  }
+
+  int num_live_buffers() const { return num_live_buffers_; }
+
+ private:
+  std::atomic<int> num_live_buffers_{0};
+};
+
+class QuicReceiveBufferPoolTest : public QuicTest {
+ protected:
+  CountingAllocator allocator_;
+};
+
+TEST_F(QuicReceiveBufferPoolTest, ReleasedBuffersAreReused) {
+  QuicReceiveBufferPool pool(&allocator_, kBufferSize);
+  QuicReceiveBufferReference buffer1 = pool.Acquire();
+  QuicReceiveBufferReference buffer2 = pool.Acquire();
+  ASSERT_TRUE(buffer1);
+  EXPECT_EQ(kBufferSize, buffer1.size());
+  EXPECT_NE(buffer1.data(), buffer2.data());
+  EXPECT_EQ(2u, pool.num_allocations());
+
+  char* data = buffer1.data();
+  buffer1 = QuicReceiveBufferReference();
+  EXPECT_FALSE(buffer1);
+  EXPECT_EQ(1u, pool.num_free_buffers());
+  QuicReceiveBufferReference buffer3 = pool.Acquire();
+  EXPECT_EQ(data, buffer3.data());
+  EXPECT_TRUE(buffer3.HasUniqueReference());
+  EXPECT_EQ(2u, pool.num_allocations());
+  EXPECT_EQ(0u, pool.num_free_buffers());
+}
+
+TEST_F(QuicReceiveBufferPoolTest, SharedBufferReleasedWithLastReference) {
+  QuicReceiveBufferPool pool(&allocator_, kBufferSize);
+  QuicReceiveBufferReference buffer = pool.Acquire();
+  EXPECT_TRUE(buffer.HasUniqueReference());
+
+  QuicReceiveBufferReference copy = buffer;
+  EXPECT_EQ(buffer.data(), copy.data());
+  EXPECT_FALSE(buffer.HasUniqueReference());
+  QuicReceiveBufferReference moved = std::move(copy);
+  EXPECT_FALSE(copy);
+  EXPECT_FALSE(buffer.HasUniqueReference());
+
+  buffer = QuicReceiveBufferReference();
+  EXPECT_TRUE(moved.HasUniqueReference());
+  EXPECT_EQ(0u, pool.num_free_buffers());
+  moved = QuicReceiveBufferReference();
+  EXPECT_EQ(1u, pool.num_free_buffers());
+}
+
+TEST_F(QuicReceiveBufferPoolTest, BufferOutlivesPool) {
+  QuicReceiveBufferReference buffer;
+  {
+    QuicReceiveBufferPool pool(&allocator_, kBufferSize);
+    buffer = pool.Acquire();
+    // Released immediately.
+    pool.Acquire();
+    EXPECT_EQ(2, allocator_.num_live_buffers());
+  }
+  // Only the free buffer is deleted with the pool.
+  EXPECT_EQ(1, allocator_.num_live_buffers());
+  memset(buffer.data(), 0, buffer.size());
+  buffer = QuicReceiveBufferReference();
+  EXPECT_EQ(0, allocator_.num_live_buffers());
+}
+
+TEST_F(QuicReceiveBufferPoolTest, MaxFreeBuffers) {
+  QuicReceiveBufferPool pool(&allocator_, kBufferSize);
+  std::vector<QuicReceiveBufferReference> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.push_back(pool.Acquire());
+  }
+  buffers.pop_back();
+  buffers.pop_back();
+  EXPECT_EQ(4u, pool.num_buffers());
+  EXPECT_EQ(2u, pool.num_free_buffers());
+
+  // Lowering the limit deletes the free buffers above it.
+  pool.SetMaxFreeBuffers(1);
+  EXPECT_EQ(3u, pool.num_buffers());
+  EXPECT_EQ(1u, pool.num_free_buffers());
+  EXPECT_EQ(3, allocator_.num_live_buffers());
+
+  // Buffers released above the limit are deleted.
+  buffers.clear();
+  EXPECT_EQ(1u, pool.num_buffers());
+  EXPECT_EQ(1u, pool.num_free_buffers());
+  EXPECT_EQ(1, allocator_.num_live_buffers());
+  EXPECT_EQ(4u, pool.num_allocations());
+}
+
+// Drops references to the buffers it is given on its own thread.
+class ReleaseThread : public QuicThread {
+ public:
+  explicit ReleaseThread(std::vector<QuicReceiveBufferReference> buffers)
+      : QuicThread("ReleaseThread"), buffers_(std::move(buffers)) {}
+
+  void Run() override {
+    for (QuicReceiveBufferReference& buffer : buffers_) {
+      buffer = QuicReceiveBufferReference();
+    }
+  }
+
+ private:
+  std::vector<QuicReceiveBufferReference> buffers_;
+};
+
+TEST_F(QuicReceiveBufferPoolTest, ReleaseOnOtherThreads) {
+  const size_t kNumThreads = 4;
+  const size_t kBuffersPerThread = 1000;
+  QuicReceiveBufferPool pool(&allocator_, kBufferSize);
+  std::vector<std::unique_ptr<ReleaseThread>> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    std::vector<QuicReceiveBufferReference> buffers;
+    for (size_t j = 0; j < kBuffersPerThread; ++j) {
+      buffers.push_back(pool.Acquire());
+      // Half of the buffers have two references.
+      if (j % 2 == 0) {
+        buffers.push_back(buffers.back());
+      }
+    }
+    threads.push_back(std::make_unique<ReleaseThread>(std::move(buffers)));
+  }
+  for (auto& thread : threads) {
+    thread->Start();
+  }
+  for (auto& thread : threads) {
+    thread->Join();
+  }
+  EXPECT_EQ(kNumThreads * kBuffersPerThread, pool.num_free_buffers());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
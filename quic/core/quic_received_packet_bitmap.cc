@@ -0,0 +1,254 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_received_packet_bitmap.h"
+
+#include <algorithm>
+
+#include "absl/numeric/bits.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+QuicReceivedPacketBitmap::QuicReceivedPacketBitmap()
+    : words_{}, num_packets_(0) {}
+
+void QuicReceivedPacketBitmap::Add(QuicPacketNumber packet_number) {
+  if (!packet_number.IsInitialized()) {
+    return;
+  }
+  if (!window_start_.IsInitialized()) {
+    window_start_ = WordStart(packet_number);
+  }
+  if (packet_number < window_start_) {
+    if (intervals_.Contains(packet_number)) {
+      return;
+    }
+    intervals_.Add(packet_number, packet_number + 1);
+  } else {
+    if (packet_number >= window_end()) {
+      MoveWindowForward(packet_number);
+    }
+    const uint64_t bit = uint64_t{1}
+                         << (packet_number.ToUint64() % kBitsPerWord);
+    uint64_t& word = Word(packet_number);
+    if ((word & bit) != 0) {
+      return;
+    }
+    word |= bit;
+  }
+  ++num_packets_;
+  if (largest_written_.IsInitialized() && packet_number <= largest_written_) {
+    holes_filled_.push_back(packet_number);
+  }
+  if (!min_.IsInitialized() || packet_number < min_) {
+    min_ = packet_number;
+  }
+  max_.UpdateMax(packet_number);
+}
+
+bool QuicReceivedPacketBitmap::Contains(QuicPacketNumber packet_number) const {
+  if (Empty() || !packet_number.IsInitialized()) {
+    return false;
+  }
+  if (packet_number < window_start_) {
+    return intervals_.Contains(packet_number);
+  }
+  if (packet_number >= window_end()) {
+    return false;
+  }
+  return ((Word(packet_number) >> (packet_number.ToUint64() % kBitsPerWord)) &
+          1) != 0;
+}
+
+bool QuicReceivedPacketBitmap::RemoveUpTo(QuicPacketNumber higher) {
+  if (Empty() || !higher.IsInitialized() || higher <= min_) {
+    return false;
+  }
+  intervals_.TrimLessThan(higher);
+  holes_filled_.erase(
+      std::remove_if(holes_filled_.begin(), holes_filled_.end(),
+                     [higher](QuicPacketNumber packet_number) {
+                       return packet_number < higher;
+                     }),
+      holes_filled_.end());
+  for (QuicPacketNumber word_start = window_start_;
+       word_start < std::min(higher, window_end());
+       word_start += kBitsPerWord) {
+    if (word_start + kBitsPerWord <= higher) {
+      Word(word_start) = 0;
+    } else {
+      // Clear the bits below |higher|.
+      Word(word_start) &= ~uint64_t{0} << (higher - word_start);
+    }
+  }
+  RecomputeMinAndNumPackets();
+  return true;
+}
+
+QuicPacketNumber QuicReceivedPacketBitmap::Min() const {
+  QUICHE_DCHECK(!Empty());
+  return min_;
+}
+
+QuicPacketNumber QuicReceivedPacketBitmap::Max() const {
+  QUICHE_DCHECK(!Empty());
+  return max_;
+}
+
+bool QuicReceivedPacketBitmap::HasGaps() const {
+  return !Empty() && max_ - min_ + 1 != num_packets_;
+}
+
+QuicPacketCount QuicReceivedPacketBitmap::LastIntervalLength() const {
+  if (Empty()) {
+    return 0;
+  }
+  QuicPacketCount length = 0;
+  if (max_ >= window_start_) {
+    // Count the set bits below and including max_, a word at a time.
+    QuicPacketNumber word_start = WordStart(max_);
+    size_t num_bits = max_ - word_start + 1;
+    while (true) {
+      const uint64_t bits = Word(word_start) << (kBitsPerWord - num_bits);
+      const size_t ones = absl::countl_one(bits);
+      if (ones < num_bits) {
+        return length + ones;
+      }
+      length += num_bits;
+      if (word_start == window_start_) {
+        break;
+      }
+      word_start -= kBitsPerWord;
+      num_bits = kBitsPerWord;
+    }
+    // The interval continues below the window if the last interval of
+    // |intervals_| ends where the window starts.
+    if (intervals_.Empty() || intervals_.rbegin()->max() != window_start_) {
+      return length;
+    }
+  }
+  return length + intervals_.rbegin()->Length();
+}
+
+void QuicReceivedPacketBitmap::ToPacketNumberQueue(
+    PacketNumberQueue* packets) const {
+  *packets = PacketNumberQueue();
+  if (Empty()) {
+    return;
+  }
+  AddRangesFrom(min_, packets);
+}
+
+void QuicReceivedPacketBitmap::UpdatePacketNumberQueue(
+    PacketNumberQueue* packets) {
+  for (QuicPacketNumber packet_number : holes_filled_) {
+    packets->Add(packet_number);
+  }
+  holes_filled_.clear();
+  if (Empty() ||
+      (largest_written_.IsInitialized() && max_ <= largest_written_)) {
+    return;
+  }
+  AddRangesFrom(largest_written_.IsInitialized()
+                    ? std::max(min_, largest_written_ + 1)
+                    : min_,
+                packets);
+  largest_written_ = max_;
+}
+
+// static
+QuicPacketNumber QuicReceivedPacketBitmap::WordStart(
+    QuicPacketNumber packet_number) {
+  return QuicPacketNumber(packet_number.ToUint64() -
+                          packet_number.ToUint64() % kBitsPerWord);
+}
+
+uint64_t& QuicReceivedPacketBitmap::Word(QuicPacketNumber packet_number) {
+  QUICHE_DCHECK(packet_number >= window_start_ &&
+                packet_number < window_end());
+  return words_[(packet_number.ToUint64() / kBitsPerWord) % kNumWords];
+}
+
+uint64_t QuicReceivedPacketBitmap::Word(QuicPacketNumber packet_number) const {
+  QUICHE_DCHECK(packet_number >= window_start_ &&
+                packet_number < window_end());
+  return words_[(packet_number.ToUint64() / kBitsPerWord) % kNumWords];
+}
+
+void QuicReceivedPacketBitmap::MoveWindowForward(
+    QuicPacketNumber packet_number) {
+  QUICHE_DCHECK_GE(packet_number, window_end());
+  const QuicPacketNumber new_window_start =
+      WordStart(packet_number) - (kWindowSize - kBitsPerWord);
+  const QuicPacketNumber evict_end = std::min(new_window_start, window_end());
+  for (QuicPacketNumber word_start = window_start_; word_start < evict_end;
+       word_start += kBitsPerWord) {
+    uint64_t& word = Word(word_start);
+    uint64_t bits = word;
+    while (bits != 0) {
+      const size_t low = absl::countr_zero(bits);
+      const size_t high = low + absl::countr_one(bits >> low);
+      intervals_.AddOptimizedForAppend(word_start + low, word_start + high);
+      bits = high == kBitsPerWord ? 0 : bits & (~uint64_t{0} << high);
+    }
+    word = 0;
+  }
+  window_start_ = new_window_start;
+}
+
+void QuicReceivedPacketBitmap::AddRangesFrom(
+    QuicPacketNumber start,
+    PacketNumberQueue* packets) const {
+  for (auto it = intervals_.LowerBound(start); it != intervals_.end(); ++it) {
+    packets->AddRange(std::max(start, it->min()), it->max());
+  }
+  if (max_ < window_start_) {
+    return;
+  }
+  start = std::max(start, window_start_);
+  for (QuicPacketNumber word_start = WordStart(start); word_start <= max_;
+       word_start += kBitsPerWord) {
+    uint64_t bits = Word(word_start);
+    if (start > word_start) {
+      // Skip the bits below |start| in its word.
+      bits &= ~uint64_t{0} << (start - word_start);
+    }
+    while (bits != 0) {
+      // Find the next run of set bits [low, high).
+      const size_t low = absl::countr_zero(bits);
+      const size_t high = low + absl::countr_one(bits >> low);
+      // Adjacent ranges are merged by AddRange.
+      packets->AddRange(word_start + low, word_start + high);
+      bits = high == kBitsPerWord ? 0 : bits & (~uint64_t{0} << high);
+    }
+  }
+}
+
+void QuicReceivedPacketBitmap::RecomputeMinAndNumPackets() {
+  num_packets_ = 0;
+  min_.Clear();
+  for (const auto& interval : intervals_) {
+    num_packets_ += interval.Length();
+  }
+  if (!intervals_.Empty()) {
+    min_ = intervals_.begin()->min();
+  }
+  for (QuicPacketNumber word_start = window_start_; word_start < window_end();
+       word_start += kBitsPerWord) {
+    const uint64_t bits = Word(word_start);
+    if (bits == 0) {
+      continue;
+    }
+    num_packets_ += absl::popcount(bits);
+    if (!min_.IsInitialized()) {
+      min_ = word_start + absl::countr_zero(bits);
+    }
+  }
+  if (num_packets_ == 0) {
+    max_.Clear();
+  }
+}
+
+}  // namespace quic
@@ -0,0 +1,124 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_BITMAP_H_
+#define QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_BITMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "quic/core/frames/quic_ack_frame.h"
+#include "quic/core/quic_interval_set.h"
+#include "quic/core/quic_packet_number.h"
+#include "quic/core/quic_types.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// Tracks the set of received packet numbers. Packet numbers within a sliding
+// window below the largest received one are tracked as bits, so that
+// receiving packets out of order does not add, merge and split intervals.
+// Packet numbers which fall out of the window are moved to an interval set,
+// and packets received below the window are added to it directly. Intervals
+// are only built when the set is written into an ack frame.
+class QUIC_EXPORT_PRIVATE QuicReceivedPacketBitmap {
+ public:
+  // Number of packet numbers covered by the window.
+  static constexpr QuicPacketCount kWindowSize = 4096;
+
+  QuicReceivedPacketBitmap();
+  QuicReceivedPacketBitmap(const QuicReceivedPacketBitmap&) = delete;
+  QuicReceivedPacketBitmap& operator=(const QuicReceivedPacketBitmap&) =
+      delete;
+
+  // Adds |packet_number| to the set. The window moves forward if
+  // |packet_number| is above it.
+  void Add(QuicPacketNumber packet_number);
+
+  // Returns true if |packet_number| is in the set.
+  bool Contains(QuicPacketNumber packet_number) const;
+
+  // Removes packet numbers smaller than |higher|. Returns true if any packet
+  // number was removed.
+  bool RemoveUpTo(QuicPacketNumber higher);
+
+  bool Empty() const { return num_packets_ == 0; }
+
+  // Smallest and largest packet numbers in the set. Must not be called if the
+  // set is empty.
+  QuicPacketNumber Min() const;
+  QuicPacketNumber Max() const;
+
+  // Returns the number of packet numbers in the set.
+  QuicPacketCount NumPackets() const { return num_packets_; }
+
+  // Returns true if packet numbers are missing between Min() and Max(), ie
+  // the set has more than one interval.
+  bool HasGaps() const;
+
+  // Returns the length of the interval containing Max(), or 0 if the set is
+  // empty.
+  QuicPacketCount LastIntervalLength() const;
+
+  // Replaces the contents of |packets| with the packet numbers in the set.
+  void ToPacketNumberQueue(PacketNumberQueue* packets) const;
+
+  // Adds the packet numbers added since the last call to |packets|, which
+  // holds the packet numbers of the set as of that call: the runs above the
+  // largest packet number written then, and the packet numbers which filled
+  // holes below it. The caller must remove the packet numbers removed by
+  // RemoveUpTo() from |packets| as well.
+  void UpdatePacketNumberQueue(PacketNumberQueue* packets);
+
+ private:
+  static constexpr size_t kBitsPerWord = 64;
+  static constexpr size_t kNumWords = kWindowSize / kBitsPerWord;
+
+  // Returns the packet number of the first bit of the word containing
+  // |packet_number|.
+  static QuicPacketNumber WordStart(QuicPacketNumber packet_number);
+
+  // Returns the word containing |packet_number|, which must be in the window.
+  uint64_t& Word(QuicPacketNumber packet_number);
+  uint64_t Word(QuicPacketNumber packet_number) const;
+
+  QuicPacketNumber window_end() const { return window_start_ + kWindowSize; }
+
+  // Moves the window forward so that it ends right after the word containing
+  // |packet_number|, and moves the packet numbers which fall out of it to
+  // |intervals_|.
+  void MoveWindowForward(QuicPacketNumber packet_number);
+
+  // Recomputes |num_packets_| and |min_| after packet numbers are removed.
+  void RecomputeMinAndNumPackets();
+
+  // Adds the packet numbers in the set which are not smaller than |start| to
+  // |packets|.
+  void AddRangesFrom(QuicPacketNumber start, PacketNumberQueue* packets) const;
+
+  // Packet numbers below |window_start_|.
+  QuicIntervalSet<QuicPacketNumber> intervals_;
+  // First packet number covered by |words_|. A multiple of kBitsPerWord, or
+  // uninitialized until a packet number is added.
+  QuicPacketNumber window_start_;
+  // Ring of bits covering [window_start_, window_end()). Bit i of a word
+  // stands for WordStart() + i.
+  uint64_t words_[kNumWords];
+
+  QuicPacketCount num_packets_;
+  QuicPacketNumber min_;
+  QuicPacketNumber max_;
+
+  // Largest packet number written by UpdatePacketNumberQueue(), or
+  // uninitialized if it has not been called.
+  QuicPacketNumber largest_written_;
+  // Packet numbers added below |largest_written_| since
+  // UpdatePacketNumberQueue() was last called.
+  std::vector<QuicPacketNumber> holes_filled_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_BITMAP_H_
@@ -0,0 +1,173 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_received_packet_bitmap.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "quic/core/frames/quic_ack_frame.h"
+#include "quic/core/quic_packet_number.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicReceivedPacketBitmapTest : public QuicTest {
+ protected:
+  // Adds |packet_number| to both |bitmap_| and |expected_|.
+  void Add(uint64_t packet_number) {
+    bitmap_.Add(QuicPacketNumber(packet_number));
+    expected_.Add(QuicPacketNumber(packet_number));
+  }
+
+  // Removes packet numbers smaller than |higher| from |bitmap_|, |expected_|
+  // and |updated_|.
+  void RemoveUpTo(uint64_t higher) {
+    EXPECT_EQ(expected_.RemoveUpTo(QuicPacketNumber(higher)),
+              bitmap_.RemoveUpTo(QuicPacketNumber(higher)));
+    updated_.RemoveUpTo(QuicPacketNumber(higher));
+  }
+
+  // Verifies |bitmap_| contains the same packet numbers as |expected_|, both
+  // when written from scratch and when |updated_| is updated incrementally.
+  void VerifyPackets() {
+    PacketNumberQueue packets;
+    bitmap_.ToPacketNumberQueue(&packets);
+    ASSERT_EQ(expected_.NumIntervals(), packets.NumIntervals());
+    EXPECT_TRUE(
+        std::equal(expected_.begin(), expected_.end(), packets.begin()));
+    bitmap_.UpdatePacketNumberQueue(&updated_);
+    ASSERT_EQ(expected_.NumIntervals(), updated_.NumIntervals());
+    EXPECT_TRUE(
+        std::equal(expected_.begin(), expected_.end(), updated_.begin()));
+    ASSERT_EQ(expected_.Empty(), bitmap_.Empty());
+    if (expected_.Empty()) {
+      EXPECT_EQ(0u, bitmap_.LastIntervalLength());
+      return;
+    }
+    EXPECT_EQ(expected_.Min(), bitmap_.Min());
+    EXPECT_EQ(expected_.Max(), bitmap_.Max());
+    EXPECT_EQ(expected_.NumPacketsSlow(), bitmap_.NumPackets());
+    EXPECT_EQ(expected_.NumIntervals() > 1, bitmap_.HasGaps());
+    EXPECT_EQ(expected_.LastIntervalLength(), bitmap_.LastIntervalLength());
+  }
+
+  QuicReceivedPacketBitmap bitmap_;
+  PacketNumberQueue expected_;
+  // Updated by UpdatePacketNumberQueue() in VerifyPackets().
+  PacketNumberQueue updated_;
+};
+
+TEST_F(QuicReceivedPacketBitmapTest, Empty) {
+  EXPECT_TRUE(bitmap_.Empty());
+  EXPECT_FALSE(bitmap_.Contains(QuicPacketNumber(1)));
+  EXPECT_FALSE(bitmap_.HasGaps());
+  EXPECT_FALSE(bitmap_.RemoveUpTo(QuicPacketNumber(10)));
+  VerifyPackets();
+}
+
+TEST_F(QuicReceivedPacketBitmapTest, AddInOrder) {
+  for (uint64_t i = 1; i <= 3 * QuicReceivedPacketBitmap::kWindowSize; ++i) {
+    Add(i);
+  }
+  EXPECT_TRUE(bitmap_.Contains(QuicPacketNumber(1)));
+  EXPECT_FALSE(bitmap_.Contains(
+      QuicPacketNumber(3 * QuicReceivedPacketBitmap::kWindowSize + 1)));
+  VerifyPackets();
+}
+
+TEST_F(QuicReceivedPacketBitmapTest, AddWithGaps) {
+  Add(1);
+  Add(2);
+  Add(5);
+  Add(63);
+  Add(64);
+  Add(65);
+  VerifyPackets();
+  EXPECT_FALSE(bitmap_.Contains(QuicPacketNumber(3)));
+  EXPECT_TRUE(bitmap_.Contains(QuicPacketNumber(64)));
+  EXPECT_EQ(3u, bitmap_.LastIntervalLength());
+
+  // Fill the gaps.
+  Add(4);
+  Add(3);
+  VerifyPackets();
+  // Adding a packet number again has no effect.
+  Add(2);
+  EXPECT_EQ(8u, bitmap_.NumPackets());
+}
+
+TEST_F(QuicReceivedPacketBitmapTest, AddBelowWindow) {
+  Add(10 * QuicReceivedPacketBitmap::kWindowSize);
+  // Packets below the window are added to the intervals.
+  Add(100);
+  Add(101);
+  Add(99);
+  Add(2 * QuicReceivedPacketBitmap::kWindowSize);
+  VerifyPackets();
+  EXPECT_TRUE(bitmap_.Contains(QuicPacketNumber(100)));
+  EXPECT_FALSE(bitmap_.Contains(QuicPacketNumber(102)));
+}
+
+TEST_F(QuicReceivedPacketBitmapTest, LastIntervalSpansWindowStart) {
+  for (uint64_t i = 1; i <= QuicReceivedPacketBitmap::kWindowSize + 100; ++i) {
+    Add(i);
+  }
+  // The window starts in the middle of the last interval.
+  VerifyPackets();
+  EXPECT_EQ(QuicReceivedPacketBitmap::kWindowSize + 100,
+            bitmap_.LastIntervalLength());
+}
+
+TEST_F(QuicReceivedPacketBitmapTest, RemoveUpTo) {
+  Add(3);
+  Add(70);
+  Add(71);
+  Add(5 * QuicReceivedPacketBitmap::kWindowSize);
+  EXPECT_FALSE(bitmap_.RemoveUpTo(QuicPacketNumber(2)));
+  RemoveUpTo(71);
+  VerifyPackets();
+  RemoveUpTo(5 * QuicReceivedPacketBitmap::kWindowSize - 5);
+  VerifyPackets();
+  RemoveUpTo(5 * QuicReceivedPacketBitmap::kWindowSize + 1);
+  EXPECT_TRUE(bitmap_.Empty());
+  VerifyPackets();
+
+  // Packets can still be added afterwards.
+  Add(5 * QuicReceivedPacketBitmap::kWindowSize + 10);
+  VerifyPackets();
+}
+
+TEST_F(QuicReceivedPacketBitmapTest, RandomOrder) {
+  SimpleRandom random;
+  uint64_t largest = 0;
+  for (int i = 0; i < 20000; ++i) {
+    // Mostly increasing packet numbers with small gaps, and one in ten
+    // packets up to two windows behind the largest one.
+    uint64_t packet_number = largest + 1 + random.RandUint64() % 8;
+    if (largest > 0 && random.RandUint64() % 10 == 0) {
+      packet_number =
+          largest -
+          random.RandUint64() %
+              std::min(largest, 2 * QuicReceivedPacketBitmap::kWindowSize);
+    }
+    largest = std::max(largest, packet_number);
+    Add(packet_number);
+    if (i % 100 == 0) {
+      VerifyPackets();
+    }
+    if (i % 5000 == 4999) {
+      RemoveUpTo(largest > 3000 ? largest - 3000 : 1);
+      VerifyPackets();
+    }
+  }
+  VerifyPackets();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -34,7 +34,12 @@ QuicReceivedPacketManager::QuicReceivedPacketManager()
     : QuicReceivedPacketManager(nullptr) {}
 
 QuicReceivedPacketManager::QuicReceivedPacketManager(QuicConnectionStats* stats)
-    : ack_frame_updated_(false),
+    : use_received_packet_bitmap_(
+          GetQuicRestartFlag(quic_use_received_packet_bitmap)),
+      received_packets_(use_received_packet_bitmap_
+                            ? std::make_unique<QuicReceivedPacketBitmap>()
+                            : nullptr),
+      ack_frame_updated_(false),
       max_ack_ranges_(0),
       time_largest_observed_(QuicTime::Zero()),
       save_timestamps_(false),
@@ -101,7 +106,12 @@ void QuicReceivedPacketManager::RecordPacketReceived(
     ack_frame_.largest_acked = packet_number;
     time_largest_observed_ = receipt_time;
   }
-  ack_frame_.packets.Add(packet_number);
+  if (use_received_packet_bitmap_) {
+    QUIC_RESTART_FLAG_COUNT(quic_use_received_packet_bitmap);
+    received_packets_->Add(packet_number);
+  } else {
+    ack_frame_.packets.Add(packet_number);
+  }
 
   if (save_timestamps_) {
     // The timestamp format only handles packets in time order.
@@ -129,6 +139,11 @@ void QuicReceivedPacketManager::RecordPacketReceived(
 }
 
 bool QuicReceivedPacketManager::IsMissing(QuicPacketNumber packet_number) {
+  if (use_received_packet_bitmap_) {
+    return LargestAcked(ack_frame_).IsInitialized() &&
+           packet_number < LargestAcked(ack_frame_) &&
+           !received_packets_->Contains(packet_number);
+  }
   return LargestAcked(ack_frame_).IsInitialized() &&
          packet_number < LargestAcked(ack_frame_) &&
          !ack_frame_.packets.Contains(packet_number);
@@ -136,6 +151,12 @@ bool QuicReceivedPacketManager::IsMissing(QuicPacketNumber packet_number) {
 
 bool QuicReceivedPacketManager::IsAwaitingPacket(
     QuicPacketNumber packet_number) const {
+  if (use_received_packet_bitmap_) {
+    QUICHE_DCHECK(packet_number.IsInitialized());
+    return (!peer_least_packet_awaiting_ack_.IsInitialized() ||
+            packet_number >= peer_least_packet_awaiting_ack_) &&
+           !received_packets_->Contains(packet_number);
+  }
   return quic::IsAwaitingPacket(ack_frame_, packet_number,
                                 peer_least_packet_awaiting_ack_);
 }
@@ -151,10 +172,18 @@ const QuicFrame QuicReceivedPacketManager::GetUpdatedAckFrame(
                                     ? QuicTime::Delta::Zero()
                                     : approximate_now - time_largest_observed_;
   }
+  if (use_received_packet_bitmap_) {
+    // Add the packets received since the last ack frame to its intervals.
+    received_packets_->UpdatePacketNumberQueue(&ack_frame_.packets);
+  }
   while (max_ack_ranges_ > 0 &&
          ack_frame_.packets.NumIntervals() > max_ack_ranges_) {
     ack_frame_.packets.RemoveSmallestInterval();
   }
+  if (use_received_packet_bitmap_ && !ack_frame_.packets.Empty()) {
+    // Stop tracking the removed intervals.
+    received_packets_->RemoveUpTo(ack_frame_.packets.Min());
+  }
   // Clear all packet times if any are too far from largest observed.
   // It's expected this is extremely rare.
   for (auto it = ack_frame_.received_packet_times.begin();
@@ -188,15 +217,21 @@ void QuicReceivedPacketManager::DontWaitForPacketsBefore(
       least_unacked > peer_least_packet_awaiting_ack_) {
     peer_least_packet_awaiting_ack_ = least_unacked;
     bool packets_updated = ack_frame_.packets.RemoveUpTo(least_unacked);
+    if (use_received_packet_bitmap_) {
+      packets_updated = received_packets_->RemoveUpTo(least_unacked);
+    }
     if (packets_updated) {
       // Ack frame gets updated because packets set is updated because of stop
       // waiting frame.
       ack_frame_updated_ = true;
     }
   }
-  QUICHE_DCHECK(ack_frame_.packets.Empty() ||
+  QUICHE_DCHECK(use_received_packet_bitmap_ || ack_frame_.packets.Empty() ||
                 !peer_least_packet_awaiting_ack_.IsInitialized() ||
                 ack_frame_.packets.Min() >= peer_least_packet_awaiting_ack_);
+  QUICHE_DCHECK(!use_received_packet_bitmap_ || received_packets_->Empty() ||
+                !peer_least_packet_awaiting_ack_.IsInitialized() ||
+                received_packets_->Min() >= peer_least_packet_awaiting_ack_);
 }
 
 QuicTime::Delta QuicReceivedPacketManager::GetMaxAckDelay(
@@ -299,6 +334,16 @@ void QuicReceivedPacketManager::ResetAckStates() {
 }
 
 bool QuicReceivedPacketManager::HasMissingPackets() const {
+  if (use_received_packet_bitmap_) {
+    if (received_packets_->Empty()) {
+      return false;
+    }
+    if (received_packets_->HasGaps()) {
+      return true;
+    }
+    return peer_least_packet_awaiting_ack_.IsInitialized() &&
+           received_packets_->Min() > peer_least_packet_awaiting_ack_;
+  }
   if (ack_frame_.packets.Empty()) {
     return false;
   }
@@ -310,11 +355,16 @@ bool QuicReceivedPacketManager::HasMissingPackets() const {
 }
 
 bool QuicReceivedPacketManager::HasNewMissingPackets() const {
+  if (!HasMissingPackets()) {
+    return false;
+  }
+  const QuicPacketCount last_interval_length =
+      use_received_packet_bitmap_ ? received_packets_->LastIntervalLength()
+                                  : ack_frame_.packets.LastIntervalLength();
   if (one_immediate_ack_) {
-    return HasMissingPackets() && ack_frame_.packets.LastIntervalLength() == 1;
+    return last_interval_length == 1;
   }
-  return HasMissingPackets() &&
-         ack_frame_.packets.LastIntervalLength() <= kMaxPacketsAfterNewMissing;
+  return last_interval_length <= kMaxPacketsAfterNewMissing;
 }
 
 bool QuicReceivedPacketManager::ack_frame_updated() const {
@@ -335,6 +385,9 @@ QuicPacketNumber QuicReceivedPacketManager::PeerFirstSendingPacketNumber()
 }
 
 bool QuicReceivedPacketManager::IsAckFrameEmpty() const {
+  if (use_received_packet_bitmap_) {
+    return received_packets_->Empty();
+  }
   return ack_frame_.packets.Empty();
 }
 
@@ -6,10 +6,12 @@
 #define QUICHE_QUIC_CORE_QUIC_RECEIVED_PACKET_MANAGER_H_
 
 #include <cstddef>
+#include <memory>
 #include "quic/core/frames/quic_ack_frequency_frame.h"
 #include "quic/core/quic_config.h"
 #include "quic/core/quic_framer.h"
 #include "quic/core/quic_packets.h"
+#include "quic/core/quic_received_packet_bitmap.h"
 #include "quic/platform/api/quic_export.h"
 
 namespace quic {
@@ -150,9 +152,19 @@ class QUIC_EXPORT_PRIVATE QuicReceivedPacketManager {
   // hasn't received an ack.
   QuicPacketNumber peer_least_packet_awaiting_ack_;
 
-  // Received packet information used to produce acks.
+  // Received packet information used to produce acks. When
+  // |use_received_packet_bitmap_| is true, the received packets are tracked by
+  // |received_packets_|, and |ack_frame_.packets| holds the packets of the
+  // last ack frame built by GetUpdatedAckFrame, which adds the packets
+  // received since then to it.
   QuicAckFrame ack_frame_;
 
+  // Latched value of quic_restart_flag_quic_use_received_packet_bitmap.
+  const bool use_received_packet_bitmap_;
+  // Only created when |use_received_packet_bitmap_| is true, so that the
+  // managers of connections which do not use it stay small.
+  std::unique_ptr<QuicReceivedPacketBitmap> received_packets_;
+
   // True if |ack_frame_| has been updated since UpdateReceivedPacketInfo was
   // last called.
   bool ack_frame_updated_;
@@ -9,14 +9,18 @@
 #include <ostream>
 #include <vector>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "quic/core/congestion_control/rtt_stats.h"
 #include "quic/core/crypto/crypto_protocol.h"
 #include "quic/core/quic_connection_stats.h"
 #include "quic/core/quic_constants.h"
+#include "quic/core/quic_received_packet_bitmap.h"
 #include "quic/platform/api/quic_expect_bug.h"
 #include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/mock_clock.h"
+#include "quic/test_tools/quic_test_utils.h"
 
 namespace quic {
 namespace test {
@@ -41,9 +45,13 @@ const QuicTime::Delta kMinRttMs = QuicTime::Delta::FromMilliseconds(40);
 const QuicTime::Delta kDelayedAckTime =
     QuicTime::Delta::FromMilliseconds(kDefaultDelayedAckTimeMs);
 
-class QuicReceivedPacketManagerTest : public QuicTest {
+// The boolean parameter denotes whether received packets are tracked in a
+// QuicReceivedPacketBitmap.
+class QuicReceivedPacketManagerTest : public QuicTestWithParam<bool> {
  protected:
-  QuicReceivedPacketManagerTest() : received_manager_(&stats_) {
+  QuicReceivedPacketManagerTest()
+      : use_received_packet_bitmap_(SetUseReceivedPacketBitmap(GetParam())),
+        received_manager_(&stats_) {
     clock_.AdvanceTime(QuicTime::Delta::FromSeconds(1));
     rtt_stats_.UpdateRtt(kMinRttMs, QuicTime::Delta::Zero(), QuicTime::Zero());
     received_manager_.set_save_timestamps(true, false);
@@ -82,13 +90,25 @@ class QuicReceivedPacketManagerTest : public QuicTest {
     }
   }
 
+  // Sets the flag before |received_manager_| latches it.
+  static bool SetUseReceivedPacketBitmap(bool value) {
+    SetQuicRestartFlag(quic_use_received_packet_bitmap, value);
+    return value;
+  }
+
+  const bool use_received_packet_bitmap_;
   MockClock clock_;
   RttStats rtt_stats_;
   QuicConnectionStats stats_;
   QuicReceivedPacketManager received_manager_;
 };
 
-TEST_F(QuicReceivedPacketManagerTest, DontWaitForPacketsBefore) {
+INSTANTIATE_TEST_SUITE_P(UseReceivedPacketBitmap,
+                         QuicReceivedPacketManagerTest,
+                         ::testing::Bool(),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicReceivedPacketManagerTest, DontWaitForPacketsBefore) {
   QuicPacketHeader header;
   header.packet_number = QuicPacketNumber(2u);
   received_manager_.RecordPacketReceived(header, QuicTime::Zero());
@@ -101,7 +121,7 @@ TEST_F(QuicReceivedPacketManagerTest, DontWaitForPacketsBefore) {
   EXPECT_TRUE(received_manager_.IsAwaitingPacket(QuicPacketNumber(6u)));
 }
 
-TEST_F(QuicReceivedPacketManagerTest, GetUpdatedAckFrame) {
+TEST_P(QuicReceivedPacketManagerTest, GetUpdatedAckFrame) {
   QuicPacketHeader header;
   header.packet_number = QuicPacketNumber(2u);
   QuicTime two_ms = QuicTime::Zero() + QuicTime::Delta::FromMilliseconds(2);
@@ -143,7 +163,7 @@ TEST_F(QuicReceivedPacketManagerTest, GetUpdatedAckFrame) {
   EXPECT_EQ(2u, ack.ack_frame->received_packet_times.size());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, UpdateReceivedConnectionStats) {
+TEST_P(QuicReceivedPacketManagerTest, UpdateReceivedConnectionStats) {
   EXPECT_FALSE(received_manager_.ack_frame_updated());
   RecordPacketReceipt(1);
   EXPECT_TRUE(received_manager_.ack_frame_updated());
@@ -156,7 +176,7 @@ TEST_F(QuicReceivedPacketManagerTest, UpdateReceivedConnectionStats) {
   EXPECT_EQ(1u, stats_.packets_reordered);
 }
 
-TEST_F(QuicReceivedPacketManagerTest, LimitAckRanges) {
+TEST_P(QuicReceivedPacketManagerTest, LimitAckRanges) {
   received_manager_.set_max_ack_ranges(10);
   EXPECT_FALSE(received_manager_.ack_frame_updated());
   for (int i = 0; i < 100; ++i) {
@@ -178,7 +198,42 @@ TEST_F(QuicReceivedPacketManagerTest, LimitAckRanges) {
   }
 }
 
-TEST_F(QuicReceivedPacketManagerTest, IgnoreOutOfOrderTimestamps) {
+TEST_P(QuicReceivedPacketManagerTest, AckFrameBeyondBitmapWindow) {
+  // Receive every third packet, then fill in the gaps in reverse order, so
+  // that packets arrive both within and below the bitmap window.
+  const uint64_t kNumPackets = 3 * QuicReceivedPacketBitmap::kWindowSize;
+  PacketNumberQueue expected;
+  for (uint64_t i = 1; i <= kNumPackets; i += 3) {
+    RecordPacketReceipt(i);
+    expected.Add(QuicPacketNumber(i));
+  }
+  EXPECT_TRUE(received_manager_.HasMissingPackets());
+  EXPECT_TRUE(received_manager_.IsMissing(QuicPacketNumber(2)));
+  EXPECT_FALSE(received_manager_.IsMissing(QuicPacketNumber(4)));
+  for (uint64_t i = kNumPackets; i > 0; --i) {
+    if (i % 3 == 0) {
+      RecordPacketReceipt(i);
+      expected.Add(QuicPacketNumber(i));
+    }
+  }
+
+  QuicFrame ack = received_manager_.GetUpdatedAckFrame(QuicTime::Zero());
+  ASSERT_EQ(expected.NumIntervals(), ack.ack_frame->packets.NumIntervals());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(),
+                         ack.ack_frame->packets.begin()));
+  EXPECT_TRUE(received_manager_.HasMissingPackets());
+  EXPECT_FALSE(received_manager_.IsAwaitingPacket(QuicPacketNumber(3)));
+  EXPECT_TRUE(received_manager_.IsAwaitingPacket(QuicPacketNumber(2)));
+
+  received_manager_.DontWaitForPacketsBefore(QuicPacketNumber(kNumPackets));
+  EXPECT_FALSE(received_manager_.HasMissingPackets());
+  EXPECT_FALSE(received_manager_.IsAwaitingPacket(QuicPacketNumber(2)));
+  ack = received_manager_.GetUpdatedAckFrame(QuicTime::Zero());
+  EXPECT_EQ(1u, ack.ack_frame->packets.NumIntervals());
+  EXPECT_EQ(QuicPacketNumber(kNumPackets), ack.ack_frame->packets.Min());
+}
+
+TEST_P(QuicReceivedPacketManagerTest, IgnoreOutOfOrderTimestamps) {
   EXPECT_FALSE(received_manager_.ack_frame_updated());
   RecordPacketReceipt(1, QuicTime::Zero());
   EXPECT_TRUE(received_manager_.ack_frame_updated());
@@ -190,7 +245,7 @@ TEST_F(QuicReceivedPacketManagerTest, IgnoreOutOfOrderTimestamps) {
   EXPECT_EQ(2u, received_manager_.ack_frame().received_packet_times.size());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, IgnoreOutOfOrderPackets) {
+TEST_P(QuicReceivedPacketManagerTest, IgnoreOutOfOrderPackets) {
   received_manager_.set_save_timestamps(true, true);
   EXPECT_FALSE(received_manager_.ack_frame_updated());
   RecordPacketReceipt(1, QuicTime::Zero());
@@ -205,7 +260,7 @@ TEST_F(QuicReceivedPacketManagerTest, IgnoreOutOfOrderPackets) {
   EXPECT_EQ(2u, received_manager_.ack_frame().received_packet_times.size());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, HasMissingPackets) {
+TEST_P(QuicReceivedPacketManagerTest, HasMissingPackets) {
   EXPECT_QUIC_BUG(received_manager_.PeerFirstSendingPacketNumber(),
                   "No packets have been received yet");
   RecordPacketReceipt(4, QuicTime::Zero());
@@ -226,7 +281,7 @@ TEST_F(QuicReceivedPacketManagerTest, HasMissingPackets) {
   EXPECT_FALSE(received_manager_.HasMissingPackets());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, OutOfOrderReceiptCausesAckSent) {
+TEST_P(QuicReceivedPacketManagerTest, OutOfOrderReceiptCausesAckSent) {
   EXPECT_FALSE(HasPendingAck());
 
   RecordPacketReceipt(3, clock_.ApproximateNow());
@@ -259,7 +314,7 @@ TEST_F(QuicReceivedPacketManagerTest, OutOfOrderReceiptCausesAckSent) {
   CheckAckTimeout(clock_.ApproximateNow());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, OutOfOrderReceiptCausesAckSent1Ack) {
+TEST_P(QuicReceivedPacketManagerTest, OutOfOrderReceiptCausesAckSent1Ack) {
   QuicReceivedPacketManagerPeer::SetOneImmediateAck(&received_manager_, true);
   EXPECT_FALSE(HasPendingAck());
 
@@ -293,7 +348,7 @@ TEST_F(QuicReceivedPacketManagerTest, OutOfOrderReceiptCausesAckSent1Ack) {
   CheckAckTimeout(clock_.ApproximateNow() + kDelayedAckTime);
 }
 
-TEST_F(QuicReceivedPacketManagerTest, OutOfOrderAckReceiptCausesNoAck) {
+TEST_P(QuicReceivedPacketManagerTest, OutOfOrderAckReceiptCausesNoAck) {
   EXPECT_FALSE(HasPendingAck());
 
   RecordPacketReceipt(2, clock_.ApproximateNow());
@@ -305,7 +360,7 @@ TEST_F(QuicReceivedPacketManagerTest, OutOfOrderAckReceiptCausesNoAck) {
   EXPECT_FALSE(HasPendingAck());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, AckReceiptCausesAckSend) {
+TEST_P(QuicReceivedPacketManagerTest, AckReceiptCausesAckSend) {
   EXPECT_FALSE(HasPendingAck());
 
   RecordPacketReceipt(1, clock_.ApproximateNow());
@@ -332,7 +387,7 @@ TEST_F(QuicReceivedPacketManagerTest, AckReceiptCausesAckSend) {
   EXPECT_FALSE(HasPendingAck());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, AckSentEveryNthPacket) {
+TEST_P(QuicReceivedPacketManagerTest, AckSentEveryNthPacket) {
   EXPECT_FALSE(HasPendingAck());
   received_manager_.set_ack_frequency(3);
 
@@ -348,7 +403,7 @@ TEST_F(QuicReceivedPacketManagerTest, AckSentEveryNthPacket) {
   }
 }
 
-TEST_F(QuicReceivedPacketManagerTest, AckDecimationReducesAcks) {
+TEST_P(QuicReceivedPacketManagerTest, AckDecimationReducesAcks) {
   EXPECT_FALSE(HasPendingAck());
 
   // Start ack decimation from 10th packet.
@@ -381,7 +436,7 @@ TEST_F(QuicReceivedPacketManagerTest, AckDecimationReducesAcks) {
   CheckAckTimeout(clock_.ApproximateNow());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, SendDelayedAckDecimation) {
+TEST_P(QuicReceivedPacketManagerTest, SendDelayedAckDecimation) {
   EXPECT_FALSE(HasPendingAck());
   // The ack time should be based on min_rtt * 1/4, since it's less than the
   // default delayed ack time.
@@ -412,7 +467,7 @@ TEST_F(QuicReceivedPacketManagerTest, SendDelayedAckDecimation) {
   CheckAckTimeout(clock_.ApproximateNow());
 }
 
-TEST_F(QuicReceivedPacketManagerTest, SendDelayedAckDecimationMin1ms) {
+TEST_P(QuicReceivedPacketManagerTest, SendDelayedAckDecimationMin1ms) {
   EXPECT_FALSE(HasPendingAck());
   // Seed the min_rtt with a kAlarmGranularity signal.
   rtt_stats_.UpdateRtt(kAlarmGranularity, QuicTime::Delta::Zero(),
@@ -445,7 +500,7 @@ TEST_F(QuicReceivedPacketManagerTest, SendDelayedAckDecimationMin1ms) {
   CheckAckTimeout(clock_.ApproximateNow());
 }
 
-TEST_F(QuicReceivedPacketManagerTest,
+TEST_P(QuicReceivedPacketManagerTest,
        SendDelayedAckDecimationUnlimitedAggregation) {
   EXPECT_FALSE(HasPendingAck());
   QuicConfig config;
@@ -485,7 +540,7 @@ TEST_F(QuicReceivedPacketManagerTest,
   CheckAckTimeout(ack_time);
 }
 
-TEST_F(QuicReceivedPacketManagerTest, SendDelayedAckDecimationEighthRtt) {
+TEST_P(QuicReceivedPacketManagerTest, SendDelayedAckDecimationEighthRtt) {
   EXPECT_FALSE(HasPendingAck());
   QuicReceivedPacketManagerPeer::SetAckDecimationDelay(&received_manager_,
                                                        0.125);
@@ -519,7 +574,7 @@ TEST_F(QuicReceivedPacketManagerTest, SendDelayedAckDecimationEighthRtt) {
   CheckAckTimeout(clock_.ApproximateNow());
 }
 
-TEST_F(QuicReceivedPacketManagerTest,
+TEST_P(QuicReceivedPacketManagerTest,
        UpdateMaxAckDelayAndAckFrequencyFromAckFrequencyFrame) {
   EXPECT_FALSE(HasPendingAck());
 
@@ -539,7 +594,7 @@ TEST_F(QuicReceivedPacketManagerTest,
   }
 }
 
-TEST_F(QuicReceivedPacketManagerTest,
+TEST_P(QuicReceivedPacketManagerTest,
        DisableOutOfOrderAckByIgnoreOrderFromAckFrequencyFrame) {
   EXPECT_FALSE(HasPendingAck());
 
@@ -573,7 +628,7 @@ TEST_F(QuicReceivedPacketManagerTest,
   CheckAckTimeout(clock_.ApproximateNow() + kDelayedAckTime);
 }
 
-TEST_F(QuicReceivedPacketManagerTest,
+TEST_P(QuicReceivedPacketManagerTest,
        DisableMissingPaketsAckByIgnoreOrderFromAckFrequencyFrame) {
   EXPECT_FALSE(HasPendingAck());
   QuicConfig config;
@@ -612,7 +667,7 @@ TEST_F(QuicReceivedPacketManagerTest,
   CheckAckTimeout(clock_.ApproximateNow() + kDelayedAckTime);
 }
 
-TEST_F(QuicReceivedPacketManagerTest,
+TEST_P(QuicReceivedPacketManagerTest,
        AckDecimationDisabledWhenAckFrequencyFrameIsReceived) {
   EXPECT_FALSE(HasPendingAck());
 
@@ -638,7 +693,7 @@ TEST_F(QuicReceivedPacketManagerTest,
   }
 }
 
-TEST_F(QuicReceivedPacketManagerTest, UpdateAckTimeoutOnPacketReceiptTime) {
+TEST_P(QuicReceivedPacketManagerTest, UpdateAckTimeoutOnPacketReceiptTime) {
   EXPECT_FALSE(HasPendingAck());
 
   // Received packets 3 and 4.
@@ -664,7 +719,7 @@ TEST_F(QuicReceivedPacketManagerTest, UpdateAckTimeoutOnPacketReceiptTime) {
   CheckAckTimeout(clock_.ApproximateNow());
 }
 
-TEST_F(QuicReceivedPacketManagerTest,
+TEST_P(QuicReceivedPacketManagerTest,
        UpdateAckTimeoutOnPacketReceiptTimeLongerQueuingTime) {
   EXPECT_FALSE(HasPendingAck());
 
@@ -686,6 +741,62 @@ TEST_F(QuicReceivedPacketManagerTest,
   }
 }
 
+// Logs the cost of recording received packets and generating an ack every
+// other packet, with 0%, 1% and 10% of the packets reordered by up to 20
+// packets.
+TEST_P(QuicReceivedPacketManagerTest, DISABLED_AckGenerationCost) {
+  const uint64_t kNumPackets = 200000;
+  const uint64_t kMaxReorderingDistance = 20;
+  for (int reordering_percent : {0, 1, 10}) {
+    // Build the receive order: delayed packets are received after the packet
+    // |kMaxReorderingDistance| above them.
+    SimpleRandom random;
+    std::vector<uint64_t> receive_order;
+    receive_order.reserve(kNumPackets);
+    std::vector<std::vector<uint64_t>> delayed(kNumPackets + 1);
+    for (uint64_t i = 1; i <= kNumPackets; ++i) {
+      if (i + kMaxReorderingDistance <= kNumPackets &&
+          static_cast<int>(random.RandUint64() % 100) < reordering_percent) {
+        delayed[i + 1 + random.RandUint64() % kMaxReorderingDistance]
+            .push_back(i);
+      } else {
+        receive_order.push_back(i);
+      }
+      for (uint64_t packet_number : delayed[i]) {
+        receive_order.push_back(packet_number);
+      }
+    }
+
+    QuicConnectionStats stats;
+    QuicReceivedPacketManager manager(&stats);
+    manager.set_max_ack_ranges(255);
+    QuicPacketHeader header;
+    size_t num_intervals = 0;
+    const absl::Time start = absl::Now();
+    for (size_t i = 0; i < receive_order.size(); ++i) {
+      header.packet_number = QuicPacketNumber(receive_order[i]);
+      manager.RecordPacketReceived(header, QuicTime::Zero());
+      if (i % 2 == 1) {
+        QuicFrame ack = manager.GetUpdatedAckFrame(QuicTime::Zero());
+        num_intervals += ack.ack_frame->packets.NumIntervals();
+        manager.ResetAckStates();
+      }
+      if (i % 1000 == 999 && receive_order[i] > 2 * kMaxReorderingDistance) {
+        // The peer stops waiting for acked packets.
+        manager.DontWaitForPacketsBefore(
+            QuicPacketNumber(receive_order[i] - 2 * kMaxReorderingDistance));
+      }
+    }
+    const absl::Duration elapsed = absl::Now() - start;
+    QUIC_LOG(INFO) << (use_received_packet_bitmap_ ? "Bitmap" : "Intervals")
+                   << ", " << reordering_percent << "% reordering: "
+                   << elapsed / receive_order.size()
+                   << " per packet, average ack ranges "
+                   << static_cast<double>(num_intervals) /
+                          (receive_order.size() / 2);
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
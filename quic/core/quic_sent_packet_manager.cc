@@ -700,7 +700,7 @@ void QuicSentPacketManager::MarkForRetransmission(
                 transmission_type != PROBING_RETRANSMISSION);
   if (ShouldForceRetransmission(transmission_type)) {
     const bool retransmitted = unacked_packets_.RetransmitFrames(
-        QuicFrames(transmission_info->retransmittable_frames),
+        transmission_info->retransmittable_frames.frames(),
         transmission_type);
     if (GetQuicRestartFlag(quic_set_packet_state_if_all_data_retransmitted)) {
       QUIC_RESTART_FLAG_COUNT(quic_set_packet_state_if_all_data_retransmitted);
@@ -1645,6 +1645,10 @@ AckResult QuicSentPacketManager::OnAckFrameEnd(
   QuicByteCount prior_bytes_in_flight = unacked_packets_.bytes_in_flight();
   // Reverse packets_acked_ so that it is in ascending order.
   std::reverse(packets_acked_.begin(), packets_acked_.end());
+  // Newly acked packets are added to last_ack_frame_ one contiguous range
+  // [acked_range_start, acked_range_end) at a time.
+  QuicPacketNumber acked_range_start;
+  QuicPacketNumber acked_range_end;
   for (AckedPacket& acked_packet : packets_acked_) {
     QuicTransmissionInfo* info =
         unacked_packets_.GetMutableTransmissionInfo(acked_packet.packet_number);
@@ -1663,6 +1667,7 @@ AckResult QuicSentPacketManager::OnAckFrameEnd(
             << " with state: "
             << QuicUtils::SentPacketStateToString(info->state);
         if (supports_multiple_packet_number_spaces()) {
+          last_ack_frame_.packets.AddRange(acked_range_start, acked_range_end);
           if (info->state == NEVER_SENT) {
             return UNSENT_PACKETS_ACKED;
           }
@@ -1680,9 +1685,15 @@ AckResult QuicSentPacketManager::OnAckFrameEnd(
     if (supports_multiple_packet_number_spaces() &&
         QuicUtils::GetPacketNumberSpace(ack_decrypted_level) !=
             packet_number_space) {
+      last_ack_frame_.packets.AddRange(acked_range_start, acked_range_end);
       return PACKETS_ACKED_IN_WRONG_PACKET_NUMBER_SPACE;
     }
-    last_ack_frame_.packets.Add(acked_packet.packet_number);
+    if (!acked_range_end.IsInitialized() ||
+        acked_range_end != acked_packet.packet_number) {
+      last_ack_frame_.packets.AddRange(acked_range_start, acked_range_end);
+      acked_range_start = acked_packet.packet_number;
+    }
+    acked_range_end = acked_packet.packet_number + 1;
     if (info->encryption_level == ENCRYPTION_HANDSHAKE) {
       handshake_packet_acked_ = true;
     } else if (info->encryption_level == ENCRYPTION_ZERO_RTT) {
@@ -1709,6 +1720,7 @@ AckResult QuicSentPacketManager::OnAckFrameEnd(
                       last_ack_frame_.ack_delay_time,
                       acked_packet.receive_timestamp);
   }
+  last_ack_frame_.packets.AddRange(acked_range_start, acked_range_end);
   const bool acked_new_packet = !packets_acked_.empty();
   PostProcessNewlyAckedPackets(ack_packet_number, ack_decrypted_level,
                                last_ack_frame_, ack_receive_time, rtt_updated_,
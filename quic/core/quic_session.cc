@@ -120,6 +120,11 @@ QuicSession::QuicSession(
         config_.GetMaxUnidirectionalStreamsToSend() +
         num_expected_unidirectional_static_streams);
   }
+  if (GetQuicRestartFlag(quic_pool_stream_send_buffer_slices)) {
+    QUIC_RESTART_FLAG_COUNT(quic_pool_stream_send_buffer_slices);
+    stream_send_buffer_allocator_ = std::make_unique<QuicSlabBufferAllocator>(
+        connection_->helper()->GetStreamSendBufferAllocator());
+  }
 }
 
 void QuicSession::Initialize() {
@@ -2459,6 +2464,18 @@ WriteStreamDataResult QuicSession::WriteStreamData(QuicStreamId id,
   return WRITE_FAILED;
 }
 
+bool QuicSession::GetContiguousStreamData(QuicStreamId id,
+                                          QuicStreamOffset offset,
+                                          QuicByteCount data_length,
+                                          absl::string_view* data) {
+  QuicStream* stream = GetStream(id);
+  if (stream == nullptr) {
+    // Let WriteStreamData() handle the missing stream.
+    return false;
+  }
+  return stream->GetContiguousStreamData(offset, data_length, data);
+}
+
 bool QuicSession::WriteCryptoData(EncryptionLevel level,
                                   QuicStreamOffset offset,
                                   QuicByteCount data_length,
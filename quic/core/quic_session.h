@@ -33,6 +33,7 @@
 #include "quic/core/quic_packet_creator.h"
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_path_validator.h"
+#include "quic/core/quic_slab_buffer_allocator.h"
 #include "quic/core/quic_stream.h"
 #include "quic/core/quic_stream_frame_data_producer.h"
 #include "quic/core/quic_types.h"
@@ -192,6 +193,9 @@ class QUIC_EXPORT_PRIVATE QuicSession
                                         QuicStreamOffset offset,
                                         QuicByteCount data_length,
                                         QuicDataWriter* writer) override;
+  bool GetContiguousStreamData(QuicStreamId id, QuicStreamOffset offset,
+                               QuicByteCount data_length,
+                               absl::string_view* data) override;
   bool WriteCryptoData(EncryptionLevel level, QuicStreamOffset offset,
                        QuicByteCount data_length,
                        QuicDataWriter* writer) override;
@@ -761,6 +765,14 @@ class QUIC_EXPORT_PRIVATE QuicSession
 
   QuicDatagramQueue* datagram_queue() { return &datagram_queue_; }
 
+  // Returns the allocator which streams allocate the slices of their send
+  // buffers from, or nullptr if they use the allocator of the connection
+  // helper. Its number of buffers and slabs tell the send buffer slices and
+  // memory in use by the connection.
+  QuicSlabBufferAllocator* stream_send_buffer_allocator() {
+    return stream_send_buffer_allocator_.get();
+  }
+
   size_t num_static_streams() const { return num_static_streams_; }
 
   size_t num_zombie_streams() const { return num_zombie_streams_; }
@@ -918,6 +930,10 @@ class QUIC_EXPORT_PRIVATE QuicSession
   // May be null.
   Visitor* visitor_;
 
+  // Allocates the send buffer slices of all streams if not null, so it must
+  // outlive all streams.
+  std::unique_ptr<QuicSlabBufferAllocator> stream_send_buffer_allocator_;
+
   // A list of streams which need to write more data.  Stream register
   // themselves in their constructor, and unregisterm themselves in their
   // destructors, so the write blocked list must outlive all streams.
@@ -0,0 +1,241 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_session_index.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/numeric/int128.h"
+#include "common/platform/api/quiche_prefetch.h"
+#include "quic/platform/api/quic_bug_tracker.h"
+
+namespace quic {
+
+namespace {
+
+// The top kShardBits bits of a hash select the shard, and its low bits the
+// first entry to probe within the shard.
+const size_t kShardBits = 4;
+const size_t kNumShards = size_t{1} << kShardBits;
+
+const size_t kMinEntriesPerShard = 16;
+
+// Shards grow when they would be more than 3/4 full, which keeps probe
+// sequences short at a cost of 43 to 85 bytes per connection ID.
+bool ExceedsMaxLoad(size_t size, size_t num_entries) {
+  return size * 4 > num_entries * 3;
+}
+
+// Multiplies |a| and |b| and folds the 128-bit product.
+inline uint64_t Mix(uint64_t a, uint64_t b) {
+  absl::uint128 product = absl::uint128(a) * b;
+  return absl::Uint128Low64(product) ^ absl::Uint128High64(product);
+}
+
+}  // namespace
+
+static_assert(kQuicMaxConnectionIdWithLengthPrefixLength < 3 * 8,
+              "Connection IDs and their length must fit in three words");
+
+QuicSessionIndex::QuicSessionIndex()
+    : QuicSessionIndex(QuicRandom::GetInstance()) {}
+
+QuicSessionIndex::QuicSessionIndex(QuicRandom* random)
+    : hash_key_{random->RandUint64(), random->RandUint64()},
+      shards_(kNumShards),
+      size_(0) {}
+
+QuicSession* QuicSessionIndex::Find(
+    const QuicConnectionId& connection_id) const {
+  Key key;
+  if (!MakeKey(connection_id, &key)) {
+    return nullptr;
+  }
+  const uint64_t hash = Hash(key);
+  const Shard& shard = ShardForHash(hash);
+  if (shard.entries.empty()) {
+    return nullptr;
+  }
+  const size_t mask = shard.entries.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    const Entry& entry = shard.entries[i];
+    if (entry.session == nullptr) {
+      return nullptr;
+    }
+    if (entry.key == key) {
+      // The caller is about to process a packet with the session.
+      quiche::QuichePrefetchT0(entry.session);
+      return entry.session;
+    }
+  }
+}
+
+bool QuicSessionIndex::Insert(const QuicConnectionId& connection_id,
+                              QuicSession* session) {
+  QUICHE_DCHECK(session != nullptr);
+  Key key;
+  if (!MakeKey(connection_id, &key)) {
+    QUIC_BUG(quic_bug_session_index_long_connection_id)
+        << "Cannot index connection ID " << connection_id << " of length "
+        << static_cast<int>(connection_id.length());
+    return false;
+  }
+  const uint64_t hash = Hash(key);
+  Shard& shard = ShardForHash(hash);
+  if (!shard.entries.empty()) {
+    const size_t mask = shard.entries.size() - 1;
+    for (size_t i = hash & mask; shard.entries[i].session != nullptr;
+         i = (i + 1) & mask) {
+      if (shard.entries[i].key == key) {
+        return false;
+      }
+    }
+  }
+  if (ExceedsMaxLoad(shard.size + 1, shard.entries.size())) {
+    Grow(&shard);
+  }
+  InsertNew(&shard, hash, key, session);
+  ++size_;
+  return true;
+}
+
+bool QuicSessionIndex::Erase(const QuicConnectionId& connection_id) {
+  Key key;
+  if (!MakeKey(connection_id, &key)) {
+    return false;
+  }
+  const uint64_t hash = Hash(key);
+  Shard& shard = ShardForHash(hash);
+  if (shard.entries.empty()) {
+    return false;
+  }
+  const size_t mask = shard.entries.size() - 1;
+  size_t i = hash & mask;
+  while (true) {
+    if (shard.entries[i].session == nullptr) {
+      return false;
+    }
+    if (shard.entries[i].key == key) {
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+
+  // Shift back the following entries of the probe sequence which would no
+  // longer be reachable from their home entry once |i| is empty.
+  size_t j = i;
+  while (true) {
+    j = (j + 1) & mask;
+    const Entry& entry = shard.entries[j];
+    if (entry.session == nullptr) {
+      break;
+    }
+    const size_t home = Hash(entry.key) & mask;
+    const bool home_between_i_and_j =
+        i <= j ? (i < home && home <= j) : (i < home || home <= j);
+    if (home_between_i_and_j) {
+      continue;
+    }
+    shard.entries[i] = entry;
+    i = j;
+  }
+  shard.entries[i] = Entry();
+  --shard.size;
+  --size_;
+  return true;
+}
+
+void QuicSessionIndex::Clear() {
+  for (Shard& shard : shards_) {
+    shard = Shard();
+  }
+  size_ = 0;
+}
+
+size_t QuicSessionIndex::GetMemoryUsage() const {
+  size_t usage = shards_.capacity() * sizeof(Shard);
+  for (const Shard& shard : shards_) {
+    usage += shard.entries.capacity() * sizeof(Entry);
+  }
+  return usage;
+}
+
+// static
+bool QuicSessionIndex::MakeKey(const QuicConnectionId& connection_id,
+                               Key* key) {
+  if (connection_id.length() > kQuicMaxConnectionIdWithLengthPrefixLength) {
+    return false;
+  }
+  // Whole words are loaded with fixed-size copies and the remaining bytes are
+  // shifted in, so that the key is built in registers. A variable-size memcpy
+  // may be compiled into a string instruction with a high startup cost.
+  const char* data = connection_id.data();
+  const size_t length = connection_id.length();
+  uint64_t words[3] = {0, 0, 0};
+  size_t offset = 0;
+  for (; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+    memcpy(&words[offset / sizeof(uint64_t)], data + offset,
+           sizeof(uint64_t));
+  }
+  uint64_t tail = 0;
+  for (size_t i = 0; offset + i < length; ++i) {
+    tail |= uint64_t{static_cast<uint8_t>(data[offset + i])} << (8 * i);
+  }
+  words[offset / sizeof(uint64_t)] = tail;
+  // The length goes into the top byte of the last word, which connection IDs
+  // never reach.
+  words[2] |= uint64_t{static_cast<uint8_t>(length)} << 56;
+  key->words[0] = words[0];
+  key->words[1] = words[1];
+  key->words[2] = words[2];
+  return true;
+}
+
+uint64_t QuicSessionIndex::Hash(const Key& key) const {
+  const uint64_t hash =
+      Mix(key.words[0] ^ hash_key_[0], key.words[1] ^ hash_key_[1]);
+  return Mix(hash ^ key.words[2],
+             hash_key_[0] ^ UINT64_C(0x9e3779b97f4a7c15));
+}
+
+QuicSessionIndex::Shard& QuicSessionIndex::ShardForHash(uint64_t hash) {
+  return shards_[hash >> (64 - kShardBits)];
+}
+
+const QuicSessionIndex::Shard& QuicSessionIndex::ShardForHash(
+    uint64_t hash) const {
+  return shards_[hash >> (64 - kShardBits)];
+}
+
+// static
+void QuicSessionIndex::InsertNew(Shard* shard,
+                                 uint64_t hash,
+                                 const Key& key,
+                                 QuicSession* session) {
+  const size_t mask = shard->entries.size() - 1;
+  size_t i = hash & mask;
+  while (shard->entries[i].session != nullptr) {
+    i = (i + 1) & mask;
+  }
+  shard->entries[i].key = key;
+  shard->entries[i].session = session;
+  ++shard->size;
+}
+
+void QuicSessionIndex::Grow(Shard* shard) {
+  std::vector<Entry> entries(
+      std::max(kMinEntriesPerShard, shard->entries.size() * 2));
+  entries.swap(shard->entries);
+  shard->size = 0;
+  for (const Entry& entry : entries) {
+    if (entry.session != nullptr) {
+      InsertNew(shard, Hash(entry.key), entry.key, entry.session);
+    }
+  }
+}
+
+}  // namespace quic
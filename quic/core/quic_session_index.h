@@ -0,0 +1,114 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_SESSION_INDEX_H_
+#define QUICHE_QUIC_CORE_QUIC_SESSION_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "quic/core/crypto/quic_random.h"
+#include "quic/core/quic_connection_id.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+class QuicSession;
+
+// QuicSessionIndex maps server connection IDs to the sessions owning them,
+// without owning the sessions. It is meant for servers with millions of
+// connections, where the per-packet lookup cost is dominated by cache misses:
+// - Connection IDs of up to kQuicMaxConnectionIdWithLengthPrefixLength bytes
+//   are stored inline, as fixed-width keys compared word by word, so that an
+//   entry is 32 bytes and two of them share a cache line.
+// - Entries are stored with open addressing and linear probing, so a lookup
+//   usually touches a single cache line, and removal shifts entries back
+//   rather than leaving tombstones.
+// - Entries are split into shards by hash, which grow independently, so that
+//   growing the index only moves a fraction of the entries at a time.
+// - Find() prefetches the session it returns, which the caller is about to
+//   process the packet with.
+//
+// Keys are hashed with a random per-index key, so that peers cannot choose
+// connection IDs that land on the same probe sequence.
+class QUIC_EXPORT_PRIVATE QuicSessionIndex {
+ public:
+  QuicSessionIndex();
+  explicit QuicSessionIndex(QuicRandom* random);
+  QuicSessionIndex(const QuicSessionIndex&) = delete;
+  QuicSessionIndex& operator=(const QuicSessionIndex&) = delete;
+
+  // Returns the session of |connection_id|, or nullptr if there is none.
+  QuicSession* Find(const QuicConnectionId& connection_id) const;
+
+  // Maps |connection_id| to |session|, which must not be nullptr. Returns
+  // false, and does not change the index, if |connection_id| is already
+  // mapped or is too long to be indexed.
+  bool Insert(const QuicConnectionId& connection_id, QuicSession* session);
+
+  // Removes |connection_id| from the index. Returns false if it was not
+  // mapped.
+  bool Erase(const QuicConnectionId& connection_id);
+
+  // Removes all entries.
+  void Clear();
+
+  // Number of connection IDs in the index.
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Heap memory used by the index, in bytes.
+  size_t GetMemoryUsage() const;
+
+ private:
+  // A connection ID zero-padded to 24 bytes, with its length in the top byte
+  // of the last word.
+  struct Key {
+    bool operator==(const Key& other) const {
+      return words[0] == other.words[0] && words[1] == other.words[1] &&
+             words[2] == other.words[2];
+    }
+    uint64_t words[3];
+  };
+
+  struct Entry {
+    Key key;
+    // nullptr if the entry is empty.
+    QuicSession* session;
+  };
+
+  struct Shard {
+    // Number of non-empty entries.
+    size_t size = 0;
+    // Empty or a power of 2 number of entries.
+    std::vector<Entry> entries;
+  };
+
+  // Populates |key| with |connection_id|. Returns false if it is too long.
+  static bool MakeKey(const QuicConnectionId& connection_id, Key* key);
+
+  uint64_t Hash(const Key& key) const;
+  Shard& ShardForHash(uint64_t hash);
+  const Shard& ShardForHash(uint64_t hash) const;
+
+  // Inserts |key| into |shard|, which must not contain it and must have room
+  // for it.
+  static void InsertNew(Shard* shard,
+                        uint64_t hash,
+                        const Key& key,
+                        QuicSession* session);
+
+  // Doubles the number of entries of |shard|.
+  void Grow(Shard* shard);
+
+  const uint64_t hash_key_[2];
+  std::vector<Shard> shards_;
+  size_t size_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_SESSION_INDEX_H_
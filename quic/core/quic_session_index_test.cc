@@ -0,0 +1,210 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_session_index.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/quic_connection_id.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+// The index never dereferences sessions, so tests use addresses within a
+// buffer as sessions.
+class FakeSessions {
+ public:
+  explicit FakeSessions(size_t num_sessions)
+      : storage_(std::make_shared<std::vector<char>>(num_sessions)) {}
+
+  QuicSession* session(size_t i) const {
+    return reinterpret_cast<QuicSession*>(storage_->data() + i);
+  }
+
+  // Returns a shared_ptr to session(i) which shares ownership of the buffer,
+  // without allocating.
+  std::shared_ptr<QuicSession> shared_session(size_t i) const {
+    return std::shared_ptr<QuicSession>(storage_, session(i));
+  }
+
+ private:
+  std::shared_ptr<std::vector<char>> storage_;
+};
+
+QuicConnectionId RandomConnectionId(QuicRandom* random, uint8_t length) {
+  QuicConnectionId connection_id;
+  connection_id.set_length(length);
+  random->RandBytes(connection_id.mutable_data(), length);
+  return connection_id;
+}
+
+class QuicSessionIndexTest : public QuicTest {
+ protected:
+  QuicSessionIndexTest() : sessions_(1000) {}
+
+  FakeSessions sessions_;
+};
+
+TEST_F(QuicSessionIndexTest, InsertFindErase) {
+  QuicSessionIndex index;
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(nullptr, index.Find(TestConnectionId(1)));
+  EXPECT_FALSE(index.Erase(TestConnectionId(1)));
+
+  EXPECT_TRUE(index.Insert(TestConnectionId(1), sessions_.session(1)));
+  EXPECT_TRUE(index.Insert(TestConnectionId(2), sessions_.session(2)));
+  // Several connection IDs may map to the same session.
+  EXPECT_TRUE(index.Insert(TestConnectionId(3), sessions_.session(2)));
+  EXPECT_EQ(3u, index.size());
+  EXPECT_EQ(sessions_.session(1), index.Find(TestConnectionId(1)));
+  EXPECT_EQ(sessions_.session(2), index.Find(TestConnectionId(2)));
+  EXPECT_EQ(sessions_.session(2), index.Find(TestConnectionId(3)));
+  EXPECT_EQ(nullptr, index.Find(TestConnectionId(4)));
+
+  EXPECT_TRUE(index.Erase(TestConnectionId(2)));
+  EXPECT_FALSE(index.Erase(TestConnectionId(2)));
+  EXPECT_EQ(nullptr, index.Find(TestConnectionId(2)));
+  EXPECT_EQ(sessions_.session(2), index.Find(TestConnectionId(3)));
+  EXPECT_EQ(2u, index.size());
+
+  index.Clear();
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(nullptr, index.Find(TestConnectionId(1)));
+}
+
+TEST_F(QuicSessionIndexTest, ConnectionIdLengths) {
+  QuicSessionIndex index;
+  // IDs with the same bytes but different lengths are different keys.
+  const char kData[kQuicMaxConnectionIdWithLengthPrefixLength] = {0};
+  for (uint8_t length = 0;
+       length <= kQuicMaxConnectionIdWithLengthPrefixLength; ++length) {
+    EXPECT_TRUE(index.Insert(QuicConnectionId(kData, length),
+                             sessions_.session(length)));
+  }
+  for (uint8_t length = 0;
+       length <= kQuicMaxConnectionIdWithLengthPrefixLength; ++length) {
+    EXPECT_EQ(sessions_.session(length),
+              index.Find(QuicConnectionId(kData, length)));
+  }
+}
+
+TEST_F(QuicSessionIndexTest, RejectsDuplicatesAndLongConnectionIds) {
+  QuicSessionIndex index;
+  EXPECT_TRUE(index.Insert(TestConnectionId(1), sessions_.session(1)));
+  EXPECT_FALSE(index.Insert(TestConnectionId(1), sessions_.session(2)));
+  EXPECT_EQ(sessions_.session(1), index.Find(TestConnectionId(1)));
+
+  const char kData[kQuicMaxConnectionIdWithLengthPrefixLength + 1] = {0};
+  QuicConnectionId long_connection_id(kData, sizeof(kData));
+  EXPECT_QUIC_BUG(
+      EXPECT_FALSE(index.Insert(long_connection_id, sessions_.session(2))),
+      "Cannot index connection ID");
+  EXPECT_EQ(nullptr, index.Find(long_connection_id));
+  EXPECT_EQ(1u, index.size());
+}
+
+// Compares the index with a std::map through random insertions and removals,
+// which exercise growth and backward shifting.
+TEST_F(QuicSessionIndexTest, RandomOperations) {
+  SimpleRandom random;
+  QuicSessionIndex index(&random);
+  std::map<QuicConnectionId, QuicSession*> expected;
+  std::vector<QuicConnectionId> connection_ids;
+  for (size_t i = 0; i < 500; ++i) {
+    connection_ids.push_back(RandomConnectionId(&random, 1 + i % 20));
+  }
+  for (size_t i = 0; i < 20000; ++i) {
+    const QuicConnectionId& connection_id =
+        connection_ids[random.RandUint64() % connection_ids.size()];
+    if (random.RandUint64() % 3 == 0) {
+      EXPECT_EQ(expected.erase(connection_id) == 1,
+                index.Erase(connection_id));
+    } else {
+      QuicSession* session = sessions_.session(i % 1000);
+      EXPECT_EQ(expected.emplace(connection_id, session).second,
+                index.Insert(connection_id, session));
+    }
+    ASSERT_EQ(expected.size(), index.size());
+  }
+  for (const QuicConnectionId& connection_id : connection_ids) {
+    auto it = expected.find(connection_id);
+    EXPECT_EQ(it == expected.end() ? nullptr : it->second,
+              index.Find(connection_id));
+  }
+}
+
+// Lookup cost of the index compared to the session map of QuicDispatcher, for
+// 10K, 1M and 5M sessions with 8-byte connection IDs, looked up in random
+// order.
+TEST_F(QuicSessionIndexTest, DISABLED_LookupBenchmark) {
+  using SessionMap = absl::flat_hash_map<QuicConnectionId,
+                                         std::shared_ptr<QuicSession>,
+                                         QuicConnectionIdHash>;
+  const size_t kNumLookups = 2000000;
+
+  for (size_t num_sessions : {10000u, 1000000u, 5000000u}) {
+    SimpleRandom random;
+    random.set_seed(num_sessions);
+    FakeSessions sessions(num_sessions);
+    std::vector<QuicConnectionId> connection_ids;
+    connection_ids.reserve(num_sessions);
+    for (size_t i = 0; i < num_sessions; ++i) {
+      connection_ids.push_back(RandomConnectionId(&random, 8));
+    }
+    std::vector<uint32_t> lookup_order(kNumLookups);
+    for (uint32_t& i : lookup_order) {
+      i = random.RandUint64() % num_sessions;
+    }
+
+    double map_ns_per_lookup;
+    {
+      SessionMap map;
+      for (size_t i = 0; i < num_sessions; ++i) {
+        map.emplace(connection_ids[i], sessions.shared_session(i));
+      }
+      size_t num_found = 0;
+      const absl::Time start = absl::Now();
+      for (uint32_t i : lookup_order) {
+        auto it = map.find(connection_ids[i]);
+        num_found +=
+            it != map.end() && it->second.get() == sessions.session(i);
+      }
+      map_ns_per_lookup =
+          absl::ToDoubleNanoseconds(absl::Now() - start) / kNumLookups;
+      EXPECT_EQ(kNumLookups, num_found);
+    }
+
+    QuicSessionIndex index(&random);
+    for (size_t i = 0; i < num_sessions; ++i) {
+      index.Insert(connection_ids[i], sessions.session(i));
+    }
+    size_t num_found = 0;
+    const absl::Time start = absl::Now();
+    for (uint32_t i : lookup_order) {
+      num_found += index.Find(connection_ids[i]) == sessions.session(i);
+    }
+    const double index_ns_per_lookup =
+        absl::ToDoubleNanoseconds(absl::Now() - start) / kNumLookups;
+    EXPECT_EQ(kNumLookups, num_found);
+
+    QUIC_LOG(INFO) << num_sessions << " sessions: session map "
+                   << map_ns_per_lookup << " ns/lookup, session index "
+                   << index_ns_per_lookup << " ns/lookup, "
+                   << static_cast<double>(index.GetMemoryUsage()) /
+                          num_sessions
+                   << " index bytes/session";
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
@@ -0,0 +1,147 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_slab_buffer_allocator.h"
+
+#include <new>
+
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+QuicSlabBufferAllocator::QuicSlabBufferAllocator(
+    quiche::QuicheBufferAllocator* fallback_allocator)
+    : fallback_allocator_(fallback_allocator),
+      current_slab_(nullptr),
+      num_buffers_(0) {}
+
+QuicSlabBufferAllocator::~QuicSlabBufferAllocator() {
+  if (num_buffers_ > 0) {
+    // Slabs which are still in use are leaked rather than freed under the
+    // buffers.
+    QUIC_BUG(quic_bug_slab_buffer_allocator_in_use)
+        << "Destroying slab allocator with " << num_buffers_
+        << " buffers in use.";
+  }
+  for (Slab* slab : free_slabs_) {
+    FreeSlab(slab);
+  }
+  if (current_slab_ != nullptr && current_slab_->num_buffers == 0) {
+    FreeSlab(current_slab_);
+  }
+}
+
+char* QuicSlabBufferAllocator::New(size_t size) {
+  if (size == 0 || size > kMaxBufferSize) {
+    return fallback_allocator_->New(size);
+  }
+  if (current_slab_ == nullptr || current_slab_->used + size > kSlabSize) {
+    SwitchSlab(size);
+  }
+  char* buffer = reinterpret_cast<char*>(current_slab_) + current_slab_->used;
+  current_slab_->used += size;
+  ++current_slab_->num_buffers;
+  ++num_buffers_;
+  return buffer;
+}
+
+char* QuicSlabBufferAllocator::New(size_t size, bool flag_enable) {
+  if (!flag_enable) {
+    return fallback_allocator_->New(size, flag_enable);
+  }
+  return New(size);
+}
+
+void QuicSlabBufferAllocator::Delete(char* buffer) {
+  Slab* slab = SlabOf(buffer);
+  if (slab == nullptr) {
+    fallback_allocator_->Delete(buffer);
+    return;
+  }
+  QUICHE_DCHECK_LT(0u, slab->num_buffers);
+  --slab->num_buffers;
+  --num_buffers_;
+  if (slab->num_buffers > 0) {
+    return;
+  }
+  if (slab == current_slab_) {
+    // Start over at the beginning of the current slab.
+    slab->used = kSlabHeaderSize;
+    return;
+  }
+  if (free_slabs_.size() >= kMaxFreeSlabs) {
+    FreeSlab(slab);
+    return;
+  }
+  free_slabs_.push_back(slab);
+}
+
+void QuicSlabBufferAllocator::MarkAllocatorIdle() {
+  for (Slab* slab : free_slabs_) {
+    FreeSlab(slab);
+  }
+  free_slabs_.clear();
+  if (current_slab_ != nullptr && current_slab_->num_buffers == 0) {
+    FreeSlab(current_slab_);
+    current_slab_ = nullptr;
+  }
+}
+
+bool QuicSlabBufferAllocator::Extend(const char* buffer,
+                                     size_t size,
+                                     size_t extra_size) {
+  // A buffer which ends where the free memory of the current slab starts is
+  // in that slab.
+  if (current_slab_ == nullptr || size == 0 ||
+      buffer + size !=
+          reinterpret_cast<char*>(current_slab_) + current_slab_->used ||
+      current_slab_->used + extra_size > kSlabSize) {
+    return false;
+  }
+  current_slab_->used += extra_size;
+  // The extension is accounted for as a buffer of its own, so that a buffer
+  // covering both can replace the extended one.
+  ++current_slab_->num_buffers;
+  ++num_buffers_;
+  return true;
+}
+
+QuicSlabBufferAllocator::Slab* QuicSlabBufferAllocator::SlabOf(
+    const char* buffer) const {
+  const uintptr_t slab_address =
+      reinterpret_cast<uintptr_t>(buffer) & ~uintptr_t{kSlabSize - 1};
+  if (!slabs_.contains(slab_address)) {
+    return nullptr;
+  }
+  return reinterpret_cast<Slab*>(slab_address);
+}
+
+void QuicSlabBufferAllocator::SwitchSlab(size_t size) {
+  QUICHE_DCHECK_LE(size, kSlabSize - kSlabHeaderSize);
+  if (current_slab_ != nullptr && current_slab_->num_buffers == 0) {
+    current_slab_->used = kSlabHeaderSize;
+    return;
+  }
+  // The previous slab is added to |free_slabs_| once its last buffer is
+  // deleted.
+  if (!free_slabs_.empty()) {
+    current_slab_ = free_slabs_.back();
+    free_slabs_.pop_back();
+  } else {
+    void* memory = ::operator new(kSlabSize, std::align_val_t(kSlabSize));
+    slabs_.insert(reinterpret_cast<uintptr_t>(memory));
+    current_slab_ = new (memory) Slab;
+  }
+  current_slab_->used = kSlabHeaderSize;
+  current_slab_->num_buffers = 0;
+}
+
+void QuicSlabBufferAllocator::FreeSlab(Slab* slab) {
+  slabs_.erase(reinterpret_cast<uintptr_t>(slab));
+  slab->~Slab();
+  ::operator delete(slab, std::align_val_t(kSlabSize));
+}
+
+}  // namespace quic
@@ -0,0 +1,107 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_SLAB_BUFFER_ALLOCATOR_H_
+#define QUICHE_QUIC_CORE_QUIC_SLAB_BUFFER_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "quic/platform/api/quic_export.h"
+#include "common/quiche_buffer_allocator.h"
+
+namespace quic {
+
+// QuicSlabBufferAllocator hands out small buffers, such as the slices of
+// stream send buffers, from fixed size slabs. Buffers are carved out of the
+// current slab one after the other, and a slab is reused once all of its
+// buffers are deleted. This replaces one allocation per buffer with one per
+// slab, and keeps buffers which are written one after the other adjacent in
+// memory, so that they can be extended by Extend().
+//
+// Larger buffers, and buffers which need to be compatible with operator new,
+// are allocated by the fallback allocator. Not thread safe.
+//
+// A slab is only reused once all of its buffers are deleted, so a single
+// buffer which stays outstanding, such as an unacked slice of a stream which
+// stopped writing, pins its whole slab. In the worst case, with one small
+// buffer left in each slab, the allocator uses kSlabSize bytes per
+// outstanding buffer. Without outstanding buffers, it keeps the current slab
+// and up to kMaxFreeSlabs free ones, ie 32KB, until MarkAllocatorIdle() is
+// called.
+class QUIC_EXPORT_PRIVATE QuicSlabBufferAllocator
+    : public quiche::QuicheBufferAllocator {
+ public:
+  // Size of a slab, which includes its header. Slabs are aligned to their
+  // size.
+  static constexpr size_t kSlabSize = 16 * 1024;
+  // Buffers larger than this are allocated by the fallback allocator.
+  static constexpr size_t kMaxBufferSize = kSlabSize / 4;
+  // Maximum number of free slabs which are kept for reuse.
+  static constexpr size_t kMaxFreeSlabs = 1;
+
+  explicit QuicSlabBufferAllocator(
+      quiche::QuicheBufferAllocator* fallback_allocator);
+  QuicSlabBufferAllocator(const QuicSlabBufferAllocator&) = delete;
+  QuicSlabBufferAllocator& operator=(const QuicSlabBufferAllocator&) = delete;
+  ~QuicSlabBufferAllocator() override;
+
+  // QuicheBufferAllocator
+  char* New(size_t size) override;
+  char* New(size_t size, bool flag_enable) override;
+  void Delete(char* buffer) override;
+  void MarkAllocatorIdle() override;
+
+  // If the |size| bytes at |buffer|, which was returned by New(), are directly
+  // followed by free memory of the current slab, allocates |extra_size| bytes
+  // there and returns true. The extended buffer is deleted by a single call to
+  // Delete(), which must be passed |buffer|.
+  bool Extend(const char* buffer, size_t size, size_t extra_size);
+
+  // Number of buffers allocated from slabs which are not deleted yet.
+  size_t num_buffers() const { return num_buffers_; }
+
+  // Number of slabs, including free ones.
+  size_t num_slabs() const { return slabs_.size(); }
+
+  // Number of free slabs which are kept for reuse.
+  size_t num_free_slabs() const { return free_slabs_.size(); }
+
+ private:
+  // Header at the start of each slab.
+  struct Slab {
+    // Number of bytes used, including this header.
+    size_t used;
+    // Number of buffers in the slab which are not deleted.
+    size_t num_buffers;
+  };
+
+  static constexpr size_t kSlabHeaderSize = (sizeof(Slab) + 15) / 16 * 16;
+
+  // Returns the slab which contains |buffer|, or nullptr if |buffer| is not
+  // allocated from a slab.
+  Slab* SlabOf(const char* buffer) const;
+
+  // Makes |current_slab_| a slab with |size| free bytes at least.
+  void SwitchSlab(size_t size);
+
+  void FreeSlab(Slab* slab);
+
+  quiche::QuicheBufferAllocator* fallback_allocator_;
+
+  // Addresses of all the slabs.
+  absl::flat_hash_set<uintptr_t> slabs_;
+  // Slab which new buffers are allocated from.
+  Slab* current_slab_;
+  // Slabs without buffers, other than |current_slab_|.
+  std::vector<Slab*> free_slabs_;
+
+  size_t num_buffers_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_SLAB_BUFFER_ALLOCATOR_H_
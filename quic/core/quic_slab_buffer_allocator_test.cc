@@ -0,0 +1,138 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_slab_buffer_allocator.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "quic/platform/api/quic_test.h"
+#include "common/simple_buffer_allocator.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class QuicSlabBufferAllocatorTest : public QuicTest {
+ protected:
+  QuicSlabBufferAllocatorTest()
+      : allocator_(quiche::SimpleBufferAllocator::Get()) {}
+
+  QuicSlabBufferAllocator allocator_;
+};
+
+TEST_F(QuicSlabBufferAllocatorTest, BuffersShareSlab) {
+  char* buffer1 = allocator_.New(100);
+  char* buffer2 = allocator_.New(200);
+  memset(buffer1, 'a', 100);
+  memset(buffer2, 'b', 200);
+  EXPECT_EQ(buffer1 + 100, buffer2);
+  EXPECT_EQ(1u, allocator_.num_slabs());
+  EXPECT_EQ(2u, allocator_.num_buffers());
+
+  allocator_.Delete(buffer1);
+  EXPECT_EQ(1u, allocator_.num_buffers());
+  EXPECT_EQ(std::string(200, 'b'), std::string(buffer2, 200));
+  allocator_.Delete(buffer2);
+  EXPECT_EQ(0u, allocator_.num_buffers());
+
+  // The slab is reused from its start.
+  EXPECT_EQ(buffer1, allocator_.New(100));
+  allocator_.Delete(buffer1);
+  EXPECT_EQ(1u, allocator_.num_slabs());
+}
+
+TEST_F(QuicSlabBufferAllocatorTest, LargeBuffersUseFallbackAllocator) {
+  char* buffer = allocator_.New(QuicSlabBufferAllocator::kMaxBufferSize + 1);
+  EXPECT_EQ(0u, allocator_.num_slabs());
+  EXPECT_EQ(0u, allocator_.num_buffers());
+  allocator_.Delete(buffer);
+
+  buffer = allocator_.New(100, /*flag_enable=*/false);
+  EXPECT_EQ(0u, allocator_.num_buffers());
+  allocator_.Delete(buffer);
+}
+
+TEST_F(QuicSlabBufferAllocatorTest, FreeSlabsAreReused) {
+  const size_t kBufferSize = QuicSlabBufferAllocator::kMaxBufferSize;
+  // Fill a few slabs.
+  std::vector<char*> buffers;
+  for (size_t i = 0; i < 3 * QuicSlabBufferAllocator::kSlabSize / kBufferSize;
+       ++i) {
+    buffers.push_back(allocator_.New(kBufferSize));
+  }
+  EXPECT_LE(3u, allocator_.num_slabs());
+  for (char* buffer : buffers) {
+    allocator_.Delete(buffer);
+  }
+  EXPECT_EQ(0u, allocator_.num_buffers());
+  // Only up to kMaxFreeSlabs free slabs are kept, besides the current one.
+  const size_t num_slabs = QuicSlabBufferAllocator::kMaxFreeSlabs + 1;
+  EXPECT_EQ(QuicSlabBufferAllocator::kMaxFreeSlabs,
+            allocator_.num_free_slabs());
+  EXPECT_EQ(num_slabs, allocator_.num_slabs());
+
+  // No slabs are allocated while free ones are available.
+  buffers.clear();
+  while (allocator_.num_free_slabs() > 0) {
+    buffers.push_back(allocator_.New(kBufferSize));
+  }
+  EXPECT_EQ(num_slabs, allocator_.num_slabs());
+  for (char* buffer : buffers) {
+    allocator_.Delete(buffer);
+  }
+
+  allocator_.MarkAllocatorIdle();
+  EXPECT_EQ(0u, allocator_.num_slabs());
+  EXPECT_EQ(0u, allocator_.num_free_slabs());
+}
+
+TEST_F(QuicSlabBufferAllocatorTest, Extend) {
+  char* buffer1 = allocator_.New(100);
+  EXPECT_TRUE(allocator_.Extend(buffer1, 100, 50));
+  EXPECT_TRUE(allocator_.Extend(buffer1, 150, 50));
+  // Only the end of the last buffer can be extended.
+  EXPECT_FALSE(allocator_.Extend(buffer1, 100, 50));
+  char* buffer2 = allocator_.New(100);
+  EXPECT_EQ(buffer1 + 200, buffer2);
+  EXPECT_FALSE(allocator_.Extend(buffer1, 200, 50));
+
+  // A buffer covering an extension replaces the extended buffer, and each
+  // extension, with a single Delete().
+  EXPECT_EQ(4u, allocator_.num_buffers());
+  allocator_.Delete(buffer1);
+  allocator_.Delete(buffer1);
+  allocator_.Delete(buffer1);
+  EXPECT_EQ(1u, allocator_.num_buffers());
+  allocator_.Delete(buffer2);
+
+  // Buffers from the fallback allocator cannot be extended.
+  char* buffer3 = allocator_.New(QuicSlabBufferAllocator::kMaxBufferSize + 1);
+  EXPECT_FALSE(allocator_.Extend(
+      buffer3, QuicSlabBufferAllocator::kMaxBufferSize + 1, 10));
+  allocator_.Delete(buffer3);
+}
+
+TEST_F(QuicSlabBufferAllocatorTest, ExtendBeyondSlab) {
+  const size_t kBufferSize = QuicSlabBufferAllocator::kMaxBufferSize;
+  std::vector<char*> buffers;
+  while (allocator_.num_slabs() < 2) {
+    buffers.push_back(allocator_.New(kBufferSize));
+  }
+  // The last buffer is the first one of the second slab, and the first slab
+  // has less than a buffer of free memory left.
+  char* last_of_first_slab = buffers[buffers.size() - 2];
+  EXPECT_FALSE(allocator_.Extend(last_of_first_slab, kBufferSize, 1));
+  EXPECT_FALSE(allocator_.Extend(buffers.back(), kBufferSize,
+                                 QuicSlabBufferAllocator::kSlabSize));
+  for (char* buffer : buffers) {
+    allocator_.Delete(buffer);
+  }
+  EXPECT_EQ(0u, allocator_.num_buffers());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
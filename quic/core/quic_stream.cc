@@ -376,6 +376,9 @@ QuicStream::QuicStream(QuicStreamId id, QuicSession* session,
                 : type),
       creation_time_(session->connection()->clock()->ApproximateNow()),
       perspective_(session->perspective()) {
+  if (session->stream_send_buffer_allocator() != nullptr) {
+    send_buffer_.set_slab_allocator(session->stream_send_buffer_allocator());
+  }
   if (type_ == WRITE_UNIDIRECTIONAL) {
     fin_received_ = true;
     CloseReadSide();
@@ -1211,6 +1214,13 @@ bool QuicStream::WriteStreamData(QuicStreamOffset offset,
   return send_buffer_.WriteStreamData(offset, data_length, writer);
 }
 
+bool QuicStream::GetContiguousStreamData(QuicStreamOffset offset,
+                                         QuicByteCount data_length,
+                                         absl::string_view* data) {
+  QUICHE_DCHECK_LT(0u, data_length);
+  return send_buffer_.GetContiguousStreamData(offset, data_length, data);
+}
+
 void QuicStream::WriteBufferedData(EncryptionLevel level) {
   QUICHE_DCHECK(!write_side_closed_ && (HasBufferedData() || fin_buffered_));
 
@@ -332,6 +332,12 @@ class QUIC_EXPORT_PRIVATE QuicStream
   bool WriteStreamData(QuicStreamOffset offset, QuicByteCount data_length,
                        QuicDataWriter* writer);
 
+  // Points |data| at |data_length| bytes of data starting at |offset| in the
+  // send buffer if they are contiguous. Returns false otherwise.
+  bool GetContiguousStreamData(QuicStreamOffset offset,
+                               QuicByteCount data_length,
+                               absl::string_view* data);
+
   // Called when data [offset, offset + data_length) is acked. |fin_acked|
   // indicates whether the fin is acked. Returns true and updates
   // |newly_acked_length| if any new stream data (including fin) gets acked.
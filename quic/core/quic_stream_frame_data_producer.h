@@ -5,6 +5,7 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_STREAM_FRAME_DATA_PRODUCER_H_
 #define QUICHE_QUIC_CORE_QUIC_STREAM_FRAME_DATA_PRODUCER_H_
 
+#include "absl/strings/string_view.h"
 #include "quic/core/quic_types.h"
 
 namespace quic {
@@ -25,6 +26,18 @@ class QUIC_EXPORT_PRIVATE QuicStreamFrameDataProducer {
                                                 QuicByteCount data_length,
                                                 QuicDataWriter* writer) = 0;
 
+  // If the |data_length| bytes of stream |id| at |offset| are in contiguous
+  // memory, points |data| at them and returns true, in which case they count
+  // as written as if by WriteStreamData(). |data| stays valid until the packet
+  // which carries it is serialized. Returns false otherwise, and the data is
+  // written by WriteStreamData() instead.
+  virtual bool GetContiguousStreamData(QuicStreamId /*id*/,
+                                       QuicStreamOffset /*offset*/,
+                                       QuicByteCount /*data_length*/,
+                                       absl::string_view* /*data*/) {
+    return false;
+  }
+
   // Writes the data for a CRYPTO frame to |writer| for a frame at encryption
   // level |level| starting at offset |offset| for |data_length| bytes. Returns
   // whether writing the data was successful.
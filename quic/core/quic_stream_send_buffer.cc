@@ -5,6 +5,7 @@
 #include "quic/core/quic_stream_send_buffer.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include "quic/core/quic_data_writer.h"
 #include "quic/core/quic_interval.h"
@@ -52,18 +53,31 @@ QuicStreamSendBuffer::QuicStreamSendBuffer(
     : current_end_offset_(0),
       stream_offset_(0),
       allocator_(allocator),
+      slab_allocator_(nullptr),
       stream_bytes_written_(0),
       stream_bytes_outstanding_(0),
       write_index_(-1) {}
 
 QuicStreamSendBuffer::~QuicStreamSendBuffer() {}
 
+void QuicStreamSendBuffer::set_slab_allocator(
+    QuicSlabBufferAllocator* slab_allocator) {
+  QUICHE_DCHECK_EQ(0u, stream_offset_);
+  allocator_ = slab_allocator;
+  slab_allocator_ = slab_allocator;
+}
+
 void QuicStreamSendBuffer::SaveStreamData(absl::string_view data) {
   QUICHE_DCHECK(!data.empty());
 
   // Latch the maximum data slice size.
   const QuicByteCount max_data_slice_size =
       GetQuicFlag(FLAGS_quic_send_buffer_max_data_slice_size);
+  if (slab_allocator_ != nullptr) {
+    const size_t bytes_appended = AppendToLastSlice(data, max_data_slice_size);
+    stream_offset_ += bytes_appended;
+    data = data.substr(bytes_appended);
+  }
   while (!data.empty()) {
     auto slice_len = std::min<absl::string_view::size_type>(
         data.length(), max_data_slice_size);
@@ -145,6 +159,27 @@ bool QuicStreamSendBuffer::WriteStreamData(QuicStreamOffset offset,
   return data_length == 0;
 }
 
+bool QuicStreamSendBuffer::GetContiguousStreamData(QuicStreamOffset offset,
+                                                   QuicByteCount data_length,
+                                                   absl::string_view* data) {
+  QUIC_BUG_IF(quic_bug_contiguous_stream_data_out_of_order,
+              current_end_offset_ < offset)
+      << "Tried to write data out of sequence. last_offset_end:"
+      << current_end_offset_ << ", offset:" << offset;
+  auto slice_it = interval_deque_.DataAt(offset);
+  if (slice_it == interval_deque_.DataEnd() || offset < slice_it->offset ||
+      offset + data_length > slice_it->offset + slice_it->slice.length()) {
+    return false;
+  }
+  *data = absl::string_view(
+      slice_it->slice.data() + (offset - slice_it->offset), data_length);
+  current_end_offset_ = std::max(current_end_offset_,
+                                 slice_it->offset + slice_it->slice.length());
+  // Advance the write index past the slice, as WriteStreamData() does.
+  ++slice_it;
+  return true;
+}
+
 bool QuicStreamSendBuffer::OnStreamDataAcked(
     QuicStreamOffset offset,
     QuicByteCount data_length,
@@ -284,6 +319,35 @@ void QuicStreamSendBuffer::CleanUpBufferedSlices() {
   }
 }
 
+size_t QuicStreamSendBuffer::AppendToLastSlice(
+    absl::string_view data,
+    QuicByteCount max_data_slice_size) {
+  if (interval_deque_.Empty()) {
+    return 0;
+  }
+  BufferedSlice& last = interval_deque_.Back();
+  const size_t length = last.slice.length();
+  if (last.slice.empty() || length >= max_data_slice_size) {
+    return 0;
+  }
+  const size_t bytes_to_append =
+      std::min<size_t>(data.length(), max_data_slice_size - length);
+  // This fails unless the slice is the last one allocated from the current
+  // slab, which also rules out slices saved by SaveMemSlice().
+  if (!slab_allocator_->Extend(last.slice.data(), length, bytes_to_append)) {
+    return 0;
+  }
+  char* buffer = const_cast<char*>(last.slice.data());
+  memcpy(buffer + length, data.data(), bytes_to_append);
+  // The extended slice replaces the last one, which releases the memory of
+  // the latter, and keeps the memory of the extension.
+  last.slice = quiche::QuicheMemSlice(quiche::QuicheBuffer(
+      quiche::QuicheUniqueBufferPtr(
+          buffer, quiche::QuicheBufferDeleter(slab_allocator_)),
+      length + bytes_to_append));
+  return bytes_to_append;
+}
+
 bool QuicStreamSendBuffer::IsStreamDataOutstanding(
     QuicStreamOffset offset,
     QuicByteCount data_length) const {
@@ -5,10 +5,12 @@
 #ifndef QUICHE_QUIC_CORE_QUIC_STREAM_SEND_BUFFER_H_
 #define QUICHE_QUIC_CORE_QUIC_STREAM_SEND_BUFFER_H_
 
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "quic/core/frames/quic_stream_frame.h"
 #include "quic/core/quic_interval_deque.h"
 #include "quic/core/quic_interval_set.h"
+#include "quic/core/quic_slab_buffer_allocator.h"
 #include "quic/core/quic_types.h"
 #include "common/platform/api/quiche_mem_slice.h"
 #include "common/quiche_circular_deque.h"
@@ -68,6 +70,11 @@ class QUIC_EXPORT_PRIVATE QuicStreamSendBuffer {
   QuicStreamSendBuffer(QuicStreamSendBuffer&& other) = delete;
   ~QuicStreamSendBuffer();
 
+  // Makes SaveStreamData() allocate slices from |slab_allocator|, and append
+  // small writes to the last slice while it has room, instead of adding a
+  // slice per write. Must be called before any data is saved.
+  void set_slab_allocator(QuicSlabBufferAllocator* slab_allocator);
+
   // Save |data| to send buffer.
   void SaveStreamData(absl::string_view data);
 
@@ -85,6 +92,13 @@ class QUIC_EXPORT_PRIVATE QuicStreamSendBuffer {
                        QuicByteCount data_length,
                        QuicDataWriter* writer);
 
+  // Points |data| at the |data_length| bytes at |offset| and returns true if
+  // they are in a single slice, which saves copying them when the packet is
+  // encrypted. Otherwise returns false and leaves |data| unchanged.
+  bool GetContiguousStreamData(QuicStreamOffset offset,
+                               QuicByteCount data_length,
+                               absl::string_view* data);
+
   // Called when data [offset, offset + data_length) is acked or removed as
   // stream is canceled. Removes fully acked data slice from send buffer. Set
   // |newly_acked_length|. Returns false if trying to ack unsent data.
@@ -141,6 +155,12 @@ class QUIC_EXPORT_PRIVATE QuicStreamSendBuffer {
   // Cleanup empty slices in order from buffered_slices_.
   void CleanUpBufferedSlices();
 
+  // Appends as much of |data| as fits to the last slice, if it is allocated
+  // from |slab_allocator_| and can grow in place to at most
+  // |max_data_slice_size| bytes. Returns the number of bytes appended.
+  size_t AppendToLastSlice(absl::string_view data,
+                           QuicByteCount max_data_slice_size);
+
   // |current_end_offset_| stores the end offset of the current slice to ensure
   // data isn't being written out of order when using the |interval_deque_|.
   QuicStreamOffset current_end_offset_;
@@ -151,6 +171,9 @@ class QUIC_EXPORT_PRIVATE QuicStreamSendBuffer {
 
   quiche::QuicheBufferAllocator* allocator_;
 
+  // If not null, SaveStreamData() coalesces small writes. Not owned.
+  QuicSlabBufferAllocator* slab_allocator_;
+
   // Bytes that have been consumed by the stream.
   uint64_t stream_bytes_written_;
 
@@ -4,13 +4,18 @@
 
 #include "quic/core/quic_stream_send_buffer.h"
 
+#include <algorithm>
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "quic/core/quic_data_writer.h"
+#include "quic/core/quic_slab_buffer_allocator.h"
 #include "quic/core/quic_utils.h"
 #include "quic/platform/api/quic_expect_bug.h"
 #include "quic/platform/api/quic_flags.h"
+#include "quic/platform/api/quic_logging.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/quic_stream_send_buffer_peer.h"
 #include "quic/test_tools/quic_test_utils.h"
@@ -311,6 +316,29 @@ TEST_F(QuicStreamSendBufferTest, EndOffset) {
   EXPECT_EQ(3840u, QuicStreamSendBufferPeer::EndOffset(&send_buffer_));
 }
 
+TEST_F(QuicStreamSendBufferTest, GetContiguousStreamData) {
+  absl::string_view data;
+  EXPECT_TRUE(send_buffer_.GetContiguousStreamData(0, 1000, &data));
+  EXPECT_EQ(std::string(1000, 'a'), data);
+  // Data in the rest of the first slice.
+  EXPECT_TRUE(send_buffer_.GetContiguousStreamData(1000, 24, &data));
+  EXPECT_EQ(std::string(24, 'a'), data);
+  EXPECT_EQ(1024u, QuicStreamSendBufferPeer::EndOffset(&send_buffer_));
+
+  // Data which spans two slices is not contiguous.
+  EXPECT_FALSE(send_buffer_.GetContiguousStreamData(2000, 100, &data));
+  EXPECT_EQ(std::string(24, 'a'), data);
+  EXPECT_EQ(1024u, QuicStreamSendBufferPeer::EndOffset(&send_buffer_));
+
+  char buf[100];
+  QuicDataWriter writer(100, buf, quiche::HOST_BYTE_ORDER);
+  ASSERT_TRUE(send_buffer_.WriteStreamData(2000, 100, &writer));
+  EXPECT_EQ(std::string(100, 'c'), absl::string_view(buf, 100));
+  EXPECT_TRUE(send_buffer_.GetContiguousStreamData(3072, 768, &data));
+  EXPECT_EQ(std::string(768, 'd'), data);
+  EXPECT_EQ(3840u, QuicStreamSendBufferPeer::EndOffset(&send_buffer_));
+}
+
 TEST_F(QuicStreamSendBufferTest, SaveMemSliceSpan) {
   quiche::SimpleBufferAllocator allocator;
   QuicStreamSendBuffer send_buffer(&allocator);
@@ -340,6 +368,102 @@ TEST_F(QuicStreamSendBufferTest, SaveEmptyMemSliceSpan) {
   EXPECT_EQ(10u, send_buffer.size());
 }
 
+TEST_F(QuicStreamSendBufferTest, CoalesceSmallWrites) {
+  SetQuicFlag(FLAGS_quic_send_buffer_max_data_slice_size, 1024);
+  QuicSlabBufferAllocator slab_allocator(&allocator_);
+  {
+    QuicStreamSendBuffer send_buffer(&allocator_);
+    send_buffer.set_slab_allocator(&slab_allocator);
+    send_buffer.SaveStreamData(std::string(100, 'a'));
+    send_buffer.SaveStreamData(std::string(100, 'b'));
+    EXPECT_EQ(1u, send_buffer.size());
+    EXPECT_EQ(200u, send_buffer.stream_offset());
+
+    // Data can be appended after the slice is partially written.
+    char buf[4000];
+    QuicDataWriter writer(4000, buf, quiche::HOST_BYTE_ORDER);
+    ASSERT_TRUE(send_buffer.WriteStreamData(0, 150, &writer));
+    send_buffer.OnStreamDataConsumed(150);
+    send_buffer.SaveStreamData(std::string(100, 'c'));
+    EXPECT_EQ(1u, send_buffer.size());
+    ASSERT_TRUE(send_buffer.WriteStreamData(150, 150, &writer));
+    send_buffer.OnStreamDataConsumed(150);
+    EXPECT_EQ(std::string(100, 'a') + std::string(100, 'b') +
+                  std::string(100, 'c'),
+              absl::string_view(buf, 300));
+
+    // The last slice only grows up to the maximum slice size.
+    send_buffer.SaveStreamData(std::string(1000, 'd'));
+    EXPECT_EQ(2u, send_buffer.size());
+    EXPECT_EQ(1300u, send_buffer.stream_offset());
+
+    // Mem slices are not appended to.
+    send_buffer.SaveMemSlice(MemSliceFromString(std::string(100, 'e')));
+    send_buffer.SaveStreamData(std::string(100, 'f'));
+    EXPECT_EQ(4u, send_buffer.size());
+
+    QuicDataWriter writer2(4000, buf, quiche::HOST_BYTE_ORDER);
+    ASSERT_TRUE(send_buffer.WriteStreamData(300, 1200, &writer2));
+    send_buffer.OnStreamDataConsumed(1200);
+    EXPECT_EQ(std::string(1000, 'd') + std::string(100, 'e') +
+                  std::string(100, 'f'),
+              absl::string_view(buf, 1200));
+
+    QuicByteCount newly_acked_length;
+    EXPECT_TRUE(send_buffer.OnStreamDataAcked(0, 1500, &newly_acked_length));
+    EXPECT_EQ(1500u, newly_acked_length);
+    EXPECT_EQ(0u, send_buffer.size());
+    EXPECT_EQ(0u, slab_allocator.num_buffers());
+  }
+  EXPECT_EQ(0u, slab_allocator.num_buffers());
+}
+
+// Logs the cost of many small writes, as made by RPC style applications,
+// which are sent and acked in batches, with and without a slab allocator.
+TEST_F(QuicStreamSendBufferTest, DISABLED_SmallWritesBenchmark) {
+  const size_t kNumWrites = 500000;
+  const size_t kWriteSize = 100;
+  const size_t kWritesPerBatch = 20;
+  const std::string data(kWriteSize, 'a');
+  for (bool use_slab_allocator : {false, true}) {
+    QuicSlabBufferAllocator slab_allocator(&allocator_);
+    QuicStreamSendBuffer send_buffer(&allocator_);
+    if (use_slab_allocator) {
+      send_buffer.set_slab_allocator(&slab_allocator);
+    }
+    char buf[kWriteSize * kWritesPerBatch];
+    size_t max_slices = 0;
+    QuicStreamOffset acked_offset = 0;
+    const absl::Time start = absl::Now();
+    for (size_t i = 1; i <= kNumWrites; ++i) {
+      send_buffer.SaveStreamData(data);
+      max_slices = std::max(max_slices, send_buffer.size());
+      if (i % kWritesPerBatch != 0) {
+        continue;
+      }
+      // Send the batch, and ack the previous one.
+      QuicDataWriter writer(sizeof(buf), buf, quiche::HOST_BYTE_ORDER);
+      const QuicStreamOffset offset = send_buffer.stream_bytes_written();
+      ASSERT_TRUE(
+          send_buffer.WriteStreamData(offset, sizeof(buf), &writer));
+      send_buffer.OnStreamDataConsumed(sizeof(buf));
+      if (offset > acked_offset) {
+        QuicByteCount newly_acked_length;
+        ASSERT_TRUE(send_buffer.OnStreamDataAcked(
+            acked_offset, offset - acked_offset, &newly_acked_length));
+        acked_offset = offset;
+      }
+    }
+    QUIC_LOG(INFO) << (use_slab_allocator ? "Slab allocator" : "Allocator")
+                   << ": " << kNumWrites << " writes of " << kWriteSize
+                   << " bytes took " << absl::Now() - start
+                   << ", max slices: " << max_slices
+                   << ", slab buffers in use: "
+                   << slab_allocator.num_buffers()
+                   << ", slabs: " << slab_allocator.num_slabs();
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
@@ -6,10 +6,13 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "quic/core/quic_clock.h"
@@ -36,7 +39,10 @@ QuicStreamSequencer::QuicStreamSequencer(StreamInterface* quic_stream)
       num_frames_received_(0),
       num_duplicate_frames_received_(0),
       ignore_read_data_(false),
-      level_triggered_(false) {}
+      first_slice_bytes_consumed_(0),
+      received_slices_bytes_(0),
+      level_triggered_(false),
+      receive_mem_slices_(false) {}
 
 QuicStreamSequencer::~QuicStreamSequencer() {
   if (stream_ == nullptr) {
@@ -77,20 +83,32 @@ void QuicStreamSequencer::OnFrameData(QuicStreamOffset byte_offset,
                                       size_t data_len,
                                       const char* data_buffer) {
   highest_offset_ = std::max(highest_offset_, byte_offset + data_len);
-  const size_t previous_readable_bytes = buffered_frames_.ReadableBytes();
+  const size_t previous_readable_bytes = ReadableBytes();
   size_t bytes_written;
-  std::string error_details;
-  QuicErrorCode result = buffered_frames_.OnStreamData(
-      byte_offset, absl::string_view(data_buffer, data_len), &bytes_written,
-      &error_details);
-  if (result != QUIC_NO_ERROR) {
-    std::string details =
-        absl::StrCat("Stream ", stream_->id(), ": ",
-                     QuicErrorCodeToString(result), ": ", error_details);
-    QUIC_LOG_FIRST_N(WARNING, 50) << QuicErrorCodeToString(result);
-    QUIC_LOG_FIRST_N(WARNING, 50) << details;
-    stream_->OnUnrecoverableError(result, details);
-    return;
+  if (ShouldReceiveMemSlice(byte_offset, data_len)) {
+    // |data_buffer| does not outlive this call, so the data is copied once
+    // into a slice which can be handed out as is.
+    auto buffer = std::make_unique<char[]>(data_len);
+    memcpy(buffer.get(), data_buffer, data_len);
+    received_slices_.push_back(
+        quiche::QuicheMemSlice(std::move(buffer), data_len));
+    received_slices_bytes_ += data_len;
+    buffered_frames_.MarkReceivedAndConsumed(data_len);
+    bytes_written = data_len;
+  } else {
+    std::string error_details;
+    QuicErrorCode result = buffered_frames_.OnStreamData(
+        byte_offset, absl::string_view(data_buffer, data_len), &bytes_written,
+        &error_details);
+    if (result != QUIC_NO_ERROR) {
+      std::string details =
+          absl::StrCat("Stream ", stream_->id(), ": ",
+                       QuicErrorCodeToString(result), ": ", error_details);
+      QUIC_LOG_FIRST_N(WARNING, 50) << QuicErrorCodeToString(result);
+      QUIC_LOG_FIRST_N(WARNING, 50) << details;
+      stream_->OnUnrecoverableError(result, details);
+      return;
+    }
   }
 
   if (bytes_written == 0) {
@@ -104,7 +122,7 @@ void QuicStreamSequencer::OnFrameData(QuicStreamOffset byte_offset,
   }
 
   if (level_triggered_) {
-    if (buffered_frames_.ReadableBytes() > previous_readable_bytes) {
+    if (ReadableBytes() > previous_readable_bytes) {
       // Readable bytes has changed, let stream decide if to inform application
       // or not.
       if (ignore_read_data_) {
@@ -116,7 +134,7 @@ void QuicStreamSequencer::OnFrameData(QuicStreamOffset byte_offset,
     return;
   }
   const bool stream_unblocked =
-      previous_readable_bytes == 0 && buffered_frames_.ReadableBytes() > 0;
+      previous_readable_bytes == 0 && ReadableBytes() > 0;
   if (stream_unblocked) {
     if (ignore_read_data_) {
       FlushBufferedFrames();
@@ -126,6 +144,35 @@ void QuicStreamSequencer::OnFrameData(QuicStreamOffset byte_offset,
   }
 }
 
+bool QuicStreamSequencer::ShouldReceiveMemSlice(QuicStreamOffset byte_offset,
+                                                size_t data_len) const {
+  // Only data which is readable right away, and does not need to be merged
+  // with buffered data, is received as a slice.
+  return receive_mem_slices_ && !ignore_read_data_ && data_len > 0 &&
+         byte_offset == buffered_frames_.BytesConsumed() &&
+         buffered_frames_.Empty() &&
+         received_slices_bytes_ + data_len <= kStreamReceiveWindowLimit;
+}
+
+size_t QuicStreamSequencer::ConsumeReceivedSlices(size_t num_bytes) {
+  size_t bytes_consumed = 0;
+  while (bytes_consumed < num_bytes && !received_slices_.empty()) {
+    const size_t bytes_in_slice =
+        received_slices_.front().length() - first_slice_bytes_consumed_;
+    const size_t bytes_to_consume =
+        std::min(bytes_in_slice, num_bytes - bytes_consumed);
+    bytes_consumed += bytes_to_consume;
+    if (bytes_to_consume < bytes_in_slice) {
+      first_slice_bytes_consumed_ += bytes_to_consume;
+      break;
+    }
+    received_slices_.pop_front();
+    first_slice_bytes_consumed_ = 0;
+  }
+  received_slices_bytes_ -= bytes_consumed;
+  return bytes_consumed;
+}
+
 bool QuicStreamSequencer::CloseStreamAtOffset(QuicStreamOffset offset) {
   const QuicStreamOffset kMaxOffset =
       std::numeric_limits<QuicStreamOffset>::max();
@@ -163,7 +210,7 @@ void QuicStreamSequencer::MaybeCloseStream() {
   }
 
   QUIC_DVLOG(1) << "Passing up termination, as we've processed "
-                << buffered_frames_.BytesConsumed() << " of " << close_offset_
+                << NumBytesConsumed() << " of " << close_offset_
                 << " bytes.";
   // This will cause the stream to consume the FIN.
   // Technically it's an error if |num_bytes_consumed| isn't exactly
@@ -180,18 +227,59 @@ void QuicStreamSequencer::MaybeCloseStream() {
 
 int QuicStreamSequencer::GetReadableRegions(iovec* iov, size_t iov_len) const {
   QUICHE_DCHECK(!blocked_);
-  return buffered_frames_.GetReadableRegions(iov, iov_len);
+  if (received_slices_.empty()) {
+    return buffered_frames_.GetReadableRegions(iov, iov_len);
+  }
+  size_t iov_used = 0;
+  size_t offset_in_slice = first_slice_bytes_consumed_;
+  for (const quiche::QuicheMemSlice& slice : received_slices_) {
+    if (iov_used == iov_len) {
+      return iov_used;
+    }
+    iov[iov_used].iov_base = const_cast<char*>(slice.data() + offset_in_slice);
+    iov[iov_used].iov_len = slice.length() - offset_in_slice;
+    offset_in_slice = 0;
+    ++iov_used;
+  }
+  if (iov_used < iov_len && buffered_frames_.HasBytesToRead()) {
+    iov_used += buffered_frames_.GetReadableRegions(iov + iov_used,
+                                                    iov_len - iov_used);
+  }
+  return iov_used;
 }
 
 bool QuicStreamSequencer::GetReadableRegion(iovec* iov) const {
   QUICHE_DCHECK(!blocked_);
-  return buffered_frames_.GetReadableRegion(iov);
+  if (received_slices_.empty()) {
+    return buffered_frames_.GetReadableRegion(iov);
+  }
+  const quiche::QuicheMemSlice& slice = received_slices_.front();
+  iov->iov_base = const_cast<char*>(slice.data() + first_slice_bytes_consumed_);
+  iov->iov_len = slice.length() - first_slice_bytes_consumed_;
+  return true;
 }
 
 bool QuicStreamSequencer::PeekRegion(QuicStreamOffset offset,
                                      iovec* iov) const {
   QUICHE_DCHECK(!blocked_);
-  return buffered_frames_.PeekRegion(offset, iov);
+  if (received_slices_.empty() || offset >= buffered_frames_.BytesConsumed()) {
+    return buffered_frames_.PeekRegion(offset, iov);
+  }
+  if (offset < NumBytesConsumed()) {
+    return false;
+  }
+  QuicStreamOffset slice_offset =
+      NumBytesConsumed() - first_slice_bytes_consumed_;
+  for (const quiche::QuicheMemSlice& slice : received_slices_) {
+    if (offset < slice_offset + slice.length()) {
+      iov->iov_base = const_cast<char*>(slice.data() + (offset - slice_offset));
+      iov->iov_len = slice.length() - (offset - slice_offset);
+      return true;
+    }
+    slice_offset += slice.length();
+  }
+  QUIC_NOTREACHED();
+  return false;
 }
 
 void QuicStreamSequencer::Read(std::string* buffer) {
@@ -203,12 +291,89 @@ void QuicStreamSequencer::Read(std::string* buffer) {
   Readv(&iov, 1);
 }
 
+size_t QuicStreamSequencer::ReadMemSlices(
+    std::vector<quiche::QuicheMemSlice>* slices) {
+  QUICHE_DCHECK(!blocked_);
+  size_t bytes_read = 0;
+  if (first_slice_bytes_consumed_ > 0) {
+    // Only the unconsumed part of the first slice is handed out.
+    const quiche::QuicheMemSlice& slice = received_slices_.front();
+    const size_t length = slice.length() - first_slice_bytes_consumed_;
+    auto buffer = std::make_unique<char[]>(length);
+    memcpy(buffer.get(), slice.data() + first_slice_bytes_consumed_, length);
+    slices->push_back(quiche::QuicheMemSlice(std::move(buffer), length));
+    bytes_read += length;
+    received_slices_.pop_front();
+    first_slice_bytes_consumed_ = 0;
+  }
+  for (quiche::QuicheMemSlice& slice : received_slices_) {
+    bytes_read += slice.length();
+    slices->push_back(std::move(slice));
+  }
+  received_slices_.clear();
+  received_slices_bytes_ = 0;
+
+  const size_t buffered_bytes = buffered_frames_.ReadableBytes();
+  if (buffered_bytes > 0) {
+    auto buffer = std::make_unique<char[]>(buffered_bytes);
+    iovec iov;
+    iov.iov_base = buffer.get();
+    iov.iov_len = buffered_bytes;
+    std::string error_details;
+    size_t bytes_copied;
+    QuicErrorCode read_error =
+        buffered_frames_.Readv(&iov, 1, &bytes_copied, &error_details);
+    if (read_error != QUIC_NO_ERROR) {
+      std::string details =
+          absl::StrCat("Stream ", stream_->id(), ": ", error_details);
+      stream_->OnUnrecoverableError(read_error, details);
+      return bytes_read;
+    }
+    slices->push_back(quiche::QuicheMemSlice(std::move(buffer), bytes_copied));
+    bytes_read += bytes_copied;
+  }
+
+  stream_->AddBytesConsumed(bytes_read);
+  return bytes_read;
+}
+
 size_t QuicStreamSequencer::Readv(const struct iovec* iov, size_t iov_len) {
   QUICHE_DCHECK(!blocked_);
+  size_t bytes_read_from_slices = 0;
+  absl::InlinedVector<iovec, 4> remaining_iov;
+  if (!received_slices_.empty()) {
+    // Copy data received as slices first, and read buffered data into the
+    // remaining space.
+    size_t dest_index = 0;
+    size_t dest_offset = 0;
+    while (!received_slices_.empty() && dest_index < iov_len) {
+      const quiche::QuicheMemSlice& slice = received_slices_.front();
+      const size_t bytes_to_copy =
+          std::min(slice.length() - first_slice_bytes_consumed_,
+                   iov[dest_index].iov_len - dest_offset);
+      memcpy(static_cast<char*>(iov[dest_index].iov_base) + dest_offset,
+             slice.data() + first_slice_bytes_consumed_, bytes_to_copy);
+      bytes_read_from_slices += ConsumeReceivedSlices(bytes_to_copy);
+      dest_offset += bytes_to_copy;
+      if (dest_offset == iov[dest_index].iov_len) {
+        ++dest_index;
+        dest_offset = 0;
+      }
+    }
+    remaining_iov.assign(iov + dest_index, iov + iov_len);
+    if (!remaining_iov.empty()) {
+      remaining_iov[0].iov_base =
+          static_cast<char*>(remaining_iov[0].iov_base) + dest_offset;
+      remaining_iov[0].iov_len -= dest_offset;
+    }
+    iov = remaining_iov.data();
+    iov_len = remaining_iov.size();
+  }
   std::string error_details;
   size_t bytes_read;
   QuicErrorCode read_error =
       buffered_frames_.Readv(iov, iov_len, &bytes_read, &error_details);
+  bytes_read += bytes_read_from_slices;
   if (read_error != QUIC_NO_ERROR) {
     std::string details =
         absl::StrCat("Stream ", stream_->id(), ": ", error_details);
@@ -221,20 +386,25 @@ size_t QuicStreamSequencer::Readv(const struct iovec* iov, size_t iov_len) {
 }
 
 bool QuicStreamSequencer::HasBytesToRead() const {
-  return buffered_frames_.HasBytesToRead();
+  return received_slices_bytes_ > 0 || buffered_frames_.HasBytesToRead();
 }
 
 size_t QuicStreamSequencer::ReadableBytes() const {
-  return buffered_frames_.ReadableBytes();
+  return received_slices_bytes_ + buffered_frames_.ReadableBytes();
 }
 
 bool QuicStreamSequencer::IsClosed() const {
-  return buffered_frames_.BytesConsumed() >= close_offset_;
+  return NumBytesConsumed() >= close_offset_;
 }
 
 void QuicStreamSequencer::MarkConsumed(size_t num_bytes_consumed) {
   QUICHE_DCHECK(!blocked_);
-  bool result = buffered_frames_.MarkConsumed(num_bytes_consumed);
+  const size_t bytes_consumed_from_slices =
+      num_bytes_consumed <= ReadableBytes()
+          ? ConsumeReceivedSlices(num_bytes_consumed)
+          : 0;
+  bool result = buffered_frames_.MarkConsumed(num_bytes_consumed -
+                                              bytes_consumed_from_slices);
   if (!result) {
     QUIC_BUG(quic_bug_10858_2)
         << "Invalid argument to MarkConsumed."
@@ -267,6 +437,9 @@ void QuicStreamSequencer::StopReading() {
 }
 
 void QuicStreamSequencer::ReleaseBuffer() {
+  received_slices_.clear();
+  first_slice_bytes_consumed_ = 0;
+  received_slices_bytes_ = 0;
   buffered_frames_.ReleaseWholeBuffer();
 }
 
@@ -278,20 +451,22 @@ void QuicStreamSequencer::ReleaseBufferIfEmpty() {
 
 void QuicStreamSequencer::FlushBufferedFrames() {
   QUICHE_DCHECK(ignore_read_data_);
-  size_t bytes_flushed = buffered_frames_.FlushBufferedFrames();
+  size_t bytes_flushed = ConsumeReceivedSlices(received_slices_bytes_) +
+                         buffered_frames_.FlushBufferedFrames();
   QUIC_DVLOG(1) << "Flushing buffered data at offset "
-                << buffered_frames_.BytesConsumed() << " length "
+                << NumBytesConsumed() << " length "
                 << bytes_flushed << " for stream " << stream_->id();
   stream_->AddBytesConsumed(bytes_flushed);
   MaybeCloseStream();
 }
 
 size_t QuicStreamSequencer::NumBytesBuffered() const {
-  return buffered_frames_.BytesBuffered();
+  return received_slices_bytes_ + buffered_frames_.BytesBuffered();
 }
 
 QuicStreamOffset QuicStreamSequencer::NumBytesConsumed() const {
-  return buffered_frames_.BytesConsumed();
+  // |buffered_frames_| considers data received as slices consumed already.
+  return buffered_frames_.BytesConsumed() - received_slices_bytes_;
 }
 
 const std::string QuicStreamSequencer::DebugString() const {
@@ -8,11 +8,14 @@
 #include <cstddef>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_stream_sequencer_buffer.h"
 #include "quic/core/quic_types.h"
 #include "quic/platform/api/quic_export.h"
+#include "common/platform/api/quiche_mem_slice.h"
+#include "common/quiche_circular_deque.h"
 
 namespace quic {
 
@@ -105,6 +108,13 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
   // data as consumed.
   void Read(std::string* buffer);
 
+  // Appends all of the readable data to |slices| and marks it as consumed.
+  // Data received as mem slices (see set_receive_mem_slices()) is handed out
+  // without a copy, and buffered data is copied into one more slice. The
+  // slices can be passed to another stream's WriteMemSlices(). Returns the
+  // number of bytes read.
+  size_t ReadMemSlices(std::vector<quiche::QuicheMemSlice>* slices);
+
   // Returns true if the sequncer has bytes available for reading.
   bool HasBytesToRead() const;
 
@@ -155,6 +165,16 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
 
   bool level_triggered() const { return level_triggered_; }
 
+  // If true, frames which arrive in order while nothing is buffered are copied
+  // into their own mem slice, instead of the sequencer buffer, so that
+  // ReadMemSlices() hands them out without another copy. All the read methods
+  // keep working on such data.
+  void set_receive_mem_slices(bool receive_mem_slices) {
+    receive_mem_slices_ = receive_mem_slices;
+  }
+
+  bool receive_mem_slices() const { return receive_mem_slices_; }
+
   void set_stream(StreamInterface* stream) { stream_ = stream; }
 
   // Returns string describing internal state.
@@ -181,12 +201,29 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
                    size_t data_len,
                    const char* data_buffer);
 
+  // Returns true if data at |byte_offset| should be received as a mem slice.
+  bool ShouldReceiveMemSlice(QuicStreamOffset byte_offset,
+                             size_t data_len) const;
+
+  // Consumes up to |num_bytes| bytes of |received_slices_|, and returns the
+  // number of bytes consumed.
+  size_t ConsumeReceivedSlices(size_t num_bytes);
+
   // The stream which owns this sequencer.
   StreamInterface* stream_;
 
   // Stores received data in offset order.
   QuicStreamSequencerBuffer buffered_frames_;
 
+  // Data received as mem slices which is not consumed yet, which comes right
+  // before the data in |buffered_frames_|. |buffered_frames_| considers it
+  // consumed already.
+  quiche::QuicheCircularDeque<quiche::QuicheMemSlice> received_slices_;
+  // Number of bytes of the first slice which are consumed.
+  size_t first_slice_bytes_consumed_;
+  // Number of bytes in |received_slices_| which are not consumed.
+  size_t received_slices_bytes_;
+
   // The highest offset that is received so far.
   QuicStreamOffset highest_offset_;
 
@@ -210,6 +247,9 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencer {
   // If false, only call OnDataAvailable() when it becomes newly unblocked.
   // Otherwise, call OnDataAvailable() when number of readable bytes changes.
   bool level_triggered_;
+
+  // If true, in order data can be received as mem slices.
+  bool receive_mem_slices_;
 };
 
 }  // namespace quic
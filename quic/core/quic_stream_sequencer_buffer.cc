@@ -45,7 +45,10 @@ QuicStreamSequencerBuffer::QuicStreamSequencerBuffer(size_t max_capacity_bytes)
       max_blocks_count_(CalculateBlockCount(max_capacity_bytes)),
       current_blocks_count_(0u),
       total_bytes_read_(0),
-      blocks_(nullptr) {
+      blocks_(nullptr),
+      use_contiguous_buffer_(
+          GetQuicRestartFlag(quic_contiguous_stream_sequencer_buffer)),
+      contiguous_bytes_end_(0) {
   QUICHE_DCHECK_GE(max_blocks_count_, kInitialBlockCount);
   Clear();
 }
@@ -62,6 +65,8 @@ void QuicStreamSequencerBuffer::Clear() {
       }
     }
   }
+  // There is no buffered data left to keep contiguous, so go back to blocks.
+  contiguous_buffer_.reset();
   num_bytes_buffered_ = 0;
   bytes_received_.Clear();
   bytes_received_.Add(0, total_bytes_read_);
@@ -108,6 +113,103 @@ void QuicStreamSequencerBuffer::MaybeAddMoreBlocks(
   current_blocks_count_ = new_block_count;
 }
 
+bool QuicStreamSequencerBuffer::MaybeGrowContiguousBuffer(
+    QuicStreamOffset ending_offset,
+    std::string* error_details) {
+  const QuicByteCount bytes_needed = ending_offset - total_bytes_read_;
+  // Stay in blocks until the unread data spans more than a block. Data of up
+  // to kBlockSizeBytes may still straddle a block boundary, and is then read
+  // as two regions.
+  const size_t current_size = contiguous_buffer_ == nullptr
+                                  ? kBlockSizeBytes
+                                  : contiguous_buffer_->size();
+  if (bytes_needed <= current_size) {
+    return true;
+  }
+  size_t new_size = contiguous_buffer_ == nullptr
+                        ? kInitialBlockCount * kBlockSizeBytes
+                        : kBlocksGrowthFactor * contiguous_buffer_->size();
+  new_size = std::min(std::max<size_t>(new_size, bytes_needed),
+                      max_buffer_capacity_bytes_);
+  std::unique_ptr<QuicDoubleMappedBuffer> new_buffer =
+      QuicDoubleMappedBuffer::Create(new_size);
+
+  // The data buffered at or above |total_bytes_read_|.
+  QuicIntervalSet<QuicStreamOffset> buffered_data = bytes_received_;
+  if (contiguous_buffer_ != nullptr) {
+    buffered_data.Add(total_bytes_read_, contiguous_bytes_end_);
+  } else {
+    buffered_data.Difference(0, total_bytes_read_);
+  }
+
+  if (new_buffer != nullptr) {
+    QUIC_RESTART_FLAG_COUNT(quic_contiguous_stream_sequencer_buffer);
+    for (const auto& interval : buffered_data) {
+      CopyBufferedData(interval.min(), interval.Length(),
+                       new_buffer->At(interval.min()));
+    }
+    if (contiguous_buffer_ == nullptr && blocks_ != nullptr) {
+      for (size_t i = 0; i < current_blocks_count_; ++i) {
+        if (blocks_[i] != nullptr) {
+          RetireBlock(i);
+        }
+      }
+      current_blocks_count_ = 0;
+      blocks_.reset(nullptr);
+    }
+    contiguous_buffer_ = std::move(new_buffer);
+    contiguous_bytes_end_ = total_bytes_read_;
+    if (!buffered_data.Empty() &&
+        buffered_data.begin()->min() == total_bytes_read_) {
+      contiguous_bytes_end_ = buffered_data.begin()->max();
+      buffered_data.PopFront();
+    }
+    bytes_received_ = std::move(buffered_data);
+    return true;
+  }
+
+  QUIC_DLOG(INFO) << "Falling back to blocks.";
+  use_contiguous_buffer_ = false;
+  if (contiguous_buffer_ == nullptr) {
+    return true;
+  }
+  // Move the buffered data back into blocks.
+  std::unique_ptr<QuicDoubleMappedBuffer> old_buffer =
+      std::move(contiguous_buffer_);
+  bytes_received_ = buffered_data;
+  bytes_received_.Add(0, total_bytes_read_);
+  MaybeAddMoreBlocks(ending_offset);
+  for (const auto& interval : buffered_data) {
+    size_t bytes_copy = 0;
+    if (!CopyStreamData(interval.min(),
+                        absl::string_view(old_buffer->At(interval.min()),
+                                          interval.Length()),
+                        &bytes_copy, error_details)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void QuicStreamSequencerBuffer::CopyBufferedData(QuicStreamOffset offset,
+                                                 size_t length,
+                                                 char* dest) const {
+  if (contiguous_buffer_ != nullptr) {
+    memcpy(dest, contiguous_buffer_->At(offset), length);
+    return;
+  }
+  while (length > 0) {
+    const size_t block_idx = GetBlockIndex(offset);
+    const size_t block_offset = GetInBlockOffset(offset);
+    const size_t bytes_to_copy =
+        std::min(length, GetBlockCapacity(block_idx) - block_offset);
+    memcpy(dest, blocks_[block_idx]->buffer + block_offset, bytes_to_copy);
+    dest += bytes_to_copy;
+    offset += bytes_to_copy;
+    length -= bytes_to_copy;
+  }
+}
+
 QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
     QuicStreamOffset starting_offset,
     absl::string_view data,
@@ -126,6 +228,15 @@ QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
     return QUIC_INTERNAL_ERROR;
   }
 
+  if (use_contiguous_buffer_ &&
+      !MaybeGrowContiguousBuffer(starting_offset + size, error_details)) {
+    return QUIC_STREAM_SEQUENCER_INVALID_STATE;
+  }
+  if (contiguous_buffer_ != nullptr) {
+    return OnContiguousStreamData(starting_offset, data, bytes_buffered,
+                                  error_details);
+  }
+
   if (bytes_received_.Empty() ||
       starting_offset >= bytes_received_.rbegin()->max() ||
       bytes_received_.IsDisjoint(QuicInterval<QuicStreamOffset>(
@@ -179,6 +290,54 @@ QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
   return QUIC_NO_ERROR;
 }
 
+QuicErrorCode QuicStreamSequencerBuffer::OnContiguousStreamData(
+    QuicStreamOffset starting_offset,
+    absl::string_view data,
+    size_t* const bytes_buffered,
+    std::string* error_details) {
+  const QuicStreamOffset ending_offset = starting_offset + data.size();
+  if (starting_offset == contiguous_bytes_end_ && bytes_received_.Empty()) {
+    // Fast path for data received in order, which does not need to be
+    // recorded in |bytes_received_|.
+    memcpy(contiguous_buffer_->At(starting_offset), data.data(), data.size());
+    contiguous_bytes_end_ = ending_offset;
+    *bytes_buffered = data.size();
+    num_bytes_buffered_ += data.size();
+    return QUIC_NO_ERROR;
+  }
+  if (ending_offset <= contiguous_bytes_end_) {
+    return QUIC_NO_ERROR;
+  }
+  const QuicStreamOffset new_data_offset =
+      std::max(starting_offset, contiguous_bytes_end_);
+  QuicIntervalSet<QuicStreamOffset> newly_received(new_data_offset,
+                                                   ending_offset);
+  newly_received.Difference(bytes_received_);
+  if (newly_received.Empty()) {
+    return QUIC_NO_ERROR;
+  }
+  bytes_received_.Add(new_data_offset, ending_offset);
+  if (bytes_received_.Size() >= kMaxNumDataIntervalsAllowed) {
+    // This frame is going to create more intervals than allowed. Stop
+    // processing.
+    *error_details = "Too many data intervals received for this stream.";
+    return QUIC_TOO_MANY_STREAM_DATA_INTERVALS;
+  }
+  for (const auto& interval : newly_received) {
+    memcpy(contiguous_buffer_->At(interval.min()),
+           data.data() + (interval.min() - starting_offset),
+           interval.Length());
+    *bytes_buffered += interval.Length();
+  }
+  num_bytes_buffered_ += *bytes_buffered;
+  // The data may have filled the first gap.
+  if (bytes_received_.begin()->min() == contiguous_bytes_end_) {
+    contiguous_bytes_end_ = bytes_received_.begin()->max();
+    bytes_received_.PopFront();
+  }
+  return QUIC_NO_ERROR;
+}
+
 bool QuicStreamSequencerBuffer::CopyStreamData(QuicStreamOffset offset,
                                                absl::string_view data,
                                                size_t* bytes_copy,
@@ -251,11 +410,34 @@ bool QuicStreamSequencerBuffer::CopyStreamData(QuicStreamOffset offset,
   return true;
 }
 
+void QuicStreamSequencerBuffer::MarkReceivedAndConsumed(size_t bytes) {
+  QUICHE_DCHECK(Empty());
+  const QuicStreamOffset offset = total_bytes_read_;
+  total_bytes_read_ += bytes;
+  if (contiguous_buffer_ != nullptr) {
+    contiguous_bytes_end_ = total_bytes_read_;
+    return;
+  }
+  bytes_received_.AddOptimizedForAppend(offset, total_bytes_read_);
+}
+
 QuicErrorCode QuicStreamSequencerBuffer::Readv(const iovec* dest_iov,
                                                size_t dest_count,
                                                size_t* bytes_read,
                                                std::string* error_details) {
   *bytes_read = 0;
+  if (contiguous_buffer_ != nullptr) {
+    for (size_t i = 0; i < dest_count && ReadableBytes() > 0; ++i) {
+      const size_t bytes_to_copy =
+          std::min<size_t>(ReadableBytes(), dest_iov[i].iov_len);
+      memcpy(dest_iov[i].iov_base, contiguous_buffer_->At(total_bytes_read_),
+             bytes_to_copy);
+      num_bytes_buffered_ -= bytes_to_copy;
+      total_bytes_read_ += bytes_to_copy;
+      *bytes_read += bytes_to_copy;
+    }
+    return QUIC_NO_ERROR;
+  }
   for (size_t i = 0; i < dest_count && ReadableBytes() > 0; ++i) {
     char* dest = reinterpret_cast<char*>(dest_iov[i].iov_base);
     QUICHE_DCHECK(dest != nullptr);
@@ -320,6 +502,12 @@ int QuicStreamSequencerBuffer::GetReadableRegions(struct iovec* iov,
     return 0;
   }
 
+  if (contiguous_buffer_ != nullptr) {
+    iov[0].iov_base = contiguous_buffer_->At(total_bytes_read_);
+    iov[0].iov_len = ReadableBytes();
+    return 1;
+  }
+
   size_t start_block_idx = NextBlockToRead();
   QuicStreamOffset readable_offset_end = FirstMissingByte() - 1;
   QUICHE_DCHECK_GE(readable_offset_end + 1, total_bytes_read_);
@@ -385,6 +573,12 @@ bool QuicStreamSequencerBuffer::PeekRegion(QuicStreamOffset offset,
     return false;
   }
 
+  if (contiguous_buffer_ != nullptr) {
+    iov->iov_base = contiguous_buffer_->At(offset);
+    iov->iov_len = FirstMissingByte() - offset;
+    return true;
+  }
+
   // Beginning of region.
   size_t block_idx = GetBlockIndex(offset);
   size_t block_offset = GetInBlockOffset(offset);
@@ -407,6 +601,11 @@ bool QuicStreamSequencerBuffer::MarkConsumed(size_t bytes_consumed) {
   if (bytes_consumed > ReadableBytes()) {
     return false;
   }
+  if (contiguous_buffer_ != nullptr) {
+    total_bytes_read_ += bytes_consumed;
+    num_bytes_buffered_ -= bytes_consumed;
+    return true;
+  }
   size_t bytes_to_consume = bytes_consumed;
   while (bytes_to_consume > 0) {
     size_t block_idx = NextBlockToRead();
@@ -507,6 +706,10 @@ bool QuicStreamSequencerBuffer::RetireBlockIfEmpty(size_t block_index) {
 }
 
 bool QuicStreamSequencerBuffer::Empty() const {
+  if (contiguous_buffer_ != nullptr) {
+    return bytes_received_.Empty() &&
+           contiguous_bytes_end_ == total_bytes_read_;
+  }
   return bytes_received_.Empty() ||
          (bytes_received_.Size() == 1 && total_bytes_read_ > 0 &&
           bytes_received_.begin()->max() == total_bytes_read_);
@@ -525,10 +728,17 @@ size_t QuicStreamSequencerBuffer::GetBlockCapacity(size_t block_index) const {
 }
 
 std::string QuicStreamSequencerBuffer::ReceivedFramesDebugString() const {
+  if (contiguous_buffer_ != nullptr) {
+    return absl::StrCat("[0, ", contiguous_bytes_end_, ") ",
+                        bytes_received_.ToString());
+  }
   return bytes_received_.ToString();
 }
 
 QuicStreamOffset QuicStreamSequencerBuffer::FirstMissingByte() const {
+  if (contiguous_buffer_ != nullptr) {
+    return contiguous_bytes_end_;
+  }
   if (bytes_received_.Empty() || bytes_received_.begin()->min() > 0) {
     // Offset 0 is not received yet.
     return 0;
@@ -538,7 +748,7 @@ QuicStreamOffset QuicStreamSequencerBuffer::FirstMissingByte() const {
 
 QuicStreamOffset QuicStreamSequencerBuffer::NextExpectedByte() const {
   if (bytes_received_.Empty()) {
-    return 0;
+    return contiguous_buffer_ != nullptr ? contiguous_bytes_end_ : 0;
   }
   return bytes_received_.rbegin()->max();
 }
@@ -17,6 +17,19 @@
 // - An upper limit on the number of blocks in the buffer provides an upper
 //   bound on memory use.
 //
+// When quic_restart_flag_quic_contiguous_stream_sequencer_buffer is true and
+// the platform supports it, the blocks are replaced by a double mapped
+// circular buffer (see QuicDoubleMappedBuffer) once the data from the first
+// unread byte to the end of the received data spans more than kBlockSizeBytes,
+// so that all the readable data is returned in a single iovec from then on.
+// Until then, readable data which straddles a block boundary is returned in
+// two iovecs. In double mapped mode, data received in order is not recorded in
+// the interval set. The double mapped buffer starts at kInitialBlockCount
+// blocks and grows like the block array, up to the maximum capacity. Its
+// memory is only freed when the buffer is cleared or released, so in the
+// worst case a stream keeps the largest span of data it has buffered resident
+// until then.
+//
 // This class is thread-unsafe.
 //
 // QuicStreamSequencerBuffer maintains a concept of the readable region, which
@@ -65,6 +78,7 @@
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "quic/core/quic_double_mapped_buffer.h"
 #include "quic/core/quic_interval_set.h"
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_types.h"
@@ -111,6 +125,11 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
                              size_t* bytes_buffered,
                              std::string* error_details);
 
+  // Records the next |bytes| bytes after BytesConsumed() as received and
+  // consumed, without buffering them. Must only be called when the buffer is
+  // empty.
+  void MarkReceivedAndConsumed(size_t bytes);
+
   // Reads from this buffer into given iovec array, up to number of iov_len
   // iovec objects and returns the number of bytes read.
   QuicErrorCode Readv(const struct iovec* dest_iov,
@@ -216,6 +235,25 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // next_expected_byte.
   void MaybeAddMoreBlocks(QuicStreamOffset next_expected_byte);
 
+  // Moves the buffered data into a new, larger |contiguous_buffer_| if the
+  // unread data up to |ending_offset| spans more than kBlockSizeBytes or does
+  // not fit in the current |contiguous_buffer_|. Falls back to blocks if the
+  // double mapped buffer cannot be created. Returns false if moving the data
+  // failed.
+  bool MaybeGrowContiguousBuffer(QuicStreamOffset ending_offset,
+                                 std::string* error_details);
+
+  // Copies |length| buffered bytes starting at |offset| to |dest|.
+  void CopyBufferedData(QuicStreamOffset offset,
+                        size_t length,
+                        char* dest) const;
+
+  // OnStreamData() in contiguous buffer mode.
+  QuicErrorCode OnContiguousStreamData(QuicStreamOffset starting_offset,
+                                       absl::string_view data,
+                                       size_t* bytes_buffered,
+                                       std::string* error_details);
+
   // The maximum total capacity of this buffer in byte, as constructed.
   size_t max_buffer_capacity_bytes_;
 
@@ -237,8 +275,21 @@ class QUIC_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // Number of bytes in buffer.
   size_t num_bytes_buffered_;
 
-  // Currently received data.
+  // Currently received data. In contiguous buffer mode, only contains data
+  // above |contiguous_bytes_end_|.
   QuicIntervalSet<QuicStreamOffset> bytes_received_;
+
+  // Latched value of quic_restart_flag_quic_contiguous_stream_sequencer_buffer,
+  // unless the contiguous buffer could not be created.
+  bool use_contiguous_buffer_;
+
+  // Circular buffer holding all the data in contiguous buffer mode, which is
+  // used when it is not null. Created when the buffered data no longer fits in
+  // a single block.
+  std::unique_ptr<QuicDoubleMappedBuffer> contiguous_buffer_;
+
+  // In contiguous buffer mode, the first byte which is not received.
+  QuicStreamOffset contiguous_bytes_end_;
 };
 
 }  // namespace quic
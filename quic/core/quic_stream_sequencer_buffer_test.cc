@@ -13,6 +13,8 @@
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "quic/core/quic_double_mapped_buffer.h"
+#include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_logging.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/quic_stream_sequencer_buffer_peer.h"
@@ -820,6 +822,24 @@ TEST_F(QuicStreamSequencerBufferTest, MarkConsumedAcrossEnd) {
   EXPECT_TRUE(helper_->CheckBufferInvariants());
 }
 
+TEST_F(QuicStreamSequencerBufferTest, MarkReceivedAndConsumed) {
+  buffer_->MarkReceivedAndConsumed(1024);
+  EXPECT_EQ(1024u, buffer_->BytesConsumed());
+  EXPECT_EQ(0u, buffer_->BytesBuffered());
+  EXPECT_TRUE(buffer_->Empty());
+  EXPECT_FALSE(helper_->IsBufferAllocated());
+  // Data before the marked bytes is a duplicate.
+  buffer_->OnStreamData(512, std::string(512, 'a'), &written_,
+                        &error_details_);
+  EXPECT_EQ(0u, written_);
+  // Data after them is buffered.
+  buffer_->OnStreamData(1024, std::string(100, 'b'), &written_,
+                        &error_details_);
+  EXPECT_EQ(100u, written_);
+  EXPECT_EQ(100u, buffer_->ReadableBytes());
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
 TEST_F(QuicStreamSequencerBufferTest, FlushBufferedFrames) {
   // Write into [0, 8.5 * kBlockSizeBytes - 1024) and then read out [0, 1024).
   std::string source(max_capacity_bytes_ - 1024, 'a');
@@ -861,12 +881,15 @@ TEST_F(QuicStreamSequencerBufferTest, TooManyGaps) {
   }
 }
 
+// The boolean parameter denotes whether the contiguous buffer mode is used.
 class QuicStreamSequencerBufferRandomIOTest
-    : public QuicStreamSequencerBufferTest {
+    : public QuicStreamSequencerBufferTest,
+      public ::testing::WithParamInterface<bool> {
  public:
   using OffsetSizePair = std::pair<QuicStreamOffset, size_t>;
 
   void SetUp() override {
+    SetQuicRestartFlag(quic_contiguous_stream_sequencer_buffer, GetParam());
     // Test against a larger capacity then above tests. Also make sure the last
     // block is partially available to use.
     max_capacity_bytes_ = 8.25 * kBlockSizeBytes;
@@ -952,7 +975,12 @@ class QuicStreamSequencerBufferRandomIOTest
   SimpleRandom rng_;
 };
 
-TEST_F(QuicStreamSequencerBufferRandomIOTest, RandomWriteAndReadv) {
+INSTANTIATE_TEST_SUITE_P(UseContiguousBuffer,
+                         QuicStreamSequencerBufferRandomIOTest,
+                         ::testing::Bool(),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicStreamSequencerBufferRandomIOTest, RandomWriteAndReadv) {
   // Set kMaxReadSize larger than kBlockSizeBytes to test both small and large
   // read.
   const size_t kMaxReadSize = kBlockSizeBytes * 2;
@@ -1015,7 +1043,7 @@ TEST_F(QuicStreamSequencerBufferRandomIOTest, RandomWriteAndReadv) {
   EXPECT_LE(bytes_to_buffer_, total_bytes_written_);
 }
 
-TEST_F(QuicStreamSequencerBufferRandomIOTest, RandomWriteAndConsumeInPlace) {
+TEST_P(QuicStreamSequencerBufferRandomIOTest, RandomWriteAndConsumeInPlace) {
   // The value 4 is chosen such that the max write size is no larger than the
   // maximum buffer capacity.
   const size_t kMaxNumReads = 4;
@@ -1132,6 +1160,177 @@ TEST_F(QuicStreamSequencerBufferTest, GrowBlockSizeOnDemand) {
   ASSERT_EQ(helper_->current_blocks_count(), 1024u);
 }
 
+class QuicStreamSequencerContiguousBufferTest
+    : public QuicStreamSequencerBufferTest {
+ public:
+  void SetUp() override {
+    SetQuicRestartFlag(quic_contiguous_stream_sequencer_buffer, true);
+    Initialize();
+  }
+
+ protected:
+  // Returns false if the platform does not support the contiguous buffer, in
+  // which case the buffer falls back to blocks.
+  bool IsContiguousBufferSupported() {
+    if (QuicDoubleMappedBuffer::Create(kBlockSizeBytes) == nullptr) {
+      QUIC_LOG(WARNING) << "Test skipped since double mapping is not "
+                           "supported.";
+      return false;
+    }
+    return true;
+  }
+
+  // Writes |length| bytes at |offset|, with each byte set to its offset.
+  void WriteData(QuicStreamOffset offset, size_t length) {
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+      data[i] = static_cast<char>((offset + i) % 256);
+    }
+    EXPECT_THAT(buffer_->OnStreamData(offset, data, &written_, &error_details_),
+                IsQuicNoError());
+  }
+
+  // Returns true if |iov| contains the bytes written at |offset|.
+  bool VerifyData(const iovec& iov, QuicStreamOffset offset) {
+    const char* data = reinterpret_cast<const char*>(iov.iov_base);
+    for (size_t i = 0; i < iov.iov_len; ++i) {
+      if (data[i] != static_cast<char>((offset + i) % 256)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+TEST_F(QuicStreamSequencerContiguousBufferTest, SingleReadableRegion) {
+  if (!IsContiguousBufferSupported()) {
+    return;
+  }
+  // Go around the buffer several times, leaving data across its end.
+  const size_t kWriteSize = 3 * kBlockSizeBytes;
+  QuicStreamOffset offset = 0;
+  for (int i = 0; i < 10; ++i) {
+    WriteData(offset, kWriteSize);
+    EXPECT_EQ(kWriteSize, written_);
+    offset += kWriteSize;
+    iovec iovs[3];
+    ASSERT_EQ(1, buffer_->GetReadableRegions(iovs, 3));
+    EXPECT_EQ(buffer_->ReadableBytes(), iovs[0].iov_len);
+    EXPECT_TRUE(VerifyData(iovs[0], buffer_->BytesConsumed()));
+    // Leave some data for the next iteration.
+    EXPECT_TRUE(buffer_->MarkConsumed(iovs[0].iov_len - kBlockSizeBytes));
+    EXPECT_TRUE(helper_->CheckBufferInvariants());
+  }
+  EXPECT_EQ(kBlockSizeBytes, buffer_->ReadableBytes());
+  EXPECT_EQ(0u, helper_->bytes_received().Size());
+}
+
+TEST_F(QuicStreamSequencerContiguousBufferTest, OutOfOrderAndOverlappingData) {
+  if (!IsContiguousBufferSupported()) {
+    return;
+  }
+  WriteData(200, 100);
+  WriteData(400, 100);
+  // Data more than a block ahead moves the buffered data out of the blocks.
+  const QuicStreamOffset kFarOffset = 2 * kBlockSizeBytes;
+  WriteData(kFarOffset, 100);
+  EXPECT_FALSE(helper_->IsBufferAllocated());
+  EXPECT_FALSE(buffer_->HasBytesToRead());
+  EXPECT_EQ(300u, buffer_->BytesBuffered());
+  EXPECT_EQ(3u, helper_->bytes_received().Size());
+
+  // Overlaps with [200, 300).
+  WriteData(0, 250);
+  EXPECT_EQ(200u, written_);
+  EXPECT_EQ(300u, buffer_->ReadableBytes());
+  EXPECT_EQ(2u, helper_->bytes_received().Size());
+  // Duplicate data.
+  WriteData(100, 50);
+  EXPECT_EQ(0u, written_);
+
+  iovec iov;
+  ASSERT_TRUE(buffer_->PeekRegion(100, &iov));
+  EXPECT_EQ(200u, iov.iov_len);
+  EXPECT_TRUE(VerifyData(iov, 100));
+  EXPECT_FALSE(buffer_->PeekRegion(300, &iov));
+
+  char dest[120];
+  iovec dest_iovs[2] = {{dest, 20}, {dest + 20, 100}};
+  size_t bytes_read;
+  EXPECT_THAT(buffer_->Readv(dest_iovs, 2, &bytes_read, &error_details_),
+              IsQuicNoError());
+  EXPECT_EQ(120u, bytes_read);
+  EXPECT_TRUE(VerifyData(iovec{dest, 120}, 0));
+
+  // Fill the gap.
+  WriteData(300, 100);
+  EXPECT_EQ(380u, buffer_->ReadableBytes());
+  EXPECT_EQ(1u, helper_->bytes_received().Size());
+  EXPECT_EQ(kFarOffset + 100 - 120, buffer_->FlushBufferedFrames());
+  EXPECT_TRUE(buffer_->Empty());
+  EXPECT_EQ(kFarOffset + 100, buffer_->BytesConsumed());
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
+TEST_F(QuicStreamSequencerContiguousBufferTest, SmallDataStaysInBlocks) {
+  if (!IsContiguousBufferSupported()) {
+    return;
+  }
+  for (int i = 0; i < 10; ++i) {
+    WriteData(i * 1000, 1000);
+    EXPECT_TRUE(buffer_->MarkConsumed(1000));
+    EXPECT_TRUE(helper_->IsBufferAllocated());
+  }
+  // Only data which does not fit in a block needs the double mapped buffer.
+  WriteData(10000, kBlockSizeBytes + 1);
+  EXPECT_FALSE(helper_->IsBufferAllocated());
+  iovec iov;
+  ASSERT_TRUE(buffer_->GetReadableRegion(&iov));
+  EXPECT_EQ(kBlockSizeBytes + 1, iov.iov_len);
+  EXPECT_TRUE(VerifyData(iov, 10000));
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
+TEST_F(QuicStreamSequencerContiguousBufferTest, GrowContiguousBuffer) {
+  if (!IsContiguousBufferSupported()) {
+    return;
+  }
+  WriteData(0, 2 * kBlockSizeBytes);
+  // Beyond the initial size of the double mapped buffer.
+  const QuicStreamOffset kFarOffset = max_capacity_bytes_ - 100;
+  WriteData(kFarOffset, 100);
+  EXPECT_EQ(2 * kBlockSizeBytes + 100, buffer_->BytesBuffered());
+
+  iovec iovs[2];
+  ASSERT_EQ(1, buffer_->GetReadableRegions(iovs, 2));
+  EXPECT_EQ(2 * kBlockSizeBytes, iovs[0].iov_len);
+  EXPECT_TRUE(VerifyData(iovs[0], 0));
+  EXPECT_TRUE(buffer_->MarkConsumed(2 * kBlockSizeBytes));
+
+  WriteData(2 * kBlockSizeBytes, kFarOffset - 2 * kBlockSizeBytes);
+  ASSERT_EQ(1, buffer_->GetReadableRegions(iovs, 2));
+  EXPECT_EQ(kFarOffset + 100 - 2 * kBlockSizeBytes, iovs[0].iov_len);
+  EXPECT_TRUE(VerifyData(iovs[0], 2 * kBlockSizeBytes));
+  EXPECT_TRUE(helper_->CheckBufferInvariants());
+}
+
+TEST_F(QuicStreamSequencerContiguousBufferTest, ReleaseWholeBuffer) {
+  if (!IsContiguousBufferSupported()) {
+    return;
+  }
+  WriteData(0, 2 * kBlockSizeBytes);
+  EXPECT_FALSE(helper_->IsBufferAllocated());
+  EXPECT_TRUE(buffer_->MarkConsumed(2 * kBlockSizeBytes));
+  buffer_->ReleaseWholeBuffer();
+  // New data goes into blocks again.
+  WriteData(2 * kBlockSizeBytes, 1024);
+  EXPECT_TRUE(helper_->IsBufferAllocated());
+  iovec iov;
+  ASSERT_TRUE(buffer_->GetReadableRegion(&iov));
+  EXPECT_EQ(1024u, iov.iov_len);
+  EXPECT_TRUE(VerifyData(iov, 2 * kBlockSizeBytes));
+}
+
 }  // anonymous namespace
 
 }  // namespace test
@@ -14,6 +14,7 @@
 #include "quic/core/crypto/quic_decrypter.h"
 #include "quic/core/crypto/quic_encrypter.h"
 #include "quic/core/quic_clock.h"
+#include "quic/core/quic_compact_time_wait_list.h"
 #include "quic/core/quic_connection_id.h"
 #include "quic/core/quic_framer.h"
 #include "quic/core/quic_packets.h"
@@ -47,6 +48,14 @@ class ConnectionIdCleanUpAlarm : public QuicAlarm::DelegateWithoutContext {
   QuicTimeWaitListManager* time_wait_list_manager_;
 };
 
+bool TerminationPacketTemplate::operator==(
+    const TerminationPacketTemplate& other) const {
+  return type == other.type && version == other.version &&
+         error_code == other.error_code &&
+         error_details == other.error_details &&
+         use_length_prefix == other.use_length_prefix;
+}
+
 TimeWaitConnectionInfo::TimeWaitConnectionInfo(
     bool ietf_quic,
     std::vector<std::unique_ptr<QuicEncryptedPacket>>* termination_packets,
@@ -80,7 +89,15 @@ QuicTimeWaitListManager::QuicTimeWaitListManager(
           alarm_factory->CreateAlarm(new ConnectionIdCleanUpAlarm(this))),
       clock_(clock),
       writer_(writer),
-      visitor_(visitor) {
+      visitor_(visitor),
+      batch_writes_(GetQuicRestartFlag(quic_batch_time_wait_list_writes)),
+      rate_limit_packets_(
+          GetQuicRestartFlag(quic_rate_limit_time_wait_list_packets)) {
+  if (GetQuicRestartFlag(quic_compact_time_wait_list)) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_compact_time_wait_list, 1, 3);
+    compact_time_wait_list_ =
+        std::make_unique<QuicCompactTimeWaitList>(time_wait_period_);
+  }
   SetConnectionIdCleanUpAlarm();
 }
 
@@ -127,8 +144,35 @@ void QuicTimeWaitListManager::AddConnectionIdToTimeWait(
   const QuicConnectionId& canonical_connection_id =
       info.active_connection_ids.front();
   QUICHE_DCHECK(action != SEND_TERMINATION_PACKETS ||
-                !info.termination_packets.empty());
+                !info.termination_packets.empty() ||
+                info.termination_packet_template.has_value());
   QUICHE_DCHECK(action != DO_NOTHING || info.ietf_quic);
+  if (compact_time_wait_list_ != nullptr) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_compact_time_wait_list, 2, 3);
+    int num_packets = 0;
+    QuicCompactTimeWaitList::Connection* connection =
+        compact_time_wait_list_->Find(canonical_connection_id);
+    const bool new_connection_id = connection == nullptr;
+    if (!new_connection_id) {  // Replace record if it is reinserted.
+      num_packets = connection->num_packets;
+      compact_time_wait_list_->Remove(canonical_connection_id);
+    }
+    TrimTimeWaitListIfNeeded();
+    if (new_connection_id) {
+      for (const auto& cid : info.active_connection_ids) {
+        visitor_->OnConnectionAddedToTimeWaitList(cid);
+      }
+    }
+    compact_time_wait_list_->Add(clock_->ApproximateNow(), num_packets,
+                                 action, std::move(info));
+    return;
+  }
+  if (info.termination_packet_template.has_value() &&
+      info.termination_packets.empty()) {
+    BuildTerminationPackets(*info.termination_packet_template,
+                            canonical_connection_id, info.ietf_quic,
+                            &info.termination_packets);
+  }
   int num_packets = 0;
   auto it = FindConnectionIdDataInMap(canonical_connection_id);
   const bool new_connection_id = it == connection_id_map_.end();
@@ -152,11 +196,27 @@ void QuicTimeWaitListManager::AddConnectionIdToTimeWait(
 
 bool QuicTimeWaitListManager::IsConnectionIdInTimeWait(
     QuicConnectionId connection_id) const {
+  if (compact_time_wait_list_ != nullptr) {
+    return compact_time_wait_list_->Contains(connection_id);
+  }
   return indirect_connection_id_map_.contains(connection_id);
 }
 
+size_t QuicTimeWaitListManager::num_connections() const {
+  if (compact_time_wait_list_ != nullptr) {
+    return compact_time_wait_list_->size();
+  }
+  return connection_id_map_.size();
+}
+
 void QuicTimeWaitListManager::OnBlockedWriterCanWrite() {
   writer_->SetWritable();
+  if (has_unflushed_writes_) {
+    FlushWrites();
+    if (writer_->IsWriteBlocked()) {
+      return;
+    }
+  }
   while (!pending_packets_queue_.empty()) {
     QueuedPacket* queued_packet = pending_packets_queue_.front().get();
     if (!WriteToWire(queued_packet)) {
@@ -166,6 +226,32 @@ void QuicTimeWaitListManager::OnBlockedWriterCanWrite() {
   }
 }
 
+void QuicTimeWaitListManager::FlushWrites() {
+  if (!has_unflushed_writes_) {
+    return;
+  }
+  QUIC_RESTART_FLAG_COUNT_N(quic_batch_time_wait_list_writes, 2, 3);
+  if (writer_->IsWriteBlocked()) {
+    // Another user of the writer got it blocked.
+    visitor_->OnWriteBlocked(this);
+    return;
+  }
+  WriteResult result = writer_->Flush();
+  if (IsWriteBlockedStatus(result.status)) {
+    // The writer keeps the packets it has not written, so flush again once it
+    // is writable.
+    QUICHE_DCHECK(writer_->IsWriteBlocked());
+    visitor_->OnWriteBlocked(this);
+    return;
+  }
+  has_unflushed_writes_ = false;
+  if (IsWriteError(result.status)) {
+    QUIC_LOG_FIRST_N(WARNING, 1)
+        << "Received unknown error while flushing termination packets: "
+        << strerror(result.error_code);
+  }
+}
+
 void QuicTimeWaitListManager::ProcessPacket(
     const QuicSocketAddress& self_address,
     const QuicSocketAddress& peer_address,
@@ -176,60 +262,100 @@ void QuicTimeWaitListManager::ProcessPacket(
   QUICHE_DCHECK(IsConnectionIdInTimeWait(connection_id));
   // TODO(satyamshekhar): Think about handling packets from different peer
   // addresses.
-  auto it = FindConnectionIdDataInMap(connection_id);
-  QUICHE_DCHECK(it != connection_id_map_.end());
-  // Increment the received packet count.
-  ConnectionIdData* connection_data = &it->second;
-  ++(connection_data->num_packets);
+  int num_packets;
+  QuicTime time_added = QuicTime::Zero();
+  QuicTime::Delta srtt = QuicTime::Delta::Zero();
+  TimeWaitAction action;
+  bool ietf_quic;
+  // Only used by the compact time-wait list, which does not store termination
+  // packets as such.
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> built_termination_packets;
+  const std::vector<std::unique_ptr<QuicEncryptedPacket>>* termination_packets =
+      &built_termination_packets;
+  QuicCompactTimeWaitList::Connection* compact_connection = nullptr;
+  if (compact_time_wait_list_ != nullptr) {
+    compact_connection = compact_time_wait_list_->Find(connection_id);
+    QUICHE_DCHECK(compact_connection != nullptr);
+    // Increment the received packet count.
+    num_packets = ++compact_connection->num_packets;
+    time_added = compact_connection->time_added;
+    srtt = compact_connection->srtt;
+    action = compact_connection->action;
+    ietf_quic = compact_connection->ietf_quic;
+  } else {
+    auto it = FindConnectionIdDataInMap(connection_id);
+    QUICHE_DCHECK(it != connection_id_map_.end());
+    // Increment the received packet count.
+    ConnectionIdData* connection_data = &it->second;
+    num_packets = ++(connection_data->num_packets);
+    time_added = connection_data->time_added;
+    srtt = connection_data->info.srtt;
+    action = connection_data->action;
+    ietf_quic = connection_data->info.ietf_quic;
+    termination_packets = &connection_data->info.termination_packets;
+  }
   const QuicTime now = clock_->ApproximateNow();
   QuicTime::Delta delta = QuicTime::Delta::Zero();
-  if (now > connection_data->time_added) {
-    delta = now - connection_data->time_added;
+  if (now > time_added) {
+    delta = now - time_added;
   }
-  OnPacketReceivedForKnownConnection(connection_data->num_packets, delta,
-                                     connection_data->info.srtt);
+  OnPacketReceivedForKnownConnection(num_packets, delta, srtt);
 
-  if (!ShouldSendResponse(connection_data->num_packets)) {
+  if (!ShouldSendResponse(num_packets)) {
     QUIC_DLOG(INFO) << "Processing " << connection_id << " in time wait state: "
                     << "throttled";
     return;
   }
 
+  if (compact_connection != nullptr &&
+      (action == SEND_TERMINATION_PACKETS ||
+       action == SEND_CONNECTION_CLOSE_PACKETS)) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_compact_time_wait_list, 3, 3);
+    const TerminationPacketTemplate* termination_template =
+        compact_time_wait_list_->GetTemplate(*compact_connection);
+    if (termination_template != nullptr) {
+      BuildTerminationPackets(*termination_template,
+                              compact_connection->canonical_connection_id,
+                              ietf_quic, &built_termination_packets);
+    } else {
+      compact_time_wait_list_->CopyTerminationPackets(
+          *compact_connection, &built_termination_packets);
+    }
+  }
+
   QUIC_DLOG(INFO) << "Processing " << connection_id << " in time wait state: "
                   << "header format=" << header_format
-                  << " ietf=" << connection_data->info.ietf_quic
-                  << ", action=" << connection_data->action
+                  << " ietf=" << ietf_quic << ", action=" << action
                   << ", number termination packets="
-                  << connection_data->info.termination_packets.size();
-  switch (connection_data->action) {
+                  << termination_packets->size();
+  switch (action) {
     case SEND_TERMINATION_PACKETS:
-      if (connection_data->info.termination_packets.empty()) {
+      if (termination_packets->empty()) {
         QUIC_BUG(quic_bug_10608_1) << "There are no termination packets.";
         return;
       }
       switch (header_format) {
         case IETF_QUIC_LONG_HEADER_PACKET:
-          if (!connection_data->info.ietf_quic) {
+          if (!ietf_quic) {
             QUIC_CODE_COUNT(quic_received_long_header_packet_for_gquic);
           }
           break;
         case IETF_QUIC_SHORT_HEADER_PACKET:
-          if (!connection_data->info.ietf_quic) {
+          if (!ietf_quic) {
             QUIC_CODE_COUNT(quic_received_short_header_packet_for_gquic);
           }
           // Send stateless reset in response to short header packets.
-          SendPublicReset(self_address, peer_address, connection_id,
-                          connection_data->info.ietf_quic,
+          SendPublicReset(self_address, peer_address, connection_id, ietf_quic,
                           received_packet_length, std::move(packet_context));
           return;
         case GOOGLE_QUIC_PACKET:
-          if (connection_data->info.ietf_quic) {
+          if (ietf_quic) {
             QUIC_CODE_COUNT(quic_received_gquic_packet_for_ietf_quic);
           }
           break;
       }
 
-      for (const auto& packet : connection_data->info.termination_packets) {
+      for (const auto& packet : *termination_packets) {
         SendOrQueuePacket(std::make_unique<QueuedPacket>(
                               self_address, peer_address, packet->Clone()),
                           packet_context.get());
@@ -237,11 +363,11 @@ void QuicTimeWaitListManager::ProcessPacket(
       return;
 
     case SEND_CONNECTION_CLOSE_PACKETS:
-      if (connection_data->info.termination_packets.empty()) {
+      if (termination_packets->empty()) {
         QUIC_BUG(quic_bug_10608_2) << "There are no termination packets.";
         return;
       }
-      for (const auto& packet : connection_data->info.termination_packets) {
+      for (const auto& packet : *termination_packets) {
         SendOrQueuePacket(std::make_unique<QueuedPacket>(
                               self_address, peer_address, packet->Clone()),
                           packet_context.get());
@@ -252,13 +378,12 @@ void QuicTimeWaitListManager::ProcessPacket(
       if (header_format == IETF_QUIC_LONG_HEADER_PACKET) {
         QUIC_CODE_COUNT(quic_stateless_reset_long_header_packet);
       }
-      SendPublicReset(self_address, peer_address, connection_id,
-                      connection_data->info.ietf_quic, received_packet_length,
-                      std::move(packet_context));
+      SendPublicReset(self_address, peer_address, connection_id, ietf_quic,
+                      received_packet_length, std::move(packet_context));
       return;
     case DO_NOTHING:
       QUIC_CODE_COUNT(quic_time_wait_list_do_nothing);
-      QUICHE_DCHECK(connection_data->info.ietf_quic);
+      QUICHE_DCHECK(ietf_quic);
   }
 }
 
@@ -352,6 +477,24 @@ std::unique_ptr<QuicEncryptedPacket> QuicTimeWaitListManager::BuildPublicReset(
   return QuicFramer::BuildPublicResetPacket(packet);
 }
 
+void QuicTimeWaitListManager::BuildTerminationPackets(
+    const TerminationPacketTemplate& termination_template,
+    QuicConnectionId connection_id,
+    bool ietf_quic,
+    std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+  switch (termination_template.type) {
+    case TerminationPacketTemplate::CONNECTION_CLOSE:
+      visitor_->BuildConnectionClosePacket(termination_template, connection_id,
+                                           packets);
+      return;
+    case TerminationPacketTemplate::VERSION_NEGOTIATION:
+      packets->push_back(QuicFramer::BuildVersionNegotiationPacket(
+          connection_id, EmptyQuicConnectionId(), ietf_quic,
+          termination_template.use_length_prefix, /*versions=*/{}));
+      return;
+  }
+}
+
 std::unique_ptr<QuicEncryptedPacket>
 QuicTimeWaitListManager::BuildIetfStatelessResetPacket(
     QuicConnectionId connection_id,
@@ -376,6 +519,10 @@ bool QuicTimeWaitListManager::SendOrQueuePacket(
     QUIC_CODE_COUNT(quic_too_many_pending_packets_in_time_wait);
     return true;
   }
+  if (rate_limit_packets_ && !AllowPacketTo(packet->peer_address())) {
+    QUIC_CODE_COUNT(quic_time_wait_list_packet_rate_limited);
+    return true;
+  }
   if (WriteToWire(packet.get())) {
     // Allow the packet to be deleted upon leaving this function.
     return true;
@@ -394,9 +541,15 @@ bool QuicTimeWaitListManager::WriteToWire(QueuedPacket* queued_packet) {
       queued_packet->self_address().host(), queued_packet->peer_address(),
       nullptr);
 
-  // If using a batch writer and the packet is buffered, flush it.
+  // If using a batch writer and the packet is buffered, flush it, unless the
+  // dispatcher calls FlushWrites() at the end of the read loop.
   if (writer_->IsBatchMode() && result.status == WRITE_STATUS_OK &&
       result.bytes_written == 0) {
+    if (batch_writes_) {
+      QUIC_RESTART_FLAG_COUNT_N(quic_batch_time_wait_list_writes, 1, 3);
+      has_unflushed_writes_ = true;
+      return true;
+    }
     result = writer_->Flush();
   }
 
@@ -414,7 +567,49 @@ bool QuicTimeWaitListManager::WriteToWire(QueuedPacket* queued_packet) {
   return true;
 }
 
+bool QuicTimeWaitListManager::AllowPacketTo(
+    const QuicSocketAddress& peer_address) {
+  QUIC_RESTART_FLAG_COUNT(quic_rate_limit_time_wait_list_packets);
+  const QuicTime now = clock_->ApproximateNow();
+  const QuicTime::Delta interval = QuicTime::Delta::FromMilliseconds(
+      GetQuicFlag(FLAGS_quic_time_wait_list_rate_limit_interval_ms));
+  // Sources are in the order their interval started, so the expired ones are
+  // at the front.
+  while (!packets_per_source_.empty() &&
+         packets_per_source_.front().second.interval_start + interval <= now) {
+    packets_per_source_.pop_front();
+  }
+  const QuicSocketAddress source(peer_address.host(), 0);
+  auto it = packets_per_source_.find(source);
+  if (it == packets_per_source_.end()) {
+    if (packets_per_source_.size() >=
+        GetQuicFlag(FLAGS_quic_time_wait_list_max_rate_limited_sources)) {
+      // Forget the oldest source rather than dropping packets to new ones.
+      QUIC_CODE_COUNT(quic_time_wait_list_rate_limited_source_evicted);
+      packets_per_source_.pop_front();
+    }
+    it = packets_per_source_.emplace(source, SourcePacketCount{now, 0}).first;
+  }
+  if (it->second.num_packets >=
+      GetQuicFlag(FLAGS_quic_time_wait_list_max_packets_per_source)) {
+    return false;
+  }
+  ++it->second.num_packets;
+  return true;
+}
+
 void QuicTimeWaitListManager::SetConnectionIdCleanUpAlarm() {
+  if (compact_time_wait_list_ != nullptr) {
+    // Connections are expired in batches, once the whole oldest slot of the
+    // timing wheel has expired.
+    QuicTime next_alarm_time = compact_time_wait_list_->NextExpirationTime();
+    if (!next_alarm_time.IsInitialized()) {
+      next_alarm_time = clock_->ApproximateNow() + time_wait_period_;
+    }
+    connection_id_clean_up_alarm_->Update(next_alarm_time,
+                                          QuicTime::Delta::Zero());
+    return;
+  }
   QuicTime::Delta next_alarm_interval = QuicTime::Delta::Zero();
   if (!connection_id_map_.empty()) {
     QuicTime oldest_connection_id =
@@ -437,6 +632,17 @@ void QuicTimeWaitListManager::SetConnectionIdCleanUpAlarm() {
 
 bool QuicTimeWaitListManager::MaybeExpireOldestConnection(
     QuicTime expiration_time) {
+  if (compact_time_wait_list_ != nullptr) {
+    if (!compact_time_wait_list_->MaybeRemoveOldest(expiration_time)) {
+      return false;
+    }
+    if (expiration_time == QuicTime::Infinite()) {
+      QUIC_CODE_COUNT(quic_time_wait_list_trim_full);
+    } else {
+      QUIC_CODE_COUNT(quic_time_wait_list_expire_connections);
+    }
+    return true;
+  }
   if (connection_id_map_.empty()) {
     return false;
   }
@@ -474,7 +680,7 @@ void QuicTimeWaitListManager::TrimTimeWaitListIfNeeded() {
   if (kMaxConnections < 0) {
     return;
   }
-  while (!connection_id_map_.empty() &&
+  while (num_connections() > 0 &&
          num_connections() >= static_cast<size_t>(kMaxConnections)) {
     MaybeExpireOldestConnection(QuicTime::Infinite());
   }
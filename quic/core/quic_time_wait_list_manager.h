@@ -10,8 +10,10 @@
 
 #include <cstddef>
 #include <memory>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/optional.h"
 #include "quic/core/quic_blocked_writer_interface.h"
 #include "quic/core/quic_connection_id.h"
 #include "quic/core/quic_framer.h"
@@ -20,6 +22,7 @@
 #include "quic/core/quic_session.h"
 #include "quic/core/quic_types.h"
 #include "quic/platform/api/quic_flags.h"
+#include "quic/platform/api/quic_socket_address.h"
 #include "common/quiche_linked_hash_map.h"
 
 namespace quic {
@@ -29,6 +32,38 @@ class QuicDispatcherPeer;
 class QuicTimeWaitListManagerPeer;
 }  // namespace test
 
+class QuicCompactTimeWaitList;
+
+// Describes termination packets which only depend on the connection ID they
+// are sent for, so that they can be rebuilt when needed rather than stored.
+struct QUIC_NO_EXPORT TerminationPacketTemplate {
+  enum Type : uint8_t {
+    // A packet containing a CONNECTION_CLOSE frame specifying |error_code| and
+    // |error_details|, encrypted with the initial keys of |version|. Built by
+    // the Visitor of the QuicTimeWaitListManager.
+    CONNECTION_CLOSE,
+    // A version negotiation packet with an empty version list.
+    VERSION_NEGOTIATION,
+  };
+
+  bool operator==(const TerminationPacketTemplate& other) const;
+
+  template <typename H>
+  friend H AbslHashValue(H h, const TerminationPacketTemplate& t) {
+    return H::combine(std::move(h), t.type, t.version.handshake_protocol,
+                      t.version.transport_version, t.error_code,
+                      t.error_details, t.use_length_prefix);
+  }
+
+  Type type = CONNECTION_CLOSE;
+  // Only used by CONNECTION_CLOSE.
+  ParsedQuicVersion version = UnsupportedQuicVersion();
+  QuicErrorCode error_code = QUIC_NO_ERROR;
+  std::string error_details;
+  // Only used by VERSION_NEGOTIATION.
+  bool use_length_prefix = false;
+};
+
 // TimeWaitConnectionInfo comprises information of a connection which is in the
 // time wait list.
 struct QUIC_NO_EXPORT TimeWaitConnectionInfo {
@@ -49,6 +84,9 @@ struct QUIC_NO_EXPORT TimeWaitConnectionInfo {
 
   bool ietf_quic;
   std::vector<std::unique_ptr<QuicEncryptedPacket>> termination_packets;
+  // If set, termination packets are built from this template for the first
+  // active connection ID, instead of being provided.
+  absl::optional<TerminationPacketTemplate> termination_packet_template;
   std::vector<QuicConnectionId> active_connection_ids;
   QuicTime::Delta srtt;
 };
@@ -85,6 +123,13 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
     // Called after the given connection is added to the time-wait list.
     virtual void OnConnectionAddedToTimeWaitList(
         QuicConnectionId connection_id) = 0;
+
+    // Appends to |packets| the CONNECTION_CLOSE packet described by
+    // |termination_template| for |connection_id|.
+    virtual void BuildConnectionClosePacket(
+        const TerminationPacketTemplate& termination_template,
+        QuicConnectionId connection_id,
+        std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) = 0;
   };
 
   // writer - the entity that writes to the socket. (Owned by the caller)
@@ -133,6 +178,11 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   // send because the underlying socket was write blocked.
   void OnBlockedWriterCanWrite() override;
 
+  // Flushes the packets which the writer buffered since the last flush. Only
+  // needed if quic_restart_flag_quic_batch_time_wait_list_writes is true, in
+  // which case packets are left in the batch writer until this is called.
+  void FlushWrites();
+
   bool IsWriterBlocked() const override {
     return writer_ != nullptr && writer_->IsWriteBlocked();
   }
@@ -146,7 +196,7 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   void TrimTimeWaitListIfNeeded();
 
   // The number of connections on the time-wait list.
-  size_t num_connections() const { return connection_id_map_.size(); }
+  size_t num_connections() const;
 
   // Sends a version negotiation packet for |server_connection_id| and
   // |client_connection_id| announcing support for |supported_versions| to
@@ -242,6 +292,10 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   // packet.
   bool WriteToWire(QueuedPacket* packet);
 
+  // Returns true, and counts the packet, if a packet may be sent to the IP
+  // address of |peer_address| in its current rate limiting interval.
+  bool AllowPacketTo(const QuicSocketAddress& peer_address);
+
   // Register the alarm server to wake up at appropriate time.
   void SetConnectionIdCleanUpAlarm();
 
@@ -264,6 +318,14 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
       QuicConnectionId connection_id,
       size_t received_packet_length);
 
+  // Appends to |packets| the termination packets described by
+  // |termination_template| for |connection_id|.
+  void BuildTerminationPackets(
+      const TerminationPacketTemplate& termination_template,
+      QuicConnectionId connection_id,
+      bool ietf_quic,
+      std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets);
+
   // A map from a recently closed connection_id to the number of packets
   // received after the termination of the connection bound to the
   // connection_id.
@@ -316,6 +378,10 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
   // Removes a ConnectionIdData entry in connection_id_map_.
   void RemoveConnectionDataFromMap(ConnectionIdMap::iterator it);
 
+  // Replaces |connection_id_map_| and |indirect_connection_id_map_| if the
+  // compact time-wait list is enabled.
+  std::unique_ptr<QuicCompactTimeWaitList> compact_time_wait_list_;
+
   // Pending termination packets that need to be sent out to the peer when we
   // are given a chance to write by the dispatcher.
   quiche::QuicheCircularDeque<std::unique_ptr<QueuedPacket>>
@@ -336,6 +402,28 @@ class QUIC_NO_EXPORT QuicTimeWaitListManager
 
   // Interface that manages blocked writers.
   Visitor* visitor_;
+
+  // Latched value of quic_restart_flag_quic_batch_time_wait_list_writes.
+  const bool batch_writes_;
+
+  // True if the writer may hold packets buffered since the last flush.
+  bool has_unflushed_writes_ = false;
+
+  // Latched value of quic_restart_flag_quic_rate_limit_time_wait_list_packets.
+  const bool rate_limit_packets_;
+
+  struct QUIC_NO_EXPORT SourcePacketCount {
+    QuicTime interval_start;
+    uint64_t num_packets;
+  };
+
+  // Number of packets sent to each IP address, stored with a zero port, in the
+  // rate limiting interval which started with the first packet sent to it, in
+  // the order the intervals started.
+  quiche::QuicheLinkedHashMap<QuicSocketAddress,
+                              SourcePacketCount,
+                              QuicSocketAddressHash>
+      packets_per_source_;
 };
 
 }  // namespace quic
@@ -13,6 +13,7 @@
 #include "quic/core/crypto/null_encrypter.h"
 #include "quic/core/crypto/quic_decrypter.h"
 #include "quic/core/crypto/quic_encrypter.h"
+#include "quic/core/quic_compact_time_wait_list.h"
 #include "quic/core/quic_connection_id.h"
 #include "quic/core/quic_data_reader.h"
 #include "quic/core/quic_framer.h"
@@ -30,6 +31,7 @@ using testing::_;
 using testing::Args;
 using testing::Assign;
 using testing::DoAll;
+using testing::InSequence;
 using testing::Matcher;
 using testing::NiceMock;
 using testing::Return;
@@ -783,6 +785,347 @@ TEST_F(QuicTimeWaitListManagerTest, TooManyPendingPackets) {
                     &time_wait_list_manager_));
 }
 
+// Appends a packet of |length| bytes to |packets|.
+void AppendPacket(size_t length,
+                  std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+  packets->push_back(std::make_unique<QuicEncryptedPacket>(
+      new char[length], length, /*owns_buffer=*/true));
+}
+
+TEST_F(QuicTimeWaitListManagerTest, TemplatedPacketsAreBuiltWhenAdded) {
+  const size_t kConnectionCloseLength = 100;
+  TimeWaitConnectionInfo info(/*ietf_quic=*/true, nullptr, {connection_id_});
+  info.termination_packet_template.emplace();
+  info.termination_packet_template->error_code = QUIC_HANDSHAKE_FAILED;
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(connection_id_));
+  EXPECT_CALL(visitor_,
+              BuildConnectionClosePacket(*info.termination_packet_template,
+                                         connection_id_, _))
+      .WillOnce(testing::WithArg<2>(
+          [](std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+            AppendPacket(kConnectionCloseLength, packets);
+          }));
+  time_wait_list_manager_.AddConnectionIdToTimeWait(
+      QuicTimeWaitListManager::SEND_TERMINATION_PACKETS, std::move(info));
+
+  // The stored packet is sent without building it again.
+  EXPECT_CALL(writer_, WritePacket(_, kConnectionCloseLength,
+                                   self_address_.host(), peer_address_, _))
+      .Times(2)
+      .WillRepeatedly(Return(WriteResult(WRITE_STATUS_OK, 1)));
+  ProcessPacket(connection_id_);
+  ProcessPacket(connection_id_);
+}
+
+class QuicCompactTimeWaitListManagerTest : public QuicTimeWaitListManagerTest {
+ protected:
+  QuicCompactTimeWaitListManagerTest() {
+    SetQuicRestartFlag(quic_compact_time_wait_list, true);
+    compact_manager_ = std::make_unique<QuicTimeWaitListManager>(
+        &writer_, &visitor_, &clock_, &alarm_factory_);
+  }
+
+  void AddCompactConnectionId(QuicConnectionId connection_id) {
+    compact_manager_->AddConnectionIdToTimeWait(
+        QuicTimeWaitListManager::SEND_STATELESS_RESET,
+        TimeWaitConnectionInfo(/*ietf_quic=*/true, nullptr, {connection_id}));
+  }
+
+  void ProcessPacket(QuicConnectionId connection_id) {
+    compact_manager_->ProcessPacket(
+        self_address_, peer_address_, connection_id,
+        IETF_QUIC_LONG_HEADER_PACKET, kTestPacketSize,
+        std::make_unique<QuicPerPacketContext>());
+  }
+
+  std::unique_ptr<QuicTimeWaitListManager> compact_manager_;
+};
+
+TEST_F(QuicCompactTimeWaitListManagerTest, SendConnectionCloses) {
+  const size_t kConnectionCloseLength = 100;
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> termination_packets;
+  AppendPacket(kConnectionCloseLength, &termination_packets);
+  AppendPacket(kConnectionCloseLength + 1, &termination_packets);
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(TestConnectionId(7)));
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(TestConnectionId(8)));
+  compact_manager_->AddConnectionIdToTimeWait(
+      QuicTimeWaitListManager::SEND_CONNECTION_CLOSE_PACKETS,
+      TimeWaitConnectionInfo(/*ietf_quic=*/true, &termination_packets,
+                             {TestConnectionId(7), TestConnectionId(8)}));
+  EXPECT_EQ(1u, compact_manager_->num_connections());
+  EXPECT_TRUE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(7)));
+  EXPECT_TRUE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(8)));
+
+  EXPECT_CALL(writer_, WritePacket(_, kConnectionCloseLength,
+                                   self_address_.host(), peer_address_, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 1)));
+  EXPECT_CALL(writer_, WritePacket(_, kConnectionCloseLength + 1,
+                                   self_address_.host(), peer_address_, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 1)));
+  ProcessPacket(TestConnectionId(8));
+}
+
+TEST_F(QuicCompactTimeWaitListManagerTest, BuildTemplatedPacketsOnDemand) {
+  const size_t kConnectionCloseLength = 100;
+  TerminationPacketTemplate termination_template;
+  termination_template.type = TerminationPacketTemplate::CONNECTION_CLOSE;
+  termination_template.version = QuicVersionMax();
+  termination_template.error_code = QUIC_HANDSHAKE_FAILED;
+  termination_template.error_details = "Reject connection";
+  for (uint64_t conn_id = 1; conn_id <= 2; ++conn_id) {
+    TimeWaitConnectionInfo info(/*ietf_quic=*/true, nullptr,
+                                {TestConnectionId(conn_id)});
+    info.termination_packet_template = termination_template;
+    EXPECT_CALL(visitor_,
+                OnConnectionAddedToTimeWaitList(TestConnectionId(conn_id)));
+    compact_manager_->AddConnectionIdToTimeWait(
+        QuicTimeWaitListManager::SEND_TERMINATION_PACKETS, std::move(info));
+  }
+
+  // Packets are built for each response, which is sent with exponential back
+  // off.
+  EXPECT_CALL(visitor_, BuildConnectionClosePacket(termination_template,
+                                                   TestConnectionId(2), _))
+      .Times(3)
+      .WillRepeatedly(testing::WithArg<2>(
+          [](std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets) {
+            AppendPacket(kConnectionCloseLength, packets);
+          }));
+  EXPECT_CALL(writer_, WritePacket(_, kConnectionCloseLength,
+                                   self_address_.host(), peer_address_, _))
+      .Times(3)
+      .WillRepeatedly(Return(WriteResult(WRITE_STATUS_OK, 1)));
+  for (int i = 0; i < 4; ++i) {
+    ProcessPacket(TestConnectionId(2));
+  }
+}
+
+TEST_F(QuicCompactTimeWaitListManagerTest, BuildVersionNegotiationOnDemand) {
+  std::unique_ptr<QuicEncryptedPacket> packet(
+      QuicFramer::BuildVersionNegotiationPacket(
+          connection_id_, EmptyQuicConnectionId(), /*ietf_quic=*/true,
+          /*use_length_prefix=*/true, /*versions=*/{}));
+  TimeWaitConnectionInfo info(/*ietf_quic=*/true, nullptr, {connection_id_});
+  info.termination_packet_template.emplace();
+  info.termination_packet_template->type =
+      TerminationPacketTemplate::VERSION_NEGOTIATION;
+  info.termination_packet_template->use_length_prefix = true;
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(connection_id_));
+  compact_manager_->AddConnectionIdToTimeWait(
+      QuicTimeWaitListManager::SEND_TERMINATION_PACKETS, std::move(info));
+
+  EXPECT_CALL(writer_, WritePacket(_, packet->length(), self_address_.host(),
+                                   peer_address_, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 1)));
+  ProcessPacket(connection_id_);
+}
+
+TEST_F(QuicCompactTimeWaitListManagerTest, CleanUpOldConnectionIds) {
+  const QuicTime::Delta time_wait_period =
+      QuicTimeWaitListManagerPeer::time_wait_period(compact_manager_.get());
+  const QuicTime::Delta slot_duration =
+      time_wait_period * (1.0 / QuicCompactTimeWaitList::kNumWheelSlots);
+  const QuicTime start = clock_.ApproximateNow();
+  for (uint64_t conn_id = 1; conn_id <= 3; ++conn_id) {
+    EXPECT_CALL(visitor_,
+                OnConnectionAddedToTimeWaitList(TestConnectionId(conn_id)));
+    AddCompactConnectionId(TestConnectionId(conn_id));
+    clock_.AdvanceTime(slot_duration * 0.4);
+  }
+  EXPECT_EQ(3u, compact_manager_->num_connections());
+
+  // Expire the first two connections.
+  clock_.AdvanceTime(start + time_wait_period + slot_duration * 0.4 -
+                     clock_.ApproximateNow());
+  QuicTime next_alarm_time = QuicTime::Zero();
+  EXPECT_CALL(alarm_factory_, OnAlarmSet(_, _))
+      .WillRepeatedly(testing::SaveArg<1>(&next_alarm_time));
+  compact_manager_->CleanUpOldConnectionIds();
+  EXPECT_EQ(1u, compact_manager_->num_connections());
+  EXPECT_TRUE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(3)));
+
+  // The alarm fires once the whole slot of the timing wheel of the last
+  // connection has expired.
+  const QuicTime expiration_time =
+      start + time_wait_period + slot_duration * 0.8;
+  EXPECT_LE(expiration_time, next_alarm_time);
+  EXPECT_GT(expiration_time + slot_duration, next_alarm_time);
+  clock_.AdvanceTime(next_alarm_time - clock_.ApproximateNow());
+  compact_manager_->CleanUpOldConnectionIds();
+  EXPECT_EQ(0u, compact_manager_->num_connections());
+  EXPECT_FALSE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(3)));
+  EXPECT_EQ(clock_.ApproximateNow() + time_wait_period, next_alarm_time);
+}
+
+TEST_F(QuicCompactTimeWaitListManagerTest, MaxConnections) {
+  SetQuicFlag(FLAGS_quic_time_wait_list_max_connections, 2);
+  for (uint64_t conn_id = 1; conn_id <= 3; ++conn_id) {
+    EXPECT_CALL(visitor_,
+                OnConnectionAddedToTimeWaitList(TestConnectionId(conn_id)));
+    AddCompactConnectionId(TestConnectionId(conn_id));
+    clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(1));
+  }
+  EXPECT_EQ(2u, compact_manager_->num_connections());
+  EXPECT_FALSE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(1)));
+  EXPECT_TRUE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(3)));
+
+  // Re-adding a connection replaces it, so that it is now the newest.
+  AddCompactConnectionId(TestConnectionId(2));
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(TestConnectionId(4)));
+  AddCompactConnectionId(TestConnectionId(4));
+  EXPECT_TRUE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(2)));
+  EXPECT_FALSE(compact_manager_->IsConnectionIdInTimeWait(TestConnectionId(3)));
+}
+
+class QuicBatchedTimeWaitListManagerTest : public QuicTimeWaitListManagerTest {
+ protected:
+  QuicBatchedTimeWaitListManagerTest() {
+    SetQuicRestartFlag(quic_batch_time_wait_list_writes, true);
+    batched_manager_ = std::make_unique<QuicTimeWaitListManager>(
+        &writer_, &visitor_, &clock_, &alarm_factory_);
+    ON_CALL(writer_, IsBatchMode()).WillByDefault(Return(true));
+  }
+
+  void SendPacketTo(const QuicSocketAddress& peer_address) {
+    QuicEncryptedPacket packet("reset", 5);
+    batched_manager_->SendPacket(self_address_, peer_address, packet);
+  }
+
+  std::unique_ptr<QuicTimeWaitListManager> batched_manager_;
+};
+
+TEST_F(QuicBatchedTimeWaitListManagerTest, FlushOncePerReadLoop) {
+  const QuicSocketAddress other_peer_address(TestPeerIPAddress(),
+                                             kTestPort + 1);
+  EXPECT_CALL(writer_, WritePacket(_, 5, self_address_.host(), _, _))
+      .Times(2)
+      .WillRepeatedly(Return(WriteResult(WRITE_STATUS_OK, 0)));
+  EXPECT_CALL(writer_, Flush()).Times(0);
+  SendPacketTo(peer_address_);
+  SendPacketTo(other_peer_address);
+
+  EXPECT_CALL(writer_, Flush())
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 10)));
+  batched_manager_->FlushWrites();
+  // Nothing was buffered since.
+  batched_manager_->FlushWrites();
+}
+
+TEST_F(QuicBatchedTimeWaitListManagerTest, RetryBlockedFlush) {
+  EXPECT_CALL(writer_, WritePacket(_, 5, self_address_.host(), _, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 0)));
+  SendPacketTo(peer_address_);
+
+  EXPECT_CALL(writer_, Flush())
+      .WillOnce(DoAll(Assign(&writer_is_blocked_, true),
+                      Return(WriteResult(WRITE_STATUS_BLOCKED, EAGAIN))));
+  EXPECT_CALL(visitor_, OnWriteBlocked(batched_manager_.get()));
+  batched_manager_->FlushWrites();
+
+  // Packets sent while blocked are queued.
+  EXPECT_CALL(writer_, WritePacket(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(visitor_, OnWriteBlocked(batched_manager_.get()));
+  SendPacketTo(peer_address_);
+
+  // The buffered packets are flushed before the queued one is written.
+  writer_is_blocked_ = false;
+  InSequence s;
+  EXPECT_CALL(writer_, Flush())
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  EXPECT_CALL(writer_, WritePacket(_, 5, self_address_.host(), _, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 0)));
+  EXPECT_CALL(writer_, Flush())
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  batched_manager_->OnBlockedWriterCanWrite();
+  batched_manager_->FlushWrites();
+}
+
+class QuicRateLimitedTimeWaitListManagerTest
+    : public QuicTimeWaitListManagerTest {
+ protected:
+  QuicRateLimitedTimeWaitListManagerTest() {
+    SetQuicRestartFlag(quic_rate_limit_time_wait_list_packets, true);
+    rate_limited_manager_ = std::make_unique<QuicTimeWaitListManager>(
+        &writer_, &visitor_, &clock_, &alarm_factory_);
+    other_host_.FromString("127.0.0.2");
+  }
+
+  void SendPacketTo(const QuicSocketAddress& peer_address) {
+    QuicEncryptedPacket packet("reset", 5);
+    rate_limited_manager_->SendPacket(self_address_, peer_address, packet);
+  }
+
+  QuicTime::Delta RateLimitInterval() const {
+    return QuicTime::Delta::FromMilliseconds(
+        GetQuicFlag(FLAGS_quic_time_wait_list_rate_limit_interval_ms));
+  }
+
+  std::unique_ptr<QuicTimeWaitListManager> rate_limited_manager_;
+  QuicIpAddress other_host_;
+};
+
+TEST_F(QuicRateLimitedTimeWaitListManagerTest, RateLimitPerSource) {
+  SetQuicFlag(FLAGS_quic_time_wait_list_max_packets_per_source, 2);
+  const QuicSocketAddress other_peer_address(other_host_, kTestPort);
+  ASSERT_NE(peer_address_.host(), other_host_);
+
+  // Packets to the same IP address count against the same limit, whatever
+  // their port.
+  const QuicSocketAddress other_port_address(peer_address_.host(),
+                                             kTestPort + 1);
+  EXPECT_CALL(writer_, WritePacket(_, _, _, peer_address_, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  EXPECT_CALL(writer_, WritePacket(_, _, _, other_port_address, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  SendPacketTo(peer_address_);
+  SendPacketTo(other_port_address);
+  SendPacketTo(peer_address_);
+
+  // Each address has its own interval, starting with the first packet sent to
+  // it.
+  clock_.AdvanceTime(RateLimitInterval() * 0.5);
+  EXPECT_CALL(writer_, WritePacket(_, _, _, other_peer_address, _))
+      .Times(2)
+      .WillRepeatedly(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  SendPacketTo(other_peer_address);
+
+  // The limit is reset once the interval ends.
+  clock_.AdvanceTime(RateLimitInterval() * 0.5);
+  EXPECT_CALL(writer_, WritePacket(_, _, _, peer_address_, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  SendPacketTo(peer_address_);
+  SendPacketTo(other_peer_address);
+  SendPacketTo(other_peer_address);
+}
+
+TEST_F(QuicRateLimitedTimeWaitListManagerTest, ForgetOldestSourceWhenFull) {
+  SetQuicFlag(FLAGS_quic_time_wait_list_max_rate_limited_sources, 1);
+  SetQuicFlag(FLAGS_quic_time_wait_list_max_packets_per_source, 1);
+  const QuicSocketAddress other_peer_address(other_host_, kTestPort);
+
+  EXPECT_CALL(writer_, WritePacket(_, _, _, peer_address_, _))
+      .Times(2)
+      .WillRepeatedly(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  EXPECT_CALL(writer_, WritePacket(_, _, _, other_peer_address, _))
+      .WillOnce(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  SendPacketTo(peer_address_);
+  SendPacketTo(peer_address_);
+  // Packets to new addresses are still sent when the table is full, and
+  // replace the oldest address.
+  SendPacketTo(other_peer_address);
+  SendPacketTo(peer_address_);
+}
+
+TEST_F(QuicRateLimitedTimeWaitListManagerTest, NoRateLimitByDefault) {
+  SetQuicFlag(FLAGS_quic_time_wait_list_max_packets_per_source, 1);
+  EXPECT_CALL(writer_, WritePacket(_, _, _, peer_address_, _))
+      .Times(2)
+      .WillRepeatedly(Return(WriteResult(WRITE_STATUS_OK, 5)));
+  QuicEncryptedPacket packet("reset", 5);
+  time_wait_list_manager_.SendPacket(self_address_, peer_address_, packet);
+  time_wait_list_manager_.SendPacket(self_address_, peer_address_, packet);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
@@ -0,0 +1,199 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_timing_wheel.h"
+
+#include <algorithm>
+
+#include "absl/numeric/bits.h"
+#include "quic/platform/api/quic_logging.h"
+
+namespace quic {
+
+QuicTimingWheel::Timer::Timer()
+    : deadline_(QuicTime::Zero()),
+      previous_(nullptr),
+      next_(nullptr),
+      level_(kNotScheduled),
+      slot_(0) {}
+
+QuicTimingWheel::Timer::~Timer() {
+  QUICHE_DCHECK(!IsScheduled());
+}
+
+QuicTimingWheel::QuicTimingWheel(QuicTime::Delta granularity)
+    : granularity_us_(std::max<int64_t>(1, granularity.ToMicroseconds())),
+      current_tick_(0),
+      size_(0),
+      occupied_{},
+      slots_{} {}
+
+QuicTimingWheel::~QuicTimingWheel() {
+  for (int level = 0; level < kNumLevels; ++level) {
+    for (Timer* head : slots_[level]) {
+      if (head == nullptr) {
+        continue;
+      }
+      Timer* timer = head;
+      do {
+        Timer* next = timer->next_;
+        timer->level_ = Timer::kNotScheduled;
+        timer->previous_ = nullptr;
+        timer->next_ = nullptr;
+        timer = next;
+      } while (timer != head);
+    }
+  }
+}
+
+void QuicTimingWheel::Schedule(Timer* timer, QuicTime deadline) {
+  if (timer->IsScheduled()) {
+    Unlink(timer);
+  } else {
+    ++size_;
+  }
+  timer->deadline_ = deadline;
+  Link(timer);
+}
+
+void QuicTimingWheel::Cancel(Timer* timer) {
+  if (!timer->IsScheduled()) {
+    return;
+  }
+  Unlink(timer);
+  --size_;
+}
+
+QuicTimingWheel::Timer* QuicTimingWheel::PopExpired(QuicTime now) {
+  const uint64_t now_tick = std::max(ToTick(now), current_tick_);
+  while (true) {
+    const int level = LowestOccupiedLevel();
+    if (level == kNumLevels) {
+      current_tick_ = now_tick;
+      return nullptr;
+    }
+    const int slot = absl::countr_zero(occupied_[level]);
+    const uint64_t start = SlotStart(level, slot);
+    if (start > now_tick) {
+      current_tick_ = now_tick;
+      return nullptr;
+    }
+    current_tick_ = start;
+
+    Timer* head = slots_[level][slot];
+    if (level > 0) {
+      // The slot is now within 64^level ticks of the current tick, so move
+      // its timers to lower levels.
+      slots_[level][slot] = nullptr;
+      occupied_[level] &= ~(uint64_t{1} << slot);
+      head->previous_->next_ = nullptr;
+      for (Timer* timer = head; timer != nullptr;) {
+        Timer* next = timer->next_;
+        Link(timer);
+        timer = next;
+      }
+      continue;
+    }
+
+    // Only the slot of |now_tick| can have timers which are not due yet.
+    Timer* timer = head;
+    do {
+      if (timer->deadline_ <= now) {
+        Unlink(timer);
+        --size_;
+        return timer;
+      }
+      timer = timer->next_;
+    } while (timer != head);
+    return nullptr;
+  }
+}
+
+QuicTime QuicTimingWheel::NextDeadline() const {
+  const int level = LowestOccupiedLevel();
+  if (level == kNumLevels) {
+    return QuicTime::Zero();
+  }
+  const int slot = absl::countr_zero(occupied_[level]);
+  if (level > 0) {
+    return QuicTime::Zero() + QuicTime::Delta::FromMicroseconds(
+                                  SlotStart(level, slot) * granularity_us_);
+  }
+  const Timer* head = slots_[0][slot];
+  QuicTime earliest = head->deadline_;
+  for (const Timer* timer = head->next_; timer != head;
+       timer = timer->next_) {
+    earliest = std::min(earliest, timer->deadline_);
+  }
+  return earliest;
+}
+
+uint64_t QuicTimingWheel::ToTick(QuicTime time) const {
+  const int64_t time_us = (time - QuicTime::Zero()).ToMicroseconds();
+  return time_us <= 0 ? 0 : static_cast<uint64_t>(time_us) / granularity_us_;
+}
+
+void QuicTimingWheel::Link(Timer* timer) {
+  // Overdue timers go to the slot of the current tick.
+  const uint64_t tick = std::max(ToTick(timer->deadline_), current_tick_);
+  // The level is that of the most significant group of bits in which the
+  // tick differs from the current tick.
+  const uint64_t difference = tick ^ current_tick_;
+  const int level =
+      difference == 0
+          ? 0
+          : (63 - absl::countl_zero(difference)) / kBitsPerLevel;
+  const int slot = (tick >> (level * kBitsPerLevel)) & (kSlotsPerLevel - 1);
+  timer->level_ = level;
+  timer->slot_ = slot;
+
+  Timer*& head = slots_[level][slot];
+  if (head == nullptr) {
+    head = timer;
+    timer->previous_ = timer;
+    timer->next_ = timer;
+    occupied_[level] |= uint64_t{1} << slot;
+    return;
+  }
+  // Append, so that timers which are linked first are popped first.
+  timer->previous_ = head->previous_;
+  timer->next_ = head;
+  head->previous_->next_ = timer;
+  head->previous_ = timer;
+}
+
+void QuicTimingWheel::Unlink(Timer* timer) {
+  Timer*& head = slots_[timer->level_][timer->slot_];
+  if (timer->next_ == timer) {
+    head = nullptr;
+    occupied_[timer->level_] &= ~(uint64_t{1} << timer->slot_);
+  } else {
+    timer->previous_->next_ = timer->next_;
+    timer->next_->previous_ = timer->previous_;
+    if (head == timer) {
+      head = timer->next_;
+    }
+  }
+  timer->level_ = Timer::kNotScheduled;
+  timer->previous_ = nullptr;
+  timer->next_ = nullptr;
+}
+
+int QuicTimingWheel::LowestOccupiedLevel() const {
+  int level = 0;
+  while (level < kNumLevels && occupied_[level] == 0) {
+    ++level;
+  }
+  return level;
+}
+
+uint64_t QuicTimingWheel::SlotStart(int level, int slot) const {
+  const int shift = level * kBitsPerLevel;
+  const int group_shift = shift + kBitsPerLevel;
+  const uint64_t group_start =
+      group_shift >= 64 ? 0 : (current_tick_ >> group_shift) << group_shift;
+  return group_start | (static_cast<uint64_t>(slot) << shift);
+}
+
+}  // namespace quic
@@ -0,0 +1,125 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_CORE_QUIC_TIMING_WHEEL_H_
+#define QUICHE_QUIC_CORE_QUIC_TIMING_WHEEL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "quic/core/quic_time.h"
+#include "quic/platform/api/quic_export.h"
+
+namespace quic {
+
+// A hierarchical timing wheel, which keeps a large number of timers whose
+// deadlines change much more often than they expire, e.g. the alarms of QUIC
+// connections, which are updated on almost every packet.
+//
+// Time is divided into ticks of |granularity|.  Level 0 of the wheel has a
+// slot for each of the next 64 ticks, level 1 a slot for each of the next 64
+// groups of 64 ticks, and so on, so that any deadline can be represented.
+// Scheduling and cancelling a timer are O(1), as they only link or unlink it
+// from the list of its slot.  Timers with far away deadlines are moved to
+// lower levels as the wheel advances, at most once per level.
+//
+// Timers never expire before their deadline.  Timers whose deadlines are in
+// the same tick expire in an unspecified order, so the granularity should be
+// as fine as the order of the timers needs to be.
+class QUIC_EXPORT_PRIVATE QuicTimingWheel {
+ public:
+  // A timer which can be scheduled in a wheel.  Intrusive, so that
+  // scheduling it does not allocate.  Must not be destroyed while scheduled.
+  class QUIC_EXPORT_PRIVATE Timer {
+   public:
+    Timer();
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+    ~Timer();
+
+    bool IsScheduled() const { return level_ != kNotScheduled; }
+
+    // The deadline the timer was last scheduled at.
+    QuicTime deadline() const { return deadline_; }
+
+   private:
+    friend class QuicTimingWheel;
+
+    static constexpr uint8_t kNotScheduled = 0xff;
+
+    QuicTime deadline_;
+    // The timers in the same slot form a circular doubly linked list.
+    Timer* previous_;
+    Timer* next_;
+    uint8_t level_;
+    uint8_t slot_;
+  };
+
+  explicit QuicTimingWheel(QuicTime::Delta granularity);
+  QuicTimingWheel(const QuicTimingWheel&) = delete;
+  QuicTimingWheel& operator=(const QuicTimingWheel&) = delete;
+  // Unschedules all the timers still in the wheel.
+  ~QuicTimingWheel();
+
+  // Schedules |timer| to expire at |deadline|, moving it if it is already
+  // scheduled.  |deadline| may be in the past, in which case the timer
+  // expires on the next call to PopExpired().
+  void Schedule(Timer* timer, QuicTime deadline);
+
+  // Unschedules |timer|.  No-op if it is not scheduled.
+  void Cancel(Timer* timer);
+
+  // Unschedules and returns a timer whose deadline is at or before |now|, or
+  // nullptr if there is none.  Timers are returned tick by tick, so that a
+  // timer is never returned after one which is due in a later tick, except
+  // that timers scheduled after their tick has passed are returned with the
+  // current tick.
+  Timer* PopExpired(QuicTime now);
+
+  // Returns a time at or before the earliest deadline in the wheel, at which
+  // PopExpired() should be called next, or QuicTime::Zero() if the wheel is
+  // empty.  Exact if the earliest deadline is within 64 ticks of the current
+  // tick, otherwise it is the start of the group of ticks the earliest
+  // deadline is in.
+  QuicTime NextDeadline() const;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  QuicTime::Delta granularity() const {
+    return QuicTime::Delta::FromMicroseconds(granularity_us_);
+  }
+
+ private:
+  static constexpr int kBitsPerLevel = 6;
+  static constexpr int kSlotsPerLevel = 1 << kBitsPerLevel;
+  // Enough levels to represent any 64 bit tick.
+  static constexpr int kNumLevels = (64 + kBitsPerLevel - 1) / kBitsPerLevel;
+
+  uint64_t ToTick(QuicTime time) const;
+
+  // Links |timer| into the slot of its deadline, relative to |current_tick_|.
+  void Link(Timer* timer);
+  void Unlink(Timer* timer);
+
+  // Returns the lowest level which has a scheduled timer, or kNumLevels if
+  // the wheel is empty.
+  int LowestOccupiedLevel() const;
+
+  // Returns the first tick of |slot| of |level|.
+  uint64_t SlotStart(int level, int slot) const;
+
+  const uint64_t granularity_us_;
+  // The tick the wheel has advanced to.  The occupied slots of level 0 are
+  // at or after it, and those of the other levels strictly after it.
+  uint64_t current_tick_;
+  size_t size_;
+  // Bit i of occupied_[level] is set if slots_[level][i] is not empty.
+  uint64_t occupied_[kNumLevels];
+  Timer* slots_[kNumLevels][kSlotsPerLevel];
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_CORE_QUIC_TIMING_WHEEL_H_
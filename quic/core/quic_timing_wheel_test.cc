@@ -0,0 +1,294 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/core/quic_timing_wheel.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/quic_time.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/test_tools/quic_test_utils.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+using Timer = QuicTimingWheel::Timer;
+
+QuicTime TimeAt(int64_t microseconds) {
+  return QuicTime::Zero() + QuicTime::Delta::FromMicroseconds(microseconds);
+}
+
+// Pops all the timers which are due at |now|.
+std::vector<Timer*> PopAllExpired(QuicTimingWheel* wheel, QuicTime now) {
+  std::vector<Timer*> expired;
+  while (Timer* timer = wheel->PopExpired(now)) {
+    expired.push_back(timer);
+  }
+  return expired;
+}
+
+class QuicTimingWheelTest : public QuicTest {
+ protected:
+  QuicTimingWheelTest()
+      : wheel_(QuicTime::Delta::FromMicroseconds(1)), timers_(10) {}
+
+  QuicTimingWheel wheel_;
+  std::vector<Timer> timers_;
+};
+
+TEST_F(QuicTimingWheelTest, ExpireInOrder) {
+  // Deadlines in different levels of the wheel.
+  const int64_t kDeadlines[] = {5, 70, 1, 5000, 300000, 63, 64, 1000000000};
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(kDeadlines); ++i) {
+    wheel_.Schedule(&timers_[i], TimeAt(kDeadlines[i]));
+    EXPECT_TRUE(timers_[i].IsScheduled());
+  }
+  EXPECT_EQ(ABSL_ARRAYSIZE(kDeadlines), wheel_.size());
+  EXPECT_EQ(TimeAt(1), wheel_.NextDeadline());
+
+  EXPECT_EQ(nullptr, wheel_.PopExpired(TimeAt(0)));
+  EXPECT_EQ(std::vector<Timer*>({&timers_[2], &timers_[0]}),
+            PopAllExpired(&wheel_, TimeAt(5)));
+  EXPECT_FALSE(timers_[0].IsScheduled());
+  EXPECT_EQ(TimeAt(63), wheel_.NextDeadline());
+
+  EXPECT_EQ(std::vector<Timer*>({&timers_[5], &timers_[6], &timers_[1]}),
+            PopAllExpired(&wheel_, TimeAt(4999)));
+  // 5000 is beyond level 0 of tick 4999, so the next deadline is the start
+  // of its group of ticks.
+  const QuicTime next_deadline = wheel_.NextDeadline();
+  EXPECT_LE(TimeAt(4999), next_deadline);
+  EXPECT_GE(TimeAt(5000), next_deadline);
+
+  EXPECT_EQ(std::vector<Timer*>({&timers_[3], &timers_[4], &timers_[7]}),
+            PopAllExpired(&wheel_, TimeAt(2000000000)));
+  EXPECT_TRUE(wheel_.empty());
+  EXPECT_EQ(QuicTime::Zero(), wheel_.NextDeadline());
+}
+
+TEST_F(QuicTimingWheelTest, RescheduleAndCancel) {
+  wheel_.Schedule(&timers_[0], TimeAt(100));
+  wheel_.Schedule(&timers_[1], TimeAt(200));
+  wheel_.Schedule(&timers_[0], TimeAt(300));
+  EXPECT_EQ(2u, wheel_.size());
+  EXPECT_EQ(TimeAt(300), timers_[0].deadline());
+
+  wheel_.Cancel(&timers_[1]);
+  EXPECT_FALSE(timers_[1].IsScheduled());
+  EXPECT_EQ(1u, wheel_.size());
+  // Cancelling an unscheduled timer is a no-op.
+  wheel_.Cancel(&timers_[1]);
+  EXPECT_EQ(1u, wheel_.size());
+
+  EXPECT_TRUE(PopAllExpired(&wheel_, TimeAt(299)).empty());
+  EXPECT_EQ(std::vector<Timer*>({&timers_[0]}),
+            PopAllExpired(&wheel_, TimeAt(300)));
+}
+
+TEST_F(QuicTimingWheelTest, ScheduleInThePast) {
+  wheel_.Schedule(&timers_[0], TimeAt(1000));
+  EXPECT_EQ(std::vector<Timer*>({&timers_[0]}),
+            PopAllExpired(&wheel_, TimeAt(1000)));
+
+  wheel_.Schedule(&timers_[1], TimeAt(10));
+  wheel_.Schedule(&timers_[2], TimeAt(1001));
+  EXPECT_EQ(TimeAt(10), wheel_.NextDeadline());
+  EXPECT_EQ(std::vector<Timer*>({&timers_[1]}),
+            PopAllExpired(&wheel_, TimeAt(1000)));
+  EXPECT_EQ(std::vector<Timer*>({&timers_[2]}),
+            PopAllExpired(&wheel_, TimeAt(1001)));
+}
+
+TEST_F(QuicTimingWheelTest, Granularity) {
+  QuicTimingWheel wheel(QuicTime::Delta::FromMilliseconds(1));
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(1), wheel.granularity());
+  wheel.Schedule(&timers_[0], TimeAt(1500));
+  wheel.Schedule(&timers_[1], TimeAt(1200));
+  // Timers never expire early, even within a tick.
+  EXPECT_TRUE(PopAllExpired(&wheel, TimeAt(1100)).empty());
+  EXPECT_EQ(std::vector<Timer*>({&timers_[1]}),
+            PopAllExpired(&wheel, TimeAt(1499)));
+  EXPECT_EQ(TimeAt(1500), wheel.NextDeadline());
+  EXPECT_EQ(std::vector<Timer*>({&timers_[0]}),
+            PopAllExpired(&wheel, TimeAt(1500)));
+}
+
+TEST_F(QuicTimingWheelTest, DestroyWithScheduledTimers) {
+  auto wheel = std::make_unique<QuicTimingWheel>(
+      QuicTime::Delta::FromMicroseconds(1));
+  wheel->Schedule(&timers_[0], TimeAt(1));
+  wheel->Schedule(&timers_[1], TimeAt(1));
+  wheel->Schedule(&timers_[2], TimeAt(100000));
+  wheel.reset();
+  for (const Timer& timer : timers_) {
+    EXPECT_FALSE(timer.IsScheduled());
+  }
+}
+
+// Compares the wheel against a multimap under random operations.
+TEST_F(QuicTimingWheelTest, MatchesMultimap) {
+  SimpleRandom random;
+  random.set_seed(42);
+  for (int64_t granularity_us : {1, 7, 1000}) {
+    QuicTimingWheel wheel(QuicTime::Delta::FromMicroseconds(granularity_us));
+    std::vector<Timer> timers(100);
+    std::multimap<QuicTime, Timer*> expected;
+    auto erase_expected = [&expected](Timer* timer) {
+      auto range = expected.equal_range(timer->deadline());
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == timer) {
+          expected.erase(it);
+          return true;
+        }
+      }
+      return false;
+    };
+    QuicTime now = TimeAt(1000000);
+    for (int i = 0; i < 100000; ++i) {
+      Timer* timer = &timers[random.RandUint64() % timers.size()];
+      if (timer->IsScheduled()) {
+        ASSERT_TRUE(erase_expected(timer));
+      }
+      const uint64_t operation = random.RandUint64() % 4;
+      if (operation == 0) {
+        wheel.Cancel(timer);
+      } else {
+        if (operation == 1) {
+          now = now + QuicTime::Delta::FromMicroseconds(
+                          random.RandUint64() % (100 * granularity_us));
+        }
+        // Mostly near deadlines, sometimes far away or overdue ones.
+        int64_t offset_us = random.RandUint64() % (10 * granularity_us);
+        if (random.RandUint64() % 8 == 0) {
+          offset_us = random.RandUint64() % 100000000;
+        }
+        if (random.RandUint64() % 16 == 0) {
+          offset_us = -offset_us;
+        }
+        const QuicTime deadline =
+            now + QuicTime::Delta::FromMicroseconds(offset_us);
+        wheel.Schedule(timer, deadline);
+        expected.insert({deadline, timer});
+      }
+      ASSERT_EQ(expected.size(), wheel.size());
+      if (!wheel.empty()) {
+        ASSERT_GE(expected.begin()->first, wheel.NextDeadline());
+      }
+
+      for (Timer* expired : PopAllExpired(&wheel, now)) {
+        ASSERT_GE(now, expired->deadline());
+        ASSERT_TRUE(erase_expected(expired));
+      }
+      ASSERT_TRUE(expected.empty() || expected.begin()->first > now);
+    }
+    for (Timer& timer : timers) {
+      wheel.Cancel(&timer);
+    }
+  }
+}
+
+// Measures the cost of the alarm pattern of a server with many connections:
+// on every packet, a connection updates a few of its alarms, mostly moving
+// them later, and alarms of idle connections expire.  The wheel is compared
+// against a multimap keyed by deadline, which is what SimpleEpollServer keeps
+// its alarms in.
+TEST_F(QuicTimingWheelTest, DISABLED_AlarmUpdateBenchmark) {
+  const int kAlarmsPerConnection = 10;
+  const int kUpdatesPerPacket = 3;
+  const int kNumPackets = 1000000;
+  const QuicTime::Delta kTimePerPacket = QuicTime::Delta::FromMicroseconds(2);
+  // Deadlines of the alarms of a connection relative to the packet that
+  // updates them, e.g. ack, retransmission and idle timeouts.
+  const int64_t kTimeoutsUs[kAlarmsPerConnection] = {
+      1000,   25000,   200000, 30000000, 5000,
+      100000, 1000000, 50000,  10000,    600000000};
+
+  for (int num_connections : {1000, 50000}) {
+    const int num_alarms = num_connections * kAlarmsPerConnection;
+
+    SimpleRandom random;
+    random.set_seed(1);
+    std::multimap<QuicTime, int> multimap;
+    std::vector<std::multimap<QuicTime, int>::iterator> tokens;
+    QuicTime now = TimeAt(1000000);
+    for (int i = 0; i < num_alarms; ++i) {
+      tokens.push_back(multimap.insert(
+          {now + QuicTime::Delta::FromMicroseconds(
+                     kTimeoutsUs[i % kAlarmsPerConnection]),
+           i}));
+    }
+    int64_t multimap_expired = 0;
+    absl::Time start = absl::Now();
+    for (int packet = 0; packet < kNumPackets; ++packet) {
+      now = now + kTimePerPacket;
+      const int connection = random.RandUint64() % num_connections;
+      for (int update = 0; update < kUpdatesPerPacket; ++update) {
+        const int alarm = connection * kAlarmsPerConnection +
+                          random.RandUint64() % kAlarmsPerConnection;
+        if (tokens[alarm] != multimap.end()) {
+          multimap.erase(tokens[alarm]);
+        }
+        tokens[alarm] = multimap.insert(
+            {now + QuicTime::Delta::FromMicroseconds(
+                       kTimeoutsUs[alarm % kAlarmsPerConnection]),
+             alarm});
+      }
+      while (!multimap.empty() && multimap.begin()->first <= now) {
+        tokens[multimap.begin()->second] = multimap.end();
+        multimap.erase(multimap.begin());
+        ++multimap_expired;
+      }
+    }
+    const double multimap_seconds = absl::ToDoubleSeconds(absl::Now() - start);
+
+    random.set_seed(1);
+    QuicTimingWheel wheel(QuicTime::Delta::FromMicroseconds(1));
+    std::vector<Timer> timers(num_alarms);
+    now = TimeAt(1000000);
+    for (int i = 0; i < num_alarms; ++i) {
+      wheel.Schedule(&timers[i],
+                     now + QuicTime::Delta::FromMicroseconds(
+                               kTimeoutsUs[i % kAlarmsPerConnection]));
+    }
+    int64_t wheel_expired = 0;
+    start = absl::Now();
+    for (int packet = 0; packet < kNumPackets; ++packet) {
+      now = now + kTimePerPacket;
+      const int connection = random.RandUint64() % num_connections;
+      for (int update = 0; update < kUpdatesPerPacket; ++update) {
+        const int alarm = connection * kAlarmsPerConnection +
+                          random.RandUint64() % kAlarmsPerConnection;
+        wheel.Schedule(&timers[alarm],
+                       now + QuicTime::Delta::FromMicroseconds(
+                                 kTimeoutsUs[alarm % kAlarmsPerConnection]));
+      }
+      while (wheel.PopExpired(now) != nullptr) {
+        ++wheel_expired;
+      }
+    }
+    const double wheel_seconds = absl::ToDoubleSeconds(absl::Now() - start);
+    for (Timer& timer : timers) {
+      wheel.Cancel(&timer);
+    }
+
+    EXPECT_EQ(multimap_expired, wheel_expired);
+    const double updates = kNumPackets * kUpdatesPerPacket;
+    QUIC_LOG(INFO) << num_connections << " connections, " << num_alarms
+                   << " alarms, " << wheel_expired << " expired: multimap "
+                   << multimap_seconds * 1e9 / updates
+                   << " ns per update, timing wheel "
+                   << wheel_seconds * 1e9 / updates << " ns per update";
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
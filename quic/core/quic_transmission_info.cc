@@ -3,10 +3,74 @@
 // found in the LICENSE file.
 
 #include "quic/core/quic_transmission_info.h"
+
+#include <utility>
+
 #include "absl/strings/str_cat.h"
+#include "quic/platform/api/quic_logging.h"
 
 namespace quic {
 
+QuicRetransmittableFrames::QuicRetransmittableFrames() = default;
+
+QuicRetransmittableFrames::QuicRetransmittableFrames(
+    const QuicRetransmittableFrames& other) {
+  *this = other;
+}
+
+QuicRetransmittableFrames::QuicRetransmittableFrames(
+    QuicRetransmittableFrames&& other) noexcept = default;
+
+QuicRetransmittableFrames& QuicRetransmittableFrames::operator=(
+    const QuicRetransmittableFrames& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (other.empty()) {
+    frames_.reset();
+  } else {
+    frames_ = std::make_unique<QuicFrames>(*other.frames_);
+  }
+  return *this;
+}
+
+QuicRetransmittableFrames& QuicRetransmittableFrames::operator=(
+    QuicRetransmittableFrames&& other) noexcept = default;
+
+QuicRetransmittableFrames::~QuicRetransmittableFrames() {}
+
+void QuicRetransmittableFrames::push_back(const QuicFrame& frame) {
+  if (frames_ == nullptr) {
+    frames_ = std::make_unique<QuicFrames>();
+  }
+  frames_->push_back(frame);
+}
+
+void QuicRetransmittableFrames::Swap(QuicFrames* frames,
+                                     std::unique_ptr<QuicFrames> storage) {
+  if (frames_ == nullptr) {
+    if (frames->empty()) {
+      return;
+    }
+    frames_ = storage != nullptr ? std::move(storage)
+                                 : std::make_unique<QuicFrames>();
+    QUICHE_DCHECK(frames_->empty());
+  }
+  frames_->swap(*frames);
+}
+
+std::unique_ptr<QuicFrames> QuicRetransmittableFrames::DeleteFrames() {
+  if (frames_ != nullptr) {
+    quic::DeleteFrames(frames_.get());
+  }
+  return std::move(frames_);
+}
+
+const QuicFrames& QuicRetransmittableFrames::frames() const {
+  static const QuicFrames* const kEmptyFrames = new QuicFrames();
+  return frames_ == nullptr ? *kEmptyFrames : *frames_;
+}
+
 QuicTransmissionInfo::QuicTransmissionInfo()
     : sent_time(QuicTime::Zero()),
       bytes_sent(0),
@@ -48,8 +112,8 @@ std::string QuicTransmissionInfo::DebugString() const {
       ", has_ack_frequency: ", has_ack_frequency,
       ", first_sent_after_loss: ", first_sent_after_loss.ToString(),
       ", largest_acked: ", largest_acked.ToString(),
-      ", retransmittable_frames: ", QuicFramesToString(retransmittable_frames),
-      "}");
+      ", retransmittable_frames: ",
+      QuicFramesToString(retransmittable_frames.frames()), "}");
 }
 
 }  // namespace quic
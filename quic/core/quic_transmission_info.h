@@ -6,6 +6,7 @@
 #define QUICHE_QUIC_CORE_QUIC_TRANSMISSION_INFO_H_
 
 #include <list>
+#include <memory>
 
 #include "quic/core/frames/quic_frame.h"
 #include "quic/core/quic_ack_listener_interface.h"
@@ -14,6 +15,50 @@
 
 namespace quic {
 
+// The retransmittable frames of a sent packet. The frame list is stored out of
+// line and only allocated when the packet has retransmittable frames, so that
+// the fields of QuicTransmissionInfo which are read by ack processing and loss
+// detection are packed into fewer cache lines. Like QuicFrames, it does not
+// own the frames it points to, and copies are shallow copies of the frames.
+class QUIC_EXPORT_PRIVATE QuicRetransmittableFrames {
+ public:
+  QuicRetransmittableFrames();
+  QuicRetransmittableFrames(const QuicRetransmittableFrames& other);
+  QuicRetransmittableFrames(QuicRetransmittableFrames&& other) noexcept;
+  QuicRetransmittableFrames& operator=(const QuicRetransmittableFrames& other);
+  QuicRetransmittableFrames& operator=(
+      QuicRetransmittableFrames&& other) noexcept;
+  ~QuicRetransmittableFrames();
+
+  bool empty() const { return frames_ == nullptr || frames_->empty(); }
+  size_t size() const { return frames_ == nullptr ? 0 : frames_->size(); }
+
+  const QuicFrame& operator[](size_t index) const { return (*frames_)[index]; }
+
+  QuicFrame* begin() { return frames_ == nullptr ? nullptr : frames_->data(); }
+  QuicFrame* end() { return begin() + size(); }
+  const QuicFrame* begin() const {
+    return frames_ == nullptr ? nullptr : frames_->data();
+  }
+  const QuicFrame* end() const { return begin() + size(); }
+
+  void push_back(const QuicFrame& frame);
+
+  // Swaps the frames with |frames|. |storage| is used to hold the frame list
+  // if none is allocated yet, and may be null.
+  void Swap(QuicFrames* frames, std::unique_ptr<QuicFrames> storage);
+
+  // Deletes the frames, see DeleteFrames(). Returns the storage of the frame
+  // list, which is empty and may be reused by Swap().
+  std::unique_ptr<QuicFrames> DeleteFrames();
+
+  // Returns the frame list, which is empty if none is allocated.
+  const QuicFrames& frames() const;
+
+ private:
+  std::unique_ptr<QuicFrames> frames_;
+};
+
 // Stores details of a single sent packet.
 struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
   // Used by STL when assigning into a map.
@@ -34,8 +79,14 @@ struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
 
   std::string DebugString() const;
 
-  QuicFrames retransmittable_frames;
+  // Fields used when processing acks and detecting losses come first.
   QuicTime sent_time;
+  // The largest_acked in the ack frame, if the packet contains an ack.
+  QuicPacketNumber largest_acked;
+  // Records the first sent packet after this packet was detected lost. Zero if
+  // this packet has not been detected lost. This is used to keep lost packet
+  // for another RTT (for potential spurious loss detection)
+  QuicPacketNumber first_sent_after_loss;
   QuicPacketLength bytes_sent;
   EncryptionLevel encryption_level;
   // Reason why this packet was transmitted.
@@ -48,12 +99,7 @@ struct QUIC_EXPORT_PRIVATE QuicTransmissionInfo {
   bool has_crypto_handshake;
   // True if the packet contains ack frequency frame.
   bool has_ack_frequency;
-  // Records the first sent packet after this packet was detected lost. Zero if
-  // this packet has not been detected lost. This is used to keep lost packet
-  // for another RTT (for potential spurious loss detection)
-  QuicPacketNumber first_sent_after_loss;
-  // The largest_acked in the ack frame, if the packet contains an ack.
-  QuicPacketNumber largest_acked;
+  QuicRetransmittableFrames retransmittable_frames;
 };
 // TODO(ianswett): Add static_assert when size of this struct is reduced below
 // 64 bytes.
@@ -27,6 +27,10 @@ const QuicUdpSocketFd kQuicInvalidSocketFd = -1;
 
 const size_t kDefaultUdpPacketControlBufferSize = 512;
 
+// The largest super-buffer the kernel may return for a single read on a socket
+// with UDP GRO enabled.
+const size_t kMaxGroPacketSize = 64 * 1024;
+
 enum class QuicUdpPacketInfoBit : uint8_t {
   DROPPED_PACKETS = 0,   // Read
   V4_SELF_IP,            // Read
@@ -35,6 +39,7 @@ enum class QuicUdpPacketInfoBit : uint8_t {
   RECV_TIMESTAMP,        // Read
   TTL,                   // Read & Write
   GOOGLE_PACKET_HEADER,  // Read
+  GRO_SEGMENT_SIZE,      // Read
   NUM_BITS,
 };
 static_assert(static_cast<size_t>(QuicUdpPacketInfoBit::NUM_BITS) <=
@@ -143,6 +148,19 @@ class QUIC_EXPORT_PRIVATE QuicUdpPacketInfo {
     bitmask_.Set(QuicUdpPacketInfoBit::GOOGLE_PACKET_HEADER);
   }
 
+  // The size of each datagram coalesced by UDP GRO into the packet buffer. All
+  // datagrams except the last one have exactly this size, the last one may be
+  // shorter.
+  QuicByteCount gro_segment_size() const {
+    QUICHE_DCHECK(HasValue(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE));
+    return gro_segment_size_;
+  }
+
+  void SetGroSegmentSize(QuicByteCount gro_segment_size) {
+    gro_segment_size_ = gro_segment_size;
+    bitmask_.Set(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE);
+  }
+
  private:
   BitMask64 bitmask_;
   QuicPacketCount dropped_packets_;
@@ -152,6 +170,7 @@ class QUIC_EXPORT_PRIVATE QuicUdpPacketInfo {
   QuicWallTime receive_timestamp_ = QuicWallTime::Zero();
   int ttl_;
   BufferSpan google_packet_headers_;
+  QuicByteCount gro_segment_size_ = 0;
 };
 
 // QuicUdpSocketApi provides a minimal set of apis for sending and receiving
@@ -187,6 +206,18 @@ class QUIC_EXPORT_PRIVATE QuicUdpSocketApi {
   bool EnableReceiveTtlForV4(QuicUdpSocketFd fd);
   bool EnableReceiveTtlForV6(QuicUdpSocketFd fd);
 
+  // Enable UDP generic receive offload on |fd|. Once enabled, a single read may
+  // return multiple datagrams from the same peer coalesced into one buffer, and
+  // the size of each datagram is reported via
+  // QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE. Callers must supply packet buffers
+  // of at least kMaxGroPacketSize bytes. Return false if GRO is not supported.
+  bool EnableUdpGro(QuicUdpSocketFd fd);
+
+  // Enable SO_REUSEPORT on |fd|, so that multiple sockets can bind to the same
+  // address and have incoming datagrams distributed among them. Must be called
+  // before Bind(). Return false if SO_REUSEPORT is not supported.
+  bool EnableReusePort(QuicUdpSocketFd fd);
+
   // Wait for |fd| to become readable, up to |timeout|.
   // Return true if |fd| is readable upon return.
   bool WaitUntilReadable(QuicUdpSocketFd fd, QuicTime::Delta timeout);
@@ -230,6 +261,14 @@ class QUIC_EXPORT_PRIVATE QuicUdpSocketApi {
                              BitMask64 packet_info_interested,
                              ReadPacketResults* results);
 
+  // Populate |packet_info| from the control messages in |control_buffer|,
+  // which must have been filled in by the kernel on a read, e.g. by a
+  // completion-based read API that bypasses ReadPacket. Only information set in
+  // |packet_info_interested| is populated.
+  void PopulatePacketInfoFromControlBuffer(BufferSpan control_buffer,
+                                           BitMask64 packet_info_interested,
+                                           QuicUdpPacketInfo* packet_info);
+
   // Write a packet to |fd|.
   // packet_buffer, packet_buffer_len:  The packet buffer to write.
   // packet_info:                       The per packet information to set.
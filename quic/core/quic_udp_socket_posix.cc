@@ -25,6 +25,16 @@
 
 #if defined(__linux__) && !defined(__ANDROID__)
 #define QUIC_UDP_SOCKET_SUPPORT_TTL 1
+#define QUIC_UDP_SOCKET_SUPPORT_GRO 1
+#endif
+
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
 #endif
 
 namespace quic {
@@ -55,6 +65,7 @@ const size_t kMinCmsgSpaceForRead =
     + CMSG_SPACE(sizeof(in_pktinfo))   // V4 Self IP
     + CMSG_SPACE(sizeof(in6_pktinfo))  // V6 Self IP
     + kCmsgSpaceForRecvTimestamp + CMSG_SPACE(sizeof(int))  // TTL
+    + CMSG_SPACE(sizeof(int))                               // GRO segment
     + kCmsgSpaceForGooglePacketHeader;
 
 QuicUdpSocketFd CreateNonblockingSocket(int address_family) {
@@ -178,6 +189,18 @@ void PopulatePacketInfoFromControlMessage(struct cmsghdr* cmsg,
     return;
   }
 
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+  if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+    if (packet_info_interested.IsSet(QuicUdpPacketInfoBit::GRO_SEGMENT_SIZE)) {
+      const int segment_size = *(reinterpret_cast<int*>(CMSG_DATA(cmsg)));
+      if (segment_size > 0) {
+        packet_info->SetGroSegmentSize(segment_size);
+      }
+    }
+    return;
+  }
+#endif
+
   if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TTL) ||
       (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_HOPLIMIT)) {
     if (packet_info_interested.IsSet(QuicUdpPacketInfoBit::TTL)) {
@@ -362,6 +385,27 @@ bool QuicUdpSocketApi::EnableReceiveTtlForV6(QuicUdpSocketFd fd) {
 #endif
 }
 
+bool QuicUdpSocketApi::EnableUdpGro(QuicUdpSocketFd fd) {
+#if defined(QUIC_UDP_SOCKET_SUPPORT_GRO)
+  int enable_gro = 1;
+  return 0 == setsockopt(fd, SOL_UDP, UDP_GRO, &enable_gro, sizeof(enable_gro));
+#else
+  (void)fd;
+  return false;
+#endif
+}
+
+bool QuicUdpSocketApi::EnableReusePort(QuicUdpSocketFd fd) {
+#if defined(SO_REUSEPORT)
+  int reuse_port = 1;
+  return 0 == setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse_port,
+                         sizeof(reuse_port));
+#else
+  (void)fd;
+  return false;
+#endif
+}
+
 bool QuicUdpSocketApi::WaitUntilReadable(QuicUdpSocketFd fd,
                                          QuicTime::Delta timeout) {
   fd_set read_fds;
@@ -559,6 +603,24 @@ size_t QuicUdpSocketApi::ReadMultiplePackets(QuicUdpSocketFd fd,
 #endif
 }
 
+void QuicUdpSocketApi::PopulatePacketInfoFromControlBuffer(
+    BufferSpan control_buffer,
+    BitMask64 packet_info_interested,
+    QuicUdpPacketInfo* packet_info) {
+  if (control_buffer.buffer_len == 0) {
+    return;
+  }
+  msghdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.msg_control = control_buffer.buffer;
+  hdr.msg_controllen = control_buffer.buffer_len;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+    PopulatePacketInfoFromControlMessage(cmsg, packet_info,
+                                         packet_info_interested);
+  }
+}
+
 WriteResult QuicUdpSocketApi::WritePacket(
     QuicUdpSocketFd fd,
     const char* packet_buffer,
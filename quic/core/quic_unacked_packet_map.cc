@@ -4,9 +4,12 @@
 
 #include "quic/core/quic_unacked_packet_map.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <limits>
+#include <memory>
 #include <type_traits>
+#include <utility>
 
 #include "absl/container/inlined_vector.h"
 #include "quic/core/quic_connection_stats.h"
@@ -19,6 +22,10 @@
 namespace quic {
 
 namespace {
+
+// The maximum number of frame lists of removed packets kept for reuse.
+const size_t kMaxFreeFrameLists = 256;
+
 bool WillStreamFrameLengthSumWrapAround(QuicPacketLength lhs,
                                         QuicPacketLength rhs) {
   static_assert(
@@ -135,12 +142,16 @@ QuicUnackedPacketMap::QuicUnackedPacketMap(Perspective perspective)
                                        {QuicTime::Zero()}},
       last_crypto_packet_sent_time_(QuicTime::Zero()),
       session_notifier_(nullptr),
-      supports_multiple_packet_number_spaces_(false) {
+      supports_multiple_packet_number_spaces_(false),
+      reuse_frame_lists_(
+          GetQuicRestartFlag(quic_reuse_retransmittable_frame_lists)),
+      aggregate_acked_stream_frames_per_stream_(GetQuicRestartFlag(
+          quic_aggregate_acked_stream_frames_per_stream)) {
 }
 
 QuicUnackedPacketMap::~QuicUnackedPacketMap() {
   for (QuicTransmissionInfo& transmission_info : unacked_packets_) {
-    DeleteFrames(&(transmission_info.retransmittable_frames));
+    transmission_info.retransmittable_frames.DeleteFrames();
   }
 }
 
@@ -199,8 +210,15 @@ void QuicUnackedPacketMap::AddSentPacket(SerializedPacket* mutable_packet,
     last_crypto_packet_sent_time_ = sent_time;
   }
 
-  mutable_packet->retransmittable_frames.swap(
-      unacked_packets_.back().retransmittable_frames);
+  std::unique_ptr<QuicFrames> storage;
+  if (reuse_frame_lists_ && !mutable_packet->retransmittable_frames.empty() &&
+      !free_frame_lists_.empty()) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_reuse_retransmittable_frame_lists, 1, 2);
+    storage = std::move(free_frame_lists_.back());
+    free_frame_lists_.pop_back();
+  }
+  unacked_packets_.back().retransmittable_frames.Swap(
+      &mutable_packet->retransmittable_frames, std::move(storage));
 }
 
 void QuicUnackedPacketMap::RemoveObsoletePackets() {
@@ -208,7 +226,7 @@ void QuicUnackedPacketMap::RemoveObsoletePackets() {
     if (!IsPacketUseless(least_unacked_, unacked_packets_.front())) {
       break;
     }
-    DeleteFrames(&unacked_packets_.front().retransmittable_frames);
+    DeleteRetransmittableFrames(&unacked_packets_.front());
     unacked_packets_.pop_front();
     ++least_unacked_;
   }
@@ -238,10 +256,21 @@ bool QuicUnackedPacketMap::HasRetransmittableFrames(
 
 void QuicUnackedPacketMap::RemoveRetransmittability(
     QuicTransmissionInfo* info) {
-  DeleteFrames(&info->retransmittable_frames);
+  DeleteRetransmittableFrames(info);
   info->first_sent_after_loss.Clear();
 }
 
+void QuicUnackedPacketMap::DeleteRetransmittableFrames(
+    QuicTransmissionInfo* info) {
+  std::unique_ptr<QuicFrames> storage =
+      info->retransmittable_frames.DeleteFrames();
+  if (reuse_frame_lists_ && storage != nullptr &&
+      free_frame_lists_.size() < kMaxFreeFrameLists) {
+    QUIC_RESTART_FLAG_COUNT_N(quic_reuse_retransmittable_frame_lists, 2, 2);
+    free_frame_lists_.push_back(std::move(storage));
+  }
+}
+
 void QuicUnackedPacketMap::RemoveRetransmittability(
     QuicPacketNumber packet_number) {
   QUICHE_DCHECK_GE(packet_number, least_unacked_);
@@ -500,6 +529,13 @@ void QuicUnackedPacketMap::MaybeAggregateAckedStreamFrame(
   if (session_notifier_ == nullptr) {
     return;
   }
+  if (aggregate_acked_stream_frames_per_stream_) {
+    QUIC_RESTART_FLAG_COUNT(quic_aggregate_acked_stream_frames_per_stream);
+    for (const auto& frame : info.retransmittable_frames) {
+      AggregateAckedFramePerStream(frame, ack_delay, receive_timestamp);
+    }
+    return;
+  }
   for (const auto& frame : info.retransmittable_frames) {
     // Determine whether acked stream frame can be aggregated.
     const bool can_aggregate =
@@ -541,8 +577,70 @@ void QuicUnackedPacketMap::MaybeAggregateAckedStreamFrame(
   }
 }
 
+void QuicUnackedPacketMap::AggregateAckedFramePerStream(
+    const QuicFrame& frame,
+    QuicTime::Delta ack_delay,
+    QuicTime receive_timestamp) {
+  if (frame.type != STREAM_FRAME) {
+    // Notify the stream frames acked before this frame first.
+    NotifyAggregatedStreamFrameAcked(ack_delay);
+    session_notifier_->OnFrameAcked(frame, ack_delay, receive_timestamp);
+    return;
+  }
+  const QuicStreamFrame& stream_frame = frame.stream_frame;
+  auto it = std::find_if(aggregated_stream_frames_.begin(),
+                         aggregated_stream_frames_.end(),
+                         [&stream_frame](const QuicStreamFrame& aggregated) {
+                           return aggregated.stream_id ==
+                                  stream_frame.stream_id;
+                         });
+  if (it != aggregated_stream_frames_.end()) {
+    const bool can_aggregate =
+        stream_frame.offset == it->offset + it->data_length &&
+        !WillStreamFrameLengthSumWrapAround(it->data_length,
+                                            stream_frame.data_length);
+    if (can_aggregate) {
+      it->data_length += stream_frame.data_length;
+      it->fin = stream_frame.fin;
+      if (!it->fin) {
+        return;
+      }
+    }
+    // Notify session notifier the data aggregated for this stream gets acked,
+    // either because it is followed by a gap or because fin is acked.
+    session_notifier_->OnFrameAcked(QuicFrame(*it), ack_delay,
+                                    /*receive_timestamp=*/QuicTime::Zero());
+    aggregated_stream_frames_.erase(it);
+    if (can_aggregate) {
+      return;
+    }
+  }
+  if (stream_frame.fin) {
+    session_notifier_->OnFrameAcked(frame, ack_delay, receive_timestamp);
+    return;
+  }
+  if (aggregated_stream_frames_.size() == kMaxAggregatedStreamFrames) {
+    session_notifier_->OnFrameAcked(QuicFrame(aggregated_stream_frames_[0]),
+                                    ack_delay,
+                                    /*receive_timestamp=*/QuicTime::Zero());
+    aggregated_stream_frames_.erase(aggregated_stream_frames_.begin());
+  }
+  // Delay notifying session notifier stream frame gets acked in case it can
+  // be aggregated with following acked ones of the same stream.
+  aggregated_stream_frames_.push_back(
+      QuicStreamFrame(stream_frame.stream_id, /*fin=*/false,
+                      stream_frame.offset, stream_frame.data_length));
+}
+
 void QuicUnackedPacketMap::NotifyAggregatedStreamFrameAcked(
     QuicTime::Delta ack_delay) {
+  if (!aggregated_stream_frames_.empty() && session_notifier_ != nullptr) {
+    for (const QuicStreamFrame& aggregated : aggregated_stream_frames_) {
+      session_notifier_->OnFrameAcked(QuicFrame(aggregated), ack_delay,
+                                      /*receive_timestamp=*/QuicTime::Zero());
+    }
+    aggregated_stream_frames_.clear();
+  }
   if (aggregated_stream_frame_.stream_id == static_cast<QuicStreamId>(-1) ||
       session_notifier_ == nullptr) {
     // Aggregated stream frame is empty.
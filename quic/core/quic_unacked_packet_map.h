@@ -7,6 +7,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "absl/container/inlined_vector.h"
 #include "absl/strings/str_cat.h"
@@ -191,8 +193,8 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
                                       QuicTime receive_timestamp);
 
   // Notify the session notifier of any stream data aggregated in
-  // aggregated_stream_frame_.  No effect if the stream frame has an invalid
-  // stream id.
+  // aggregated_stream_frame_ and aggregated_stream_frames_.  No effect if the
+  // stream frame has an invalid stream id.
   void NotifyAggregatedStreamFrameAcked(QuicTime::Delta ack_delay);
 
   // Returns packet number space that |packet_number| belongs to. Please use
@@ -279,6 +281,17 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   bool IsPacketUseless(QuicPacketNumber packet_number,
                        const QuicTransmissionInfo& info) const;
 
+  // Aggregates acked |frame| with the acked data of its stream in
+  // aggregated_stream_frames_, or notifies the session notifier that it gets
+  // acked.
+  void AggregateAckedFramePerStream(const QuicFrame& frame,
+                                    QuicTime::Delta ack_delay,
+                                    QuicTime receive_timestamp);
+
+  // Deletes the retransmittable frames of |info|, and keeps the storage of
+  // the frame list for reuse by AddSentPacket.
+  void DeleteRetransmittableFrames(QuicTransmissionInfo* info);
+
   const Perspective perspective_;
 
   QuicPacketNumber largest_sent_packet_;
@@ -303,6 +316,10 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // set to nullptr.
   quiche::QuicheCircularDeque<QuicTransmissionInfo> unacked_packets_;
 
+  // Empty frame lists of removed packets, which are reused to hold the
+  // retransmittable frames of newly sent packets if |reuse_frame_lists_|.
+  std::vector<std::unique_ptr<QuicFrames>> free_frame_lists_;
+
   // The packet at the 0th index of unacked_packets_.
   QuicPacketNumber least_unacked_;
 
@@ -324,6 +341,15 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
   // by reducing the number of calls to the session notifier.
   QuicStreamFrame aggregated_stream_frame_;
 
+  // Used instead of aggregated_stream_frame_ when
+  // |aggregate_acked_stream_frames_per_stream_| is true. Aggregates acked
+  // stream data of up to kMaxAggregatedStreamFrames streams, so that acks of
+  // packets whose stream frames interleave several streams result in one
+  // notification per stream.
+  static constexpr size_t kMaxAggregatedStreamFrames = 4;
+  absl::InlinedVector<QuicStreamFrame, kMaxAggregatedStreamFrames>
+      aggregated_stream_frames_;
+
   // Receives notifications of frames being retransmitted or acknowledged.
   SessionNotifierInterface* session_notifier_;
 
@@ -332,6 +358,12 @@ class QUIC_EXPORT_PRIVATE QuicUnackedPacketMap {
 
   // Latched value of the quic_simple_inflight_time flag.
   bool simple_inflight_time_;
+
+  // Latched value of the quic_reuse_retransmittable_frame_lists flag.
+  const bool reuse_frame_lists_;
+
+  // Latched value of the quic_aggregate_acked_stream_frames_per_stream flag.
+  const bool aggregate_acked_stream_frames_per_stream_;
 };
 
 }  // namespace quic
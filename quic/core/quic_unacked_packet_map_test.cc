@@ -7,10 +7,13 @@
 #include <limits>
 
 #include "absl/base/macros.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "quic/core/frames/quic_stream_frame.h"
 #include "quic/core/quic_packet_number.h"
 #include "quic/core/quic_transmission_info.h"
 #include "quic/core/quic_utils.h"
+#include "quic/platform/api/quic_logging.h"
 #include "quic/platform/api/quic_test.h"
 #include "quic/test_tools/quic_test_utils.h"
 #include "quic/test_tools/quic_unacked_packet_map_peer.h"
@@ -577,6 +580,79 @@ TEST_P(QuicUnackedPacketMapTest, CannotAggregateAckedControlFrames) {
   unacked_packets_.NotifyAggregatedStreamFrameAcked(QuicTime::Delta::Zero());
 }
 
+MATCHER_P(IsStreamFrame, stream_frame, "") {
+  return arg.type == STREAM_FRAME && arg.stream_frame == stream_frame;
+}
+
+TEST_P(QuicUnackedPacketMapTest, AggregateAckedStreamFramesPerStream) {
+  SetQuicRestartFlag(quic_aggregate_acked_stream_frames_per_stream, true);
+  QuicUnackedPacketMap unacked_packets(GetParam());
+  unacked_packets.SetSessionNotifier(&notifier_);
+  testing::InSequence s;
+
+  // Acked packets whose stream frames interleave streams 3 and 7.
+  EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(0);
+  for (QuicStreamOffset offset = 0; offset < 400; offset += 100) {
+    QuicTransmissionInfo info;
+    info.retransmittable_frames.push_back(
+        QuicFrame(QuicStreamFrame(3, false, offset, 100)));
+    info.retransmittable_frames.push_back(
+        QuicFrame(QuicStreamFrame(7, false, offset, 100)));
+    unacked_packets.MaybeAggregateAckedStreamFrame(
+        info, QuicTime::Delta::Zero(), QuicTime::Zero());
+  }
+
+  // Verify the data of each stream is acked at once.
+  EXPECT_CALL(notifier_,
+              OnFrameAcked(IsStreamFrame(QuicStreamFrame(3, false, 0, 400)),
+                           _, _));
+  EXPECT_CALL(notifier_,
+              OnFrameAcked(IsStreamFrame(QuicStreamFrame(7, false, 0, 400)),
+                           _, _));
+  unacked_packets.NotifyAggregatedStreamFrameAcked(QuicTime::Delta::Zero());
+
+  // Verify a gap in the acked data of a stream and an acked fin stop the
+  // aggregation.
+  QuicTransmissionInfo info1;
+  info1.retransmittable_frames.push_back(
+      QuicFrame(QuicStreamFrame(3, false, 400, 100)));
+  info1.retransmittable_frames.push_back(
+      QuicFrame(QuicStreamFrame(7, false, 400, 100)));
+  QuicTransmissionInfo info2;
+  info2.retransmittable_frames.push_back(
+      QuicFrame(QuicStreamFrame(3, false, 600, 100)));
+  QuicTransmissionInfo info3;
+  info3.retransmittable_frames.push_back(
+      QuicFrame(QuicStreamFrame(3, true, 700, 0)));
+  EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(0);
+  unacked_packets.MaybeAggregateAckedStreamFrame(
+      info1, QuicTime::Delta::Zero(), QuicTime::Zero());
+  EXPECT_CALL(notifier_,
+              OnFrameAcked(IsStreamFrame(QuicStreamFrame(3, false, 400, 100)),
+                           _, _));
+  unacked_packets.MaybeAggregateAckedStreamFrame(
+      info2, QuicTime::Delta::Zero(), QuicTime::Zero());
+  EXPECT_CALL(notifier_,
+              OnFrameAcked(IsStreamFrame(QuicStreamFrame(3, true, 600, 100)),
+                           _, _));
+  unacked_packets.MaybeAggregateAckedStreamFrame(
+      info3, QuicTime::Delta::Zero(), QuicTime::Zero());
+
+  // Verify the aggregated data is acked before a control frame.
+  QuicTransmissionInfo info4;
+  QuicWindowUpdateFrame window_update(1, 5, 100);
+  info4.retransmittable_frames.push_back(QuicFrame(window_update));
+  EXPECT_CALL(notifier_,
+              OnFrameAcked(IsStreamFrame(QuicStreamFrame(7, false, 400, 100)),
+                           _, _));
+  EXPECT_CALL(notifier_, OnFrameAcked(_, _, _));
+  unacked_packets.MaybeAggregateAckedStreamFrame(
+      info4, QuicTime::Delta::Zero(), QuicTime::Zero());
+
+  EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).Times(0);
+  unacked_packets.NotifyAggregatedStreamFrameAcked(QuicTime::Delta::Zero());
+}
+
 TEST_P(QuicUnackedPacketMapTest, LargestSentPacketMultiplePacketNumberSpaces) {
   unacked_packets_.EnableMultiplePacketNumberSpacesSupport();
   EXPECT_FALSE(
@@ -694,6 +770,109 @@ TEST_P(QuicUnackedPacketMapTest, DebugString) {
       "bytes_in_flight: 1000, packets_in_flight: 1}");
 }
 
+TEST_P(QuicUnackedPacketMapTest, ReuseFrameListsOfRemovedPackets) {
+  SetQuicRestartFlag(quic_reuse_retransmittable_frame_lists, true);
+  QuicUnackedPacketMap unacked_packets(GetParam());
+  unacked_packets.SetSessionNotifier(&notifier_);
+  QuicStreamId stream_id(1);
+  for (uint64_t packet_number = 1; packet_number <= 2; ++packet_number) {
+    SerializedPacket packet(
+        CreateRetransmittablePacketForStream(packet_number, stream_id));
+    unacked_packets.AddSentPacket(&packet, NOT_RETRANSMISSION, now_, true,
+                                  true);
+    EXPECT_TRUE(packet.retransmittable_frames.empty());
+  }
+  unacked_packets.RemoveFromInFlight(QuicPacketNumber(1));
+  unacked_packets.RemoveRetransmittability(QuicPacketNumber(1));
+  unacked_packets.IncreaseLargestAcked(QuicPacketNumber(1));
+  unacked_packets.RemoveObsoletePackets();
+
+  SerializedPacket packet3(
+      CreateRetransmittablePacketForStream(3, stream_id + 4));
+  unacked_packets.AddSentPacket(&packet3, NOT_RETRANSMISSION, now_, true,
+                                true);
+  EXPECT_TRUE(unacked_packets.HasRetransmittableFrames(QuicPacketNumber(2)));
+  EXPECT_TRUE(unacked_packets.HasRetransmittableFrames(QuicPacketNumber(3)));
+  const QuicTransmissionInfo& info =
+      unacked_packets.GetTransmissionInfo(QuicPacketNumber(3));
+  ASSERT_EQ(1u, info.retransmittable_frames.size());
+  EXPECT_EQ(STREAM_FRAME, info.retransmittable_frames[0].type);
+  EXPECT_EQ(stream_id + 4,
+            info.retransmittable_frames[0].stream_frame.stream_id);
+
+  // Copies of a transmission info have their own frame list.
+  QuicTransmissionInfo copy = info;
+  copy.retransmittable_frames.push_back(QuicFrame(QuicPingFrame()));
+  EXPECT_EQ(2u, copy.retransmittable_frames.size());
+  EXPECT_EQ(1u, info.retransmittable_frames.size());
+}
+
+// Logs the cost of processing acks, and of scanning the packets in flight for
+// losses, with 1K, 10K and 100K packets in flight.
+TEST_P(QuicUnackedPacketMapTest, DISABLED_AckProcessingCost) {
+  EXPECT_CALL(notifier_, OnFrameAcked(_, _, _)).WillRepeatedly(Return(true));
+  const QuicStreamId stream_id = QuicUtils::GetFirstBidirectionalStreamId(
+      CurrentSupportedVersions()[0].transport_version, Perspective::IS_CLIENT);
+  // Each ack acknowledges this many packets.
+  const uint64_t kPacketsPerAck = 2;
+
+  for (uint64_t packets_in_flight : {1000, 10000, 100000}) {
+    QuicUnackedPacketMap unacked_packets(GetParam());
+    unacked_packets.SetSessionNotifier(&notifier_);
+    QuicStreamOffset offset = 0;
+    for (uint64_t i = 1; i <= packets_in_flight; ++i) {
+      SerializedPacket packet(
+          CreateRetransmittablePacketForStream(i, stream_id));
+      packet.retransmittable_frames[0].stream_frame.offset = offset;
+      packet.retransmittable_frames[0].stream_frame.data_length =
+          kDefaultLength;
+      offset += kDefaultLength;
+      unacked_packets.AddSentPacket(&packet, NOT_RETRANSMISSION,
+                                    now_ + QuicTime::Delta::FromMicroseconds(i),
+                                    true, true);
+    }
+
+    // Walks the packets in flight like loss detection does when no packet is
+    // lost.
+    const absl::Time scan_start = absl::Now();
+    QuicTime::Delta total_sent_time = QuicTime::Delta::Zero();
+    for (auto it = unacked_packets.begin(); it != unacked_packets.end(); ++it) {
+      if (it->in_flight && it->state == OUTSTANDING &&
+          !it->largest_acked.IsInitialized()) {
+        total_sent_time = total_sent_time + (it->sent_time - now_);
+      }
+    }
+    const absl::Duration scan_time = absl::Now() - scan_start;
+    EXPECT_LT(QuicTime::Delta::Zero(), total_sent_time);
+
+    // Acks all packets in order, like QuicSentPacketManager::OnAckFrameEnd.
+    const absl::Time ack_start = absl::Now();
+    for (uint64_t i = 1; i <= packets_in_flight; ++i) {
+      QuicPacketNumber packet_number(i);
+      QuicTransmissionInfo* info =
+          unacked_packets.GetMutableTransmissionInfo(packet_number);
+      unacked_packets.MaybeAggregateAckedStreamFrame(
+          *info, QuicTime::Delta::Zero(), QuicTime::Zero());
+      unacked_packets.RemoveFromInFlight(info);
+      unacked_packets.RemoveRetransmittability(info);
+      info->state = ACKED;
+      if (i % kPacketsPerAck == 0 || i == packets_in_flight) {
+        unacked_packets.NotifyAggregatedStreamFrameAcked(
+            QuicTime::Delta::Zero());
+        unacked_packets.IncreaseLargestAcked(packet_number);
+        unacked_packets.RemoveObsoletePackets();
+      }
+    }
+    const absl::Duration ack_time = absl::Now() - ack_start;
+    EXPECT_TRUE(unacked_packets.empty());
+
+    QUIC_LOG(INFO) << packets_in_flight << " packets in flight: loss detection "
+                   << "scan " << scan_time / packets_in_flight
+                   << " per packet, ack processing "
+                   << ack_time / packets_in_flight << " per packet";
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace quic
@@ -47,6 +47,12 @@ class MockQuicSessionVisitor : public QuicTimeWaitListManager::Visitor {
               OnConnectionAddedToTimeWaitList,
               (QuicConnectionId connection_id),
               (override));
+  MOCK_METHOD(void,
+              BuildConnectionClosePacket,
+              (const TerminationPacketTemplate& termination_template,
+               QuicConnectionId connection_id,
+               std::vector<std::unique_ptr<QuicEncryptedPacket>>* packets),
+              (override));
 };
 
 class MockQuicCryptoServerStreamHelper
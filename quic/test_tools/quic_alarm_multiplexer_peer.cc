@@ -0,0 +1,19 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/test_tools/quic_alarm_multiplexer_peer.h"
+
+namespace quic {
+
+namespace test {
+
+// static
+QuicAlarm* QuicAlarmMultiplexerPeer::GetPlatformAlarm(
+    QuicAlarmMultiplexer* multiplexer) {
+  return multiplexer->platform_alarm_.get();
+}
+
+}  // namespace test
+
+}  // namespace quic
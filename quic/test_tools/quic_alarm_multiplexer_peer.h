@@ -0,0 +1,29 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TEST_TOOLS_QUIC_ALARM_MULTIPLEXER_PEER_H_
+#define QUICHE_QUIC_TEST_TOOLS_QUIC_ALARM_MULTIPLEXER_PEER_H_
+
+#include "quic/core/quic_alarm.h"
+#include "quic/core/quic_alarm_multiplexer.h"
+
+namespace quic {
+
+namespace test {
+
+class QuicAlarmMultiplexerPeer {
+ public:
+  QuicAlarmMultiplexerPeer() = delete;
+
+  // Returns the alarm of the underlying alarm factory, or nullptr if no
+  // alarm has been set yet.  Firing it fires the multiplexed alarms which are
+  // due.
+  static QuicAlarm* GetPlatformAlarm(QuicAlarmMultiplexer* multiplexer);
+};
+
+}  // namespace test
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TEST_TOOLS_QUIC_ALARM_MULTIPLEXER_PEER_H_
@@ -189,6 +189,12 @@ QuicAlarm* QuicConnectionPeer::GetRetireSelfIssuedConnectionIdAlarm(
       connection->self_issued_cid_manager_.get());
 }
 
+// static
+QuicAlarmMultiplexer* QuicConnectionPeer::GetAlarmMultiplexer(
+    QuicConnection* connection) {
+  return connection->alarm_multiplexer_.get();
+}
+
 // static
 QuicPacketWriter* QuicConnectionPeer::GetWriter(QuicConnection* connection) {
   return connection->writer_;
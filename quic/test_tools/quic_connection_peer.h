@@ -18,6 +18,7 @@ namespace quic {
 
 struct QuicPacketHeader;
 class QuicAlarm;
+class QuicAlarmMultiplexer;
 class QuicConnectionHelperInterface;
 class QuicConnectionVisitorInterface;
 class QuicEncryptedPacket;
@@ -95,6 +96,8 @@ class QuicConnectionPeer {
       QuicConnection* connection);
   static QuicAlarm* GetRetireSelfIssuedConnectionIdAlarm(
       QuicConnection* connection);
+  // Returns nullptr if the alarms of |connection| are not multiplexed.
+  static QuicAlarmMultiplexer* GetAlarmMultiplexer(QuicConnection* connection);
 
   static QuicPacketWriter* GetWriter(QuicConnection* connection);
   // If |owns_writer| is true, takes ownership of |writer|.
@@ -117,20 +117,14 @@ std::string QuicDispatcherPeer::SelectAlpn(
 // static
 QuicSession* QuicDispatcherPeer::GetFirstSessionIfAny(
     QuicDispatcher* dispatcher) {
-  if (dispatcher->reference_counted_session_map_.empty()) {
-    return nullptr;
-  }
-  return dispatcher->reference_counted_session_map_.begin()->second.get();
+  return dispatcher->GetFirstSession();
 }
 
 // static
 const QuicSession* QuicDispatcherPeer::FindSession(
     const QuicDispatcher* dispatcher,
     QuicConnectionId id) {
-  auto it = dispatcher->reference_counted_session_map_.find(id);
-  return (it == dispatcher->reference_counted_session_map_.end())
-             ? nullptr
-             : it->second.get();
+  return dispatcher->FindSession(id);
 }
 
 // static
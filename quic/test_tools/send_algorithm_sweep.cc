@@ -0,0 +1,300 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/test_tools/send_algorithm_sweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+
+#include "absl/strings/str_cat.h"
+#include "quic/core/congestion_control/send_algorithm_interface.h"
+#include "quic/core/quic_connection.h"
+#include "quic/core/quic_connection_stats.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_thread.h"
+#include "quic/test_tools/quic_connection_peer.h"
+#include "quic/test_tools/quic_sent_packet_manager_peer.h"
+#include "quic/test_tools/quic_test_utils.h"
+#include "quic/test_tools/simulator/link.h"
+#include "quic/test_tools/simulator/quic_endpoint.h"
+#include "quic/test_tools/simulator/random_loss_filter.h"
+#include "quic/test_tools/simulator/simulator.h"
+#include "quic/test_tools/simulator/switch.h"
+
+namespace quic {
+namespace test {
+
+namespace {
+
+// Use the initial CWND of 10, as 32 is too much for small bottlenecks.
+const QuicPacketCount kInitialCwndPackets = 10;
+const QuicPacketLength kMaxPacketSize = 1350;
+// The local links are this many times faster than the bottleneck, so that
+// the queue builds at the switch.
+const int kLocalLinkSpeedup = 10;
+// Fraction of the RTT which is spent on the local links.
+const double kLocalLinkRttFraction = 0.05;
+// The interval at which the bottleneck queue is sampled.
+const QuicTime::Delta kQueueSampleInterval =
+    QuicTime::Delta::FromMilliseconds(1);
+const uint64_t kFirstConnectionId = 42;
+
+// Returns the |percentile| (in [0, 1]) of |samples|, which is reordered.
+QuicTime::Delta Percentile(std::vector<QuicTime::Delta>* samples,
+                           double percentile) {
+  if (samples->empty()) {
+    return QuicTime::Delta::Zero();
+  }
+  const size_t index = std::min(
+      samples->size() - 1, static_cast<size_t>(percentile * samples->size()));
+  std::nth_element(samples->begin(), samples->begin() + index,
+                   samples->end());
+  return (*samples)[index];
+}
+
+// Runs scenarios until there are none left.  Scenarios are taken by the
+// workers one at a time, so that slow scenarios do not hold up the others.
+class SweepWorker : public QuicThread {
+ public:
+  SweepWorker(const std::vector<SendAlgorithmSweepScenario>* scenarios,
+              std::atomic<size_t>* next_scenario,
+              std::vector<SendAlgorithmSweepResult>* results)
+      : QuicThread("SweepWorker"),
+        scenarios_(scenarios),
+        next_scenario_(next_scenario),
+        results_(results) {}
+
+  void Run() override {
+    for (size_t index = next_scenario_->fetch_add(1);
+         index < scenarios_->size(); index = next_scenario_->fetch_add(1)) {
+      (*results_)[index] = RunSendAlgorithmSweepScenario((*scenarios_)[index]);
+    }
+  }
+
+ private:
+  const std::vector<SendAlgorithmSweepScenario>* scenarios_;
+  std::atomic<size_t>* next_scenario_;
+  // Each result is written by a single worker.
+  std::vector<SendAlgorithmSweepResult>* results_;
+};
+
+}  // namespace
+
+std::vector<SendAlgorithmSweepScenario> SendAlgorithmSweepGrid::Scenarios()
+    const {
+  std::vector<SendAlgorithmSweepScenario> scenarios;
+  for (CongestionControlType type : congestion_control_types) {
+    for (QuicBandwidth bandwidth : bandwidths) {
+      for (QuicTime::Delta rtt : rtts) {
+        for (float buffer_bdp : buffer_bdps) {
+          for (float loss_rate : loss_rates) {
+            for (size_t flows : num_flows) {
+              SendAlgorithmSweepScenario scenario;
+              scenario.congestion_control_type = type;
+              scenario.bandwidth = bandwidth;
+              scenario.rtt = rtt;
+              scenario.buffer_bdp = buffer_bdp;
+              scenario.loss_rate = loss_rate;
+              scenario.num_flows = flows;
+              scenario.duration = duration;
+              scenario.random_seed = random_seed;
+              scenarios.push_back(scenario);
+            }
+          }
+        }
+      }
+    }
+  }
+  return scenarios;
+}
+
+SendAlgorithmSweepResult RunSendAlgorithmSweepScenario(
+    const SendAlgorithmSweepScenario& scenario) {
+  SimpleRandom random;
+  random.set_seed(scenario.random_seed);
+  simulator::Simulator simulator(&random);
+
+  std::vector<std::unique_ptr<simulator::QuicEndpoint>> senders;
+  std::vector<std::unique_ptr<simulator::QuicEndpoint>> receivers;
+  std::vector<simulator::QuicEndpointBase*> receiver_pointers;
+  for (size_t i = 0; i < scenario.num_flows; ++i) {
+    const std::string sender_name = absl::StrCat("Sender", i + 1);
+    const std::string receiver_name = absl::StrCat("Receiver", i + 1);
+    senders.push_back(std::make_unique<simulator::QuicEndpoint>(
+        &simulator, sender_name, receiver_name, Perspective::IS_CLIENT,
+        TestConnectionId(kFirstConnectionId + i)));
+    receivers.push_back(std::make_unique<simulator::QuicEndpoint>(
+        &simulator, receiver_name, sender_name, Perspective::IS_SERVER,
+        TestConnectionId(kFirstConnectionId + i)));
+    receiver_pointers.push_back(receivers.back().get());
+  }
+  simulator::QuicEndpointMultiplexer receiver_multiplexer(
+      "Receiver multiplexer", receiver_pointers);
+
+  const QuicTime::Delta local_link_delay =
+      scenario.rtt * (kLocalLinkRttFraction / 2);
+  const QuicTime::Delta bottleneck_link_delay =
+      scenario.rtt * 0.5 - local_link_delay;
+  const QuicByteCount queue_capacity =
+      std::max<QuicByteCount>(scenario.buffer_bdp *
+                                  (scenario.bandwidth * scenario.rtt),
+                              kMaxOutgoingPacketSize);
+  // Port 1 leads to the receivers, and the senders use the others.
+  simulator::Switch network_switch(&simulator, "Switch",
+                                   scenario.num_flows + 1, queue_capacity);
+  simulator::RandomLossFilter loss_filter(&simulator, "Loss filter",
+                                          network_switch.port(1),
+                                          scenario.loss_rate);
+  std::vector<std::unique_ptr<simulator::SymmetricLink>> links;
+  links.push_back(std::make_unique<simulator::SymmetricLink>(
+      &receiver_multiplexer, &loss_filter, scenario.bandwidth,
+      bottleneck_link_delay));
+  for (size_t i = 0; i < scenario.num_flows; ++i) {
+    links.push_back(std::make_unique<simulator::SymmetricLink>(
+        senders[i].get(), network_switch.port(i + 2),
+        scenario.bandwidth * kLocalLinkSpeedup, local_link_delay));
+  }
+
+  for (const auto& sender : senders) {
+    QuicConnection* connection = sender->connection();
+    // Ownership of the send algorithm will be overtaken by the connection.
+    QuicConnectionPeer::SetSendAlgorithm(
+        connection,
+        SendAlgorithmInterface::Create(
+            connection->clock(),
+            connection->sent_packet_manager().GetRttStats(),
+            QuicSentPacketManagerPeer::GetUnackedPacketMap(
+                QuicConnectionPeer::GetSentPacketManager(connection)),
+            scenario.congestion_control_type, &random,
+            QuicConnectionPeer::GetStats(connection), kInitialCwndPackets,
+            /*old_send_algorithm=*/nullptr));
+    connection->SetMaxPacketLength(kMaxPacketSize);
+    // More than any flow can send in the duration of the scenario.
+    sender->AddBytesToTransfer(2 * (scenario.bandwidth * scenario.duration) +
+                               kMaxOutgoingPacketSize);
+  }
+
+  std::vector<QuicTime::Delta> queueing_delays;
+  const QuicTime start_time = simulator.GetClock()->Now();
+  const QuicTime end_time = start_time + scenario.duration;
+  while (simulator.GetClock()->Now() < end_time) {
+    simulator.RunFor(
+        std::min(kQueueSampleInterval, end_time - simulator.GetClock()->Now()));
+    queueing_delays.push_back(scenario.bandwidth.TransferTime(
+        network_switch.port_queue(1)->bytes_queued()));
+  }
+
+  SendAlgorithmSweepResult result;
+  result.scenario = scenario;
+  QuicByteCount total_bytes_received = 0;
+  double sum_squared_bytes_received = 0;
+  QuicPacketCount packets_sent = 0;
+  QuicPacketCount packets_retransmitted = 0;
+  for (size_t i = 0; i < scenario.num_flows; ++i) {
+    const QuicByteCount bytes_received = receivers[i]->bytes_received();
+    total_bytes_received += bytes_received;
+    sum_squared_bytes_received +=
+        static_cast<double>(bytes_received) * bytes_received;
+    const QuicConnectionStats& stats = senders[i]->connection()->GetStats();
+    packets_sent += stats.packets_sent;
+    packets_retransmitted += stats.packets_retransmitted;
+  }
+  result.goodput = QuicBandwidth::FromBytesAndTimeDelta(total_bytes_received,
+                                                        scenario.duration);
+  result.queueing_delay_p50 = Percentile(&queueing_delays, 0.5);
+  result.queueing_delay_p99 = Percentile(&queueing_delays, 0.99);
+  if (packets_sent > 0) {
+    result.retransmission_rate =
+        static_cast<double>(packets_retransmitted) / packets_sent;
+  }
+  if (sum_squared_bytes_received > 0) {
+    result.fairness = static_cast<double>(total_bytes_received) *
+                      total_bytes_received /
+                      (scenario.num_flows * sum_squared_bytes_received);
+  }
+  QUIC_DVLOG(1) << "Scenario " << SendAlgorithmSweepName(
+                                      scenario.congestion_control_type)
+                << " " << scenario.bandwidth << " " << scenario.rtt
+                << ": goodput " << result.goodput;
+  return result;
+}
+
+std::vector<SendAlgorithmSweepResult> RunSendAlgorithmSweep(
+    const std::vector<SendAlgorithmSweepScenario>& scenarios,
+    size_t num_threads) {
+  std::vector<SendAlgorithmSweepResult> results(scenarios.size());
+  std::atomic<size_t> next_scenario(0);
+  std::vector<std::unique_ptr<SweepWorker>> workers;
+  for (size_t i = 0; i < std::max<size_t>(num_threads, 1); ++i) {
+    workers.push_back(
+        std::make_unique<SweepWorker>(&scenarios, &next_scenario, &results));
+    workers.back()->Start();
+  }
+  for (const auto& worker : workers) {
+    worker->Join();
+  }
+  return results;
+}
+
+std::string SendAlgorithmSweepName(CongestionControlType type) {
+  switch (type) {
+    case kCubicBytes:
+      return "cubic";
+    case kRenoBytes:
+      return "reno";
+    case kBBR:
+      return "bbr";
+    case kBBRv2:
+      return "bbr2";
+    case kPCC:
+      return "pcc";
+    case kGoogCC:
+      return "googcc";
+  }
+  return absl::StrCat("unknown(", static_cast<int>(type), ")");
+}
+
+bool ParseSendAlgorithmSweepName(absl::string_view name,
+                                 CongestionControlType* type) {
+  // kGoogCC is not listed, since SendAlgorithmInterface::Create() simulates it
+  // with BBR.
+  for (CongestionControlType candidate :
+       {kCubicBytes, kRenoBytes, kBBR, kBBRv2, kPCC}) {
+    if (name == SendAlgorithmSweepName(candidate)) {
+      *type = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string SendAlgorithmSweepResultsToCsv(
+    const std::vector<SendAlgorithmSweepResult>& results) {
+  std::ostringstream csv;
+  csv << "congestion_control,bandwidth_kbps,rtt_ms,buffer_bdp,loss_rate,"
+         "num_flows,duration_s,random_seed,goodput_kbps,utilization,"
+         "queueing_delay_p50_ms,queueing_delay_p99_ms,retransmission_rate,"
+         "fairness\n";
+  for (const SendAlgorithmSweepResult& result : results) {
+    const SendAlgorithmSweepScenario& scenario = result.scenario;
+    csv << SendAlgorithmSweepName(scenario.congestion_control_type) << ","
+        << scenario.bandwidth.ToKBitsPerSecond() << ","
+        << scenario.rtt.ToMicroseconds() / 1000.0 << ","
+        << scenario.buffer_bdp << "," << scenario.loss_rate << ","
+        << scenario.num_flows << "," << scenario.duration.ToSeconds() << ","
+        << scenario.random_seed << ","
+        << result.goodput.ToKBitsPerSecond() << ","
+        << static_cast<double>(result.goodput.ToBitsPerSecond()) /
+               scenario.bandwidth.ToBitsPerSecond()
+        << "," << result.queueing_delay_p50.ToMicroseconds() / 1000.0 << ","
+        << result.queueing_delay_p99.ToMicroseconds() / 1000.0 << ","
+        << result.retransmission_rate << "," << result.fairness << "\n";
+  }
+  return csv.str();
+}
+
+}  // namespace test
+}  // namespace quic
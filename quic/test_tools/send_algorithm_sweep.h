@@ -0,0 +1,109 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TEST_TOOLS_SEND_ALGORITHM_SWEEP_H_
+#define QUICHE_QUIC_TEST_TOOLS_SEND_ALGORITHM_SWEEP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "quic/core/quic_bandwidth.h"
+#include "quic/core/quic_time.h"
+#include "quic/core/quic_types.h"
+
+namespace quic {
+namespace test {
+
+// A network scenario which a send algorithm is simulated in.  All the flows
+// use the same send algorithm, and share a bottleneck link:
+//
+//     Sender 1 ... Sender N
+//          \         /     <-- local links, 10 times faster than the
+//           \       /          bottleneck
+//        Network switch
+//               *  <-- the bottleneck queue in the direction
+//               |          of the receivers
+//               *  <-- random loss
+//               |
+//               |  <-- bottleneck link
+//               |
+//     Receiver 1 ... Receiver N
+struct SendAlgorithmSweepScenario {
+  CongestionControlType congestion_control_type = kCubicBytes;
+  QuicBandwidth bandwidth = QuicBandwidth::FromKBitsPerSecond(10000);
+  // Round trip time of the path, without queueing.
+  QuicTime::Delta rtt = QuicTime::Delta::FromMilliseconds(50);
+  // Capacity of the bottleneck queue, in bandwidth-delay products.
+  float buffer_bdp = 1;
+  // Fraction of the packets to the receivers which are dropped at random.
+  float loss_rate = 0;
+  // Number of flows which compete for the bottleneck.
+  size_t num_flows = 1;
+  // How long the flows send for, in simulated time.
+  QuicTime::Delta duration = QuicTime::Delta::FromSeconds(30);
+  uint64_t random_seed = 1;
+};
+
+struct SendAlgorithmSweepResult {
+  SendAlgorithmSweepScenario scenario;
+  // Bytes received by all the receivers per unit of time.
+  QuicBandwidth goodput = QuicBandwidth::Zero();
+  // Percentiles of the queueing delay at the bottleneck, sampled
+  // periodically.
+  QuicTime::Delta queueing_delay_p50 = QuicTime::Delta::Zero();
+  QuicTime::Delta queueing_delay_p99 = QuicTime::Delta::Zero();
+  // Packets retransmitted over packets sent, by all the senders.
+  double retransmission_rate = 0;
+  // Jain's fairness index of the goodput of the flows, 1 if they all get the
+  // same share of the bottleneck.
+  double fairness = 1;
+};
+
+// The grid of a sweep.  Scenarios are generated for each combination of the
+// values.
+struct SendAlgorithmSweepGrid {
+  std::vector<CongestionControlType> congestion_control_types;
+  std::vector<QuicBandwidth> bandwidths;
+  std::vector<QuicTime::Delta> rtts;
+  std::vector<float> buffer_bdps;
+  std::vector<float> loss_rates;
+  std::vector<size_t> num_flows;
+  QuicTime::Delta duration = QuicTime::Delta::FromSeconds(30);
+  uint64_t random_seed = 1;
+
+  std::vector<SendAlgorithmSweepScenario> Scenarios() const;
+};
+
+// Simulates |scenario| and returns its result.  Thread safe, as long as no
+// QUIC flags change while it runs.  The receivers only send acks, so callers
+// need to raise FLAGS_quic_max_tracked_packet_count for long scenarios to
+// keep them from closing the connection due to too many outstanding packets.
+SendAlgorithmSweepResult RunSendAlgorithmSweepScenario(
+    const SendAlgorithmSweepScenario& scenario);
+
+// Simulates all the |scenarios| on |num_threads| threads, and returns their
+// results in the same order.
+std::vector<SendAlgorithmSweepResult> RunSendAlgorithmSweep(
+    const std::vector<SendAlgorithmSweepScenario>& scenarios,
+    size_t num_threads);
+
+// Returns the name of |type| in the CSV output, e.g. "bbr2".
+std::string SendAlgorithmSweepName(CongestionControlType type);
+
+// Parses a name returned by SendAlgorithmSweepName().  Returns false if |name|
+// is unknown, or names an algorithm which is not simulated on its own.
+bool ParseSendAlgorithmSweepName(absl::string_view name,
+                                 CongestionControlType* type);
+
+// Returns |results| as CSV, with a header line and one line per result.
+std::string SendAlgorithmSweepResultsToCsv(
+    const std::vector<SendAlgorithmSweepResult>& results);
+
+}  // namespace test
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TEST_TOOLS_SEND_ALGORITHM_SWEEP_H_
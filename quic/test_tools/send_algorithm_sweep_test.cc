@@ -0,0 +1,98 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/test_tools/send_algorithm_sweep.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "quic/platform/api/quic_flags.h"
+#include "quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+class SendAlgorithmSweepTest : public QuicTest {
+ protected:
+  SendAlgorithmSweepTest() {
+    // Prevent the receivers, which only send acks, from closing connection
+    // due to too many outstanding packets.
+    SetQuicFlag(FLAGS_quic_max_tracked_packet_count, 1000000);
+  }
+
+  SendAlgorithmSweepGrid SmallGrid() {
+    SendAlgorithmSweepGrid grid;
+    grid.congestion_control_types = {kCubicBytes, kBBRv2};
+    grid.bandwidths = {QuicBandwidth::FromKBitsPerSecond(2000)};
+    grid.rtts = {QuicTime::Delta::FromMilliseconds(20)};
+    grid.buffer_bdps = {1};
+    grid.loss_rates = {0, 0.01f};
+    grid.num_flows = {1, 2};
+    grid.duration = QuicTime::Delta::FromSeconds(5);
+    return grid;
+  }
+};
+
+TEST_F(SendAlgorithmSweepTest, Scenarios) {
+  std::vector<SendAlgorithmSweepScenario> scenarios = SmallGrid().Scenarios();
+  ASSERT_EQ(8u, scenarios.size());
+  EXPECT_EQ(kCubicBytes, scenarios.front().congestion_control_type);
+  EXPECT_EQ(kBBRv2, scenarios.back().congestion_control_type);
+  EXPECT_EQ(0.01f, scenarios.back().loss_rate);
+  EXPECT_EQ(2u, scenarios.back().num_flows);
+  EXPECT_EQ(QuicTime::Delta::FromSeconds(5), scenarios.back().duration);
+}
+
+TEST_F(SendAlgorithmSweepTest, Names) {
+  for (CongestionControlType type :
+       {kCubicBytes, kRenoBytes, kBBR, kBBRv2, kPCC}) {
+    CongestionControlType parsed;
+    ASSERT_TRUE(ParseSendAlgorithmSweepName(SendAlgorithmSweepName(type),
+                                            &parsed));
+    EXPECT_EQ(type, parsed);
+  }
+  CongestionControlType parsed;
+  EXPECT_FALSE(ParseSendAlgorithmSweepName("vegas", &parsed));
+  // GoogCC would silently run BBR.
+  EXPECT_FALSE(ParseSendAlgorithmSweepName(SendAlgorithmSweepName(kGoogCC),
+                                           &parsed));
+}
+
+TEST_F(SendAlgorithmSweepTest, RunSweep) {
+  std::vector<SendAlgorithmSweepScenario> scenarios = SmallGrid().Scenarios();
+  std::vector<SendAlgorithmSweepResult> results =
+      RunSendAlgorithmSweep(scenarios, /*num_threads=*/3);
+  ASSERT_EQ(scenarios.size(), results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    const SendAlgorithmSweepResult& result = results[i];
+    EXPECT_EQ(scenarios[i].congestion_control_type,
+              result.scenario.congestion_control_type);
+    EXPECT_EQ(scenarios[i].num_flows, result.scenario.num_flows);
+    EXPECT_LT(QuicBandwidth::Zero(), result.goodput);
+    EXPECT_GE(scenarios[i].bandwidth, result.goodput);
+    EXPECT_LE(result.queueing_delay_p50, result.queueing_delay_p99);
+    EXPECT_GT(result.fairness, 0);
+    EXPECT_LE(result.fairness, 1.0001);
+    if (scenarios[i].loss_rate > 0) {
+      EXPECT_LT(0, result.retransmission_rate);
+    }
+  }
+
+  // Scenarios are deterministic, regardless of the thread they run on.
+  SendAlgorithmSweepResult result = RunSendAlgorithmSweepScenario(scenarios[3]);
+  EXPECT_EQ(results[3].goodput, result.goodput);
+  EXPECT_EQ(results[3].queueing_delay_p99, result.queueing_delay_p99);
+
+  std::vector<std::string> lines = absl::StrSplit(
+      SendAlgorithmSweepResultsToCsv(results), '\n', absl::SkipEmpty());
+  ASSERT_EQ(results.size() + 1, lines.size());
+  EXPECT_EQ(0u, lines[0].find("congestion_control,bandwidth_kbps,rtt_ms"));
+  EXPECT_EQ(0u, lines[1].find("cubic,2000,20,1,0,1,5,1,"));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
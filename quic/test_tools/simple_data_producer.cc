@@ -52,6 +52,17 @@ WriteStreamDataResult SimpleDataProducer::WriteStreamData(
   return WRITE_FAILED;
 }
 
+bool SimpleDataProducer::GetContiguousStreamData(QuicStreamId id,
+                                                 QuicStreamOffset offset,
+                                                 QuicByteCount data_length,
+                                                 absl::string_view* data) {
+  auto iter = send_buffer_map_.find(id);
+  if (iter == send_buffer_map_.end()) {
+    return false;
+  }
+  return iter->second->GetContiguousStreamData(offset, data_length, data);
+}
+
 bool SimpleDataProducer::WriteCryptoData(EncryptionLevel level,
                                          QuicStreamOffset offset,
                                          QuicByteCount data_length,
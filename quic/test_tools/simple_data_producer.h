@@ -37,6 +37,10 @@ class SimpleDataProducer : public QuicStreamFrameDataProducer {
                                         QuicStreamOffset offset,
                                         QuicByteCount data_length,
                                         QuicDataWriter* writer) override;
+  bool GetContiguousStreamData(QuicStreamId id,
+                               QuicStreamOffset offset,
+                               QuicByteCount data_length,
+                               absl::string_view* data) override;
   bool WriteCryptoData(EncryptionLevel level,
                        QuicStreamOffset offset,
                        QuicByteCount data_length,
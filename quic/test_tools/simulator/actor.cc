@@ -11,7 +11,8 @@ namespace simulator {
 Actor::Actor(Simulator* simulator, std::string name)
     : simulator_(simulator),
       clock_(simulator->GetClock()),
-      name_(std::move(name)) {
+      name_(std::move(name)),
+      schedule_index_(kNotScheduled) {
   simulator_->AddActor(this);
 }
 
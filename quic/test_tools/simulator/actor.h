@@ -5,6 +5,8 @@
 #ifndef QUICHE_QUIC_TEST_TOOLS_SIMULATOR_ACTOR_H_
 #define QUICHE_QUIC_TEST_TOOLS_SIMULATOR_ACTOR_H_
 
+#include <cstddef>
+#include <limits>
 #include <string>
 
 #include "quic/core/quic_clock.h"
@@ -37,7 +39,7 @@ class Actor {
   // to schedule the next call manually.
   virtual void Act() = 0;
 
-  std::string name() const { return name_; }
+  const std::string& name() const { return name_; }
   Simulator* simulator() const { return simulator_; }
 
  protected:
@@ -52,6 +54,14 @@ class Actor {
   std::string name_;
 
  private:
+  friend class Simulator;
+
+  static constexpr size_t kNotScheduled = std::numeric_limits<size_t>::max();
+
+  // Position of the actor in the schedule of |simulator_|, or kNotScheduled.
+  // Maintained by the simulator, so that it never has to search for the actor.
+  size_t schedule_index_;
+
   // Since the Actor object registers itself with a simulator using a pointer to
   // itself, do not allow it to be moved.
   Actor(Actor&&) = delete;
@@ -4,6 +4,10 @@
 
 #include "quic/test_tools/simulator/packet_filter.h"
 
+#include <utility>
+
+#include "quic/test_tools/simulator/simulator.h"
+
 namespace quic {
 namespace simulator {
 
@@ -19,7 +23,9 @@ PacketFilter::~PacketFilter() {}
 void PacketFilter::AcceptPacket(std::unique_ptr<Packet> packet) {
   if (FilterPacket(*packet)) {
     output_tx_port_->AcceptPacket(std::move(packet));
+    return;
   }
+  simulator_->ReleasePacket(std::move(packet));
 }
 
 QuicTime::Delta PacketFilter::TimeUntilAvailable() {
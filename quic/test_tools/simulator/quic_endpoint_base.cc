@@ -90,10 +90,12 @@ void QuicEndpointBase::RecordTrace() {
 
 void QuicEndpointBase::AcceptPacket(std::unique_ptr<Packet> packet) {
   if (packet->destination != name_) {
+    simulator_->ReleasePacket(std::move(packet));
     return;
   }
   if (drop_next_packet_) {
     drop_next_packet_ = false;
+    simulator_->ReleasePacket(std::move(packet));
     return;
   }
 
@@ -101,6 +103,7 @@ void QuicEndpointBase::AcceptPacket(std::unique_ptr<Packet> packet) {
                                      packet->contents.size(), clock_->Now());
   connection_->ProcessUdpPacket(connection_->self_address(),
                                 connection_->peer_address(), received_packet);
+  simulator_->ReleasePacket(std::move(packet));
 }
 
 UnconstrainedPortInterface* QuicEndpointBase::GetRxPort() {
@@ -144,12 +147,12 @@ WriteResult QuicEndpointBase::Writer::WritePacket(
     return WriteResult(WRITE_STATUS_BLOCKED, 0);
   }
 
-  auto packet = std::make_unique<Packet>();
+  std::unique_ptr<Packet> packet = endpoint_->simulator()->AllocatePacket();
   packet->source = endpoint_->name();
   packet->destination = endpoint_->peer_name_;
   packet->tx_timestamp = endpoint_->clock_->Now();
 
-  packet->contents = std::string(buffer, buf_len);
+  packet->contents.assign(buffer, buf_len);
   packet->size = buf_len;
 
   endpoint_->nic_tx_queue_.AcceptPacket(std::move(packet));
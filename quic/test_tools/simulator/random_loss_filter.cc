@@ -0,0 +1,35 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/test_tools/simulator/random_loss_filter.h"
+
+#include "quic/test_tools/simulator/simulator.h"
+
+namespace quic {
+namespace simulator {
+
+namespace {
+// The granularity of the loss rate.
+const uint64_t kLossRateDenominator = 1000000;
+}  // namespace
+
+RandomLossFilter::RandomLossFilter(Simulator* simulator,
+                                   std::string name,
+                                   Endpoint* input,
+                                   float loss_rate)
+    : PacketFilter(simulator, name, input), loss_rate_(loss_rate) {}
+
+RandomLossFilter::~RandomLossFilter() {}
+
+bool RandomLossFilter::FilterPacket(const Packet& /*packet*/) {
+  if (loss_rate_ <= 0) {
+    return true;
+  }
+  return simulator_->GetRandomGenerator()->RandUint64() %
+             kLossRateDenominator >=
+         loss_rate_ * kLossRateDenominator;
+}
+
+}  // namespace simulator
+}  // namespace quic
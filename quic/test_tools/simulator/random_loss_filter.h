@@ -0,0 +1,40 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TEST_TOOLS_SIMULATOR_RANDOM_LOSS_FILTER_H_
+#define QUICHE_QUIC_TEST_TOOLS_SIMULATOR_RANDOM_LOSS_FILTER_H_
+
+#include <string>
+
+#include "quic/test_tools/simulator/packet_filter.h"
+#include "quic/test_tools/simulator/port.h"
+
+namespace quic {
+namespace simulator {
+
+// Random loss filter drops each packet passing through with a fixed
+// probability, using the random generator of the simulator.  It wraps around
+// an input port and exposes an output port.  Only the traffic from input to
+// the output is dropped.
+class RandomLossFilter : public PacketFilter {
+ public:
+  RandomLossFilter(Simulator* simulator,
+                   std::string name,
+                   Endpoint* input,
+                   float loss_rate);
+  RandomLossFilter(const RandomLossFilter&) = delete;
+  RandomLossFilter& operator=(const RandomLossFilter&) = delete;
+  ~RandomLossFilter() override;
+
+ protected:
+  bool FilterPacket(const Packet& packet) override;
+
+ private:
+  const float loss_rate_;
+};
+
+}  // namespace simulator
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TEST_TOOLS_SIMULATOR_RANDOM_LOSS_FILTER_H_
@@ -4,19 +4,34 @@
 
 #include "quic/test_tools/simulator/simulator.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "quic/core/crypto/quic_random.h"
 #include "quic/platform/api/quic_logging.h"
 
 namespace quic {
 namespace simulator {
 
+namespace {
+
+// Number of children of each node of the schedule heap.  A 4-ary heap is
+// shallower than a binary one, and the children of a node share a cache line.
+const size_t kScheduleArity = 4;
+
+// Upper bound on the number of packets kept for reuse.
+const size_t kMaxFreePackets = 4096;
+
+}  // namespace
+
 Simulator::Simulator() : Simulator(nullptr) {}
 
 Simulator::Simulator(QuicRandom* random_generator)
     : random_generator_(random_generator),
       alarm_factory_(this, "Default Alarm Manager"),
       run_for_should_stop_(false),
-      enable_random_delays_(false) {
+      enable_random_delays_(false),
+      next_sequence_number_(0) {
   run_for_alarm_.reset(
       alarm_factory_.CreateAlarm(new RunForDelegate(&run_for_should_stop_)));
 }
@@ -43,62 +58,99 @@ QuicWallTime Simulator::Clock::WallNow() const {
 }
 
 void Simulator::AddActor(Actor* actor) {
-  auto emplace_times_result =
-      scheduled_times_.insert(std::make_pair(actor, QuicTime::Infinite()));
   auto emplace_names_result = actor_names_.insert(actor->name());
 
-  // Ensure that the object was actually placed into the map.
-  QUICHE_DCHECK(emplace_times_result.second);
+  // Ensure that the object was actually placed into the set.
   QUICHE_DCHECK(emplace_names_result.second);
 }
 
 void Simulator::RemoveActor(Actor* actor) {
-  auto scheduled_time_it = scheduled_times_.find(actor);
   auto actor_names_it = actor_names_.find(actor->name());
-  QUICHE_DCHECK(scheduled_time_it != scheduled_times_.end());
   QUICHE_DCHECK(actor_names_it != actor_names_.end());
 
-  QuicTime scheduled_time = scheduled_time_it->second;
-  if (scheduled_time != QuicTime::Infinite()) {
+  if (actor->schedule_index_ != Actor::kNotScheduled) {
     Unschedule(actor);
   }
 
-  scheduled_times_.erase(scheduled_time_it);
   actor_names_.erase(actor_names_it);
 }
 
 void Simulator::Schedule(Actor* actor, QuicTime new_time) {
-  auto scheduled_time_it = scheduled_times_.find(actor);
-  QUICHE_DCHECK(scheduled_time_it != scheduled_times_.end());
-  QuicTime scheduled_time = scheduled_time_it->second;
-
-  if (scheduled_time <= new_time) {
+  size_t index = actor->schedule_index_;
+  if (index == Actor::kNotScheduled) {
+    schedule_.push_back({new_time, next_sequence_number_++, actor});
+    actor->schedule_index_ = schedule_.size() - 1;
+    SiftUp(schedule_.size() - 1);
     return;
   }
 
-  if (scheduled_time != QuicTime::Infinite()) {
-    Unschedule(actor);
+  ScheduleEntry& entry = schedule_[index];
+  if (entry.time <= new_time) {
+    return;
   }
 
-  scheduled_time_it->second = new_time;
-  schedule_.insert(std::make_pair(new_time, actor));
+  entry.time = new_time;
+  entry.sequence_number = next_sequence_number_++;
+  SiftUp(index);
 }
 
 void Simulator::Unschedule(Actor* actor) {
-  auto scheduled_time_it = scheduled_times_.find(actor);
-  QUICHE_DCHECK(scheduled_time_it != scheduled_times_.end());
-  QuicTime scheduled_time = scheduled_time_it->second;
-
-  QUICHE_DCHECK(scheduled_time != QuicTime::Infinite());
-  auto range = schedule_.equal_range(scheduled_time);
-  for (auto it = range.first; it != range.second; ++it) {
-    if (it->second == actor) {
-      schedule_.erase(it);
-      scheduled_time_it->second = QuicTime::Infinite();
-      return;
+  QUICHE_DCHECK_NE(actor->schedule_index_, Actor::kNotScheduled);
+  if (actor->schedule_index_ == Actor::kNotScheduled) {
+    return;
+  }
+  RemoveFromSchedule(actor->schedule_index_);
+}
+
+void Simulator::PlaceInSchedule(size_t index, const ScheduleEntry& entry) {
+  schedule_[index] = entry;
+  entry.actor->schedule_index_ = index;
+}
+
+void Simulator::SiftUp(size_t index) {
+  const ScheduleEntry entry = schedule_[index];
+  while (index > 0) {
+    const size_t parent = (index - 1) / kScheduleArity;
+    if (!IsEarlier(entry, schedule_[parent])) {
+      break;
+    }
+    PlaceInSchedule(index, schedule_[parent]);
+    index = parent;
+  }
+  PlaceInSchedule(index, entry);
+}
+
+void Simulator::RemoveFromSchedule(size_t index) {
+  schedule_[index].actor->schedule_index_ = Actor::kNotScheduled;
+  // Instead of moving the last entry into the hole and sifting it down, move
+  // the hole down to a leaf by promoting the earliest child at every level, and
+  // only then fill it with the last entry.  The last entry is usually one of
+  // the latest, so this saves comparing it at every level, and it rarely has to
+  // be sifted up.
+  const size_t last_index = schedule_.size() - 1;
+  while (true) {
+    const size_t first_child = index * kScheduleArity + 1;
+    if (first_child >= last_index) {
+      break;
     }
+    const size_t end_child = std::min(first_child + kScheduleArity, last_index);
+    size_t earliest_child = first_child;
+    for (size_t child = first_child + 1; child < end_child; ++child) {
+      if (IsEarlier(schedule_[child], schedule_[earliest_child])) {
+        earliest_child = child;
+      }
+    }
+    PlaceInSchedule(index, schedule_[earliest_child]);
+    index = earliest_child;
+  }
+
+  if (index != last_index) {
+    PlaceInSchedule(index, schedule_[last_index]);
+    schedule_.pop_back();
+    SiftUp(index);
+    return;
   }
-  QUICHE_DCHECK(false);
+  schedule_.pop_back();
 }
 
 const QuicClock* Simulator::GetClock() const {
@@ -121,6 +173,28 @@ QuicAlarmFactory* Simulator::GetAlarmFactory() {
   return &alarm_factory_;
 }
 
+std::unique_ptr<Packet> Simulator::AllocatePacket() {
+  if (free_packets_.empty()) {
+    return std::make_unique<Packet>();
+  }
+  std::unique_ptr<Packet> packet = std::move(free_packets_.back());
+  free_packets_.pop_back();
+  // Clearing the strings keeps their capacity.
+  packet->source.clear();
+  packet->destination.clear();
+  packet->tx_timestamp = QuicTime::Zero();
+  packet->contents.clear();
+  packet->size = 0;
+  return packet;
+}
+
+void Simulator::ReleasePacket(std::unique_ptr<Packet> packet) {
+  if (packet == nullptr || free_packets_.size() >= kMaxFreePackets) {
+    return;
+  }
+  free_packets_.push_back(std::move(packet));
+}
+
 Simulator::RunForDelegate::RunForDelegate(bool* run_for_should_stop)
     : run_for_should_stop_(run_for_should_stop) {}
 
@@ -146,13 +220,12 @@ void Simulator::RunFor(QuicTime::Delta time_span) {
 }
 
 void Simulator::HandleNextScheduledActor() {
-  const auto current_event_it = schedule_.begin();
-  QuicTime event_time = current_event_it->first;
-  Actor* actor = current_event_it->second;
+  QuicTime event_time = schedule_.front().time;
+  Actor* actor = schedule_.front().actor;
   QUIC_DVLOG(3) << "At t = " << event_time.ToDebuggingValue() << ", calling "
                 << actor->name();
 
-  Unschedule(actor);
+  RemoveFromSchedule(0);
 
   if (clock_.Now() > event_time) {
     QUIC_BUG(quic_bug_10150_1)
@@ -5,15 +5,18 @@
 #ifndef QUICHE_QUIC_TEST_TOOLS_SIMULATOR_SIMULATOR_H_
 #define QUICHE_QUIC_TEST_TOOLS_SIMULATOR_SIMULATOR_H_
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "quic/core/quic_connection.h"
 #include "quic/platform/api/quic_bug_tracker.h"
 #include "quic/platform/api/quic_containers.h"
 #include "quic/test_tools/simulator/actor.h"
 #include "quic/test_tools/simulator/alarm_factory.h"
+#include "quic/test_tools/simulator/port.h"
 #include "common/simple_buffer_allocator.h"
 
 namespace quic {
@@ -47,6 +50,15 @@ class Simulator : public QuicConnectionHelperInterface {
 
   QuicAlarmFactory* GetAlarmFactory();
 
+  // Returns an empty packet to be sent into the simulated network.  Packets
+  // passed to ReleasePacket() are reused if possible, along with the memory of
+  // their contents, so that sending a packet does not allocate.
+  std::unique_ptr<Packet> AllocatePacket();
+
+  // Recycles |packet|, which has been consumed or dropped by the network, so
+  // that it can be returned by AllocatePacket().
+  void ReleasePacket(std::unique_ptr<Packet> packet);
+
   void set_random_generator(QuicRandom* random) { random_generator_ = random; }
 
   bool enable_random_delays() const { return enable_random_delays_; }
@@ -106,6 +118,32 @@ class Simulator : public QuicConnectionHelperInterface {
   // notifies the actor.
   void HandleNextScheduledActor();
 
+  // An actor in the schedule, along with the time it is scheduled at.
+  struct ScheduleEntry {
+    QuicTime time;
+    // Orders the actors scheduled at the same time by when they were
+    // scheduled, so that they are called in that order.
+    uint64_t sequence_number;
+    Actor* actor;
+  };
+
+  // Returns true if |a| is due before |b|.
+  static bool IsEarlier(const ScheduleEntry& a, const ScheduleEntry& b) {
+    return a.time < b.time ||
+           (a.time == b.time && a.sequence_number < b.sequence_number);
+  }
+
+  // Stores |entry| at |index| of |schedule_| and updates the index of its
+  // actor.
+  void PlaceInSchedule(size_t index, const ScheduleEntry& entry);
+
+  // Restores the heap order of |schedule_| after the entry at |index| has
+  // become earlier.
+  void SiftUp(size_t index);
+
+  // Removes the entry at |index| from |schedule_|.
+  void RemoveFromSchedule(size_t index);
+
   Clock clock_;
   QuicRandom* random_generator_;
   quiche::SimpleBufferAllocator buffer_allocator_;
@@ -120,18 +158,21 @@ class Simulator : public QuicConnectionHelperInterface {
   // order to avoid synchronization issues.
   bool enable_random_delays_;
 
-  // Schedule of when the actors will be executed via an Act() call.  The
-  // schedule is subject to the following invariants:
+  // Schedule of when the actors will be executed via an Act() call, as a 4-ary
+  // min-heap ordered by IsEarlier().  Each actor knows its position in the
+  // heap, so scheduling and unscheduling never search for it.  The schedule is
+  // subject to the following invariants:
   // - An actor cannot be scheduled for a later time than it's currently in the
   //   schedule.
   // - An actor is removed from schedule either immediately before Act() is
   //   called or by explicitly calling Unschedule().
-  // - Each Actor appears in the map at most once.
-  std::multimap<QuicTime, Actor*> schedule_;
-  // For each actor, maintain the time it is scheduled at.  The value for
-  // unscheduled actors is QuicTime::Infinite().
-  absl::flat_hash_map<Actor*, QuicTime> scheduled_times_;
+  // - Each Actor appears in the heap at most once.
+  std::vector<ScheduleEntry> schedule_;
+  uint64_t next_sequence_number_;
   absl::flat_hash_set<std::string> actor_names_;
+
+  // Packets waiting to be reused by AllocatePacket().
+  std::vector<std::unique_ptr<Packet>> free_packets_;
 };
 
 template <class TerminationPredicate>
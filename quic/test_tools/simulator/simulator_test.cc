@@ -4,9 +4,15 @@
 
 #include "quic/test_tools/simulator/simulator.h"
 
+#include <algorithm>
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/container/node_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "quic/platform/api/quic_containers.h"
 #include "quic/platform/api/quic_logging.h"
 #include "quic/platform/api/quic_test.h"
@@ -68,6 +74,77 @@ TEST_F(SimulatorTest, Counters) {
   }
 }
 
+// An actor which records when it is called, and which can be scheduled from
+// the outside.
+class CallRecorder : public Actor {
+ public:
+  CallRecorder(Simulator* simulator,
+               std::string name,
+               std::vector<std::pair<QuicTime, CallRecorder*>>* calls)
+      : Actor(simulator, name), calls_(calls) {}
+
+  void Act() override { calls_->push_back({clock_->Now(), this}); }
+
+  using Actor::Schedule;
+  using Actor::Unschedule;
+
+ private:
+  std::vector<std::pair<QuicTime, CallRecorder*>>* calls_;
+};
+
+// Test that actors are called in the order of their scheduled times, and that
+// the actors scheduled at the same time are called in the order they were
+// scheduled in.
+TEST_F(SimulatorTest, ScheduleOrder) {
+  const int kNumActors = 1000;
+  Simulator simulator;
+  const QuicTime start = simulator.GetClock()->Now();
+  std::vector<std::pair<QuicTime, CallRecorder*>> calls;
+  std::vector<std::unique_ptr<CallRecorder>> recorders;
+  // The time and the sequence number of the last effective Schedule() call of
+  // each actor.
+  std::vector<std::pair<QuicTime, int>> expected(
+      kNumActors, {QuicTime::Infinite(), 0});
+  int sequence_number = 0;
+  auto schedule = [&](int i, QuicTime::Delta offset) {
+    recorders[i]->Schedule(start + offset);
+    if (start + offset < expected[i].first) {
+      expected[i] = {start + offset, sequence_number++};
+    }
+  };
+
+  for (int i = 0; i < kNumActors; ++i) {
+    recorders.push_back(std::make_unique<CallRecorder>(
+        &simulator, absl::StrCat("Recorder ", i), &calls));
+    schedule(i, QuicTime::Delta::FromMicroseconds(i * 7919 % 100));
+  }
+  for (int i = 0; i < kNumActors; i += 3) {
+    // Only the earlier times have an effect.
+    schedule(i, QuicTime::Delta::FromMicroseconds(i % 10));
+    schedule(i, QuicTime::Delta::FromMicroseconds(100));
+  }
+  for (int i = 0; i < kNumActors; i += 7) {
+    recorders[i]->Unschedule();
+    expected[i].first = QuicTime::Infinite();
+  }
+
+  std::vector<int> expected_order;
+  for (int i = 0; i < kNumActors; ++i) {
+    if (expected[i].first != QuicTime::Infinite()) {
+      expected_order.push_back(i);
+    }
+  }
+  std::sort(expected_order.begin(), expected_order.end(),
+            [&expected](int a, int b) { return expected[a] < expected[b]; });
+
+  simulator.RunUntil([]() { return false; });
+  ASSERT_EQ(expected_order.size(), calls.size());
+  for (size_t i = 0; i < calls.size(); ++i) {
+    EXPECT_EQ(expected[expected_order[i]].first, calls[i].first);
+    EXPECT_EQ(recorders[expected_order[i]].get(), calls[i].second);
+  }
+}
+
 // A port which counts the number of packets received on it, both total and
 // per-destination.
 class CounterPort : public UnconstrainedPortInterface {
@@ -125,7 +202,7 @@ class LinkSaturator : public Endpoint {
 
   void Act() override {
     if (tx_port_->TimeUntilAvailable().IsZero()) {
-      auto packet = std::make_unique<Packet>();
+      std::unique_ptr<Packet> packet = simulator_->AllocatePacket();
       packet->source = name_;
       packet->destination = destination_;
       packet->tx_timestamp = clock_->Now();
@@ -828,5 +905,81 @@ TEST_F(SimulatorTest, PacketAggregation) {
   EXPECT_EQ(0u, queue->bytes_queued());
 }
 
+// Measures how many events per second of wall time the simulator handles, with
+// |num_actors| actors which act periodically at different rates.
+TEST_F(SimulatorTest, DISABLED_EventBenchmark) {
+  for (int num_actors : {10, 1000, 100000}) {
+    Simulator simulator;
+    std::vector<std::unique_ptr<Counter>> counters;
+    for (int i = 0; i < num_actors; ++i) {
+      counters.push_back(std::make_unique<Counter>(
+          &simulator, absl::StrCat("Counter ", i),
+          QuicTime::Delta::FromMicroseconds(1000 + i % 1000)));
+    }
+
+    // Simulate about 7 million events regardless of the number of actors.
+    const QuicTime::Delta duration =
+        QuicTime::Delta::FromMicroseconds(int64_t{10000000000} / num_actors);
+    const absl::Time start = absl::Now();
+    simulator.RunFor(duration);
+    const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+    int64_t num_events = 0;
+    for (const auto& counter : counters) {
+      num_events += counter->get_value() + 1;
+    }
+    QUIC_LOG(INFO) << num_actors << " actors: " << num_events << " events in "
+                   << seconds << " s, " << num_events / seconds
+                   << " events per second";
+  }
+}
+
+// Measures the simulation speed of a dumbbell topology, in which |num_flows|
+// senders saturate their links to a switch, and share its bottleneck link to
+// the receiver.
+TEST_F(SimulatorTest, DISABLED_DumbbellBenchmark) {
+  const QuicBandwidth kAccessBandwidth =
+      QuicBandwidth::FromKBitsPerSecond(10000);
+  const QuicBandwidth kBottleneckBandwidth =
+      QuicBandwidth::FromKBitsPerSecond(1000000);
+  const QuicTime::Delta kDelay = QuicTime::Delta::FromMilliseconds(10);
+  const QuicTime::Delta kDuration = QuicTime::Delta::FromSeconds(1);
+
+  for (int num_flows : {10, 100, 1000}) {
+    Simulator simulator;
+    Switch network_switch(&simulator, "Switch", num_flows + 1,
+                          kBottleneckBandwidth * kDelay);
+    // The receiver sends a packet to itself, so that the switch learns its
+    // port and does not broadcast the packets of the senders.
+    LinkSaturator receiver(&simulator, "Receiver", 1000, "Receiver");
+    SymmetricLink bottleneck(&receiver, network_switch.port(num_flows + 1),
+                             kBottleneckBandwidth, kDelay);
+    std::vector<std::unique_ptr<LinkSaturator>> senders;
+    std::vector<std::unique_ptr<SymmetricLink>> links;
+    for (int i = 0; i < num_flows; ++i) {
+      senders.push_back(std::make_unique<LinkSaturator>(
+          &simulator, absl::StrCat("Sender ", i), 1000, "Receiver"));
+      links.push_back(std::make_unique<SymmetricLink>(
+          senders.back().get(), network_switch.port(i + 1), kAccessBandwidth,
+          kDelay));
+    }
+
+    simulator.RunFor(QuicTime::Delta::FromMicroseconds(1));
+    receiver.Pause();
+
+    const absl::Time start = absl::Now();
+    simulator.RunFor(kDuration);
+    const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+    QuicPacketCount packets_sent = 0;
+    for (const auto& sender : senders) {
+      packets_sent += sender->packets_transmitted();
+    }
+    EXPECT_LT(0u, receiver.counter()->packets());
+    QUIC_LOG(INFO) << num_flows << " flows: " << packets_sent
+                   << " packets sent and " << receiver.counter()->packets()
+                   << " received in " << seconds << " s, "
+                   << packets_sent / seconds << " packets per second";
+  }
+}
+
 }  // namespace simulator
 }  // namespace quic
@@ -6,6 +6,7 @@
 #include <utility>
 
 #include "absl/strings/str_cat.h"
+#include "quic/test_tools/simulator/simulator.h"
 #include "quic/test_tools/simulator/switch.h"
 
 namespace quic {
@@ -75,8 +76,11 @@ void Switch::DispatchPacket(SwitchPortNumber port_number,
     if (!egress_port.connected()) {
       continue;
     }
-    egress_port.EnqueuePacket(std::make_unique<Packet>(*packet));
+    std::unique_ptr<Packet> copy = source_port->simulator()->AllocatePacket();
+    *copy = *packet;
+    egress_port.EnqueuePacket(std::move(copy));
   }
+  source_port->simulator()->ReleasePacket(std::move(packet));
 }
 
 }  // namespace simulator
@@ -8,19 +8,24 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include "quic/core/crypto/quic_random.h"
+#include "quic/core/batch_writer/quic_io_uring_batch_writer.h"
 #include "quic/core/http/spdy_utils.h"
 #include "quic/core/quic_connection.h"
 #include "quic/core/quic_data_reader.h"
 #include "quic/core/quic_epoll_alarm_factory.h"
 #include "quic/core/quic_epoll_connection_helper.h"
+#include "quic/core/quic_io_uring_packet_reader.h"
 #include "quic/core/quic_packets.h"
 #include "quic/core/quic_server_id.h"
 #include "quic/core/quic_udp_socket.h"
 #include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_flag_utils.h"
+#include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_logging.h"
 #include "common/platform/api/quiche_system_event_loop.h"
 
@@ -38,7 +43,31 @@ QuicClientEpollNetworkHelper::QuicClientEpollNetworkHelper(
       overflow_supported_(false),
       packet_reader_(new QuicPacketReader()),
       client_(client),
-      max_reads_per_epoll_loop_(std::numeric_limits<int>::max()) {}
+      max_reads_per_epoll_loop_(std::numeric_limits<int>::max()),
+      io_uring_fd_(-1),
+      io_uring_write_completion_fd_(-1) {
+  if (GetQuicRestartFlag(quic_use_io_uring_for_udp)) {
+    std::unique_ptr<QuicIoUringPacketReader> io_uring_reader =
+        QuicIoUringPacketReader::Create();
+    if (io_uring_reader != nullptr) {
+      QUIC_RESTART_FLAG_COUNT_N(quic_use_io_uring_for_udp, 1, 2);
+      io_uring_fd_ = io_uring_reader->ring_fd();
+      packet_reader_ = std::move(io_uring_reader);
+      // Packets are consumed from the socket by io_uring, so completions must
+      // be watched in addition to the socket itself.
+      epoll_server_->RegisterFD(io_uring_fd_, this, EPOLLIN | EPOLLET);
+    }
+    if (QuicIoUring::IsSupported()) {
+      io_uring_write_completion_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (io_uring_write_completion_fd_ < 0) {
+        QUIC_LOG(ERROR) << "Failed to create eventfd: " << strerror(errno);
+      } else {
+        epoll_server_->RegisterFD(io_uring_write_completion_fd_, this,
+                                  EPOLLIN | EPOLLET);
+      }
+    }
+  }
+}
 
 QuicClientEpollNetworkHelper::~QuicClientEpollNetworkHelper() {
   if (client_->connected()) {
@@ -48,6 +77,15 @@ QuicClientEpollNetworkHelper::~QuicClientEpollNetworkHelper() {
   }
 
   CleanUpAllUDPSockets();
+  if (io_uring_fd_ >= 0) {
+    epoll_server_->UnregisterFD(io_uring_fd_);
+  }
+  if (io_uring_write_completion_fd_ >= 0) {
+    // Writers which outlive the helper keep their own reference to the
+    // eventfd.
+    epoll_server_->UnregisterFD(io_uring_write_completion_fd_);
+    close(io_uring_write_completion_fd_);
+  }
 }
 
 std::string QuicClientEpollNetworkHelper::Name() const {
@@ -147,6 +185,26 @@ void QuicClientEpollNetworkHelper::OnShutdown(QuicEpollServer* /*eps*/,
                                               int /*fd*/) {}
 
 void QuicClientEpollNetworkHelper::OnEvent(int fd, QuicEpollEvent* event) {
+  if (fd == io_uring_write_completion_fd_) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      QUIC_LOG_FIRST_N(ERROR, 10)
+          << "Failed to read eventfd: " << strerror(errno);
+    }
+    // Sends completed after the writer reported being write blocked.
+    if (client_->connected()) {
+      client_->writer()->SetWritable();
+      client_->session()->connection()->OnCanWrite();
+    }
+    return;
+  }
+  if (fd == io_uring_fd_) {
+    // io_uring completions are for the socket of the latest connection.
+    fd = GetLatestFD();
+    if (fd < 0) {
+      return;
+    }
+  }
   if (event->in_events & EPOLLIN) {
     QUIC_DVLOG(1) << "Read packets on EPOLLIN";
     int times_to_read = max_reads_per_epoll_loop_;
@@ -178,6 +236,16 @@ void QuicClientEpollNetworkHelper::OnEvent(int fd, QuicEpollEvent* event) {
 }
 
 QuicPacketWriter* QuicClientEpollNetworkHelper::CreateQuicPacketWriter() {
+  if (io_uring_write_completion_fd_ >= 0) {
+    std::unique_ptr<QuicIoUringBatchWriter> writer =
+        QuicIoUringBatchWriter::Create(
+            std::make_unique<QuicBatchWriterBuffer>(), GetLatestFD(),
+            io_uring_write_completion_fd_);
+    if (writer != nullptr) {
+      QUIC_RESTART_FLAG_COUNT_N(quic_use_io_uring_for_udp, 2, 2);
+      return writer.release();
+    }
+  }
   return new QuicDefaultPacketWriter(GetLatestFD());
 }
 
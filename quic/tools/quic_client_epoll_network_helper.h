@@ -128,6 +128,13 @@ class QuicClientEpollNetworkHelper : public QuicClientBase::NetworkHelper,
   QuicClientBase* client_;
 
   int max_reads_per_epoll_loop_;
+
+  // The ring fd of |packet_reader_| if it reads with io_uring, -1 otherwise.
+  int io_uring_fd_;
+
+  // The eventfd signalled when sends of an io_uring writer complete after it
+  // reported being write blocked, or -1 if writers do not use io_uring.
+  int io_uring_write_completion_fd_;
 };
 
 }  // namespace quic
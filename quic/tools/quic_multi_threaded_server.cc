@@ -0,0 +1,321 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/tools/quic_multi_threaded_server.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "quic/core/quic_connection_id_steering.h"
+#include "quic/core/quic_dispatcher.h"
+#include "quic/core/quic_packets.h"
+#include "quic/core/quic_process_packet_interface.h"
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_flags.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_mutex.h"
+#include "quic/platform/api/quic_thread.h"
+#include "quic/tools/quic_server.h"
+
+namespace quic {
+
+namespace {
+
+// Same as the number of sessions QuicServer creates per socket event.
+const size_t kNumSessionsToCreatePerQueueEvent = 16;
+
+}  // namespace
+
+// A QuicServer which processes the packets of the connections it owns, and
+// hands all other packets over to their owning worker.
+class QuicMultiThreadedServer::Worker : public QuicServer,
+                                        public ProcessPacketInterface {
+ public:
+  Worker(QuicMultiThreadedServer* server,
+         size_t index,
+         std::unique_ptr<ProofSource> proof_source,
+         QuicSimpleServerBackend* quic_simple_server_backend,
+         const ParsedQuicVersionVector& supported_versions,
+         QuicEpollServer* epoll_server)
+      : QuicServer(std::move(proof_source),
+                   quic_simple_server_backend,
+                   supported_versions,
+                   epoll_server),
+        server_(server),
+        index_(index),
+        queue_listener_(this),
+        queue_event_fd_(-1),
+        packets_processed_(0),
+        packets_forwarded_(0) {
+    set_reuse_port(true);
+  }
+
+  ~Worker() override {
+    if (queue_event_fd_ >= 0) {
+      close(queue_event_fd_);
+    }
+  }
+
+  using QuicServer::fd;
+
+  // Creates the socket, and the event fd used to signal handed over packets.
+  bool Listen(const QuicSocketAddress& address) {
+    if (!CreateUDPSocketAndListen(address)) {
+      return false;
+    }
+    queue_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (queue_event_fd_ < 0) {
+      QUIC_LOG(ERROR) << "Failed to create eventfd: " << strerror(errno);
+      return false;
+    }
+    epoll_server()->RegisterFD(queue_event_fd_, &queue_listener_,
+                               EPOLLIN | EPOLLET);
+    return true;
+  }
+
+  // From ProcessPacketInterface. Called on this worker's thread for every
+  // packet read from its socket.
+  void ProcessPacket(const QuicSocketAddress& self_address,
+                     const QuicSocketAddress& peer_address,
+                     const QuicReceivedPacket& packet) override {
+    absl::optional<size_t> owner = QuicConnectionIdSteering::GetWorkerIndex(
+        absl::string_view(packet.data(), packet.length()),
+        server_->num_workers());
+    if (!owner.has_value() || *owner == index_) {
+      packets_processed_.fetch_add(1, std::memory_order_relaxed);
+      dispatcher()->ProcessPacket(self_address, peer_address, packet);
+      return;
+    }
+    packets_forwarded_.fetch_add(1, std::memory_order_relaxed);
+    server_->workers_[*owner]->EnqueuePacket(self_address, peer_address,
+                                             packet.Clone());
+  }
+
+  // Queues |packet| to be processed by this worker. Can be called from any
+  // thread.
+  void EnqueuePacket(const QuicSocketAddress& self_address,
+                     const QuicSocketAddress& peer_address,
+                     std::unique_ptr<QuicReceivedPacket> packet) {
+    {
+      QuicWriterMutexLock lock(&queue_mutex_);
+      queue_.push_back({self_address, peer_address, std::move(packet)});
+    }
+    const uint64_t one = 1;
+    if (write(queue_event_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      QUIC_LOG_FIRST_N(ERROR, 10)
+          << "Failed to signal worker " << index_ << ": " << strerror(errno);
+    }
+  }
+
+  QuicPacketCount packets_processed() const {
+    return packets_processed_.load(std::memory_order_relaxed);
+  }
+  QuicPacketCount packets_forwarded() const {
+    return packets_forwarded_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  ProcessPacketInterface* packet_processor() override { return this; }
+
+ private:
+  struct QueuedPacket {
+    QuicSocketAddress self_address;
+    QuicSocketAddress peer_address;
+    std::unique_ptr<QuicReceivedPacket> packet;
+  };
+
+  class QueueListener : public QuicEpollCallbackInterface {
+   public:
+    explicit QueueListener(Worker* worker) : worker_(worker) {}
+
+    std::string Name() const override { return "QuicServerWorkerQueue"; }
+
+    void OnRegistration(QuicEpollServer* /*eps*/,
+                        int /*fd*/,
+                        int /*event_mask*/) override {}
+    void OnModification(int /*fd*/, int /*event_mask*/) override {}
+    void OnEvent(int /*fd*/, QuicEpollEvent* event) override {
+      worker_->OnQueueEvent(event);
+    }
+    void OnUnregistration(int /*fd*/, bool /*replaced*/) override {}
+    void OnShutdown(QuicEpollServer* /*eps*/, int /*fd*/) override {}
+
+   private:
+    Worker* worker_;
+  };
+
+  // Processes the packets handed over by other workers.
+  void OnQueueEvent(QuicEpollEvent* event) {
+    event->out_ready_mask = 0;
+    uint64_t count;
+    if (read(queue_event_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      QUIC_LOG_FIRST_N(ERROR, 10)
+          << "Failed to read eventfd: " << strerror(errno);
+    }
+
+    std::vector<QueuedPacket> packets;
+    {
+      QuicWriterMutexLock lock(&queue_mutex_);
+      packets.swap(queue_);
+    }
+
+    dispatcher()->ProcessBufferedChlos(kNumSessionsToCreatePerQueueEvent);
+    for (const QueuedPacket& queued : packets) {
+      packets_processed_.fetch_add(1, std::memory_order_relaxed);
+      dispatcher()->ProcessPacket(queued.self_address, queued.peer_address,
+                                  *queued.packet);
+    }
+    dispatcher()->FlushTimeWaitListWrites();
+    if (dispatcher()->HasChlosBuffered()) {
+      event->out_ready_mask |= EPOLLIN;
+    }
+  }
+
+  QuicMultiThreadedServer* server_;  // unowned.
+  const size_t index_;
+
+  QueueListener queue_listener_;
+  // Readable when |queue_| is not empty.
+  int queue_event_fd_;
+  QuicMutex queue_mutex_;
+  std::vector<QueuedPacket> queue_ QUIC_GUARDED_BY(queue_mutex_);
+
+  std::atomic<QuicPacketCount> packets_processed_;
+  std::atomic<QuicPacketCount> packets_forwarded_;
+};
+
+// Runs the event loop of one worker.
+class QuicMultiThreadedServer::WorkerThread : public QuicThread {
+ public:
+  WorkerThread(Worker* worker, const std::atomic<bool>* stopping)
+      : QuicThread("QuicServerWorker"), worker_(worker), stopping_(stopping) {}
+
+  void Run() override {
+    while (!stopping_->load()) {
+      worker_->WaitForEvents();
+    }
+    worker_->Shutdown();
+  }
+
+ private:
+  Worker* worker_;                    // unowned.
+  const std::atomic<bool>* stopping_;  // unowned.
+};
+
+QuicMultiThreadedServer::QuicMultiThreadedServer(
+    size_t num_workers,
+    ProofSourceFactory proof_source_factory,
+    QuicSimpleServerBackend* quic_simple_server_backend,
+    const ParsedQuicVersionVector& supported_versions)
+    : num_workers_(num_workers),
+      proof_source_factory_(std::move(proof_source_factory)),
+      quic_simple_server_backend_(quic_simple_server_backend),
+      supported_versions_(supported_versions),
+      stopping_(false),
+      shut_down_(false),
+      kernel_steering_disabled_(false),
+      kernel_steering_(false),
+      port_(0) {
+  QUICHE_DCHECK_LT(0u, num_workers_);
+  QUICHE_DCHECK(quic_simple_server_backend_);
+}
+
+QuicMultiThreadedServer::~QuicMultiThreadedServer() {
+  Shutdown();
+}
+
+bool QuicMultiThreadedServer::CreateUDPSocketAndListen(
+    const QuicSocketAddress& address) {
+  if (!workers_.empty()) {
+    QUIC_BUG(quic_bug_multi_threaded_server_listening)
+        << "Already listening on port " << port_;
+    return false;
+  }
+  if (num_workers_ > 1 &&
+      !GetQuicRestartFlag(quic_preserve_server_connection_id_first_byte)) {
+    QUIC_LOG(ERROR) << "quic_preserve_server_connection_id_first_byte is "
+                       "required to run more than one worker.";
+    return false;
+  }
+
+  QuicSocketAddress worker_address = address;
+  for (size_t i = 0; i < num_workers_; ++i) {
+    epoll_servers_.push_back(std::make_unique<QuicEpollServer>());
+    auto worker = std::make_unique<Worker>(
+        this, i, proof_source_factory_(), quic_simple_server_backend_,
+        supported_versions_, epoll_servers_.back().get());
+    if (!worker->Listen(worker_address)) {
+      return false;
+    }
+    if (i == 0) {
+      // Other workers bind to the port picked for the first one.
+      port_ = worker->port();
+      worker_address = QuicSocketAddress(address.host(), port_);
+    }
+    workers_.push_back(std::move(worker));
+  }
+
+  // The program applies to the whole reuseport group, whose sockets are
+  // indexed in bind order, i.e. by worker index.
+  if (num_workers_ > 1 && !kernel_steering_disabled_) {
+    kernel_steering_ = QuicConnectionIdSteering::AttachReusePortProgram(
+        workers_[0]->fd(), num_workers_);
+  }
+  QUIC_LOG(INFO) << "Listening on " << worker_address.ToString() << " with "
+                 << num_workers_ << " workers, steering packets "
+                 << (kernel_steering_ ? "in the kernel" : "in userspace");
+  return true;
+}
+
+void QuicMultiThreadedServer::HandleEventsForever() {
+  Start();
+  for (auto& thread : threads_) {
+    thread->Join();
+  }
+}
+
+void QuicMultiThreadedServer::Start() {
+  QUICHE_DCHECK(threads_.empty());
+  QUICHE_DCHECK_EQ(num_workers_, workers_.size());
+  for (auto& worker : workers_) {
+    threads_.push_back(std::make_unique<WorkerThread>(worker.get(), &stopping_));
+    threads_.back()->Start();
+  }
+}
+
+void QuicMultiThreadedServer::Shutdown() {
+  if (shut_down_) {
+    return;
+  }
+  shut_down_ = true;
+  if (threads_.empty()) {
+    // Workers that never ran are shut down on this thread.
+    for (auto& worker : workers_) {
+      worker->Shutdown();
+    }
+    return;
+  }
+  stopping_.store(true);
+  for (auto& thread : threads_) {
+    thread->Join();
+  }
+}
+
+QuicPacketCount QuicMultiThreadedServer::packets_processed(
+    size_t worker) const {
+  return workers_[worker]->packets_processed();
+}
+
+QuicPacketCount QuicMultiThreadedServer::packets_forwarded(
+    size_t worker) const {
+  return workers_[worker]->packets_forwarded();
+}
+
+}  // namespace quic
@@ -0,0 +1,113 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A server which runs several QuicServers, one per thread, on the same address.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_MULTI_THREADED_SERVER_H_
+#define QUICHE_QUIC_TOOLS_QUIC_MULTI_THREADED_SERVER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "quic/core/crypto/proof_source.h"
+#include "quic/core/quic_types.h"
+#include "quic/core/quic_versions.h"
+#include "quic/platform/api/quic_epoll.h"
+#include "quic/platform/api/quic_socket_address.h"
+#include "quic/tools/quic_simple_server_backend.h"
+#include "quic/tools/quic_spdy_server_base.h"
+
+namespace quic {
+
+// QuicMultiThreadedServer runs a pool of workers, each of which is a
+// QuicServer with its own thread, QuicEpollServer, dispatcher and socket. The
+// sockets are bound to the same address with SO_REUSEPORT.
+//
+// All packets of a connection must be processed by the worker that owns it,
+// including packets sent after the client migrates to a new address. Packets
+// are therefore assigned to workers by their destination connection ID, see
+// QuicConnectionIdSteering. When the kernel supports it, a reuseport BPF
+// program delivers each packet to the right socket directly. Otherwise, or
+// for packets the kernel hashed to the wrong socket, the receiving worker
+// hands the packet over to the owning worker.
+//
+// Because connections are assigned by the first byte of their connection
+// IDs, quic_restart_flag_quic_preserve_server_connection_id_first_byte must
+// be true when there is more than one worker.
+//
+// The backend is shared by all workers, so it must be thread-safe.
+class QuicMultiThreadedServer : public QuicSpdyServerBase {
+ public:
+  // Called once per worker, since proof sources are not thread-safe.
+  using ProofSourceFactory = std::function<std::unique_ptr<ProofSource>()>;
+
+  QuicMultiThreadedServer(size_t num_workers,
+                          ProofSourceFactory proof_source_factory,
+                          QuicSimpleServerBackend* quic_simple_server_backend,
+                          const ParsedQuicVersionVector& supported_versions);
+  QuicMultiThreadedServer(const QuicMultiThreadedServer&) = delete;
+  QuicMultiThreadedServer& operator=(const QuicMultiThreadedServer&) = delete;
+
+  ~QuicMultiThreadedServer() override;
+
+  // Creates and binds the sockets of all workers. Must be called before
+  // Start().
+  bool CreateUDPSocketAndListen(const QuicSocketAddress& address) override;
+
+  // Starts the workers and waits for them. Does not return.
+  void HandleEventsForever() override;
+
+  // Starts the worker threads.
+  void Start();
+
+  // Stops the worker threads. Each worker shuts down its server on its own
+  // thread before the call returns.
+  void Shutdown();
+
+  // Do not attach the reuseport BPF program, so that packets are steered
+  // between workers in userspace. Must be called before
+  // CreateUDPSocketAndListen().
+  void DisableKernelSteeringForTesting() { kernel_steering_disabled_ = true; }
+
+  // Whether the kernel steers packets to the owning worker.
+  bool kernel_steering() const { return kernel_steering_; }
+
+  int port() const { return port_; }
+
+  size_t num_workers() const { return num_workers_; }
+
+  // Number of packets processed by |worker|, and number of packets it handed
+  // over to other workers. Can be called from any thread.
+  QuicPacketCount packets_processed(size_t worker) const;
+  QuicPacketCount packets_forwarded(size_t worker) const;
+
+ private:
+  class Worker;
+  class WorkerThread;
+
+  const size_t num_workers_;
+  ProofSourceFactory proof_source_factory_;
+  QuicSimpleServerBackend* quic_simple_server_backend_;  // unowned.
+  ParsedQuicVersionVector supported_versions_;
+
+  std::vector<std::unique_ptr<QuicEpollServer>> epoll_servers_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::unique_ptr<WorkerThread>> threads_;
+
+  // Set when workers should stop processing events.
+  std::atomic<bool> stopping_;
+  bool shut_down_;
+
+  bool kernel_steering_disabled_;
+  bool kernel_steering_;
+
+  // The port all workers are listening on.
+  int port_;
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_MULTI_THREADED_SERVER_H_
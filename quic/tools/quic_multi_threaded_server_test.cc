@@ -0,0 +1,192 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/tools/quic_multi_threaded_server.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/core/quic_versions.h"
+#include "quic/platform/api/quic_flags.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_test.h"
+#include "quic/platform/api/quic_test_loopback.h"
+#include "quic/platform/api/quic_thread.h"
+#include "quic/test_tools/crypto_test_utils.h"
+#include "quic/test_tools/quic_test_client.h"
+#include "quic/tools/quic_memory_cache_backend.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const char kServerHostname[] = "test.example.com";
+const size_t kNumWorkers = 4;
+const size_t kLargeBodySize = 256 * 1024;
+
+class QuicMultiThreadedServerTest : public QuicTestWithParam<bool> {
+ protected:
+  QuicMultiThreadedServerTest() {
+    SetQuicRestartFlag(quic_preserve_server_connection_id_first_byte, true);
+    backend_.AddSimpleResponse(kServerHostname, "/small", 200, "small body");
+    backend_.AddSimpleResponse(kServerHostname, "/large", 200,
+                               std::string(kLargeBodySize, 'a'));
+  }
+
+  // Starts a server with |num_workers| workers, which steers packets in the
+  // kernel if GetParam() is true.
+  std::unique_ptr<QuicMultiThreadedServer> StartServer(size_t num_workers) {
+    auto server = std::make_unique<QuicMultiThreadedServer>(
+        num_workers, &crypto_test_utils::ProofSourceForTesting, &backend_,
+        CurrentSupportedVersionsWithTls());
+    if (!GetParam()) {
+      server->DisableKernelSteeringForTesting();
+    }
+    EXPECT_TRUE(server->CreateUDPSocketAndListen(
+        QuicSocketAddress(TestLoopback(), 0)));
+    server->Start();
+    return server;
+  }
+
+  std::unique_ptr<QuicTestClient> CreateClient(int port) {
+    auto client = std::make_unique<QuicTestClient>(
+        QuicSocketAddress(TestLoopback(), port), kServerHostname, QuicConfig(),
+        CurrentSupportedVersionsWithTls(),
+        crypto_test_utils::ProofVerifierForTesting());
+    client->Connect();
+    return client;
+  }
+
+  QuicMemoryCacheBackend backend_;
+};
+
+INSTANTIATE_TEST_SUITE_P(KernelSteering,
+                         QuicMultiThreadedServerTest,
+                         ::testing::Bool(),
+                         ::testing::PrintToStringParamName());
+
+TEST_P(QuicMultiThreadedServerTest, RequiresConnectionIdFirstBytePreserved) {
+  SetQuicRestartFlag(quic_preserve_server_connection_id_first_byte, false);
+  QuicMultiThreadedServer server(kNumWorkers,
+                                 &crypto_test_utils::ProofSourceForTesting,
+                                 &backend_, CurrentSupportedVersionsWithTls());
+  EXPECT_FALSE(
+      server.CreateUDPSocketAndListen(QuicSocketAddress(TestLoopback(), 0)));
+}
+
+TEST_P(QuicMultiThreadedServerTest, ConnectionsSpreadAcrossWorkers) {
+  std::unique_ptr<QuicMultiThreadedServer> server = StartServer(kNumWorkers);
+  for (int i = 0; i < 32; ++i) {
+    std::unique_ptr<QuicTestClient> client = CreateClient(server->port());
+    EXPECT_EQ("small body", client->SendSynchronousRequest("/small"));
+    client->Disconnect();
+  }
+  server->Shutdown();
+
+  size_t num_busy_workers = 0;
+  QuicPacketCount packets_forwarded = 0;
+  for (size_t i = 0; i < kNumWorkers; ++i) {
+    if (server->packets_processed(i) > 0) {
+      ++num_busy_workers;
+    }
+    packets_forwarded += server->packets_forwarded(i);
+  }
+  EXPECT_LT(1u, num_busy_workers);
+  if (!GetParam() || !server->kernel_steering()) {
+    // The kernel picks sockets by 4-tuple hash, so most connections are owned
+    // by a worker which did not receive their packets.
+    EXPECT_LT(0u, packets_forwarded);
+  }
+}
+
+TEST_P(QuicMultiThreadedServerTest, MigratedConnectionStaysOnWorker) {
+  std::unique_ptr<QuicMultiThreadedServer> server = StartServer(kNumWorkers);
+  std::unique_ptr<QuicTestClient> client = CreateClient(server->port());
+  EXPECT_EQ("small body", client->SendSynchronousRequest("/small"));
+
+  // Migrating to a new port changes the 4-tuple, and usually the connection
+  // ID, but not the worker owning the connection.
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(client->client()->MigrateSocket(TestLoopback()));
+    EXPECT_EQ("small body", client->SendSynchronousRequest("/small"));
+  }
+  EXPECT_TRUE(client->connected());
+  client->Disconnect();
+}
+
+// Each thread runs clients which connect and download a large response.
+class LoadThread : public QuicThread {
+ public:
+  LoadThread(int port, size_t num_connections)
+      : QuicThread("LoadThread"),
+        port_(port),
+        num_connections_(num_connections) {}
+
+  void Run() override {
+    for (size_t i = 0; i < num_connections_; ++i) {
+      QuicTestClient client(QuicSocketAddress(TestLoopback(), port_),
+                            kServerHostname, QuicConfig(),
+                            CurrentSupportedVersionsWithTls(),
+                            crypto_test_utils::ProofVerifierForTesting());
+      client.Connect();
+      if (!client.connected()) {
+        continue;
+      }
+      ++num_handshakes_;
+      bytes_received_ += client.SendSynchronousRequest("/large").size();
+      client.Disconnect();
+    }
+  }
+
+  size_t num_handshakes() const { return num_handshakes_; }
+  size_t bytes_received() const { return bytes_received_; }
+
+ private:
+  const int port_;
+  const size_t num_connections_;
+  size_t num_handshakes_ = 0;
+  size_t bytes_received_ = 0;
+};
+
+// Loopback load test reporting handshakes/sec and bytes/sec for 1, 2 and 4
+// workers.
+TEST_P(QuicMultiThreadedServerTest, DISABLED_LoopbackScaling) {
+  const size_t kNumLoadThreads = 8;
+  const size_t kConnectionsPerThread = 8;
+  for (size_t num_workers : {1u, 2u, 4u}) {
+    std::unique_ptr<QuicMultiThreadedServer> server = StartServer(num_workers);
+
+    std::vector<std::unique_ptr<LoadThread>> threads;
+    const absl::Time start = absl::Now();
+    for (size_t i = 0; i < kNumLoadThreads; ++i) {
+      threads.push_back(
+          std::make_unique<LoadThread>(server->port(), kConnectionsPerThread));
+      threads.back()->Start();
+    }
+    size_t num_handshakes = 0;
+    size_t bytes_received = 0;
+    for (auto& thread : threads) {
+      thread->Join();
+      num_handshakes += thread->num_handshakes();
+      bytes_received += thread->bytes_received();
+    }
+    const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+    server->Shutdown();
+
+    EXPECT_EQ(kNumLoadThreads * kConnectionsPerThread, num_handshakes);
+    EXPECT_EQ(num_handshakes * kLargeBodySize, bytes_received);
+    QUIC_LOG(INFO) << num_workers << " workers, "
+                   << (server->kernel_steering() ? "kernel" : "userspace")
+                   << " steering: " << num_handshakes / seconds
+                   << " handshakes/s, " << bytes_received / seconds
+                   << " bytes/s";
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
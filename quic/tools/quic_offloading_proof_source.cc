@@ -0,0 +1,243 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/tools/quic_offloading_proof_source.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "quic/platform/api/quic_bug_tracker.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_thread.h"
+
+namespace quic {
+
+// Runs QuicOffloadingProofSource::RunWorker.
+class QuicOffloadingProofSource::WorkerThread : public QuicThread {
+ public:
+  explicit WorkerThread(QuicOffloadingProofSource* proof_source)
+      : QuicThread("QuicProofSourceWorker"), proof_source_(proof_source) {}
+
+  void Run() override { proof_source_->RunWorker(); }
+
+ private:
+  QuicOffloadingProofSource* proof_source_;  // unowned.
+};
+
+// Passed to the delegate. Hands the result over to the event loop thread,
+// which runs the callback of the operation.
+class QuicOffloadingProofSource::ResultCallback : public SignatureCallback {
+ public:
+  ResultCallback(QuicOffloadingProofSource* proof_source,
+                 std::unique_ptr<Operation> operation)
+      : proof_source_(proof_source), operation_(std::move(operation)) {}
+
+  void Run(bool ok,
+           std::string signature,
+           std::unique_ptr<Details> details) override {
+    operation_->ok = ok;
+    operation_->signature = std::move(signature);
+    operation_->details = std::move(details);
+    proof_source_->OnOperationDone(std::move(operation_));
+  }
+
+ private:
+  QuicOffloadingProofSource* proof_source_;  // unowned.
+  std::unique_ptr<Operation> operation_;
+};
+
+QuicOffloadingProofSource::QuicOffloadingProofSource(
+    std::unique_ptr<ProofSource> delegate,
+    size_t num_threads)
+    : delegate_(std::move(delegate)),
+      num_threads_(num_threads),
+      work_fd_(-1),
+      completion_fd_(-1),
+      stopping_(false) {
+  QUICHE_DCHECK(delegate_);
+  QUICHE_DCHECK_LT(0u, num_threads_);
+}
+
+QuicOffloadingProofSource::~QuicOffloadingProofSource() {
+  if (!threads_.empty()) {
+    stopping_.store(true);
+    // Wake up every worker, whether idle or not.
+    const uint64_t num_threads = threads_.size();
+    if (write(work_fd_, &num_threads, sizeof(num_threads)) < 0) {
+      QUIC_LOG(ERROR) << "Failed to stop proof source workers: "
+                      << strerror(errno);
+    }
+    for (auto& thread : threads_) {
+      thread->Join();
+    }
+  }
+  if (work_fd_ >= 0) {
+    close(work_fd_);
+  }
+  if (completion_fd_ >= 0) {
+    close(completion_fd_);
+  }
+}
+
+bool QuicOffloadingProofSource::Start() {
+  if (!threads_.empty()) {
+    QUIC_BUG(quic_bug_offloading_proof_source_started)
+        << "Proof source workers already started";
+    return false;
+  }
+  // Reads from a semaphore eventfd block until its counter is non-zero, and
+  // decrement it by one, so each queued operation wakes up one worker.
+  work_fd_ = eventfd(0, EFD_SEMAPHORE | EFD_CLOEXEC);
+  if (work_fd_ < 0) {
+    QUIC_LOG(ERROR) << "Failed to create eventfd: " << strerror(errno);
+    return false;
+  }
+  completion_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (completion_fd_ < 0) {
+    QUIC_LOG(ERROR) << "Failed to create eventfd: " << strerror(errno);
+    return false;
+  }
+  for (size_t i = 0; i < num_threads_; ++i) {
+    threads_.push_back(std::make_unique<WorkerThread>(this));
+    threads_.back()->Start();
+  }
+  return true;
+}
+
+void QuicOffloadingProofSource::RunCompletedCallbacks() {
+  uint64_t count;
+  if (read(completion_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to read eventfd: " << strerror(errno);
+  }
+
+  std::vector<std::unique_ptr<Operation>> operations;
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    operations.swap(completed_operations_);
+  }
+  for (auto& operation : operations) {
+    operation->callback->Run(operation->ok, std::move(operation->signature),
+                             std::move(operation->details));
+  }
+}
+
+void QuicOffloadingProofSource::GetProof(
+    const QuicSocketAddress& server_address,
+    const QuicSocketAddress& client_address,
+    const std::string& hostname,
+    const std::string& server_config,
+    QuicTransportVersion transport_version,
+    absl::string_view chlo_hash,
+    std::unique_ptr<Callback> callback) {
+  delegate_->GetProof(server_address, client_address, hostname, server_config,
+                      transport_version, chlo_hash, std::move(callback));
+}
+
+quiche::QuicheReferenceCountedPointer<ProofSource::Chain>
+QuicOffloadingProofSource::GetCertChain(
+    const QuicSocketAddress& server_address,
+    const QuicSocketAddress& client_address,
+    const std::string& hostname,
+    bool* cert_matched_sni) {
+  return delegate_->GetCertChain(server_address, client_address, hostname,
+                                 cert_matched_sni);
+}
+
+void QuicOffloadingProofSource::ComputeTlsSignature(
+    const QuicSocketAddress& server_address,
+    const QuicSocketAddress& client_address,
+    const std::string& hostname,
+    uint16_t signature_algorithm,
+    absl::string_view in,
+    std::unique_ptr<SignatureCallback> callback) {
+  if (threads_.empty()) {
+    delegate_->ComputeTlsSignature(server_address, client_address, hostname,
+                                   signature_algorithm, in,
+                                   std::move(callback));
+    return;
+  }
+
+  auto operation = std::make_unique<Operation>();
+  operation->server_address = server_address;
+  operation->client_address = client_address;
+  operation->hostname = hostname;
+  operation->signature_algorithm = signature_algorithm;
+  operation->in = std::string(in);
+  operation->callback = std::move(callback);
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    pending_operations_.push_back(std::move(operation));
+  }
+  const uint64_t one = 1;
+  if (write(work_fd_, &one, sizeof(one)) < 0) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to signal proof source workers: " << strerror(errno);
+  }
+}
+
+absl::InlinedVector<uint16_t, 8>
+QuicOffloadingProofSource::SupportedTlsSignatureAlgorithms() const {
+  return delegate_->SupportedTlsSignatureAlgorithms();
+}
+
+ProofSource::TicketCrypter* QuicOffloadingProofSource::GetTicketCrypter() {
+  return delegate_->GetTicketCrypter();
+}
+
+void QuicOffloadingProofSource::RunWorker() {
+  while (true) {
+    uint64_t count;
+    if (read(work_fd_, &count, sizeof(count)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      QUIC_LOG_FIRST_N(ERROR, 10)
+          << "Failed to read eventfd: " << strerror(errno);
+      return;
+    }
+    if (stopping_.load()) {
+      return;
+    }
+
+    std::unique_ptr<Operation> operation;
+    {
+      QuicWriterMutexLock lock(&mutex_);
+      if (pending_operations_.empty()) {
+        continue;
+      }
+      operation = std::move(pending_operations_.front());
+      pending_operations_.pop_front();
+    }
+    // The arguments are moved out of the operation, since the event loop may
+    // destroy it as soon as the delegate runs the callback.
+    const QuicSocketAddress server_address = operation->server_address;
+    const QuicSocketAddress client_address = operation->client_address;
+    const std::string hostname = std::move(operation->hostname);
+    const uint16_t signature_algorithm = operation->signature_algorithm;
+    const std::string in = std::move(operation->in);
+    delegate_->ComputeTlsSignature(
+        server_address, client_address, hostname, signature_algorithm, in,
+        std::make_unique<ResultCallback>(this, std::move(operation)));
+  }
+}
+
+void QuicOffloadingProofSource::OnOperationDone(
+    std::unique_ptr<Operation> operation) {
+  {
+    QuicWriterMutexLock lock(&mutex_);
+    completed_operations_.push_back(std::move(operation));
+  }
+  const uint64_t one = 1;
+  if (write(completion_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    QUIC_LOG_FIRST_N(ERROR, 10)
+        << "Failed to signal computed signatures: " << strerror(errno);
+  }
+}
+
+}  // namespace quic
@@ -0,0 +1,132 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef QUICHE_QUIC_TOOLS_QUIC_OFFLOADING_PROOF_SOURCE_H_
+#define QUICHE_QUIC_TOOLS_QUIC_OFFLOADING_PROOF_SOURCE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "quic/core/crypto/proof_source.h"
+#include "quic/platform/api/quic_mutex.h"
+#include "quic/platform/api/quic_socket_address.h"
+#include "common/quiche_circular_deque.h"
+
+namespace quic {
+
+// A ProofSource which computes TLS signatures on a pool of worker threads, so
+// that the handshakes of new connections do not delay the packets of
+// established connections processed by the event loop.
+//
+// ComputeTlsSignature always completes asynchronously once the pool is
+// started: the signature is computed by the delegate on a worker thread, and
+// the callback is run on the event loop thread by RunCompletedCallbacks(),
+// when completion_fd() becomes readable. TlsServerHandshaker sees such a
+// signature as a pending ProofSourceHandle::ComputeSignature operation, and
+// resumes the handshake from OnComputeSignatureDone.
+//
+// All other operations are delegated synchronously. The delegate must allow
+// ComputeTlsSignature to be called from several threads at once, concurrently
+// with its other methods, and it must run the signature callbacks before it
+// is destroyed.
+class QuicOffloadingProofSource : public ProofSource {
+ public:
+  QuicOffloadingProofSource(std::unique_ptr<ProofSource> delegate,
+                            size_t num_threads);
+  QuicOffloadingProofSource(const QuicOffloadingProofSource&) = delete;
+  QuicOffloadingProofSource& operator=(const QuicOffloadingProofSource&) =
+      delete;
+
+  // Stops the worker threads. Callbacks of signatures which have not been run
+  // yet are destroyed without being run.
+  ~QuicOffloadingProofSource() override;
+
+  // Creates the event fds and starts the worker threads. Signatures are
+  // computed synchronously until this succeeds.
+  bool Start();
+
+  // Readable when RunCompletedCallbacks() has callbacks to run. -1 before
+  // Start().
+  int completion_fd() const { return completion_fd_; }
+
+  // Runs the callbacks of the signatures computed since the last call. Must be
+  // called on the event loop thread.
+  void RunCompletedCallbacks();
+
+  // ProofSource implementation.
+  void GetProof(const QuicSocketAddress& server_address,
+                const QuicSocketAddress& client_address,
+                const std::string& hostname,
+                const std::string& server_config,
+                QuicTransportVersion transport_version,
+                absl::string_view chlo_hash,
+                std::unique_ptr<Callback> callback) override;
+  quiche::QuicheReferenceCountedPointer<Chain> GetCertChain(
+      const QuicSocketAddress& server_address,
+      const QuicSocketAddress& client_address,
+      const std::string& hostname,
+      bool* cert_matched_sni) override;
+  void ComputeTlsSignature(
+      const QuicSocketAddress& server_address,
+      const QuicSocketAddress& client_address,
+      const std::string& hostname,
+      uint16_t signature_algorithm,
+      absl::string_view in,
+      std::unique_ptr<SignatureCallback> callback) override;
+  absl::InlinedVector<uint16_t, 8> SupportedTlsSignatureAlgorithms()
+      const override;
+  TicketCrypter* GetTicketCrypter() override;
+
+  ProofSource* delegate() { return delegate_.get(); }
+
+ private:
+  class WorkerThread;
+  class ResultCallback;
+
+  // A signature to be computed by a worker thread, and its result.
+  struct Operation {
+    QuicSocketAddress server_address;
+    QuicSocketAddress client_address;
+    std::string hostname;
+    uint16_t signature_algorithm = 0;
+    std::string in;
+    // Only accessed on the event loop thread.
+    std::unique_ptr<SignatureCallback> callback;
+
+    bool ok = false;
+    std::string signature;
+    std::unique_ptr<Details> details;
+  };
+
+  // Computes signatures until the pool is stopped. Called on worker threads.
+  void RunWorker();
+
+  // Queues |operation| for RunCompletedCallbacks(). Can be called from any
+  // thread.
+  void OnOperationDone(std::unique_ptr<Operation> operation);
+
+  std::unique_ptr<ProofSource> delegate_;
+  const size_t num_threads_;
+
+  // A semaphore counting the operations in |pending_operations_|, on which
+  // idle worker threads block.
+  int work_fd_;
+  // Readable when |completed_operations_| is not empty.
+  int completion_fd_;
+  std::atomic<bool> stopping_;
+  std::vector<std::unique_ptr<WorkerThread>> threads_;
+
+  QuicMutex mutex_;
+  quiche::QuicheCircularDeque<std::unique_ptr<Operation>> pending_operations_
+      QUIC_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<Operation>> completed_operations_
+      QUIC_GUARDED_BY(mutex_);
+};
+
+}  // namespace quic
+
+#endif  // QUICHE_QUIC_TOOLS_QUIC_OFFLOADING_PROOF_SOURCE_H_
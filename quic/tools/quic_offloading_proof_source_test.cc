@@ -0,0 +1,274 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "quic/tools/quic_offloading_proof_source.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "quic/platform/api/quic_logging.h"
+#include "quic/platform/api/quic_mutex.h"
+#include "quic/platform/api/quic_test.h"
+
+namespace quic {
+namespace test {
+namespace {
+
+const uint16_t kSignatureAlgorithm = 0x0403;  // ecdsa_secp256r1_sha256
+
+// Signs by prefixing the input, after spinning for |signature_cost|.
+class FakeSigningProofSource : public ProofSource {
+ public:
+  explicit FakeSigningProofSource(absl::Duration signature_cost)
+      : signature_cost_(signature_cost) {}
+
+  void GetProof(const QuicSocketAddress& /*server_address*/,
+                const QuicSocketAddress& /*client_address*/,
+                const std::string& /*hostname*/,
+                const std::string& /*server_config*/,
+                QuicTransportVersion /*transport_version*/,
+                absl::string_view /*chlo_hash*/,
+                std::unique_ptr<Callback> /*callback*/) override {}
+
+  quiche::QuicheReferenceCountedPointer<Chain> GetCertChain(
+      const QuicSocketAddress& /*server_address*/,
+      const QuicSocketAddress& /*client_address*/,
+      const std::string& /*hostname*/,
+      bool* cert_matched_sni) override {
+    *cert_matched_sni = true;
+    return quiche::QuicheReferenceCountedPointer<Chain>(
+        new Chain(std::vector<std::string>{"cert"}));
+  }
+
+  void ComputeTlsSignature(
+      const QuicSocketAddress& /*server_address*/,
+      const QuicSocketAddress& /*client_address*/,
+      const std::string& hostname,
+      uint16_t signature_algorithm,
+      absl::string_view in,
+      std::unique_ptr<SignatureCallback> callback) override {
+    const absl::Time end = absl::Now() + signature_cost_;
+    while (absl::Now() < end) {
+    }
+    {
+      QuicWriterMutexLock lock(&mutex_);
+      signing_threads_.push_back(std::this_thread::get_id());
+    }
+    callback->Run(signature_algorithm == kSignatureAlgorithm,
+                  absl::StrCat(hostname, ":", in), nullptr);
+  }
+
+  absl::InlinedVector<uint16_t, 8> SupportedTlsSignatureAlgorithms()
+      const override {
+    return {kSignatureAlgorithm};
+  }
+
+  TicketCrypter* GetTicketCrypter() override { return nullptr; }
+
+  std::vector<std::thread::id> signing_threads() {
+    QuicReaderMutexLock lock(&mutex_);
+    return signing_threads_;
+  }
+
+ private:
+  const absl::Duration signature_cost_;
+  QuicMutex mutex_;
+  std::vector<std::thread::id> signing_threads_ QUIC_GUARDED_BY(mutex_);
+};
+
+struct SignatureResult {
+  bool done = false;
+  bool ok = false;
+  std::string signature;
+};
+
+class SavingSignatureCallback : public ProofSource::SignatureCallback {
+ public:
+  SavingSignatureCallback(SignatureResult* result, int* num_destroyed)
+      : result_(result), num_destroyed_(num_destroyed) {}
+  ~SavingSignatureCallback() override {
+    if (num_destroyed_ != nullptr) {
+      ++*num_destroyed_;
+    }
+  }
+
+  void Run(bool ok,
+           std::string signature,
+           std::unique_ptr<ProofSource::Details> /*details*/) override {
+    result_->done = true;
+    result_->ok = ok;
+    result_->signature = std::move(signature);
+  }
+
+ private:
+  SignatureResult* result_;
+  int* num_destroyed_;
+};
+
+class QuicOffloadingProofSourceTest : public QuicTest {
+ protected:
+  QuicOffloadingProofSourceTest()
+      : delegate_(new FakeSigningProofSource(absl::ZeroDuration())),
+        proof_source_(absl::WrapUnique(delegate_), /*num_threads=*/2) {}
+
+  void ComputeSignature(const std::string& in,
+                        uint16_t signature_algorithm,
+                        SignatureResult* result,
+                        int* num_destroyed = nullptr) {
+    proof_source_.ComputeTlsSignature(
+        QuicSocketAddress(), QuicSocketAddress(), "example.org",
+        signature_algorithm, in,
+        std::make_unique<SavingSignatureCallback>(result, num_destroyed));
+  }
+
+  // Runs completed callbacks until all of |results| are done.
+  void WaitForSignatures(const std::vector<SignatureResult*>& results) {
+    const absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while (!std::all_of(results.begin(), results.end(),
+                        [](const SignatureResult* result) {
+                          return result->done;
+                        })) {
+      ASSERT_LT(absl::Now(), deadline);
+      pollfd fd = {proof_source_.completion_fd(), POLLIN, 0};
+      poll(&fd, 1, /*timeout=*/100);
+      proof_source_.RunCompletedCallbacks();
+    }
+  }
+
+  FakeSigningProofSource* delegate_;  // Owned by |proof_source_|.
+  QuicOffloadingProofSource proof_source_;
+};
+
+TEST_F(QuicOffloadingProofSourceTest, SynchronousBeforeStart) {
+  SignatureResult result;
+  ComputeSignature("data", kSignatureAlgorithm, &result);
+  EXPECT_TRUE(result.done);
+  EXPECT_TRUE(result.ok);
+  EXPECT_EQ("example.org:data", result.signature);
+  EXPECT_EQ(-1, proof_source_.completion_fd());
+
+  bool cert_matched_sni = false;
+  EXPECT_EQ(1u, proof_source_
+                    .GetCertChain(QuicSocketAddress(), QuicSocketAddress(),
+                                  "example.org", &cert_matched_sni)
+                    ->certs.size());
+  EXPECT_TRUE(cert_matched_sni);
+  EXPECT_EQ(delegate_->SupportedTlsSignatureAlgorithms(),
+            proof_source_.SupportedTlsSignatureAlgorithms());
+}
+
+TEST_F(QuicOffloadingProofSourceTest, ComputeSignaturesOnWorkerThreads) {
+  ASSERT_TRUE(proof_source_.Start());
+  SignatureResult result1;
+  SignatureResult result2;
+  ComputeSignature("data1", kSignatureAlgorithm, &result1);
+  ComputeSignature("data2", /*signature_algorithm=*/0, &result2);
+  // Callbacks are only run by RunCompletedCallbacks().
+  EXPECT_FALSE(result1.done);
+  EXPECT_FALSE(result2.done);
+
+  WaitForSignatures({&result1, &result2});
+  EXPECT_TRUE(result1.ok);
+  EXPECT_EQ("example.org:data1", result1.signature);
+  EXPECT_FALSE(result2.ok);
+  for (std::thread::id id : delegate_->signing_threads()) {
+    EXPECT_NE(std::this_thread::get_id(), id);
+  }
+}
+
+TEST_F(QuicOffloadingProofSourceTest, DestroyWithPendingSignatures) {
+  auto proof_source = std::make_unique<QuicOffloadingProofSource>(
+      std::make_unique<FakeSigningProofSource>(absl::Milliseconds(1)),
+      /*num_threads=*/1);
+  ASSERT_TRUE(proof_source->Start());
+  const int kNumSignatures = 10;
+  std::vector<SignatureResult> results(kNumSignatures);
+  int num_destroyed = 0;
+  for (SignatureResult& result : results) {
+    proof_source->ComputeTlsSignature(
+        QuicSocketAddress(), QuicSocketAddress(), "example.org",
+        kSignatureAlgorithm, "data",
+        std::make_unique<SavingSignatureCallback>(&result, &num_destroyed));
+  }
+  proof_source.reset();
+  // Callbacks are destroyed without being run.
+  EXPECT_EQ(kNumSignatures, num_destroyed);
+  for (const SignatureResult& result : results) {
+    EXPECT_FALSE(result.done);
+  }
+}
+
+// Simulates an event loop which forwards the packets of established
+// connections while a flood of CHLOs arrives, and logs the latency of the
+// established packets with signatures computed inline and offloaded.
+// Offloading only helps if the worker threads have cores of their own.
+TEST_F(QuicOffloadingProofSourceTest,
+       DISABLED_EstablishedPacketLatencyDuringChloFlood) {
+  const absl::Duration kSignatureCost = absl::Microseconds(200);
+  const absl::Duration kPacketInterval = absl::Microseconds(20);
+  const int kPacketsPerChlo = 25;
+  const int kNumPackets = 20000;
+
+  for (bool offload : {false, true}) {
+    QuicOffloadingProofSource proof_source(
+        std::make_unique<FakeSigningProofSource>(kSignatureCost),
+        /*num_threads=*/2);
+    if (offload) {
+      ASSERT_TRUE(proof_source.Start());
+    }
+    std::vector<absl::Duration> latencies;
+    latencies.reserve(kNumPackets);
+    std::vector<std::unique_ptr<SignatureResult>> results;
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < kNumPackets; ++i) {
+      const absl::Time arrival = start + kPacketInterval * i;
+      while (absl::Now() < arrival) {
+        if (offload) {
+          proof_source.RunCompletedCallbacks();
+        }
+      }
+      latencies.push_back(absl::Now() - arrival);
+      if (i % kPacketsPerChlo == 0) {
+        results.push_back(std::make_unique<SignatureResult>());
+        proof_source.ComputeTlsSignature(
+            QuicSocketAddress(), QuicSocketAddress(), "example.org",
+            kSignatureAlgorithm, "client hello",
+            std::make_unique<SavingSignatureCallback>(results.back().get(),
+                                                      nullptr));
+      }
+    }
+    std::vector<SignatureResult*> pending;
+    for (const auto& result : results) {
+      pending.push_back(result.get());
+    }
+    const absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while (!std::all_of(
+        pending.begin(), pending.end(),
+        [](const SignatureResult* result) { return result->done; })) {
+      ASSERT_LT(absl::Now(), deadline);
+      proof_source.RunCompletedCallbacks();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    QUIC_LOG(INFO) << (offload ? "Offloaded" : "Inline") << " signatures: "
+                   << results.size() << " CHLOs, established packet latency "
+                   << "p50 " << latencies[latencies.size() / 2] << ", p99 "
+                   << latencies[latencies.size() * 99 / 100] << ", max "
+                   << latencies.back();
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace quic
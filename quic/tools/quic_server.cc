@@ -9,7 +9,9 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include <cstdint>
 #include <memory>
@@ -24,10 +26,15 @@
 #include "quic/core/quic_epoll_alarm_factory.h"
 #include "quic/core/quic_epoll_clock.h"
 #include "quic/core/quic_epoll_connection_helper.h"
+#include "quic/core/batch_writer/quic_io_uring_batch_writer.h"
+#include "quic/core/batch_writer/quic_sendmmsg_batch_writer.h"
+#include "quic/core/quic_io_uring_packet_reader.h"
 #include "quic/core/quic_packet_reader.h"
 #include "quic/core/quic_packets.h"
+#include "quic/platform/api/quic_flag_utils.h"
 #include "quic/platform/api/quic_flags.h"
 #include "quic/platform/api/quic_logging.h"
+#include "quic/tools/quic_offloading_proof_source.h"
 #include "quic/tools/quic_simple_crypto_server_stream_helper.h"
 #include "quic/tools/quic_simple_dispatcher.h"
 #include "quic/tools/quic_simple_server_backend.h"
@@ -74,13 +81,17 @@ QuicServer::QuicServer(
     : epoll_server_(*epoll_server),
       port_(0),
       fd_(-1),
+      io_uring_fd_(-1),
+      io_uring_write_completion_fd_(-1),
       packets_dropped_(0),
       overflow_supported_(false),
       silent_close_(false),
+      reuse_port_(false),
+      offloading_proof_source_(nullptr),
       config_(config),
       crypto_config_(kSourceAddressTokenSecret,
                      QuicRandom::GetInstance(),
-                     std::move(proof_source),
+                     MaybeOffloadSignatures(std::move(proof_source)),
                      KeyExchangeSource::Default()),
       crypto_config_options_(crypto_config_options),
       version_manager_(supported_versions),
@@ -116,7 +127,24 @@ void QuicServer::Initialize() {
       QuicRandom::GetInstance(), &clock, crypto_config_options_));
 }
 
-QuicServer::~QuicServer() = default;
+std::unique_ptr<ProofSource> QuicServer::MaybeOffloadSignatures(
+    std::unique_ptr<ProofSource> proof_source) {
+  if (!GetQuicRestartFlag(quic_offload_handshake_signatures)) {
+    return proof_source;
+  }
+  QUIC_RESTART_FLAG_COUNT(quic_offload_handshake_signatures);
+  auto offloading_proof_source = std::make_unique<QuicOffloadingProofSource>(
+      std::move(proof_source),
+      GetQuicFlag(FLAGS_quic_handshake_signature_threads));
+  offloading_proof_source_ = offloading_proof_source.get();
+  return offloading_proof_source;
+}
+
+QuicServer::~QuicServer() {
+  // Sessions may have signatures pending in |offloading_proof_source_|, which
+  // is destroyed with |crypto_config_|.
+  dispatcher_.reset();
+}
 
 bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
   QuicUdpSocketApi socket_api;
@@ -128,8 +156,32 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
     return false;
   }
 
+  if (reuse_port_ && !socket_api.EnableReusePort(fd_)) {
+    QUIC_LOG(ERROR) << "Failed to enable SO_REUSEPORT: " << strerror(errno);
+    return false;
+  }
+
   overflow_supported_ = socket_api.EnableDroppedPacketCount(fd_);
   socket_api.EnableReceiveTimestamp(fd_);
+  if (GetQuicRestartFlag(quic_use_io_uring_for_udp)) {
+    std::unique_ptr<QuicIoUringPacketReader> io_uring_reader =
+        QuicIoUringPacketReader::Create();
+    if (io_uring_reader != nullptr) {
+      QUIC_RESTART_FLAG_COUNT_N(quic_use_io_uring_for_udp, 1, 2);
+      io_uring_fd_ = io_uring_reader->ring_fd();
+      packet_reader_ = std::move(io_uring_reader);
+    } else {
+      QUIC_LOG(WARNING) << "io_uring is not supported, using recvmmsg.";
+    }
+  }
+  if (io_uring_fd_ < 0 && GetQuicRestartFlag(quic_server_use_udp_gro)) {
+    if (socket_api.EnableUdpGro(fd_)) {
+      QUIC_RESTART_FLAG_COUNT(quic_server_use_udp_gro);
+      packet_reader_ = std::make_unique<QuicPacketReader>(/*use_udp_gro=*/true);
+    } else {
+      QUIC_LOG(WARNING) << "UDP GRO is not supported, using recvmmsg.";
+    }
+  }
 
   sockaddr_storage addr = address.generic_address();
   int rc = bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
@@ -149,13 +201,57 @@ bool QuicServer::CreateUDPSocketAndListen(const QuicSocketAddress& address) {
   }
 
   epoll_server_.RegisterFD(fd_, this, kEpollFlags);
+  if (io_uring_fd_ >= 0) {
+    // Packets are consumed from the socket by io_uring, so completions must be
+    // watched in addition to the socket itself.
+    epoll_server_.RegisterFD(io_uring_fd_, this, EPOLLIN | EPOLLET);
+  }
   dispatcher_.reset(CreateQuicDispatcher());
-  dispatcher_->InitializeWithWriter(CreateWriter(fd_));
+  if (GetQuicRestartFlag(quic_batch_time_wait_list_writes)) {
+    // Termination packets are sent to many peers, so a batch holds packets to
+    // any destination and is written with a single sendmmsg. Connections keep
+    // their own writer.
+    dispatcher_->InitializeWithWriters(
+        CreateWriter(fd_), std::make_unique<QuicSendmmsgBatchWriter>(
+                               std::make_unique<QuicBatchWriterBuffer>(), fd_));
+  } else {
+    dispatcher_->InitializeWithWriter(CreateWriter(fd_));
+  }
+
+  if (offloading_proof_source_ != nullptr) {
+    if (offloading_proof_source_->Start()) {
+      epoll_server_.RegisterFD(offloading_proof_source_->completion_fd(), this,
+                               EPOLLIN | EPOLLET);
+    } else {
+      QUIC_LOG(WARNING) << "Failed to start proof source workers, computing "
+                           "signatures on the event loop.";
+    }
+  }
 
   return true;
 }
 
 QuicPacketWriter* QuicServer::CreateWriter(int fd) {
+  if (GetQuicRestartFlag(quic_use_io_uring_for_udp) &&
+      QuicIoUring::IsSupported() && io_uring_write_completion_fd_ < 0) {
+    io_uring_write_completion_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (io_uring_write_completion_fd_ < 0) {
+      QUIC_LOG(ERROR) << "Failed to create eventfd: " << strerror(errno);
+    } else {
+      epoll_server_.RegisterFD(io_uring_write_completion_fd_, this,
+                               EPOLLIN | EPOLLET);
+    }
+  }
+  if (io_uring_write_completion_fd_ >= 0) {
+    std::unique_ptr<QuicIoUringBatchWriter> writer =
+        QuicIoUringBatchWriter::Create(
+            std::make_unique<QuicBatchWriterBuffer>(), fd,
+            io_uring_write_completion_fd_);
+    if (writer != nullptr) {
+      QUIC_RESTART_FLAG_COUNT_N(quic_use_io_uring_for_udp, 2, 2);
+      return writer.release();
+    }
+  }
   return new QuicDefaultPacketWriter(fd);
 }
 
@@ -172,6 +268,10 @@ QuicDispatcher* QuicServer::CreateQuicDispatcher() {
       quic_simple_server_backend_, expected_server_connection_id_length_);
 }
 
+ProcessPacketInterface* QuicServer::packet_processor() {
+  return dispatcher_.get();
+}
+
 void QuicServer::HandleEventsForever() {
   while (true) {
     WaitForEvents();
@@ -193,11 +293,32 @@ void QuicServer::Shutdown() {
 
   close(fd_);
   fd_ = -1;
+  io_uring_fd_ = -1;
+  if (io_uring_write_completion_fd_ >= 0) {
+    close(io_uring_write_completion_fd_);
+    io_uring_write_completion_fd_ = -1;
+  }
 }
 
 void QuicServer::OnEvent(int fd, QuicEpollEvent* event) {
-  QUICHE_DCHECK_EQ(fd, fd_);
   event->out_ready_mask = 0;
+  if (offloading_proof_source_ != nullptr &&
+      fd == offloading_proof_source_->completion_fd()) {
+    // Resume the handshakes whose signatures have been computed.
+    offloading_proof_source_->RunCompletedCallbacks();
+    return;
+  }
+  if (fd == io_uring_write_completion_fd_) {
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      QUIC_LOG_FIRST_N(ERROR, 10)
+          << "Failed to read eventfd: " << strerror(errno);
+    }
+    // Sends completed after the writer reported being write blocked.
+    dispatcher_->OnCanWrite();
+    return;
+  }
+  QUICHE_DCHECK(fd == fd_ || fd == io_uring_fd_);
 
   if (event->in_events & EPOLLIN) {
     QUIC_DVLOG(1) << "EPOLLIN";
@@ -207,9 +328,10 @@ void QuicServer::OnEvent(int fd, QuicEpollEvent* event) {
     bool more_to_read = true;
     while (more_to_read) {
       more_to_read = packet_reader_->ReadAndDispatchPackets(
-          fd_, port_, QuicEpollClock(&epoll_server_), dispatcher_.get(),
+          fd_, port_, QuicEpollClock(&epoll_server_), packet_processor(),
           overflow_supported_ ? &packets_dropped_ : nullptr);
     }
+    dispatcher_->FlushTimeWaitListWrites();
 
     if (dispatcher_->HasChlosBuffered()) {
       // Register EPOLLIN event to consume buffered CHLO(s).
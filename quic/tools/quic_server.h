@@ -32,7 +32,9 @@ namespace test {
 class QuicServerPeer;
 }  // namespace test
 
+class ProcessPacketInterface;
 class QuicDispatcher;
+class QuicOffloadingProofSource;
 class QuicPacketReader;
 
 class QuicServer : public QuicSpdyServerBase,
@@ -118,12 +120,28 @@ class QuicServer : public QuicSpdyServerBase,
     return expected_server_connection_id_length_;
   }
 
+  // If true, the listening socket is created with SO_REUSEPORT, so that
+  // multiple servers can listen on the same address. Must be called before
+  // CreateUDPSocketAndListen().
+  void set_reuse_port(bool value) { reuse_port_ = value; }
+
+  QuicUdpSocketFd fd() const { return fd_; }
+
+  // The processor packets read from the socket are handed to. Defaults to the
+  // dispatcher.
+  virtual ProcessPacketInterface* packet_processor();
+
  private:
   friend class quic::test::QuicServerPeer;
 
   // Initialize the internal state of the server.
   void Initialize();
 
+  // Wraps |proof_source| in a QuicOffloadingProofSource if
+  // quic_restart_flag_quic_offload_handshake_signatures is true.
+  std::unique_ptr<ProofSource> MaybeOffloadSignatures(
+      std::unique_ptr<ProofSource> proof_source);
+
   // Accepts data from the framer and demuxes clients to sessions.
   std::unique_ptr<QuicDispatcher> dispatcher_;
   // Frames incoming packets and hands them to the dispatcher.
@@ -135,6 +153,13 @@ class QuicServer : public QuicSpdyServerBase,
   // Listening connection.  Also used for outbound client communication.
   QuicUdpSocketFd fd_;
 
+  // The ring fd of |packet_reader_| if it reads with io_uring, -1 otherwise.
+  int io_uring_fd_;
+
+  // The eventfd signalled when sends of the io_uring writer complete after it
+  // reported being write blocked, or -1 if the writer does not use io_uring.
+  int io_uring_write_completion_fd_;
+
   // If overflow_supported_ is true this will be the number of packets dropped
   // during the lifetime of the server.  This may overflow if enough packets
   // are dropped.
@@ -148,6 +173,13 @@ class QuicServer : public QuicSpdyServerBase,
   // without sending a final connection close.
   bool silent_close_;
 
+  // If true, the listening socket is created with SO_REUSEPORT.
+  bool reuse_port_;
+
+  // Computes handshake signatures on worker threads, or nullptr if they are
+  // computed by the event loop. Owned by |crypto_config_|.
+  QuicOffloadingProofSource* offloading_proof_source_;
+
   // config_ contains non-crypto parameters that are negotiated in the crypto
   // handshake.
   QuicConfig config_;
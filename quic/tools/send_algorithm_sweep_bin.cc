@@ -0,0 +1,202 @@
+// Copyright (c) 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Simulates congestion control algorithms over a grid of network scenarios,
+// in parallel, and writes goodput, queueing delay, retransmission rate and
+// fairness of each scenario as CSV.
+//
+// Example:
+// send_algorithm_sweep --congestion_control=cubic,bbr2 \
+//     --bandwidths_kbps=1000,10000 --rtts_ms=20,100 --loss_rates=0,0.01 \
+//     --output=sweep.csv
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "quic/platform/api/quic_flags.h"
+#include "quic/test_tools/send_algorithm_sweep.h"
+#include "common/platform/api/quiche_command_line_flags.h"
+#include "common/platform/api/quiche_system_event_loop.h"
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(
+    std::string, congestion_control, "cubic,bbr,bbr2",
+    "Comma separated congestion control algorithms to simulate, out of "
+    "cubic, reno, bbr, bbr2 and pcc.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, bandwidths_kbps, "1000,10000",
+                                "Comma separated bottleneck bandwidths, in "
+                                "kbit/s.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, rtts_ms, "20,100",
+                                "Comma separated round trip times, in ms.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, buffer_bdps, "1",
+                                "Comma separated bottleneck buffer sizes, in "
+                                "bandwidth-delay products.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, loss_rates, "0,0.01",
+                                "Comma separated random loss rates.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, num_flows, "1,4",
+                                "Comma separated numbers of competing flows.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, duration_s, 30,
+                                "Simulated duration of each scenario, in "
+                                "seconds.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, random_seed, 1,
+                                "Seed of the simulations.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(int32_t, threads, 0,
+                                "Number of scenarios to simulate in parallel. "
+                                "If 0, one per core.");
+
+DEFINE_QUICHE_COMMAND_LINE_FLAG(std::string, output, "",
+                                "File to write the CSV to. If empty, the CSV "
+                                "is written to stdout.");
+
+namespace {
+
+// Parses the comma separated |value| of |flag_name| into |values| with
+// |parse|.  Prints an error and returns false if any element is invalid.
+template <typename T, typename ParseFunction>
+bool ParseList(absl::string_view flag_name,
+               absl::string_view value,
+               ParseFunction parse,
+               std::vector<T>* values) {
+  for (absl::string_view element :
+       absl::StrSplit(value, ',', absl::SkipEmpty())) {
+    T parsed;
+    if (!parse(element, &parsed)) {
+      std::cerr << "Invalid --" << flag_name << " element: " << element
+                << std::endl;
+      return false;
+    }
+    values->push_back(parsed);
+  }
+  if (values->empty()) {
+    std::cerr << "--" << flag_name << " is empty" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool ParseGrid(quic::test::SendAlgorithmSweepGrid* grid) {
+  if (!ParseList<quic::CongestionControlType>(
+          "congestion_control", GetQuicFlag(FLAGS_congestion_control),
+          quic::test::ParseSendAlgorithmSweepName,
+          &grid->congestion_control_types)) {
+    return false;
+  }
+  if (!ParseList<quic::QuicBandwidth>(
+          "bandwidths_kbps", GetQuicFlag(FLAGS_bandwidths_kbps),
+          [](absl::string_view element, quic::QuicBandwidth* bandwidth) {
+            int64_t kbps;
+            if (!absl::SimpleAtoi(element, &kbps) || kbps <= 0) {
+              return false;
+            }
+            *bandwidth = quic::QuicBandwidth::FromKBitsPerSecond(kbps);
+            return true;
+          },
+          &grid->bandwidths)) {
+    return false;
+  }
+  if (!ParseList<quic::QuicTime::Delta>(
+          "rtts_ms", GetQuicFlag(FLAGS_rtts_ms),
+          [](absl::string_view element, quic::QuicTime::Delta* rtt) {
+            double ms;
+            if (!absl::SimpleAtod(element, &ms) || ms <= 0) {
+              return false;
+            }
+            *rtt = quic::QuicTime::Delta::FromMicroseconds(ms * 1000);
+            return true;
+          },
+          &grid->rtts)) {
+    return false;
+  }
+  auto parse_non_negative = [](absl::string_view element, float* value) {
+    return absl::SimpleAtof(element, value) && *value >= 0;
+  };
+  if (!ParseList<float>("buffer_bdps", GetQuicFlag(FLAGS_buffer_bdps),
+                        parse_non_negative, &grid->buffer_bdps) ||
+      !ParseList<float>("loss_rates", GetQuicFlag(FLAGS_loss_rates),
+                        parse_non_negative, &grid->loss_rates)) {
+    return false;
+  }
+  if (!ParseList<size_t>(
+          "num_flows", GetQuicFlag(FLAGS_num_flows),
+          [](absl::string_view element, size_t* flows) {
+            return absl::SimpleAtoi(element, flows) && *flows > 0;
+          },
+          &grid->num_flows)) {
+    return false;
+  }
+  if (GetQuicFlag(FLAGS_duration_s) <= 0) {
+    std::cerr << "--duration_s must be positive" << std::endl;
+    return false;
+  }
+  grid->duration =
+      quic::QuicTime::Delta::FromSeconds(GetQuicFlag(FLAGS_duration_s));
+  grid->random_seed = GetQuicFlag(FLAGS_random_seed);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  quiche::QuicheSystemEventLoop event_loop("send_algorithm_sweep");
+  const char* usage = "Usage: send_algorithm_sweep [options]";
+  std::vector<std::string> non_option_args =
+      quiche::QuicheParseCommandLineFlags(usage, argc, argv);
+  if (!non_option_args.empty()) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    exit(0);
+  }
+
+  quic::test::SendAlgorithmSweepGrid grid;
+  if (!ParseGrid(&grid)) {
+    quiche::QuichePrintCommandLineFlagHelp(usage);
+    exit(1);
+  }
+  if (GetQuicFlag(FLAGS_threads) < 0) {
+    std::cerr << "--threads must not be negative" << std::endl;
+    exit(1);
+  }
+  size_t num_threads = GetQuicFlag(FLAGS_threads);
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Prevent the receivers, which only send acks, from closing connection due
+  // to too many outstanding packets.  Flags are set before any worker starts,
+  // as they are not thread safe.
+  SetQuicFlag(FLAGS_quic_max_tracked_packet_count, 1000000);
+
+  const std::vector<quic::test::SendAlgorithmSweepScenario> scenarios =
+      grid.Scenarios();
+  std::cerr << "Simulating " << scenarios.size() << " scenarios on "
+            << num_threads << " threads" << std::endl;
+  const std::string csv = quic::test::SendAlgorithmSweepResultsToCsv(
+      quic::test::RunSendAlgorithmSweep(scenarios, num_threads));
+
+  const std::string output = GetQuicFlag(FLAGS_output);
+  if (output.empty()) {
+    std::cout << csv;
+    return 0;
+  }
+  std::ofstream file(output);
+  file << csv;
+  if (!file) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}